@@ -26,15 +26,20 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/core/StandardFile.hpp"
 #include "CoreRender/core/FileList.hpp"
 #include "CoreRender/core/MemoryPool.hpp"
+#include "CoreRender/core/MPSCQueue.hpp"
+#include "CoreRender/core/HashMap.hpp"
+#include "CoreRender/core/Name.hpp"
 #include "CoreRender/core/ReferenceCounted.hpp"
 #include "CoreRender/core/File.hpp"
 #include "CoreRender/core/Semaphore.hpp"
 #include "CoreRender/core/Thread.hpp"
+#include "CoreRender/core/TaskScheduler.hpp"
 #include "CoreRender/core/FileSystem.hpp"
 #include "CoreRender/core/Hardware.hpp"
 #include "CoreRender/core/StandardFileSystem.hpp"
 #include "CoreRender/core/Time.hpp"
 #include "CoreRender/core/Log.hpp"
+#include "CoreRender/core/AllocationCounter.hpp"
 #include "CoreRender/math/Vector3.hpp"
 #include "CoreRender/math/Alignment.hpp"
 #include "CoreRender/math/Quaternion.hpp"
@@ -49,9 +54,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/Animation.hpp"
 #include "CoreRender/render/RenderResource.hpp"
 #include "CoreRender/render/RenderThread.hpp"
+#include "CoreRender/render/UploadThread.hpp"
 #include "CoreRender/render/RenderStats.hpp"
 #include "CoreRender/render/RenderCaps.hpp"
 #include "CoreRender/render/Shader.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
+#include "CoreRender/render/StateChanges.hpp"
 #include "CoreRender/render/VideoDriverType.hpp"
 #include "CoreRender/render/RenderContextOpenGL.hpp"
 #include "CoreRender/render/RenderContextReuseOpenGL.hpp"
@@ -62,6 +70,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/Material.hpp"
 #include "CoreRender/render/RenderTarget.hpp"
 #include "CoreRender/render/GraphicsEngine.hpp"
+#include "CoreRender/render/FrameCapture.hpp"
+#include "CoreRender/render/FrameCaptureFile.hpp"
 #include "CoreRender/render/ModelRenderable.hpp"
 
 /**
@@ -0,0 +1,63 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _CORERENDER_CORE_ALLOCATIONCOUNTER_HPP_INCLUDED_
+#define _CORERENDER_CORE_ALLOCATIONCOUNTER_HPP_INCLUDED_
+
+namespace cr
+{
+namespace core
+{
+	/**
+	 * Debugging helper which counts all heap allocations done via operator
+	 * new in the whole program. This can be used to check that a piece of
+	 * code (e.g. the frame path between GraphicsEngine::beginFrame() and
+	 * GraphicsEngine::endFrame()) does not allocate any memory on the heap:
+	 *
+	 * @code
+	 * unsigned int allocations = AllocationCounter::getCount();
+	 * // ...
+	 * if (AllocationCounter::getCount() != allocations)
+	 * 	// ...
+	 * @endcode
+	 *
+	 * Counting is only done if the library was compiled with
+	 * CORERENDER_DEBUG_ALLOCATIONS, otherwise the count always stays 0.
+	 */
+	class AllocationCounter
+	{
+		public:
+			/**
+			 * Returns whether allocations are counted.
+			 * @return True if the library was built with
+			 * CORERENDER_DEBUG_ALLOCATIONS.
+			 */
+			static bool isEnabled();
+			/**
+			 * Returns the number of heap allocations since program start.
+			 * @return Allocation count.
+			 */
+			static unsigned int getCount();
+	};
+}
+}
+
+#endif
@@ -22,47 +22,421 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef _CORERENDER_CORE_HASHMAP_HPP_INCLUDED_
 #define _CORERENDER_CORE_HASHMAP_HPP_INCLUDED_
 
-#include "Platform.hpp"
-
-#if defined(CORERENDER_MSVC)
-	#include <hash_map>
-#elif defined(CORERENDER_GCC)
-	#ifdef __GXX_EXPERIMENTAL_CXX0X__
-		#include <tr1/unordered_map>
-	#else
-		#include <ext/hash_map>
-	#endif
-namespace __gnu_cxx
+#include <string>
+#include <utility>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+namespace cr
 {
-	template<> struct hash<std::string>
+namespace core
+{
+	/**
+	 * Hash function used by HashMap. Specializations exist for integers,
+	 * pointers and strings.
+	 */
+	template<typename Key> struct Hash
+	{
+	};
+	template<> struct Hash<unsigned int>
 	{
-		size_t operator()(std::string const &s) const
+		unsigned int operator()(unsigned int key) const
 		{
-			return __stl_hash_string(s.c_str());
+			// Finalizer of MurmurHash3, the table only uses the lower bits
+			key ^= key >> 16;
+			key *= 0x85ebca6b;
+			key ^= key >> 13;
+			key *= 0xc2b2ae35;
+			key ^= key >> 16;
+			return key;
+		}
+	};
+	template<> struct Hash<int>
+	{
+		unsigned int operator()(int key) const
+		{
+			return Hash<unsigned int>()((unsigned int)key);
+		}
+	};
+	template<typename T> struct Hash<T*>
+	{
+		unsigned int operator()(T *key) const
+		{
+			unsigned long long value = (unsigned long long)(size_t)key;
+			return Hash<unsigned int>()((unsigned int)(value ^ (value >> 32)));
+		}
+	};
+	template<> struct Hash<std::string>
+	{
+		unsigned int operator()(const std::string &key) const
+		{
+			// FNV-1a
+			unsigned int hash = 2166136261u;
+			const char *data = key.data();
+			for (unsigned int i = 0; i < key.size(); i++)
+			{
+				hash ^= (unsigned char)data[i];
+				hash *= 16777619u;
+			}
+			return hash;
 		}
 	};
-}
-#else
-	#include <map>
-#endif
 
-namespace cr
-{
-namespace core
-{
-	template<typename Key, typename Value> struct HashMap
+	/**
+	 * Hash map with open addressing which stores all entries in one
+	 * contiguous array.
+	 *
+	 * The entries are kept densely packed in insertion order (erasing moves
+	 * the last entry into the gap), and a separate power-of-two table of
+	 * (hash, index) pairs is probed linearly to find them. Maps with up to
+	 * InlineCapacity entries store them inside the object and do not use a
+	 * table at all, lookups then just compare the keys of all entries. This
+	 * makes small maps free of heap allocations and makes copying any map a
+	 * single pass over two arrays.
+	 *
+	 * The interface follows std::map, but iterators are plain pointers to
+	 * the entries and are invalidated by any insertion or erasure. The key
+	 * of an entry must not be modified through an iterator.
+	 *
+	 * @tparam Key Key type, Hash<Key> has to be defined unless a custom hash
+	 * function is passed.
+	 * @tparam Value Value type, only has to be default constructible if
+	 * operator[] is used.
+	 * @tparam InlineCapacity Number of entries stored without allocating
+	 * memory.
+	 */
+	template<typename Key, typename Value, unsigned int InlineCapacity = 4,
+	         typename HashFunction = Hash<Key> >
+	class HashMap
 	{
-#if defined(CORERENDER_MSVC)
-		typedef std::hash_map<Key, Value> Type;
-#elif defined(CORERENDER_GCC)
-	#ifdef __GXX_EXPERIMENTAL_CXX0X__
-		typedef _std::tr1::unordered_map<Key, Value> Type;
-	#else
-		typedef __gnu_cxx::hash_map<Key, Value> Type;
-	#endif
-#else
-		typedef std::map<Key, Value> Type;
-#endif
+		public:
+			typedef std::pair<Key, Value> value_type;
+			typedef value_type *iterator;
+			typedef const value_type *const_iterator;
+
+			HashMap()
+				: entries(getInlineEntries()), count(0),
+				capacity(InlineCapacity), buckets(0), mask(0)
+			{
+			}
+			HashMap(const HashMap &other)
+				: entries(getInlineEntries()), count(0),
+				capacity(InlineCapacity), buckets(0), mask(0)
+			{
+				copy(other);
+			}
+			~HashMap()
+			{
+				clear();
+				freeStorage();
+			}
+
+			HashMap &operator=(const HashMap &other)
+			{
+				if (&other == this)
+					return *this;
+				clear();
+				copy(other);
+				return *this;
+			}
+
+			iterator begin()
+			{
+				return entries;
+			}
+			iterator end()
+			{
+				return entries + count;
+			}
+			const_iterator begin() const
+			{
+				return entries;
+			}
+			const_iterator end() const
+			{
+				return entries + count;
+			}
+
+			unsigned int size() const
+			{
+				return count;
+			}
+			bool empty() const
+			{
+				return count == 0;
+			}
+
+			iterator find(const Key &key)
+			{
+				return entries + findIndex(key, HashFunction()(key));
+			}
+			const_iterator find(const Key &key) const
+			{
+				return entries + findIndex(key, HashFunction()(key));
+			}
+
+			/**
+			 * Inserts an entry if no entry with the same key exists.
+			 * @param entry Key and value of the new entry.
+			 * @return Iterator to the entry with the key and true if the
+			 * entry was inserted, false if an entry already existed.
+			 */
+			std::pair<iterator, bool> insert(const value_type &entry)
+			{
+				unsigned int hash = HashFunction()(entry.first);
+				unsigned int index = findIndex(entry.first, hash);
+				if (index != count)
+					return std::make_pair(entries + index, false);
+				append(entry, hash);
+				return std::make_pair(entries + count - 1, true);
+			}
+			/**
+			 * Returns the value for the key, inserting a default constructed
+			 * value if no entry with the key exists.
+			 */
+			Value &operator[](const Key &key)
+			{
+				unsigned int hash = HashFunction()(key);
+				unsigned int index = findIndex(key, hash);
+				if (index != count)
+					return entries[index].second;
+				append(value_type(key, Value()), hash);
+				return entries[count - 1].second;
+			}
+
+			/**
+			 * Removes an entry. The last entry is moved into its place.
+			 * @param it Entry to remove.
+			 * @return Iterator to the entry now occupying the position, so
+			 * that loops which erase entries can continue with it.
+			 */
+			iterator erase(iterator it)
+			{
+				unsigned int index = it - entries;
+				assert(index < count);
+				unsigned int last = count - 1;
+				if (buckets)
+				{
+					removeBucket(findBucket(index, HashFunction()(it->first)));
+					if (index != last)
+					{
+						unsigned int hash = HashFunction()(entries[last].first);
+						buckets[findBucket(last, hash)].index = index + 1;
+					}
+				}
+				// Values might not assign all of their state (Uniform does
+				// not), so the last entry is copy constructed instead
+				entries[index].~value_type();
+				if (index != last)
+				{
+					new(entries + index) value_type(entries[last]);
+					entries[last].~value_type();
+				}
+				count--;
+				return it;
+			}
+			/**
+			 * Removes the entry with the key if it exists.
+			 * @return Number of removed entries.
+			 */
+			unsigned int erase(const Key &key)
+			{
+				iterator it = find(key);
+				if (it == end())
+					return 0;
+				erase(it);
+				return 1;
+			}
+
+			/**
+			 * Removes all entries. Allocated memory is kept for reuse.
+			 */
+			void clear()
+			{
+				for (unsigned int i = 0; i < count; i++)
+					entries[i].~value_type();
+				count = 0;
+				if (buckets)
+					memset(buckets, 0, (mask + 1) * sizeof(Bucket));
+			}
+
+			void swap(HashMap &other)
+			{
+				HashMap tmp(*this);
+				*this = other;
+				other = tmp;
+			}
+		private:
+			/**
+			 * Slot in the lookup table. Index is the entry index plus one,
+			 * 0 marks empty slots. The hash is stored to skip most key
+			 * comparisons and to rebuild the table without rehashing.
+			 */
+			struct Bucket
+			{
+				unsigned int index;
+				unsigned int hash;
+			};
+
+			value_type *getInlineEntries()
+			{
+				return (value_type*)inlinestorage.data;
+			}
+
+			unsigned int findIndex(const Key &key, unsigned int hash) const
+			{
+				if (!buckets)
+				{
+					for (unsigned int i = 0; i < count; i++)
+					{
+						if (entries[i].first == key)
+							return i;
+					}
+					return count;
+				}
+				unsigned int slot = hash & mask;
+				while (buckets[slot].index != 0)
+				{
+					if (buckets[slot].hash == hash
+					 && entries[buckets[slot].index - 1].first == key)
+						return buckets[slot].index - 1;
+					slot = (slot + 1) & mask;
+				}
+				return count;
+			}
+			unsigned int findBucket(unsigned int index, unsigned int hash) const
+			{
+				unsigned int slot = hash & mask;
+				while (buckets[slot].index != index + 1)
+					slot = (slot + 1) & mask;
+				return slot;
+			}
+			void insertBucket(unsigned int index, unsigned int hash)
+			{
+				unsigned int slot = hash & mask;
+				while (buckets[slot].index != 0)
+					slot = (slot + 1) & mask;
+				buckets[slot].index = index + 1;
+				buckets[slot].hash = hash;
+			}
+			void removeBucket(unsigned int hole)
+			{
+				// Backward shift deletion, moves later entries of the probe
+				// sequence into the hole so that no tombstones are needed
+				unsigned int slot = (hole + 1) & mask;
+				while (buckets[slot].index != 0)
+				{
+					unsigned int ideal = buckets[slot].hash & mask;
+					if (((slot - ideal) & mask) >= ((slot - hole) & mask))
+					{
+						buckets[hole] = buckets[slot];
+						hole = slot;
+					}
+					slot = (slot + 1) & mask;
+				}
+				buckets[hole].index = 0;
+			}
+
+			void append(const value_type &entry, unsigned int hash)
+			{
+				if (count == capacity)
+				{
+					// The entry might be part of the old storage
+					value_type tmp(entry);
+					grow(capacity * 2 > 8 ? capacity * 2 : 8);
+					new(entries + count) value_type(tmp);
+				}
+				else
+				{
+					new(entries + count) value_type(entry);
+				}
+				if (buckets)
+					insertBucket(count, hash);
+				count++;
+			}
+			void grow(unsigned int newcapacity)
+			{
+				value_type *newentries = (value_type*)malloc(newcapacity * sizeof(value_type));
+				for (unsigned int i = 0; i < count; i++)
+				{
+					new(newentries + i) value_type(entries[i]);
+					entries[i].~value_type();
+				}
+				if (entries != getInlineEntries())
+					free(entries);
+				entries = newentries;
+				capacity = newcapacity;
+				// Rebuild the table with a load factor of at most 0.5
+				Bucket *oldbuckets = buckets;
+				unsigned int oldmask = mask;
+				unsigned int bucketcount = 16;
+				while (bucketcount < newcapacity * 2)
+					bucketcount *= 2;
+				buckets = (Bucket*)calloc(bucketcount, sizeof(Bucket));
+				mask = bucketcount - 1;
+				if (oldbuckets)
+				{
+					for (unsigned int i = 0; i <= oldmask; i++)
+					{
+						if (oldbuckets[i].index != 0)
+							insertBucket(oldbuckets[i].index - 1, oldbuckets[i].hash);
+					}
+					free(oldbuckets);
+				}
+				else
+				{
+					for (unsigned int i = 0; i < count; i++)
+						insertBucket(i, HashFunction()(entries[i].first));
+				}
+			}
+			void copy(const HashMap &other)
+			{
+				// Expects the map to be empty
+				if (other.count > capacity)
+				{
+					freeStorage();
+					grow(other.capacity);
+				}
+				for (unsigned int i = 0; i < other.count; i++)
+					new(entries + i) value_type(other.entries[i]);
+				count = other.count;
+				if (!buckets)
+					return;
+				if (other.buckets && other.mask == mask)
+				{
+					memcpy(buckets, other.buckets, (mask + 1) * sizeof(Bucket));
+				}
+				else
+				{
+					for (unsigned int i = 0; i < count; i++)
+						insertBucket(i, HashFunction()(entries[i].first));
+				}
+			}
+			void freeStorage()
+			{
+				if (entries != getInlineEntries())
+					free(entries);
+				free(buckets);
+				entries = getInlineEntries();
+				capacity = InlineCapacity;
+				buckets = 0;
+				mask = 0;
+			}
+
+			union
+			{
+				char data[sizeof(value_type) * InlineCapacity];
+				long double aligndouble;
+				long long alignint;
+				void *alignpointer;
+			} inlinestorage;
+			value_type *entries;
+			unsigned int count;
+			unsigned int capacity;
+			Bucket *buckets;
+			unsigned int mask;
 	};
 }
 }
@@ -25,14 +25,43 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ReferenceCounted.hpp"
 #include "FileSystem.hpp"
 #include "Time.hpp"
+#include "Thread.hpp"
+#include "Semaphore.hpp"
+#include "CoreRender/core/LogLevel.hpp"
 
-#include <tbb/mutex.h>
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
 #include <cstdarg>
 
 #define CR_FILE_LINE __FILE__ CORE_RENDER_STRINGIFY(__LINE__)
 #define CORE_RENDER_STRINGIFY(number) CORE_RENDER_STRINGIFY2(number)
 #define CORE_RENDER_STRINGIFY2(number) #number
 
+/**
+ * Minimum log level (see cr::core::LogLevel) which is compiled into the
+ * program. Messages written with the CR_LOG_* macros below this level are
+ * removed by the preprocessor including the evaluation of their arguments,
+ * and Log drops them at runtime if they are written directly. The level is
+ * defined in the generated LogLevel.hpp.
+ */
+
+#if CORERENDER_LOG_LEVEL <= 0
+	#define CR_LOG_DEBUG(log, ...) (log)->debug(__VA_ARGS__)
+#else
+	#define CR_LOG_DEBUG(log, ...) ((void)0)
+#endif
+#if CORERENDER_LOG_LEVEL <= 1
+	#define CR_LOG_INFO(log, ...) (log)->info(__VA_ARGS__)
+#else
+	#define CR_LOG_INFO(log, ...) ((void)0)
+#endif
+#if CORERENDER_LOG_LEVEL <= 2
+	#define CR_LOG_WARNING(log, ...) (log)->warning(__VA_ARGS__)
+#else
+	#define CR_LOG_WARNING(log, ...) ((void)0)
+#endif
+#define CR_LOG_ERROR(log, ...) (log)->error(__VA_ARGS__)
+
 namespace cr
 {
 namespace core
@@ -70,19 +99,27 @@ namespace core
 	};
 	/**
 	 * Class to log to a file or to the console.
+	 *
+	 * Writing a message only formats it into a slot of a fixed-size
+	 * lock-free ring buffer, a background thread then writes the messages to
+	 * the console and to the HTML log file. If the buffer is full, the
+	 * calling thread waits until the background thread has made space.
+	 *
+	 * All functions writing messages are thread-safe.
 	 */
 	class Log : public ReferenceCounted
 	{
 		public:
 			/**
 			 * Constructor. Opens a file for logging and if that fails only logs
-			 * to the console.
+			 * to the console. Starts the thread writing the messages.
 			 * @param fs File system to be used for the log file.
 			 * @param filename File name of the log file.
 			 */
 			Log(FileSystem::Ptr fs, const std::string &filename);
 			/**
-			 * Destructor.
+			 * Destructor. Writes all pending messages before closing the log
+			 * file.
 			 */
 			~Log();
 
@@ -146,12 +183,47 @@ namespace core
 			 */
 			void write(LogLevel::List level, const char *format, ...);
 
+			/**
+			 * Waits until the background thread has written all messages
+			 * which were queued before the call.
+			 */
+			void flush();
+
 			typedef SharedPointer<Log> Ptr;
 		private:
 			void write(LogLevel::List level,
 			           const char *format,
 			           std::va_list args);
 
+			/**
+			 * Number of messages which can be queued.
+			 */
+			static const unsigned int queuesize = 256;
+			/**
+			 * Maximum length of a message including the terminating 0.
+			 */
+			static const unsigned int maxlength = 1024;
+
+			/**
+			 * Slot in the message ring buffer. The sequence number says
+			 * whether the slot is free (equal to the position of the next
+			 * message to be written into it) or contains a message (position
+			 * plus one).
+			 */
+			struct Entry
+			{
+				tbb::atomic<unsigned int> sequence;
+				LogLevel::List level;
+				float time;
+				char message[maxlength];
+			};
+
+			Entry *reserveEntry(unsigned int &position);
+			void writerThread();
+			bool writeEntries();
+			void writeEntry(const Entry &entry);
+			void wakeWriter();
+
 			LogLevel::List consolelevel;
 			LogLevel::List filelevel;
 
@@ -159,7 +231,18 @@ namespace core
 
 			File::Ptr file;
 
-			tbb::mutex mutex;
+			Entry *entries;
+			tbb::atomic<unsigned int> enqueuepos;
+			unsigned int dequeuepos;
+			tbb::atomic<unsigned int> writtenpos;
+
+			Thread writer;
+			Semaphore wakeup;
+			tbb::atomic<unsigned int> sleeping;
+			tbb::atomic<bool> stopping;
+
+			bool direct;
+			tbb::spin_mutex directmutex;
 	};
 }
 }
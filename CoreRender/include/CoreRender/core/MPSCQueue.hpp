@@ -0,0 +1,140 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_CORE_MPSCQUEUE_HPP_INCLUDED_
+#define _CORERENDER_CORE_MPSCQUEUE_HPP_INCLUDED_
+
+#include <tbb/atomic.h>
+#include <vector>
+
+namespace cr
+{
+namespace core
+{
+	/**
+	 * Lock-free queue with multiple producers and a single consumer. Elements
+	 * are pushed onto a linked list with a single atomic operation, the
+	 * consumer takes the whole list at once with drain(). As the list is never
+	 * popped element by element, the queue does not suffer from the ABA
+	 * problem.
+	 *
+	 * push() is thread-safe, drain() must only be called by one thread at a
+	 * time.
+	 */
+	template<typename T> class MPSCQueue
+	{
+		public:
+			/**
+			 * Constructor.
+			 */
+			MPSCQueue()
+			{
+				head = 0;
+			}
+			/**
+			 * Destructor. Destroys all elements which have not been drained.
+			 */
+			~MPSCQueue()
+			{
+				Node *node = head;
+				while (node)
+				{
+					Node *next = node->next;
+					delete node;
+					node = next;
+				}
+			}
+
+			/**
+			 * Appends an element to the queue.
+			 * @param value Element to be inserted.
+			 */
+			void push(const T &value)
+			{
+				Node *node = new Node(value);
+				Node *oldhead = head;
+				while (true)
+				{
+					node->next = oldhead;
+					Node *current = head.compare_and_swap(node, oldhead);
+					if (current == oldhead)
+						break;
+					oldhead = current;
+				}
+			}
+			/**
+			 * Removes all elements from the queue and appends them to a list
+			 * in the order in which they were pushed.
+			 * @param list List the elements are appended to.
+			 * @return Number of elements which were removed.
+			 */
+			unsigned int drain(std::vector<T> &list)
+			{
+				Node *node = head.fetch_and_store(0);
+				if (!node)
+					return 0;
+				// The list is in reverse order
+				Node *reversed = 0;
+				unsigned int count = 0;
+				while (node)
+				{
+					Node *next = node->next;
+					node->next = reversed;
+					reversed = node;
+					node = next;
+					count++;
+				}
+				list.reserve(list.size() + count);
+				while (reversed)
+				{
+					Node *next = reversed->next;
+					list.push_back(reversed->value);
+					delete reversed;
+					reversed = next;
+				}
+				return count;
+			}
+			/**
+			 * Returns true if no element has been pushed since the last call
+			 * to drain(). The result may be outdated immediately if other
+			 * threads push elements.
+			 */
+			bool empty()
+			{
+				return head == 0;
+			}
+		private:
+			struct Node
+			{
+				Node(const T &value)
+					: value(value), next(0)
+				{
+				}
+				T value;
+				Node *next;
+			};
+			tbb::atomic<Node*> head;
+	};
+}
+}
+
+#endif
@@ -23,7 +23,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_CORE_MEMORYPOOL_HPP_INCLUDED_
 
 #include <vector>
+#include <cstddef>
 #include <tbb/spin_mutex.h>
+#include <tbb/atomic.h>
+#include <tbb/enumerable_thread_specific.h>
 
 namespace cr
 {
@@ -36,8 +39,7 @@ namespace core
 	 * at the end of the frame. This class allocates all these from larger areas
 	 * of memory to reduce the number of calls to malloc/free and can easily
 	 * reuse the memory after reset() has been called and all objects have been
-	 * deleted. allocate() however is not viable for very large objects, these
-	 * should be allocated in a different way.
+	 * deleted.
 	 *
 	 * Note that this class only works with POD types which do not have any
 	 * constructor or destructor as the latter is not called when the memory
@@ -45,56 +47,77 @@ namespace core
 	 *
 	 * The memory allocated by this class is divided into large pages, when one
 	 * is full, the next one is allocated and used for many calls to allocate().
+	 * Allocations larger than half a page get their own block of memory which
+	 * is released in reset().
+	 *
+	 * To make allocate() scale with many threads, every thread takes smaller
+	 * chunks out of the pages (which needs a lock) and then allocates from its
+	 * chunk without any locking until the chunk is full.
+	 *
+	 * reset() keeps as many pages as were used by the largest recent frame.
+	 * Spare pages are only released after the usage has stayed below this
+	 * high watermark for a number of frames, so that varying frame sizes do
+	 * not cause pages to be mapped and unmapped every frame.
 	 */
 	class MemoryPool
 	{
 		public:
+			/**
+			 * Alignment of allocations if no other alignment is requested.
+			 */
+			static const unsigned int defaultalignment = 16;
+			/**
+			 * Number of frames the usage has to stay below the high
+			 * watermark before spare pages are released.
+			 */
+			static const unsigned int retainframes = 60;
+
+			/**
+			 * Usage statistics of the pool.
+			 */
+			struct Statistics
+			{
+				/**
+				 * Bytes taken from the pool between the last two calls to
+				 * reset().
+				 */
+				unsigned int usedbytes;
+				/**
+				 * Maximum of usedbytes since the pool was created.
+				 */
+				unsigned int peakbytes;
+				/**
+				 * Number of pages currently mapped.
+				 */
+				unsigned int mappedpages;
+				/**
+				 * Number of pages and large blocks mapped between the last
+				 * two calls to reset().
+				 */
+				unsigned int mapcalls;
+			};
+
 			/**
 			 * Constructor.
 			 * @param pagesize Size of one page allocated by the class. Should
 			 * be much larger than the objects which are going to be allocated.
+			 * @param hugepages If true, the pages are backed by huge pages if
+			 * the operating system supports this. The page size is rounded up
+			 * to a multiple of the huge page size then.
 			 */
-			MemoryPool(unsigned int pagesize = 1048576)
-				: used(0)
-			{
-				// Round up page size to 4k pages
-				pagesize = (pagesize + 0xFFF) & ~0xFFF;
-				this->pagesize = pagesize;
-				// Allocate a single page
-				currentmemory = allocPage(pagesize);
-			}
+			MemoryPool(unsigned int pagesize = 1048576, bool hugepages = false);
 			/**
 			 * Destructor.
 			 */
-			~MemoryPool()
-			{
-				freePage(currentmemory, pagesize);
-				for (unsigned int i = 0; i < usedmemory.size(); i++)
-					freePage(usedmemory[i], pagesize);
-				for (unsigned int i = 0; i < freememory.size(); i++)
-					freePage(freememory[i], pagesize);
-			}
+			~MemoryPool();
 
 			/**
 			 * Frees the memory returned by all previous calls to allocate().
-			 * This function also deletes all pages which are currently not in
-			 * use to reduce memory usage of the program and to adapt to
-			 * changing needs of the program. It however leaves all pages
-			 * allocated which have been used so that they do not have to be
-			 * reallocated at once.
+			 * The pages which are not in use anymore are kept for the
+			 * following frames up to the high watermark (see the class
+			 * description), only pages above it are deleted.
 			 */
-			void reset()
-			{
-				// Delete unused free pages
-				for (unsigned int i = 0; i < freememory.size(); i++)
-					freePage(freememory[i], pagesize);
-				freememory.clear();
-				// Move used pages to the free page list
-				freememory = usedmemory;
-				usedmemory.clear();
-				// Start at the current page from the beginning
-				used = 0;
-			}
+			void reset();
 			/**
 			 * Frees the memory returned by all previous calls to allocate().
 			 * Different to reset(), this function allocates as many pages as
@@ -102,121 +125,154 @@ namespace core
 			 * possible.
 			 * @param size Amount of memory initially allocated.
 			 */
-			void reset(unsigned int size)
-			{
-				unsigned int pagecount = (size + pagesize - 1) / pagesize;
-				// We have one page in currentmemory
-				pagecount -= 1;
-				// Allocate enough pages, reusing existing pages
-				if (freememory.size() >= pagecount)
-				{
-					for (unsigned int i = 0; i < usedmemory.size(); i++)
-						freePage(usedmemory[i], pagesize);
-					usedmemory.clear();
-					for (unsigned int i = pagecount; i < freememory.size(); i++)
-						freePage(freememory[i], pagesize);
-					freememory.resize(pagecount);
-				}
-				else if (freememory.size() + usedmemory.size() >= pagecount)
-				{
-					for (unsigned int i = 0; i < pagecount - freememory.size(); i++)
-						freememory.push_back(usedmemory[i]);
-					for (unsigned int i = pagecount - freememory.size();
-						i < usedmemory.size(); i++)
-						freePage(usedmemory[i], pagesize);
-					usedmemory.clear();
-				}
-				else
-				{
-					unsigned int freepages = freememory.size();
-					freememory.resize(pagecount);
-					for (unsigned int i = 0; i < usedmemory.size(); i++)
-						freememory[freepages + i] = usedmemory[i];
-					freepages += usedmemory.size();
-					usedmemory.clear();
-					for (unsigned int i = freepages; i < pagecount; i++)
-						freememory[i] = allocPage(pagesize);
-				}
-				// Reset current memory page
-				used = 0;
-			}
+			void reset(unsigned int size);
 			/**
 			 * Frees the memory returned by all previous calls to allocate() and
 			 * reallocates all memory pages with a new page size.
 			 * @param size Amount of memory initially allocated.
 			 * @param pagesize Size of one memory page.
 			 */
-			void reset(unsigned int size, unsigned int pagesize)
-			{
-				// Round up page size to 4k pages
-				pagesize = (pagesize + 0xFFF) & ~0xFFF;
-				// Free all existing pages
-				freePage(currentmemory, this->pagesize);
-				for (unsigned int i = 0; i < usedmemory.size(); i++)
-					freePage(usedmemory[i], this->pagesize);
-				for (unsigned int i = 0; i < freememory.size(); i++)
-					freePage(freememory[i], this->pagesize);
-				usedmemory.clear();
-				// Set new page size
-				this->pagesize = pagesize;
-				// Allocate new pages
-				unsigned int pagecount = (size + pagesize - 1) / pagesize;
-				currentmemory = allocPage(pagesize);
-				freememory.resize(pagecount - 1);
-				for (unsigned int i = 0; i < pagecount - 1; i++)
-					freememory[i] = allocPage(pagesize);
-				// Reset current memory page
-				used = 0;
-			}
+			void reset(unsigned int size, unsigned int pagesize);
 
 			/**
 			 * Allocates a certain amount of memory. The pointer which is
-			 * returned is only valid until reset() is called.
+			 * returned is only valid until reset() is called. This function
+			 * is thread-safe, but must not be called while reset() is running.
 			 * @param size Size of the memory allocated (in bytes).
+			 * @param alignment Alignment of the returned pointer, has to be a
+			 * power of two.
 			 * @return Pointer to the allocated memory.
 			 */
-			void *allocate(unsigned int size)
+			void *allocate(unsigned int size,
+			                unsigned int alignment = defaultalignment)
 			{
-				// TODO: Handle large allocations properly?
-				tbb::spin_mutex::scoped_lock lock(mutex);
-				if (used + size <= pagesize)
-				{
-					// We have enough memory on this page
-					void *memory = (char*)currentmemory + used;
-					used += size;
-					return memory;
-				}
-				else if (freememory.empty())
+				// Larger allocations would waste too much of the chunks
+				if (size + alignment > chunksize / 4)
+					return allocateShared(size, alignment);
+				Chunk &chunk = chunks.local();
+				char *memory = align(chunk.current, alignment);
+				if (chunk.generation != generation
+				 || memory + size > chunk.end)
 				{
-					// Allocate a new page
-					usedmemory.push_back(currentmemory);
-					currentmemory = allocPage(pagesize);
-					used = size;
-					return currentmemory;
+					// Get a new chunk for this thread
+					chunk.current = (char*)allocateShared(chunksize,
+					                                      chunkalignment);
+					chunk.end = chunk.current + chunksize;
+					chunk.generation = generation;
+					memory = align(chunk.current, alignment);
 				}
-				else
+				chunk.current = memory + size;
+				return memory;
+			}
+
+			/**
+			 * Returns the usage statistics. Has to be called after reset()
+			 * and not while other threads allocate memory.
+			 */
+			const Statistics &getStatistics() const
+			{
+				return stats;
+			}
+			/**
+			 * Returns the size of a single page.
+			 */
+			unsigned int getPageSize() const
+			{
+				return pagesize;
+			}
+		private:
+			/**
+			 * Part of a page owned by a single thread.
+			 */
+			struct Chunk
+			{
+				Chunk()
+					: current(0), end(0), generation(0)
 				{
-					// Start a new page
-					usedmemory.push_back(currentmemory);
-					currentmemory = freememory.back();
-					freememory.pop_back();
-					used = size;
-					return currentmemory;
 				}
+
+				char *current;
+				char *end;
+				/**
+				 * Value of MemoryPool::generation when the chunk was
+				 * allocated, the chunk is invalid after reset().
+				 */
+				unsigned int generation;
+			};
+			typedef tbb::enumerable_thread_specific<Chunk,
+				tbb::cache_aligned_allocator<Chunk>,
+				tbb::ets_key_per_instance> ChunkList;
+			/**
+			 * Block of memory for a single large allocation.
+			 */
+			struct LargeBlock
+			{
+				void *memory;
+				unsigned int size;
+			};
+
+			/**
+			 * Chunks start at cache line boundaries so that the chunks of
+			 * different threads do not share cache lines.
+			 */
+			static const unsigned int chunkalignment = 64;
+
+			static unsigned int getChunkSize(unsigned int pagesize)
+			{
+				unsigned int chunksize = pagesize / 16;
+				if (chunksize > 16384)
+					chunksize = 16384;
+				return chunksize;
 			}
-		private:
-			static void *allocPage(unsigned int size);
-			static void freePage(void *page, unsigned int size);
+			static char *align(char *memory, unsigned int alignment)
+			{
+				size_t address = (size_t)memory;
+				address = (address + alignment - 1) & ~(size_t)(alignment - 1);
+				return (char*)address;
+			}
+
+			void *allocateShared(unsigned int size, unsigned int alignment);
+			void *allocateLarge(unsigned int size);
+			void collectStatistics();
+			void freeLargeBlocks();
+			void startFrame();
+
+			void *allocPage(unsigned int size);
+			void freePage(void *page, unsigned int size);
 
 			unsigned int pagesize;
+			bool hugepages;
 
 			void *currentmemory;
 			unsigned int used;
 
 			std::vector<void*> usedmemory;
 			std::vector<void*> freememory;
+			std::vector<LargeBlock> largememory;
+			unsigned int largebytes;
+
+			/**
+			 * Number of pages kept by reset().
+			 */
+			unsigned int watermark;
+			/**
+			 * Highest number of pages used since the usage dropped below the
+			 * watermark.
+			 */
+			unsigned int recentpeak;
+			/**
+			 * Number of frames since the usage dropped below the watermark.
+			 */
+			unsigned int lowframes;
+
+			Statistics stats;
+			unsigned int mapcalls;
 
 			tbb::spin_mutex mutex;
+
+			unsigned int chunksize;
+			ChunkList chunks;
+			tbb::atomic<unsigned int> generation;
 	};
 }
 }
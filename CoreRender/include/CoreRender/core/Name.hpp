@@ -0,0 +1,143 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _CORERENDER_CORE_NAME_HPP_INCLUDED_
+#define _CORERENDER_CORE_NAME_HPP_INCLUDED_
+
+#include "HashMap.hpp"
+
+#include <string>
+#include <iosfwd>
+
+namespace cr
+{
+namespace core
+{
+	/**
+	 * Interned string used for the names of resources, shader contexts and
+	 * model nodes.
+	 *
+	 * Every distinct string is stored once in a global table and a Name only
+	 * contains its 32-bit index in that table, so names can be copied,
+	 * compared and hashed like integers. Constructing a Name from a string
+	 * has to look up the string, so this should be done when resources are
+	 * created or loaded and not while rendering. Strings are never removed
+	 * from the table.
+	 *
+	 * Construction and getString() are thread-safe. The ordering of
+	 * operator<() is the order in which the strings were interned and is
+	 * not alphabetical.
+	 */
+	class Name
+	{
+		public:
+			/**
+			 * Constructor. Creates the empty name.
+			 */
+			Name()
+				: id(0)
+			{
+			}
+			/**
+			 * Constructor.
+			 * @param name String to be interned.
+			 */
+			Name(const std::string &name);
+			/**
+			 * Constructor.
+			 * @param name String to be interned.
+			 */
+			Name(const char *name);
+
+			/**
+			 * Looks up a string without adding it to the table.
+			 * @param name String to look for.
+			 * @param result Set to the name of the string if it exists.
+			 * @return True if the string has already been interned.
+			 */
+			static bool find(const std::string &name, Name &result);
+			/**
+			 * Returns the name with a certain ID.
+			 * @param id ID as returned by getID() of an existing name.
+			 * @return Name with the ID.
+			 */
+			static Name fromID(unsigned int id)
+			{
+				Name name;
+				name.id = id;
+				return name;
+			}
+
+			/**
+			 * Returns the string of the name. The reference stays valid
+			 * until the program exits.
+			 * @return String of the name.
+			 */
+			const std::string &getString() const;
+			const char *c_str() const
+			{
+				return getString().c_str();
+			}
+			/**
+			 * Returns whether this is the empty name.
+			 */
+			bool empty() const
+			{
+				return id == 0;
+			}
+			/**
+			 * Returns the index of the name in the global table.
+			 * @return Unique ID of the string.
+			 */
+			unsigned int getID() const
+			{
+				return id;
+			}
+
+			bool operator==(const Name &other) const
+			{
+				return id == other.id;
+			}
+			bool operator!=(const Name &other) const
+			{
+				return id != other.id;
+			}
+			bool operator<(const Name &other) const
+			{
+				return id < other.id;
+			}
+		private:
+			unsigned int id;
+	};
+
+	template<> struct Hash<Name>
+	{
+		unsigned int operator()(const Name &name) const
+		{
+			return Hash<unsigned int>()(name.getID());
+		}
+	};
+
+	std::ostream &operator<<(std::ostream &stream, const Name &name);
+}
+}
+
+#endif
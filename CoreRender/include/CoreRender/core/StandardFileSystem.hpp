@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_CORE_STANDARDFILESYSTEM_HPP_INCLUDED_
 
 #include "FileSystem.hpp"
+#include "Log.hpp"
 
 #include <vector>
 #include <tbb/mutex.h>
@@ -49,10 +50,19 @@ namespace core
 			virtual bool isFile(const std::string &path);
 			virtual bool isDirectory(const std::string &path);
 
+			/**
+			 * Sets the log which receives a debug message for every file
+			 * which is opened.
+			 * @param log Log for file accesses, or 0 to disable tracing.
+			 */
+			void setLog(Log::Ptr log);
+
 			typedef SharedPointer<StandardFileSystem> Ptr;
 		private:
 			tbb::mutex mutex;
 
+			Log::Ptr log;
+
 			struct Mapping
 			{
 				std::string src;
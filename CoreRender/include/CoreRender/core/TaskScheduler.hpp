@@ -0,0 +1,282 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _CORERENDER_CORE_TASKSCHEDULER_HPP_INCLUDED_
+#define _CORERENDER_CORE_TASKSCHEDULER_HPP_INCLUDED_
+
+#include "Thread.hpp"
+#include "Semaphore.hpp"
+
+#include <vector>
+#include <deque>
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
+#include <tbb/enumerable_thread_specific.h>
+
+namespace cr
+{
+namespace core
+{
+	class TaskScheduler;
+
+	/**
+	 * Set of tasks which can be waited for with TaskScheduler::wait().
+	 */
+	class TaskGroup
+	{
+		public:
+			TaskGroup()
+			{
+				pending = 0;
+			}
+
+			/**
+			 * Returns true if all tasks spawned in this group have finished.
+			 */
+			bool isFinished()
+			{
+				return (pending & countmask) == 0;
+			}
+		private:
+			friend class TaskScheduler;
+
+			static const unsigned int countmask = 0xFFFFFF;
+			static const unsigned int waiterunit = 0x1000000;
+
+			/**
+			 * Number of unfinished tasks in the lower 24 bits and number of
+			 * threads blocked in TaskScheduler::wait() in the upper 8 bits.
+			 * Both are changed together so that the last task knows how
+			 * many threads it has to wake up.
+			 */
+			tbb::atomic<unsigned int> pending;
+			/**
+			 * Posted once for every blocked thread when the last task has
+			 * finished.
+			 */
+			Semaphore finished;
+	};
+
+	/**
+	 * Unit of work executed by TaskScheduler. The task object has to stay
+	 * valid until it has been executed, unless it is created with autodelete
+	 * set, in which case the scheduler deletes it.
+	 */
+	class Task
+	{
+		public:
+			/**
+			 * Constructor.
+			 * @param autodelete If true, the scheduler deletes the task once
+			 * it has been executed.
+			 */
+			Task(bool autodelete = false)
+				: group(0), dependencycount(0), autodelete(autodelete)
+			{
+				pending = 1;
+			}
+			virtual ~Task()
+			{
+			}
+
+			/**
+			 * Executes the task. Called by the scheduler, can spawn further
+			 * tasks and wait for them.
+			 */
+			virtual void run() = 0;
+
+			/**
+			 * Makes this task wait for another task, it is only executed
+			 * after the other task has finished. Has to be called before
+			 * either task is spawned. After a task has been executed, its
+			 * dependencies are restored, so a whole task graph can be
+			 * spawned again once it has finished.
+			 * @param other Task which has to finish first.
+			 */
+			void addDependency(Task *other)
+			{
+				other->successors.push_back(this);
+				dependencycount++;
+				pending++;
+			}
+		private:
+			friend class TaskScheduler;
+
+			TaskGroup *group;
+			/**
+			 * Number of unfinished dependencies plus one while the task has
+			 * not been spawned.
+			 */
+			tbb::atomic<unsigned int> pending;
+			unsigned int dependencycount;
+			std::vector<Task*> successors;
+			bool autodelete;
+	};
+
+	/**
+	 * Task which calls a method of a class.
+	 */
+	template<class T> class ClassTask : public Task
+	{
+		public:
+			ClassTask(T *instance, void (T::*function)(void),
+			          bool autodelete = false)
+				: Task(autodelete), instance(instance), function(function)
+			{
+			}
+
+			virtual void run()
+			{
+				(instance->*function)();
+			}
+		private:
+			T *instance;
+			void (T::*function)(void);
+	};
+
+	/**
+	 * Thread pool which executes tasks on a set of worker threads. Every
+	 * worker has its own task queue, tasks spawned by a worker are put into
+	 * its queue and are executed in LIFO order by that worker. Workers which
+	 * run out of work steal the oldest tasks from the other workers. Tasks
+	 * spawned by other threads are put into a shared queue.
+	 *
+	 * wait() executes other tasks until the group has finished, so tasks can
+	 * wait for the tasks they spawned without blocking a worker. Only once
+	 * no task is left to execute and the rest of the group is running on
+	 * other threads, the waiting thread blocks until the group has finished.
+	 *
+	 * A single scheduler is meant to be shared by all parts of the engine
+	 * (resource loading, animation, culling, batch building) so that they do
+	 * not compete with separate thread pools.
+	 */
+	class TaskScheduler
+	{
+		public:
+			/**
+			 * Constructor. Does not start the worker threads yet.
+			 */
+			TaskScheduler();
+			/**
+			 * Destructor. Stops the worker threads.
+			 */
+			~TaskScheduler();
+
+			/**
+			 * Starts the worker threads. Returns once all workers have set up
+			 * their thread-local state, so no worker allocates memory after
+			 * this call unless tasks are spawned.
+			 * @param threads Number of worker threads. If 0, one thread less
+			 * than the number of logical processors is used as the thread
+			 * calling wait() also executes tasks.
+			 * @return False if a thread could not be started.
+			 */
+			bool start(unsigned int threads = 0);
+			/**
+			 * Stops the worker threads. Tasks which have not been executed
+			 * yet are dropped.
+			 */
+			void stop();
+
+			/**
+			 * Queues a task for execution.
+			 * @param task Task to be executed.
+			 * @param group Group to which the task is added.
+			 */
+			void spawn(Task *task, TaskGroup *group);
+			/**
+			 * Executes tasks until all tasks in the group have finished.
+			 * Blocks if there is nothing to execute while the group is
+			 * still running.
+			 * @param group Group to be waited for.
+			 */
+			void wait(TaskGroup *group);
+
+			/**
+			 * Returns the number of worker threads.
+			 */
+			unsigned int getThreadCount()
+			{
+				return workers.size();
+			}
+			/**
+			 * Returns the number of logical processors of the system.
+			 */
+			static unsigned int getProcessorCount();
+		private:
+			struct Worker
+			{
+				Worker()
+				{
+					count = 0;
+				}
+
+				unsigned int index;
+				Thread thread;
+				tbb::spin_mutex mutex;
+				std::deque<Task*> tasks;
+				/**
+				 * Size of the queue, can be checked without locking.
+				 */
+				tbb::atomic<unsigned int> count;
+			};
+			/**
+			 * Thread index of threads which are not workers.
+			 */
+			static const unsigned int noworker = 0xFFFFFFFF;
+
+			void workerEntry(Worker *worker);
+			Task *findTask(unsigned int index);
+			Task *popTask(Worker *queue, bool newest);
+			void execute(Task *task);
+			void enqueue(Task *task);
+			void wakeWorker();
+			bool cancelSleep();
+
+			class WorkerFunctor;
+
+			/**
+			 * Worker queues followed by the shared queue for other threads.
+			 */
+			std::vector<Worker*> workers;
+			Worker external;
+
+			typedef tbb::enumerable_thread_specific<unsigned int,
+				tbb::cache_aligned_allocator<unsigned int>,
+				tbb::ets_key_per_instance> ThreadIndexList;
+			ThreadIndexList threadindex;
+
+			/**
+			 * Number of workers which are going to sleep and have not been
+			 * woken up yet.
+			 */
+			tbb::atomic<unsigned int> sleeping;
+			Semaphore wakeup;
+			/**
+			 * Posted by every worker once it has started.
+			 */
+			Semaphore started;
+			tbb::atomic<bool> stopping;
+	};
+}
+}
+
+#endif
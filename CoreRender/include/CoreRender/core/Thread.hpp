@@ -63,6 +63,11 @@ namespace core
 			 * Waits for the thread to exit.
 			 */
 			void wait();
+
+			/**
+			 * Gives up the rest of the time slice of the calling thread.
+			 */
+			static void yield();
 		private:
 #if defined(CORERENDER_UNIX)
 			pthread_t thread;
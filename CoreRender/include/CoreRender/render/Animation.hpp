@@ -25,6 +25,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../res/Resource.hpp"
 #include "../math/Matrix4.hpp"
 #include "../math/Quaternion.hpp"
+#include "../core/Name.hpp"
+#include "../core/HashMap.hpp"
 
 namespace cr
 {
@@ -83,7 +85,7 @@ namespace render
 				/**
 				 * Name of the model node.
 				 */
-				std::string node;
+				core::Name node;
 				/**
 				 * If set to true, only one animation frame is provided which
 				 * stays constant for the whole animation time.
@@ -123,12 +125,12 @@ namespace render
 			 * Adds a channel to the animation.
 			 * @param node Name of the node affected by the channel.
 			 */
-			Channel *addChannel(const std::string &node);
+			Channel *addChannel(core::Name node);
 			/**
 			 * Removes a channel affecting a certain node.
 			 * @param node Name of the channel to be removed.
 			 */
-			void removeChannel(const std::string &node);
+			void removeChannel(core::Name node);
 			/**
 			 * Removes a channel at a certain index.
 			 * @param index Index of the channel to be removed.
@@ -139,7 +141,7 @@ namespace render
 			 * @return Channel with the specified name or 0 if no channel was
 			 * found.
 			 */
-			Channel *getChannel(const std::string &node);
+			Channel *getChannel(core::Name node);
 			/**
 			 * Returns the channel at a certain index.
 			 * @return Channel at the index, or 0 if index is too large.
@@ -174,6 +176,8 @@ namespace render
 			unsigned int framecount;
 			float fps;
 			std::vector<Channel*> channels;
+			typedef core::HashMap<core::Name, unsigned int> ChannelMap;
+			ChannelMap channelindices;
 	};
 }
 }
@@ -83,6 +83,15 @@ namespace render
 			 */
 			bool hasDepthBuffer();
 
+			/**
+			 * Framebuffer objects are not shared between contexts, so they
+			 * are always uploaded by the render thread.
+			 */
+			virtual bool isSharedBetweenContexts()
+			{
+				return false;
+			}
+
 			virtual const char *getType()
 			{
 				return "FrameBuffer";
@@ -94,6 +103,16 @@ namespace render
 				unsigned int depthbuffer;
 				unsigned int defaultdepthbuffer;
 				std::vector<unsigned int> colorbuffers;
+				/**
+				 * Number of color buffers which are enabled as draw buffers,
+				 * 0xFFFFFFFF if the draw buffers have never been set.
+				 */
+				unsigned int drawbuffers;
+				/**
+				 * True if the attachments were changed after the framebuffer
+				 * was last validated.
+				 */
+				bool changed;
 			};
 
 			/**
@@ -0,0 +1,179 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_FRAMECAPTURE_HPP_INCLUDED_
+#define _CORERENDER_RENDER_FRAMECAPTURE_HPP_INCLUDED_
+
+#include "FrameCaptureFile.hpp"
+#include "../core/File.hpp"
+
+#include <vector>
+#include <map>
+
+namespace cr
+{
+namespace render
+{
+	struct PipelineInfo;
+	struct PipelineState;
+	class VideoDriver;
+
+	/**
+	 * Frame which was captured with GraphicsEngine::captureFrame() and which
+	 * can be replayed with GraphicsEngine::replayFrame().
+	 *
+	 * A capture contains the command streams of all render passes and a list
+	 * of the resources they reference, but not the content of the
+	 * resources. Replaying with the null driver works without any further
+	 * setup. For other drivers, stand-in resources have to be created for the
+	 * buffers and textures, and their handles have to be passed to
+	 * setResourceHandle(). Shaders cannot be recreated from a capture.
+	 */
+	class FrameCapture : public core::ReferenceCounted
+	{
+		public:
+			/**
+			 * Constructor.
+			 */
+			FrameCapture();
+			/**
+			 * Destructor.
+			 */
+			virtual ~FrameCapture();
+
+			/**
+			 * Loads a capture from a file.
+			 * @param file File to read from.
+			 * @return False if the file is no valid capture.
+			 */
+			bool load(core::File::Ptr file);
+			/**
+			 * Writes a frame to a capture file. Called by the renderer.
+			 * @param file File to write to.
+			 * @param pipelines Frame data of all pipelines.
+			 * @param pipelinecount Number of pipelines.
+			 * @param width Width of the render window.
+			 * @param height Height of the render window.
+			 * @return False if writing failed.
+			 */
+			static bool save(core::File::Ptr file,
+			                 PipelineInfo *pipelines,
+			                 unsigned int pipelinecount,
+			                 unsigned int width,
+			                 unsigned int height);
+
+			/**
+			 * Returns the width of the render window during capturing.
+			 */
+			unsigned int getWidth()
+			{
+				return width;
+			}
+			/**
+			 * Returns the height of the render window during capturing.
+			 */
+			unsigned int getHeight()
+			{
+				return height;
+			}
+
+			/**
+			 * Returns the number of resources referenced by the frame.
+			 */
+			unsigned int getResourceCount()
+			{
+				return resources.size();
+			}
+			/**
+			 * Returns information about a resource referenced by the frame.
+			 * @param index Index of the resource.
+			 */
+			const FrameCaptureFile::Resource &getResource(unsigned int index)
+			{
+				return resources[index];
+			}
+			/**
+			 * Replaces the handle of a resource during replay.
+			 * @param index Index of the resource.
+			 * @param handle Handle of the stand-in resource.
+			 */
+			void setResourceHandle(unsigned int index, int handle);
+
+			/**
+			 * Returns the number of captured render passes.
+			 */
+			unsigned int getPassCount()
+			{
+				return passes.size();
+			}
+			/**
+			 * Returns the information about a captured render pass.
+			 * @param pass Index of the pass.
+			 */
+			const FrameCaptureFile::Pass &getPass(unsigned int pass)
+			{
+				return passes[pass].info;
+			}
+			/**
+			 * Returns the command stream of a pass with all resource handles
+			 * replaced as set with setResourceHandle().
+			 * @param pass Index of the pass.
+			 */
+			char *getCommands(unsigned int pass);
+			/**
+			 * Frees the driver specific data of the pipeline states of the
+			 * capture. Called by the renderer in the render thread before
+			 * the video driver is destroyed.
+			 * @param driver Video driver which was used to replay the frame.
+			 */
+			void releaseDriverData(VideoDriver *driver);
+
+			typedef core::SharedPointer<FrameCapture> Ptr;
+		private:
+			void remapCommands(unsigned int pass);
+
+			struct Pass
+			{
+				FrameCaptureFile::Pass info;
+				std::vector<char> original;
+				std::vector<char> commands;
+				bool dirty;
+			};
+
+			unsigned int width;
+			unsigned int height;
+			std::vector<FrameCaptureFile::Resource> resources;
+			std::vector<PipelineState*> states;
+			/**
+			 * Shader handles of the pipeline states during capturing.
+			 */
+			std::vector<int> stateshaders;
+			std::vector<Pass> passes;
+			/**
+			 * Replaced handles for every resource type.
+			 */
+			std::map<int, int> handles[4];
+	};
+}
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_FRAMECAPTUREFILE_HPP_INCLUDED_
+#define _CORERENDER_RENDER_FRAMECAPTUREFILE_HPP_INCLUDED_
+
+#include "../core/StructPacking.hpp"
+
+namespace cr
+{
+namespace render
+{
+	/**
+	 * File format of frame captures written by GraphicsEngine::captureFrame().
+	 *
+	 * The file starts with a Header, followed by resourcecount Resource
+	 * entries and pipelinestatecount PipelineState entries, each directly
+	 * followed by attribcount attrib mappings. Then, for every render pass of
+	 * every pipeline, a Pass entry follows, directly followed by commandsize
+	 * bytes of the command stream of the pass. In the command streams,
+	 * pipeline state commands contain the index of the pipeline state entry
+	 * instead of a pointer.
+	 */
+	struct FrameCaptureFile
+	{
+		static const unsigned int version = 2;
+		static const unsigned int tag = (int)'C' + 256 * 'R' + 65536 * 'F';
+		/**
+		 * Maximum number of attrib mappings of a pipeline state.
+		 */
+		static const unsigned int maxattribs = 32;
+
+		/**
+		 * Type of a resource referenced by the captured frame.
+		 */
+		struct ResourceType
+		{
+			enum List
+			{
+				Shader,
+				VertexBuffer,
+				IndexBuffer,
+				Texture
+			};
+		};
+
+		CORERENDER_PACK_BEGIN()
+		struct Header
+		{
+			unsigned int tag;
+			unsigned int version;
+			/**
+			 * Size of the render window.
+			 */
+			unsigned int width;
+			unsigned int height;
+			unsigned int resourcecount;
+			unsigned int pipelinestatecount;
+			unsigned int passcount;
+		}
+		CORERENDER_PACK_END();
+		CORERENDER_PACK_BEGIN()
+		struct Resource
+		{
+			unsigned int type;
+			/**
+			 * Driver handle of the resource at the time of capturing.
+			 */
+			int handle;
+			/**
+			 * For buffers, the number of bytes used by the frame. As the
+			 * content is not captured, stand-in buffers only have to be this
+			 * large to be safe when filled with zeros. For textures, the
+			 * texture type.
+			 */
+			unsigned int size;
+		}
+		CORERENDER_PACK_END();
+		CORERENDER_PACK_BEGIN()
+		struct PipelineState
+		{
+			/**
+			 * Shader handle at the time of capturing.
+			 */
+			int shader;
+			unsigned int blendmode;
+			unsigned int attribcount;
+		}
+		CORERENDER_PACK_END();
+		CORERENDER_PACK_BEGIN()
+		struct Pass
+		{
+			/**
+			 * Size of the render target, 0 for the render window.
+			 */
+			unsigned int width;
+			unsigned int height;
+			unsigned char clearcolor;
+			unsigned char cleardepth;
+			unsigned char padding[2];
+			unsigned int color;
+			float depth;
+			unsigned int commandsize;
+			/**
+			 * Size of the uniform table needed to read the command stream.
+			 */
+			unsigned int uniformcount;
+			unsigned int batchcount;
+		}
+		CORERENDER_PACK_END();
+	};
+}
+}
+
+#endif
@@ -26,6 +26,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "RenderContext.hpp"
 #include "../core/FileSystem.hpp"
 #include "../core/Log.hpp"
+#include "../core/TaskScheduler.hpp"
 #include "Texture2D.hpp"
 #include "VertexBuffer.hpp"
 #include "IndexBuffer.hpp"
@@ -33,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ShaderText.hpp"
 #include "InputEvent.hpp"
 #include "Model.hpp"
+#include "FrameCapture.hpp"
 
 #include <queue>
 #include "RenderStats.hpp"
@@ -48,6 +50,7 @@ namespace render
 	class RenderContext;
 	class Renderer;
 	class RenderThread;
+	class UploadThread;
 	class VideoDriver;
 
 	/**
@@ -92,6 +95,17 @@ namespace render
 			 * clone the render context and then proceeds in multithreaded
 			 * rendering mode. If RenderContext::clone() fails, it just proceeds
 			 * in single-threaded mode leaving a warning in the log.
+			 * @param framesinflight Maximum number of frames which are queued
+			 * for the render thread while the main thread already builds the
+			 * next frame (1 to 4). Higher values reduce the time both threads
+			 * wait for each other at the cost of latency and memory, as every
+			 * frame needs its own frame memory and deleted resources have to
+			 * be kept alive until all queued frames have been rendered. Only
+			 * used in multithreaded mode.
+			 * @param asyncuploads If true, resources are uploaded by a separate
+			 * thread with its own render context, so that the render thread
+			 * does not have to wait for large uploads. Falls back to uploading
+			 * in the render thread if the context cannot be cloned.
 			 * @return True if the engine was successfully set up. If not,
 			 * appropriate log messages are written.
 			 */
@@ -100,7 +114,9 @@ namespace render
 			          unsigned int height = 768,
 			          bool fullscreen = false,
 			          RenderContext::Ptr context = 0,
-			          bool multithreaded = true);
+			          bool multithreaded = true,
+			          unsigned int framesinflight = 1,
+			          bool asyncuploads = false);
 			/**
 			 * Resizes the render window connected to the render context. All
 			 * resources shall stay valid after the resizing.
@@ -164,6 +180,57 @@ namespace render
 			 */
 			bool endFrame();
 
+			/**
+			 * Writes the command streams of the next frame which is rendered
+			 * and metadata about the resources they use to a file. The frame
+			 * can later be loaded with FrameCapture::load() and rendered with
+			 * replayFrame(), for example to profile the render thread on a
+			 * machine without the application.
+			 * @param filename Path of the capture file in the file system of
+			 * the engine.
+			 * @return False if the file could not be opened.
+			 */
+			bool captureFrame(const std::string &filename);
+			/**
+			 * Renders a captured frame directly in the calling thread. This
+			 * only works in single-threaded mode and must not be called
+			 * between beginFrame() and endFrame(). Afterwards,
+			 * getRenderStats() returns the statistics of the replayed frame.
+			 * @param capture Captured frame.
+			 * @param passtimes If not 0, the time needed for every render pass
+			 * is appended to this list.
+			 * @return False if the engine is in multithreaded mode.
+			 */
+			bool replayFrame(FrameCapture::Ptr capture,
+			                 std::vector<core::Duration> *passtimes = 0);
+
+			/**
+			 * Limits the resource uploads done per frame to prevent hitches
+			 * when many resources are loaded at once. Resources which are used
+			 * by a frame are always uploaded before it is rendered, all other
+			 * uploads are spread over the following frames. The number and
+			 * size of the deferred uploads are reported in the render
+			 * statistics. By default, uploads are not limited. Must be called
+			 * after init(). Not used if uploads are done in a separate thread
+			 * (see init()).
+			 * @param bytes Maximum number of bytes uploaded per frame, 0 means
+			 * unlimited.
+			 * @param time Maximum time spent uploading per frame, 0 means
+			 * unlimited.
+			 */
+			void setUploadBudget(unsigned int bytes,
+			                     core::Duration time = core::Duration::Nanoseconds(0));
+			/**
+			 * Limits the number of resources destroyed per frame. Released
+			 * resources are only destroyed once the GPU has finished all
+			 * frames which might use them, the remaining ones are reported as
+			 * pending deletions in the render statistics. By default,
+			 * deletions are not limited. Must be called after init().
+			 * @param resources Maximum number of resources destroyed per
+			 * frame, 0 means unlimited.
+			 */
+			void setDeletionBudget(unsigned int resources);
+
 			/**
 			 * Sets a user-specified file system for the engine. This can be
 			 * called before calling init().
@@ -224,6 +291,19 @@ namespace render
 			{
 				return rmgr;
 			}
+			/**
+			 * Returns the task scheduler of the engine. The scheduler is used
+			 * for loading resources and should be used for other parallel
+			 * work like animation, culling and submitting batches (see
+			 * Pipeline::submit()) instead of creating further threads. It is
+			 * created in init() and deleted in shutdown().
+			 * @return Task scheduler or 0 if no worker threads could be
+			 * started.
+			 */
+			core::TaskScheduler *getTaskScheduler()
+			{
+				return scheduler;
+			}
 			/**
 			 * Returns the rendering statistics from the last completely
 			 * finished frame. Note that this frame is not the one from the last
@@ -253,6 +333,8 @@ namespace render
 			Renderer *renderer;
 			VideoDriver *driver;
 			RenderThread *renderthread;
+			UploadThread *uploadthread;
+			core::TaskScheduler *scheduler;
 
 			tbb::spin_mutex pipelinemutex;
 			std::vector<Pipeline::Ptr> pipelines;
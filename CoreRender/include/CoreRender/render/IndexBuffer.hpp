@@ -95,6 +95,8 @@ namespace render
 				return handle;
 			}
 
+			virtual unsigned int getMemorySize();
+
 			virtual const char *getType()
 			{
 				return "IndexBuffer";
@@ -72,7 +72,7 @@ namespace render
 			/**
 			 * Returns a shader flag string.
 			 */
-			std::string getShaderFlags()
+			const std::string &getShaderFlags()
 			{
 				return shaderflags;
 			}
@@ -90,6 +90,10 @@ namespace render
 				 * Sampler name.
 				 */
 				std::string name;
+				/**
+				 * Slot of the sampler name (see ShaderSlots).
+				 */
+				unsigned int slot;
 			};
 
 			/**
@@ -28,6 +28,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "VertexLayout.hpp"
 #include "GeometryFile.hpp"
 #include "../core/HashMap.hpp"
+#include "../core/Name.hpp"
 
 class TiXmlElement;
 
@@ -69,7 +70,7 @@ namespace render
 					 *
 					 * Do not use this, use Model::addNode() instead.
 					 */
-					Node(const std::string &name, Model *model, Node *parent)
+					Node(core::Name name, Model *model, Node *parent)
 						: model(model), name(name), parent(parent)
 					{
 						if (parent)
@@ -136,7 +137,7 @@ namespace render
 					 * Returns the name of the node.
 					 * @return Name.
 					 */
-					std::string getName()
+					core::Name getName()
 					{
 						return name;
 					}
@@ -171,7 +172,7 @@ namespace render
 					}
 
 					Model *model;
-					const std::string name;
+					const core::Name name;
 					Node *parent;
 					std::vector<Node*> children;
 					math::Matrix4 transformation;
@@ -218,7 +219,7 @@ namespace render
 				/**
 				 * Name of the model node.
 				 */
-				std::string name;
+				core::Name name;
 				/**
 				 * Parent of this node, if 0, then this node is the root node.
 				 */
@@ -244,7 +245,7 @@ namespace render
 				 */
 				math::Matrix4 abstransinverse;
 			};
-			typedef core::HashMap<std::string, AnimationNode*>::Type AnimationNodeMap;
+			typedef core::HashMap<core::Name, AnimationNode*> AnimationNodeMap;
 
 			/**
 			 * Joint information.
@@ -255,7 +256,7 @@ namespace render
 				 * Name of the joint. This is the name of the node it is linked
 				 * to.
 				 */
-				std::string name;
+				core::Name name;
 				/**
 				 * Inverse joint bind matrix. Multiply vertices with this matrix
 				 * to get their position in bone space.
@@ -375,12 +376,12 @@ namespace render
 			 * will be replaced with the node.
 			 * @return New node.
 			 */
-			Model::Node *addNode(const std::string &name, Node *parent);
+			Model::Node *addNode(core::Name name, Node *parent);
 			/**
 			 * Removes a node from the model.
 			 * @param name Node name.
 			 */
-			void removeNode(const std::string &name);
+			void removeNode(core::Name name);
 			/**
 			 * @param node Node to be removed.
 			 */
@@ -394,7 +395,7 @@ namespace render
 			 * Returns the node with a certain name.
 			 * @return Node, or 0 if the node was not found.
 			 */
-			Node *getNode(const std::string &name);
+			Node *getNode(core::Name name);
 			/**
 			 * Returns a map with all nodes usable for animation.
 			 * @param nodelist List which is filled with all mode nodes.
@@ -446,7 +447,7 @@ namespace render
 			std::vector<Mesh> meshes;
 			Node *rootnode;
 
-			typedef core::HashMap<std::string, Node*>::Type NodeMap;
+			typedef core::HashMap<core::Name, Node*> NodeMap;
 			NodeMap nodes;
 
 			friend class Node;
@@ -65,10 +65,33 @@ namespace render
 				return uniforms;
 			}
 		private:
+			void updateNodeCache();
+			void clearNodeCache();
+
 			Model::Ptr model;
 			std::vector<AnimStage> animstages;
 			UniformData uniforms;
 			std::vector<cr::render::RenderJob> jobs;
+
+			struct NodeInfo
+			{
+				Model::Node *node;
+				Model::AnimationNode *animnode;
+			};
+			/**
+			 * Model for which the node cache was created.
+			 */
+			Model *nodecachemodel;
+			Model::AnimationNodeMap nodes;
+			std::vector<NodeInfo> nodeinfo;
+			std::vector<Model::AnimationNode*> meshnodes;
+			std::vector<std::vector<Model::AnimationNode*> > jointnodes;
+			/**
+			 * Uniform slots of the joint matrices.
+			 */
+			std::vector<unsigned int> skinmatslots;
+			unsigned int worldmatslot;
+			unsigned int worldnormalmatslot;
 	};
 }
 }
@@ -32,6 +32,7 @@ namespace render
 	class RenderJob;
 	class Renderable;
 	struct PipelineInfo;
+	struct RenderBatch;
 	class Renderer;
 
 	/**
@@ -88,12 +89,77 @@ namespace render
 			 * @param renderable Renderable object to be rendered.
 			 */
 			void submit(Renderable *renderable);
+			/**
+			 * Submits a renderable object to the pipeline and prepares batches
+			 * for rendering. This variant can be called by multiple threads at
+			 * once, e.g. from within a tbb::parallel_for() over a list of
+			 * renderables. The index defines where the renderable is placed
+			 * in the submission order, so submitting renderables 0..n-1 in
+			 * parallel yields exactly the same batches in the same order as
+			 * submitting them one after another.
+			 * @param renderable Renderable object to be rendered.
+			 * @param index Submission index of the renderable. Must be unique
+			 * within the frame.
+			 * @note Do not mix this with the variants without index in the
+			 * same frame if deterministic output is required.
+			 */
+			void submit(Renderable *renderable, unsigned int index);
 			/**
 			 * Submits a single render job to be rendered and prepares batches
 			 * for rendering.
 			 * @param job Render job to be rendered.
 			 */
 			void submit(RenderJob *job);
+			/**
+			 * Submits a single render job to be rendered and prepares batches
+			 * for rendering. Thread-safe, see submit(Renderable*, unsigned int).
+			 * @param job Render job to be rendered.
+			 * @param index Submission index of the job. Must be unique within
+			 * the frame.
+			 */
+			void submit(RenderJob *job, unsigned int index);
+
+			/**
+			 * Registers a renderable for retained rendering. The render
+			 * batches of the renderable are created once and then reused in
+			 * every following frame until updateRenderable() is called, so
+			 * the renderable must not be passed to submit() as well. This
+			 * is meant for static geometry which rarely changes.
+			 *
+			 * Batches are rebuilt automatically if the shader handle changes
+			 * or if the vertex/index buffers or textures are replaced or
+			 * uploaded again. Changes to the render jobs themselves (like
+			 * transformations or uniform values) are not detected and have to
+			 * be signalled via updateRenderable().
+			 *
+			 * Retained batches are drawn after all submitted batches with the
+			 * same sort key.
+			 * @param renderable Renderable to be drawn in every frame. Must not
+			 * be deleted before unregisterRenderable() has been called.
+			 * @return Handle to the renderable.
+			 * @note Not thread-safe.
+			 */
+			unsigned int registerRenderable(Renderable *renderable);
+			/**
+			 * Removes a renderable which was registered via
+			 * registerRenderable().
+			 * @param handle Handle returned by registerRenderable().
+			 * @note Not thread-safe.
+			 */
+			void unregisterRenderable(unsigned int handle);
+			/**
+			 * Marks a retained renderable as changed, its render batches are
+			 * then rebuilt at the end of the frame.
+			 *
+			 * There is no cheaper path for changed uniform values: All jobs
+			 * are fetched from the renderable again and copied into a new
+			 * memory block, as queued frames might still read the old batches
+			 * which therefore cannot be patched in place. Renderables which
+			 * change in most frames should be passed to submit() instead.
+			 * @param handle Handle returned by registerRenderable().
+			 * @note Not thread-safe.
+			 */
+			void updateRenderable(unsigned int handle);
 
 			/**
 			 * Begins a new frame. Called by Renderer, do not call this
@@ -115,8 +181,66 @@ namespace render
 
 			typedef core::SharedPointer<Pipeline> Ptr;
 		private:
+			/**
+			 * Cached render batch of a retained renderable. The resources are
+			 * referenced to detect handle changes and uploads.
+			 */
+			struct RetainedBatch
+			{
+				RenderBatch *batch;
+				unsigned int pass;
+				float depth;
+				uint64_t sequence;
+				Shader::Ptr shader;
+				VertexBuffer::Ptr vertices;
+				IndexBuffer::Ptr indices;
+				Material::Ptr material;
+				/**
+				 * Sum of the revisions of the buffers and textures when the
+				 * batch was created.
+				 */
+				unsigned int revision;
+			};
+			struct RetainedRenderable
+			{
+				Renderable *renderable;
+				bool dirty;
+				/**
+				 * Memory block containing all batches of the renderable.
+				 */
+				char *memory;
+				std::vector<RetainedBatch> batches;
+			};
+
+			void submitJob(RenderJob *job,
+			               uint64_t sequence,
+			               std::vector<RetainedBatch> *retainedbatches = 0);
+			void submitRetained();
+			void rebuildRetained(unsigned int handle);
+			void retireMemory(char *memory);
+			static bool isRetainedBatchValid(const RetainedBatch &batch);
+
+			std::vector<RetainedRenderable> retained;
+			std::vector<unsigned int> freeretained;
+			struct RetiredMemory
+			{
+				char *memory;
+				/**
+				 * The memory can be freed once this many frames have been
+				 * rendered.
+				 */
+				unsigned int frame;
+			};
+			/**
+			 * Replaced retained batch memory which might still be used by
+			 * queued frames, sorted by frame.
+			 */
+			std::vector<RetiredMemory> retiredmemory;
+
 			std::vector<RenderPass::Ptr> passes;
 
+			tbb::atomic<unsigned int> submitindex;
+
 			Renderer *renderer;
 	};
 }
@@ -66,6 +66,8 @@ namespace render
 					TextureRG,
 					VertexHalfFloat,
 					PointSprite,
+					Instancing,
+					Fences,
 					Count
 				};
 			};
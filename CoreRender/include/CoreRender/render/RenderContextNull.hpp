@@ -47,7 +47,9 @@ namespace render
 
 			virtual RenderContext::Ptr clone()
 			{
-				return 0;
+				// There is no real context, so the render thread can use
+				// another dummy one
+				return new RenderContextNull();
 			}
 
 			virtual VideoDriverType::List getDriverType()
@@ -43,7 +43,7 @@ namespace render
 			 */
 			RenderJob()
 				: startindex(0), endindex(0), basevertex(0), vertexoffset(0),
-				indextype(2)
+				indextype(2), depth(0.0f)
 			{
 			}
 
@@ -89,6 +89,14 @@ namespace render
 			 * Size of a single index in byte. Can be either 1, 2 or 4.
 			 */
 			unsigned int indextype;
+			/**
+			 * View space depth of the geometry, i.e. the distance from the
+			 * camera along the viewing direction. Render passes use this to
+			 * sort batches front to back or back to front. Can be left at 0
+			 * if the depth is unknown. ModelRenderable only fills this in if
+			 * a view matrix was set with SpatialRenderable::setViewMat().
+			 */
+			float depth;
 			/**
 			 * Material to be used for rendering. Depending on which contexts
 			 * are available in the material the job is drawn in certain render
@@ -24,9 +24,17 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "RenderTarget.hpp"
 #include "CoreRender/core/Color.hpp"
+#include "CoreRender/core/Name.hpp"
+#include "CoreRender/math/StdInt.hpp"
+
+#include <tbb/enumerable_thread_specific.h>
 
 namespace cr
 {
+namespace core
+{
+	class MemoryPool;
+}
 namespace render
 {
 	class VideoDriver;
@@ -34,6 +42,41 @@ namespace render
 	struct RenderBatch;
 	struct RenderPassInfo;
 
+	/**
+	 * Order in which the batches of a render pass are drawn.
+	 */
+	struct BatchSortMode
+	{
+		enum List
+		{
+			/**
+			 * Batches are drawn in the order in which they were submitted.
+			 */
+			SubmissionOrder,
+			/**
+			 * Batches are sorted by shader, blend mode, textures and buffers
+			 * to minimize state changes. Batches with equal state are drawn
+			 * front to back.
+			 */
+			State,
+			/**
+			 * All batches are drawn front to back, state is only used to
+			 * break ties.
+			 */
+			FrontToBack,
+			/**
+			 * All batches are drawn back to front, state is only used to
+			 * break ties.
+			 */
+			BackToFront,
+			/**
+			 * Solid batches are sorted like with State, batches with any
+			 * other blend mode are drawn afterwards back to front.
+			 */
+			Automatic
+		};
+	};
+
 	/**
 	 * A render pass draws geometry with one single material context. A pipeline
 	 * then can contain many of these to draw different contexts.
@@ -49,7 +92,7 @@ namespace render
 			 * Constructor.
 			 * @param context Name of the context to be rendered in this pass.
 			 */
-			RenderPass(const std::string &context);
+			RenderPass(core::Name context);
 			/**
 			 * Destructor.
 			 */
@@ -82,6 +125,30 @@ namespace render
 			              const core::Color &color = core::Color(0, 0, 0, 0),
 			              float depth = 1.0f);
 
+			/**
+			 * Sets the order in which the batches of this pass are drawn. The
+			 * default is BatchSortMode::Automatic.
+			 * @param sortmode New sort mode.
+			 */
+			void setSortMode(BatchSortMode::List sortmode);
+			/**
+			 * Returns the order in which the batches of this pass are drawn.
+			 * @return Sort mode.
+			 */
+			BatchSortMode::List getSortMode();
+			/**
+			 * Sets whether consecutive batches which only differ in the value
+			 * of the per-instance uniform of their shader are merged into
+			 * a single instanced draw call. This only affects shaders from
+			 * ShaderText contexts with instancing. Enabled by default.
+			 * @param instancing True if batches shall be merged.
+			 */
+			void setInstancing(bool instancing);
+			/**
+			 * Returns whether batches are merged into instanced draw calls.
+			 */
+			bool getInstancing();
+
 			/**
 			 * Called by Pipeline::beginFrame(), do not call this manually.
 			 */
@@ -89,29 +156,58 @@ namespace render
 			/**
 			 * Inserts a render patch into the queue for this render pass.
 			 * Called by Pipeline::submit(), do not call this manually.
+			 * This function is thread-safe, every thread inserts into its own
+			 * batch list, the lists are merged in prepare().
 			 * @param batch Batch to be drawn.
+			 * @param depth View space depth of the batch, used for sorting.
+			 * @param sequence Submission order of the batch. Batches with
+			 * equal sort keys are drawn in the order of their sequence
+			 * numbers, which makes the result independent of the thread which
+			 * inserted the batch.
 			 */
-			void insert(RenderBatch *batch);
+			void insert(RenderBatch *batch, float depth, uint64_t sequence);
 			/**
-			 * Prepares and then returns the batch list for this pass.
+			 * Prepares and then returns the batch list for this pass. Must not
+			 * be called while other threads are still inserting batches.
 			 * @param info Target for the batch list.
+			 * @param memory Frame memory pool from which the batch list and
+			 * the render target info are allocated.
+			 * @param frame Index of the frame, used for the mipmap policies of
+			 * the render target.
 			 */
-			void prepare(RenderPassInfo *info);
+			void prepare(RenderPassInfo *info,
+			             core::MemoryPool *memory,
+			             unsigned int frame);
 
 			/**
 			 * Returns the context name for shaders drawn in this pass.
 			 * @return Context name.
 			 */
-			const std::string &getContext()
+			core::Name getContext()
 			{
 				return context;
 			}
 
 			typedef core::SharedPointer<RenderPass> Ptr;
 		private:
-			tbb::spin_mutex insertmutex;
+			struct SortEntry
+			{
+				uint64_t key;
+				uint64_t sequence;
+				RenderBatch *batch;
+			};
+			typedef std::vector<SortEntry> SortEntryList;
+			void sortBatches();
+			void mergeInstances(core::MemoryPool *memory);
+
+			tbb::enumerable_thread_specific<SortEntryList> threadbatches;
 			std::vector<RenderBatch*> batches;
 
+			BatchSortMode::List sortmode;
+			bool instancing;
+			SortEntryList sortentries;
+			SortEntryList sorttemp;
+
 			// TODO: We need info about the target etc here
 			RenderBatch **prepared;
 			unsigned int preparedcount;
@@ -123,7 +219,7 @@ namespace render
 
 			RenderTarget::Ptr target;
 
-			std::string context;
+			core::Name context;
 	};
 }
 }
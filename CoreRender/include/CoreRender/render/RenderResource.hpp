@@ -24,6 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "../res/Resource.hpp"
 
+#include <tbb/atomic.h>
+
 namespace cr
 {
 namespace render
@@ -38,7 +40,10 @@ namespace render
 	 * Basically, these resources register themselves first for creation
 	 * (Renderer::registerNew()) which the happens at
 	 * GraphicsEngine::beginFrame() and then for upload
-	 * (Renderer::registerUpload()) which happens in the render thread.
+	 * (Renderer::registerUpload()) which happens in the render thread or in a
+	 * separate upload thread (see GraphicsEngine::init()). Uploads are
+	 * limited by the upload budget of the renderer, only resources used by the
+	 * frame which is being rendered are always uploaded immediately.
 	 * onDelete() also is overridden and just calls Renderer::registerDelete()
 	 * when the reference count reaches 0 which causes the resource to be
 	 * deleted in the render thread later.
@@ -70,6 +75,31 @@ namespace render
 			 */
 			void waitForUpload();
 
+			/**
+			 * Marks the resource as used by the frame which is currently being
+			 * built. Pending uploads of used resources are done before the
+			 * frame is rendered regardless of the upload budget. Called by
+			 * Pipeline::submit() for all resources of the submitted batches.
+			 */
+			void markUsed();
+			/**
+			 * Returns the last frame which used the resource (see
+			 * Renderer::getBuildFrame()).
+			 */
+			unsigned int getLastUsedFrame()
+			{
+				return usedframe;
+			}
+			/**
+			 * Returns a counter which is incremented every time the data of
+			 * the resource is changed and has to be uploaded again. Used by
+			 * Pipeline to detect changes of retained batch resources.
+			 */
+			unsigned int getRevision()
+			{
+				return revision;
+			}
+
 			/**
 			 * Creates the GPU part of the resource. Called from
 			 * Renderer::uploadNewObjects(). Do not call this manually.
@@ -85,6 +115,23 @@ namespace render
 			 * Renderer::uploadObjects(). Do not call this manually.
 			 */
 			virtual bool upload();
+			/**
+			 * Returns the number of bytes which are transferred to the GPU by
+			 * the next call to upload(). This is used to enforce the upload
+			 * budget of the renderer. By default, this is getMemorySize().
+			 */
+			virtual unsigned int getUploadSize();
+			/**
+			 * Returns the size of the GPU memory used by the resource.
+			 */
+			virtual unsigned int getMemorySize();
+			/**
+			 * Returns whether the GPU object of the resource is shared between
+			 * render contexts. Container objects like framebuffers are not,
+			 * so they are always uploaded by the render thread instead of the
+			 * upload thread. By default, this returns true.
+			 */
+			virtual bool isSharedBetweenContexts();
 
 			typedef core::SharedPointer<RenderResource> Ptr;
 		protected:
@@ -103,6 +150,16 @@ namespace render
 			tbb::spin_mutex uploadmutex;
 			bool uploading;
 			core::Semaphore *waiting;
+
+			tbb::atomic<unsigned int> usedframe;
+			tbb::atomic<unsigned int> revision;
+			/**
+			 * Set by the renderer once create() has been called. The upload
+			 * thread must not upload resources before that.
+			 */
+			tbb::atomic<bool> created;
+
+			friend class Renderer;
 	};
 }
 }
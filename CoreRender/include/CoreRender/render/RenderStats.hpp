@@ -24,6 +24,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "../math/StdInt.hpp"
 #include "../core/Time.hpp"
+#include "StateChanges.hpp"
+
+#include <vector>
 
 namespace cr
 {
@@ -39,7 +42,13 @@ namespace render
 			 * Constructor.
 			 */
 			RenderStats()
-				: polygons(0), batches(0), fps(0.0f)
+				: polygons(0), batches(0), mergedbatches(0), commandbytes(0),
+				apicalls(0), skippeduniforms(0), uploads(0), uploadbytes(0),
+				queueduploads(0), queuedbytes(0),
+				uploadlatency(core::Duration::Nanoseconds(0)), deletions(0),
+				pendingdeletions(0), pendingdeletionbytes(0), framememory(0),
+				framememorypeak(0), framememorypages(0), framememorymaps(0),
+				fps(0.0f)
 			{
 			}
 			/**
@@ -49,10 +58,29 @@ namespace render
 			{
 				polygons = other.polygons;
 				batches = other.batches;
+				mergedbatches = other.mergedbatches;
+				commandbytes = other.commandbytes;
+				apicalls = other.apicalls;
+				skippeduniforms = other.skippeduniforms;
+				statechanges = other.statechanges;
+				passstatechanges = other.passstatechanges;
+				uploads = other.uploads;
+				uploadbytes = other.uploadbytes;
+				queueduploads = other.queueduploads;
+				queuedbytes = other.queuedbytes;
+				uploadlatency = other.uploadlatency;
+				deletions = other.deletions;
+				pendingdeletions = other.pendingdeletions;
+				pendingdeletionbytes = other.pendingdeletionbytes;
+				framememory = other.framememory;
+				framememorypeak = other.framememorypeak;
+				framememorypages = other.framememorypages;
+				framememorymaps = other.framememorymaps;
 				fps = other.fps;
 				frametime = other.frametime;
 				rendertime = other.rendertime;
 				waittime = other.waittime;
+				submitwaittime = other.submitwaittime;
 				framebegin = other.framebegin;
 				renderbegin = other.renderbegin;
 				frameend = other.frameend;
@@ -79,6 +107,161 @@ namespace render
 			{
 				return batches;
 			}
+			/**
+			 * Returns the number of batches which were merged into the draw
+			 * calls of other batches via instancing. getBatchCount() plus this
+			 * value is the number of draw calls which would have been needed
+			 * without instancing.
+			 */
+			unsigned int getMergedBatchCount() const
+			{
+				return mergedbatches;
+			}
+			/**
+			 * Returns the size of the command streams of all render passes in
+			 * bytes, i.e. the amount of frame data the render thread had to
+			 * read.
+			 */
+			unsigned int getCommandBytes() const
+			{
+				return commandbytes;
+			}
+			/**
+			 * Returns the number of calls into the graphics API which were
+			 * made to draw the batches. Redundant state changes are filtered
+			 * out by the video driver and are not counted.
+			 */
+			unsigned int getAPICallCount() const
+			{
+				return apicalls;
+			}
+			/**
+			 * Returns the number of uniform uploads which were skipped because
+			 * the shader already held the same value.
+			 */
+			unsigned int getSkippedUniformCount() const
+			{
+				return skippeduniforms;
+			}
+			/**
+			 * Returns the state changes of the whole frame. Only counted by
+			 * the accounting null driver (VideoDriverType::NullAccounting).
+			 */
+			const StateChanges &getStateChanges() const
+			{
+				return statechanges;
+			}
+			/**
+			 * Returns the state changes of every render pass in the order in
+			 * which the passes were rendered.
+			 */
+			const std::vector<StateChanges> &getPassStateChanges() const
+			{
+				return passstatechanges;
+			}
+			/**
+			 * Returns the estimated GPU cost of the state changes of the
+			 * frame. Unlike the timings, this is deterministic and can be
+			 * compared between runs on different machines.
+			 * @param weights Cost of every single state change.
+			 */
+			float getEstimatedCost(const CostWeights &weights = CostWeights()) const
+			{
+				return statechanges.getCost(weights);
+			}
+			/**
+			 * Returns the number of resources which were uploaded before the
+			 * frame was rendered.
+			 */
+			unsigned int getUploadCount() const
+			{
+				return uploads;
+			}
+			/**
+			 * Returns the number of bytes which were uploaded before the frame
+			 * was rendered.
+			 */
+			unsigned int getUploadBytes() const
+			{
+				return uploadbytes;
+			}
+			/**
+			 * Returns the number of uploads which were deferred to later frames
+			 * because the upload budget was exhausted.
+			 */
+			unsigned int getQueuedUploadCount() const
+			{
+				return queueduploads;
+			}
+			/**
+			 * Returns the size of the deferred uploads in bytes.
+			 */
+			unsigned int getQueuedUploadBytes() const
+			{
+				return queuedbytes;
+			}
+			/**
+			 * Returns the longest time a resource uploaded during the frame
+			 * has been waiting in the upload queue.
+			 */
+			core::Duration getMaxUploadLatency() const
+			{
+				return uploadlatency;
+			}
+			/**
+			 * Returns the number of resources which were destroyed after the
+			 * frame.
+			 */
+			unsigned int getDeletionCount() const
+			{
+				return deletions;
+			}
+			/**
+			 * Returns the number of deleted resources which have not been
+			 * destroyed yet because the GPU might still use them or because
+			 * the deletion budget was exhausted.
+			 */
+			unsigned int getPendingDeletionCount() const
+			{
+				return pendingdeletions;
+			}
+			/**
+			 * Returns the GPU memory used by the pending deletions in bytes.
+			 */
+			unsigned int getPendingDeletionBytes() const
+			{
+				return pendingdeletionbytes;
+			}
+			/**
+			 * Returns the number of bytes of frame memory used by the frame.
+			 */
+			unsigned int getFrameMemory() const
+			{
+				return framememory;
+			}
+			/**
+			 * Returns the largest amount of frame memory used by any frame
+			 * so far.
+			 */
+			unsigned int getFrameMemoryPeak() const
+			{
+				return framememorypeak;
+			}
+			/**
+			 * Returns the number of pages mapped for frame memory.
+			 */
+			unsigned int getFrameMemoryPages() const
+			{
+				return framememorypages;
+			}
+			/**
+			 * Returns the number of frame memory pages which had to be mapped
+			 * during the frame.
+			 */
+			unsigned int getFrameMemoryMaps() const
+			{
+				return framememorymaps;
+			}
 			/**
 			 * Returns the number of frames rendered per second. Note that this
 			 * is only measured based on the time of one single frame, so this
@@ -111,6 +294,16 @@ namespace render
 			{
 				return waittime;
 			}
+			/**
+			 * Returns the time the main thread lost in
+			 * GraphicsEngine::endFrame() waiting for the render thread to
+			 * finish an earlier frame. Both this and getWaitTime() decrease if
+			 * more frames are allowed to be in flight.
+			 */
+			core::Duration getSubmitWaitTime() const
+			{
+				return submitwaittime;
+			}
 
 			/**
 			 * Resets all statistics and sets them to 0.
@@ -119,6 +312,24 @@ namespace render
 			{
 				polygons = 0;
 				batches = 0;
+				mergedbatches = 0;
+				commandbytes = 0;
+				apicalls = 0;
+				skippeduniforms = 0;
+				statechanges = StateChanges();
+				passstatechanges.clear();
+				uploads = 0;
+				uploadbytes = 0;
+				queueduploads = 0;
+				queuedbytes = 0;
+				uploadlatency = core::Duration::Nanoseconds(0);
+				deletions = 0;
+				pendingdeletions = 0;
+				pendingdeletionbytes = 0;
+				framememory = 0;
+				framememorypeak = 0;
+				framememorypages = 0;
+				framememorymaps = 0;
 				fps = 0.0f;
 			}
 			/**
@@ -150,6 +361,14 @@ namespace render
 				// Compute frame per second
 				fps = 1000000000.0f / frametime.getNanoseconds();
 			}
+			/**
+			 * Sets the time the main thread waited for the render thread.
+			 * This is called by GraphicsEngine::endFrame().
+			 */
+			void setSubmitWaitTime(core::Duration time)
+			{
+				submitwaittime = time;
+			}
 			/**
 			 * Signals the class that a certain number of batches has been
 			 * rendered. This is called by VideoDriver::draw().
@@ -158,6 +377,105 @@ namespace render
 			{
 				this->batches += batches;
 			}
+			/**
+			 * Signals the class that a certain number of batches has been
+			 * merged into other draw calls. This is called by
+			 * VideoDriver::drawInstanced().
+			 */
+			void increaseMergedBatchCount(unsigned int batches)
+			{
+				mergedbatches += batches;
+			}
+			/**
+			 * Signals the class that a command stream of the given size has
+			 * been executed. This is called by the renderer for every pass.
+			 */
+			void increaseCommandBytes(unsigned int bytes)
+			{
+				commandbytes += bytes;
+			}
+			/**
+			 * Signals the class that the video driver made a certain number of
+			 * calls into the graphics API.
+			 */
+			void increaseAPICallCount(unsigned int calls)
+			{
+				apicalls += calls;
+			}
+			/**
+			 * Signals the class that the video driver skipped a certain
+			 * number of uniform uploads.
+			 */
+			void increaseSkippedUniformCount(unsigned int uniforms)
+			{
+				skippeduniforms += uniforms;
+			}
+			/**
+			 * Adds the state changes of a render pass. This is called by the
+			 * accounting null driver at the end of every pass.
+			 */
+			void addPassStateChanges(const StateChanges &changes)
+			{
+				statechanges += changes;
+				passstatechanges.push_back(changes);
+			}
+			/**
+			 * Signals the class that a resource has been uploaded. This is
+			 * called by the renderer.
+			 * @param bytes Size of the uploaded data.
+			 * @param latency Time the resource waited for the upload.
+			 */
+			void addUpload(unsigned int bytes, core::Duration latency)
+			{
+				uploads++;
+				uploadbytes += bytes;
+				if (latency > uploadlatency)
+					uploadlatency = latency;
+			}
+			/**
+			 * Sets the uploads which were deferred to later frames. This is
+			 * called by the renderer.
+			 */
+			void setQueuedUploads(unsigned int count, unsigned int bytes)
+			{
+				queueduploads = count;
+				queuedbytes = bytes;
+			}
+			/**
+			 * Sets the frame memory statistics. This is called by the
+			 * renderer.
+			 * @param used Bytes used by the frame.
+			 * @param peak Maximum bytes used by any frame.
+			 * @param pages Number of pages mapped.
+			 * @param maps Number of pages mapped during the frame.
+			 */
+			void setFrameMemory(unsigned int used,
+			                    unsigned int peak,
+			                    unsigned int pages,
+			                    unsigned int maps)
+			{
+				framememory = used;
+				framememorypeak = peak;
+				framememorypages = pages;
+				framememorymaps = maps;
+			}
+			/**
+			 * Signals the class that a certain number of resources has been
+			 * destroyed. This is called by the renderer.
+			 */
+			void increaseDeletionCount(unsigned int resources)
+			{
+				deletions += resources;
+			}
+			/**
+			 * Sets the deletions which were deferred to later frames. This is
+			 * called by the renderer.
+			 */
+			void setPendingDeletions(unsigned int count, unsigned int bytes)
+			{
+				pendingdeletions = count;
+				pendingdeletionbytes = bytes;
+			}
 			/**
 			 * Signals the class that a certain number of polygons has been
 			 * rendered. This is called by VideoDriver::draw().
@@ -171,10 +489,29 @@ namespace render
 			{
 				polygons = other.polygons;
 				batches = other.batches;
+				mergedbatches = other.mergedbatches;
+				commandbytes = other.commandbytes;
+				apicalls = other.apicalls;
+				skippeduniforms = other.skippeduniforms;
+				statechanges = other.statechanges;
+				passstatechanges = other.passstatechanges;
+				uploads = other.uploads;
+				uploadbytes = other.uploadbytes;
+				queueduploads = other.queueduploads;
+				queuedbytes = other.queuedbytes;
+				uploadlatency = other.uploadlatency;
+				deletions = other.deletions;
+				pendingdeletions = other.pendingdeletions;
+				pendingdeletionbytes = other.pendingdeletionbytes;
+				framememory = other.framememory;
+				framememorypeak = other.framememorypeak;
+				framememorypages = other.framememorypages;
+				framememorymaps = other.framememorymaps;
 				fps = other.fps;
 				frametime = other.frametime;
 				rendertime = other.rendertime;
 				waittime = other.waittime;
+				submitwaittime = other.submitwaittime;
 				framebegin = other.framebegin;
 				renderbegin = other.renderbegin;
 				frameend = other.frameend;
@@ -183,10 +520,29 @@ namespace render
 		private:
 			unsigned int polygons;
 			unsigned int batches;
+			unsigned int mergedbatches;
+			unsigned int commandbytes;
+			unsigned int apicalls;
+			unsigned int skippeduniforms;
+			StateChanges statechanges;
+			std::vector<StateChanges> passstatechanges;
+			unsigned int uploads;
+			unsigned int uploadbytes;
+			unsigned int queueduploads;
+			unsigned int queuedbytes;
+			core::Duration uploadlatency;
+			unsigned int deletions;
+			unsigned int pendingdeletions;
+			unsigned int pendingdeletionbytes;
+			unsigned int framememory;
+			unsigned int framememorypeak;
+			unsigned int framememorypages;
+			unsigned int framememorymaps;
 			float fps;
 			core::Duration frametime;
 			core::Duration rendertime;
 			core::Duration waittime;
+			core::Duration submitwaittime;
 
 			core::Time framebegin;
 			core::Time renderbegin;
@@ -30,6 +30,30 @@ namespace cr
 {
 namespace render
 {
+	/**
+	 * Mipmap generation policy for the color buffers of a render target.
+	 */
+	struct MipmapPolicy
+	{
+		enum List
+		{
+			/**
+			 * No mipmaps are generated, only the first level is valid.
+			 */
+			Disabled,
+			/**
+			 * Mipmaps are generated when the texture is bound by a batch
+			 * after it has been rendered to.
+			 */
+			OnDemand,
+			/**
+			 * Mipmaps are generated after rendering to the texture in every
+			 * n-th frame.
+			 */
+			Interval
+		};
+	};
+
 	class RenderTarget : public res::Resource
 	{
 		public:
@@ -43,11 +67,43 @@ namespace render
 			void setDepthBuffer(Texture2D::Ptr texture);
 			Texture::Ptr getDepthBuffer();
 
-			void addColorBuffer(Texture2D::Ptr texture);
+			/**
+			 * Adds a color buffer to the render target.
+			 * @param texture Texture which is rendered to.
+			 * @param mipmaps Mipmap generation policy for the texture.
+			 * @param interval Number of frames between two mipmap updates if
+			 * the policy is MipmapPolicy::Interval.
+			 */
+			void addColorBuffer(Texture2D::Ptr texture,
+			                    MipmapPolicy::List mipmaps = MipmapPolicy::OnDemand,
+			                    unsigned int interval = 1);
 			Texture2D::Ptr getColorBuffer(unsigned int index);
 			void removeColorBuffer(unsigned int index);
 			unsigned int getColorBufferCount();
 
+			/**
+			 * Changes the mipmap generation policy of a color buffer.
+			 * @param index Index of the color buffer.
+			 * @param mipmaps Mipmap generation policy for the texture.
+			 * @param interval Number of frames between two mipmap updates if
+			 * the policy is MipmapPolicy::Interval.
+			 */
+			void setMipmapPolicy(unsigned int index,
+			                     MipmapPolicy::List mipmaps,
+			                     unsigned int interval = 1);
+			MipmapPolicy::List getMipmapPolicy(unsigned int index);
+			unsigned int getMipmapInterval(unsigned int index);
+			/**
+			 * Returns the mipmap policy of a color buffer for a single frame.
+			 * MipmapPolicy::Interval is only returned for frames in which the
+			 * mipmaps are to be generated, MipmapPolicy::Disabled for all
+			 * others.
+			 * @param index Index of the color buffer.
+			 * @param frame Index of the frame.
+			 */
+			MipmapPolicy::List getFrameMipmapPolicy(unsigned int index,
+			                                        unsigned int frame);
+
 			virtual const char *getType()
 			{
 				return "RenderTarget";
@@ -56,7 +112,13 @@ namespace render
 			typedef core::SharedPointer<RenderTarget> Ptr;
 		private:
 			FrameBuffer::Ptr framebuffer;
-			std::vector<Texture2D::Ptr> colorbuffers;
+			struct ColorBuffer
+			{
+				Texture2D::Ptr texture;
+				MipmapPolicy::List mipmaps;
+				unsigned int interval;
+			};
+			std::vector<ColorBuffer> colorbuffers;
 			Texture::Ptr depthbuffer;
 	};
 }
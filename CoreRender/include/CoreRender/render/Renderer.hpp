@@ -26,8 +26,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "RenderContext.hpp"
 #include "../core/Log.hpp"
 #include "Shader.hpp"
+#include "RenderStats.hpp"
+#include "FrameCapture.hpp"
+#include "../core/Semaphore.hpp"
+#include "../core/MPSCQueue.hpp"
+#include "../core/HashMap.hpp"
 
-#include <queue>
+#include <vector>
+#include <deque>
+#include <tbb/atomic.h>
 
 namespace cr
 {
@@ -39,6 +46,7 @@ namespace render
 {
 	class VideoDriver;
 	class GraphicsEngine;
+	class UploadThread;
 	struct PipelineInfo;
 	struct RenderPassInfo;
 
@@ -49,62 +57,389 @@ namespace render
 			         RenderContext::Ptr secondary,
 			         core::Log::Ptr log,
 			         VideoDriver *driver,
-			         GraphicsEngine *input);
+			         GraphicsEngine *input,
+			         unsigned int framesinflight = 1);
 			~Renderer();
 
 			void registerNew(RenderResource::Ptr res);
 			void registerShaderUpload(Shader::Ptr shader);
 			void registerUpload(RenderResource::Ptr res);
+			/**
+			 * Moves a pending upload of the upload thread in front of the
+			 * uploads which are not used by any queued frame. Called by
+			 * RenderResource::markUsed() if the resource is waiting for an
+			 * upload.
+			 */
+			void prioritizeUpload(RenderResource::Ptr res);
 			void registerDelete(RenderResource *res);
 
 			void enterThread();
 			void exitThread();
 
 			void uploadNewObjects();
+			/**
+			 * Queues the frame which was built in the memory returned by
+			 * getNextFrameMemory() for rendering. The caller has to make sure
+			 * that less than getFramesInFlight() frames are queued.
+			 */
 			void prepareRendering(PipelineInfo *renderdata,
 			                      unsigned int pipelinecount);
-			void uploadObjects();
-			void deleteObjects();
+			/**
+			 * Uploads pending resources. Resources used by the frame which is
+			 * rendered next are always uploaded, the others only as long as the
+			 * upload budget (see setUploadBudget()) is not exhausted, the rest
+			 * is deferred to later frames in the order of registration.
+			 * Resources which are not shared between contexts are always
+			 * uploaded here, even if an upload thread is used.
+			 * @param all If true, all pending resources are uploaded.
+			 */
+			void uploadObjects(bool all = false);
+			/**
+			 * Limits the uploads of resources which are not used by the
+			 * current frame. At least one of these resources is uploaded every
+			 * frame even if the budget is exceeded.
+			 * @param bytes Maximum number of bytes uploaded per frame, 0 means
+			 * unlimited.
+			 * @param time Maximum time spent uploading per frame, 0 means
+			 * unlimited.
+			 */
+			void setUploadBudget(unsigned int bytes, core::Duration time);
+			/**
+			 * Moves the uploads to a separate thread. Afterwards,
+			 * uploadObjects() only waits for the uploads of the resources used
+			 * by the frame and hands the finished uploads over to the render
+			 * thread via fences. The upload budget is not used in this case.
+			 * @param thread Upload thread or 0 if the uploads shall be done in
+			 * uploadObjects() again. Has to be stopped before.
+			 */
+			void setUploadThread(UploadThread *thread);
+			/**
+			 * Uploads the oldest queued resource, preferring the ones used by
+			 * queued frames, and creates a fence for it. Called by the upload
+			 * thread. Resources which are not shared between contexts (see
+			 * RenderResource::isSharedBetweenContexts()) are never uploaded
+			 * here but by uploadObjects() in the render thread.
+			 * @return False if no upload of a created resource was queued.
+			 */
+			bool uploadNextObject();
+			/**
+			 * Destroys the deleted resources which are not referenced by any
+			 * frame which the GPU might still be executing. If the driver
+			 * supports fences, these are the frames whose fence has not been
+			 * passed yet, otherwise the frames which have not been rendered.
+			 * At most as many resources as set with setDeletionBudget() are
+			 * destroyed.
+			 * @param all If true, all deleted resources are destroyed.
+			 */
+			void deleteObjects(bool all = false);
+			/**
+			 * Limits the number of resources destroyed per frame so that the
+			 * cost of deleting many resources at once is spread over several
+			 * frames.
+			 * @param resources Maximum number of resources, 0 means unlimited.
+			 */
+			void setDeletionBudget(unsigned int resources)
+			{
+				deletionbudget = resources;
+			}
 
+			/**
+			 * Renders the oldest queued frame.
+			 */
 			void render();
 
+			/**
+			 * Stores the statistics of the frame which was just rendered and
+			 * resets the statistics of the driver. Called after render() by
+			 * the render thread.
+			 */
+			void storeStats();
+			/**
+			 * Returns the statistics of the last completely rendered frame.
+			 */
+			RenderStats getStats();
+
+			/**
+			 * Writes the next frame which is rendered to a file.
+			 * @param file File the capture is written to.
+			 */
+			void captureFrame(core::File::Ptr file);
+			/**
+			 * Renders a captured frame. Must be called from the thread which
+			 * owns the primary context.
+			 * @param capture Captured frame.
+			 * @param passtimes If not 0, the time needed for every pass is
+			 * appended to this list.
+			 */
+			void replayFrame(FrameCapture::Ptr capture,
+			                 std::vector<core::Duration> *passtimes);
+
+			/**
+			 * Returns the maximum number of frames which can be queued for
+			 * rendering while the next frame is being built.
+			 */
+			unsigned int getFramesInFlight()
+			{
+				return framesinflight;
+			}
+			/**
+			 * Returns the index of the frame which is currently being built,
+			 * i.e. the number of frames passed to prepareRendering().
+			 */
+			unsigned int getBuildFrame()
+			{
+				return buildframe;
+			}
+			/**
+			 * Returns the number of frames which have been rendered
+			 * completely. Data used by frame i can be reused once this is
+			 * larger than i.
+			 */
+			unsigned int getRenderedFrames()
+			{
+				return renderedframes;
+			}
+
 			core::Log::Ptr getLog()
 			{
 				return log;
 			}
 			core::MemoryPool *getNextFrameMemory()
 			{
-				return memory[0];
+				return memory[buildframe % memory.size()];
 			}
 			core::MemoryPool *getCurrentFrameMemory()
 			{
-				return memory[1];
+				return memory[renderedframes % memory.size()];
 			}
 			VideoDriver *getDriver()
 			{
 				return driver;
 			}
 		private:
+			/**
+			 * Returns true if the resource is used by the frame which is
+			 * rendered next or any later queued frame.
+			 */
+			bool isUsedByQueuedFrame(RenderResource *res)
+			{
+				int sinceused = res->getLastUsedFrame() - renderedframes;
+				return sinceused >= 0;
+			}
+			void waitForUploadThread();
+			void collectUploadFences();
+
 			void renderPipeline(PipelineInfo *info);
 			void renderPass(RenderPassInfo *info);
+			void executeCommands(RenderPassInfo *info);
 
 			RenderContext::Ptr primary;
 			RenderContext::Ptr secondary;
 			core::Log::Ptr log;
-			core::MemoryPool *memory[2];
+			unsigned int framesinflight;
+			/**
+			 * Frame memory, one pool for each frame in flight plus one for the
+			 * frame being built.
+			 */
+			std::vector<core::MemoryPool*> memory;
 			VideoDriver *driver;
 
-			tbb::spin_mutex newmutex;
-			std::queue<RenderResource::Ptr> newqueue;
-			tbb::spin_mutex shaderuploadmutex;
-			std::queue<Shader::Ptr> shaderuploadqueue;
+			core::MPSCQueue<RenderResource::Ptr> newqueue;
+			std::vector<RenderResource::Ptr> newobjects;
+			core::MPSCQueue<Shader::Ptr> shaderuploadqueue;
+			std::vector<Shader::Ptr> newshaders;
+			struct UploadEntry
+			{
+				RenderResource::Ptr resource;
+				/**
+				 * Time of the registration, used for the latency statistics.
+				 */
+				core::Time time;
+				/**
+				 * Upload size at the time of the registration.
+				 */
+				unsigned int size;
+				/**
+				 * Number identifying the registration in the upload thread
+				 * lists.
+				 */
+				unsigned int sequence;
+				/**
+				 * True if the upload is in the list of uploads used by
+				 * queued frames.
+				 */
+				bool prioritized;
+			};
+			core::MPSCQueue<UploadEntry> uploadqueue;
+			/**
+			 * Uploads of resources which are not shared between contexts and
+			 * therefore are uploaded by the render thread.
+			 */
+			core::MPSCQueue<UploadEntry> renderuploadqueue;
+			std::vector<UploadEntry> renderuploads;
 			tbb::spin_mutex uploadmutex;
-			std::queue<RenderResource::Ptr> uploadqueue;
-			tbb::spin_mutex deletemutex;
-			std::queue<RenderResource*> deletequeue;
+			unsigned int uploadbytebudget;
+			core::Duration uploadtimebudget;
+			/**
+			 * Uploads which were deferred because of the upload budget. Only
+			 * accessed by the render thread.
+			 */
+			std::vector<UploadEntry> deferreduploads;
+			UploadThread *uploadthread;
+			/**
+			 * Uploads which were drained from the queue by the upload thread
+			 * and have not been started yet.
+			 */
+			typedef core::HashMap<RenderResource*, UploadEntry> AsyncUploadMap;
+			AsyncUploadMap asyncuploads;
+			/**
+			 * Entries drained from uploadqueue by sortAsyncUploads().
+			 */
+			std::vector<UploadEntry> drainedasyncuploads;
+			/**
+			 * Position of an upload in one of the ordered upload lists. The
+			 * position is stale if the resource is not in asyncuploads with
+			 * the same sequence number anymore. The resource is not
+			 * dereferenced before that has been checked.
+			 */
+			struct AsyncUploadRef
+			{
+				RenderResource *resource;
+				unsigned int sequence;
+			};
+			/**
+			 * Created resources used by queued frames, oldest first.
+			 */
+			std::deque<AsyncUploadRef> priorityuploads;
+			/**
+			 * All other created resources, oldest first.
+			 */
+			std::deque<AsyncUploadRef> olduploads;
+			/**
+			 * Resources which have not been created yet.
+			 */
+			std::vector<AsyncUploadRef> uncreateduploads;
+			/**
+			 * Resources used by the frame which is being built which might
+			 * have a pending upload.
+			 */
+			core::MPSCQueue<RenderResource::Ptr> prioritizequeue;
+			std::vector<RenderResource::Ptr> prioritized;
+			unsigned int uploadsequence;
+			/**
+			 * Number of prioritized entries in asyncuploads.
+			 */
+			unsigned int priorityuploadcount;
+			/**
+			 * Sum of the upload sizes of the entries in asyncuploads.
+			 */
+			unsigned int asyncuploadbytes;
+			/**
+			 * Incremented whenever uploadNewObjects() created resources.
+			 */
+			tbb::atomic<unsigned int> creategeneration;
+			/**
+			 * Value of creategeneration when uncreateduploads was checked
+			 * last.
+			 */
+			unsigned int checkedgeneration;
+
+			/**
+			 * Moves the uploads queued for the upload thread into the
+			 * priority and age ordered lists. Has to be called with
+			 * uploadmutex locked.
+			 */
+			void sortAsyncUploads();
+			/**
+			 * Takes the next upload of the upload thread, i.e. the oldest one
+			 * used by a queued frame or the oldest one otherwise. Has to be
+			 * called with uploadmutex locked.
+			 * @return False if no upload of a created resource is queued.
+			 */
+			bool takeAsyncUpload(UploadEntry &entry);
+			/**
+			 * Resource which is currently uploaded by the upload thread.
+			 */
+			RenderResource *currentupload;
+			/**
+			 * Number of times the upload thread drained the upload queue.
+			 */
+			unsigned int uploaddrains;
+			/**
+			 * Set if the render thread waits for uploaddone.
+			 */
+			bool uploadwaiting;
+			core::Semaphore uploaddone;
+			struct UploadFence
+			{
+				void *fence;
+				unsigned int size;
+				core::Duration latency;
+			};
+			/**
+			 * Uploads finished by the upload thread which the render thread
+			 * has not waited for yet.
+			 */
+			std::vector<UploadFence> uploadfences;
+			std::vector<UploadFence> renderfences;
+			struct DeleteEntry
+			{
+				RenderResource *resource;
+				/**
+				 * The resource can be destroyed once this many frames have
+				 * been completed by the GPU.
+				 */
+				unsigned int frame;
+				/**
+				 * GPU memory used by the resource.
+				 */
+				unsigned int size;
+			};
+			core::MPSCQueue<DeleteEntry> deletequeue;
+			/**
+			 * Drained entries which might still be used by queued frames.
+			 */
+			std::vector<DeleteEntry> pendingdeletes;
+			tbb::atomic<unsigned int> deletionbudget;
+			struct FrameFence
+			{
+				void *fence;
+				/**
+				 * Number of frames which are complete when the fence has been
+				 * passed.
+				 */
+				unsigned int frames;
+			};
+			/**
+			 * Fences inserted after every rendered frame, oldest first.
+			 */
+			std::vector<FrameFence> framefences;
+			/**
+			 * Number of frames which the GPU has completely executed.
+			 */
+			unsigned int completedframes;
+
+			struct FrameInfo
+			{
+				PipelineInfo *renderdata;
+				unsigned int pipelinecount;
+			};
+			/**
+			 * Queued frames, indexed like the memory pools.
+			 */
+			std::vector<FrameInfo> frames;
+			tbb::atomic<unsigned int> buildframe;
+			tbb::atomic<unsigned int> renderedframes;
+
+			tbb::spin_mutex statsmutex;
+			RenderStats stats;
 
-			PipelineInfo *renderdata;
-			unsigned int pipelinecount;
+			tbb::spin_mutex capturemutex;
+			core::File::Ptr capturefile;
+			/**
+			 * Capture which was replayed last and still holds driver data.
+			 */
+			FrameCapture::Ptr replayedcapture;
 
 			// TODO: We should not have any pointer to the GraphicsEngine here
 			GraphicsEngine *input;
@@ -23,13 +23,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_RENDER_SHADER_HPP_INCLUDED_
 
 #include "RenderResource.hpp"
-#include "../core/HashMap.hpp"
+#include "VertexLayout.hpp"
+
+#include <vector>
+#include <tbb/atomic.h>
+#include <tbb/spin_rw_mutex.h>
 
 namespace cr
 {
 namespace render
 {
 	class ShaderText;
+	struct PipelineState;
 
 	/**
 	 * Resource containing a single shader instance.
@@ -101,6 +106,15 @@ namespace render
 			 * @return Shader handle.
 			 */
 			int getAttrib(const std::string &name);
+			/**
+			 * Returns the shader handle to an attrib.
+			 * @param slot Slot of the attrib name (see ShaderSlots).
+			 * @return Shader handle.
+			 */
+			int getAttrib(unsigned int slot)
+			{
+				return attribs.get(slot);
+			}
 			/**
 			 * Adds a uniform name to the shader. Only uniforms added like this
 			 * get valid shader handles.
@@ -113,6 +127,15 @@ namespace render
 			 * @return Shader handle.
 			 */
 			int getUniform(const std::string &name);
+			/**
+			 * Returns the shader handle to a uniform.
+			 * @param slot Slot of the uniform name (see ShaderSlots).
+			 * @return Shader handle.
+			 */
+			int getUniform(unsigned int slot)
+			{
+				return uniforms.get(slot);
+			}
 			/**
 			 * Adds a sampler name to the shader. Only textures added like this
 			 * get valid shader handles.
@@ -125,6 +148,43 @@ namespace render
 			 * @return Shader handle.
 			 */
 			int getTexture(const std::string &name);
+			/**
+			 * Returns the shader handle to a texture.
+			 * @param slot Slot of the sampler name (see ShaderSlots).
+			 * @return Shader handle.
+			 */
+			int getTexture(unsigned int slot)
+			{
+				return textures.get(slot);
+			}
+
+			/**
+			 * Makes this an instanced shader. The value of the given uniform
+			 * is then passed to the shader as a per-instance vertex attrib
+			 * with the same name, so that batches which only differ in this
+			 * uniform can be drawn with a single draw call. This is called by
+			 * ShaderText::getShader() for contexts with instancing.
+			 * @param name Name of the per-instance uniform.
+			 */
+			void setInstanceUniform(const std::string &name);
+			/**
+			 * Returns the slot of the per-instance uniform.
+			 * @return Slot (see ShaderSlots) or -1 if the shader is not
+			 * instanced.
+			 */
+			int getInstanceUniform()
+			{
+				return instanceslot;
+			}
+			/**
+			 * Returns the shader handle of the attrib receiving the
+			 * per-instance uniform.
+			 * @return Shader handle.
+			 */
+			int getInstanceAttrib()
+			{
+				return instanceattrib;
+			}
 
 			/**
 			 * Updates the shader. This registers the shader for reupload.
@@ -136,6 +196,28 @@ namespace render
 			{
 			}
 
+			/**
+			 * Returns the pipeline state object for this shader and a vertex
+			 * layout. The object is only created on the first call for a
+			 * layout and is recreated after the shader has been uploaded
+			 * again. This function is thread-safe and can be called by
+			 * multiple threads submitting jobs to a pipeline.
+			 * @param layout Vertex layout of the rendered geometry. The layout
+			 * must not be changed afterwards.
+			 * @return Pipeline state object which stays valid until the
+			 * shader is destroyed.
+			 */
+			PipelineState *getPipelineState(VertexLayout::Ptr layout);
+			/**
+			 * Marks all pipeline state objects as outdated. Called by the
+			 * renderer after uploadShader() as the shader handles might have
+			 * changed.
+			 */
+			void invalidatePipelineStates()
+			{
+				version++;
+			}
+
 			/**
 			 * Returns the handle to this shader. This usually is the OpenGL
 			 * program handle.
@@ -182,10 +264,51 @@ namespace render
 			std::string ts;
 			unsigned int blendMode;
 
-			typedef core::HashMap<std::string, int>::Type HandleMap;
-			HandleMap attribs;
-			HandleMap uniforms;
-			HandleMap textures;
+			/**
+			 * Table mapping name slots to shader handles. The table is
+			 * indexed directly by the slot and therefore grows up to the
+			 * largest name ID added to the shader. Entries for names which
+			 * were not added to the shader are -1.
+			 */
+			struct HandleTable
+			{
+				void add(unsigned int slot);
+				int get(unsigned int slot) const
+				{
+					if (slot >= handles.size())
+						return -1;
+					return handles[slot];
+				}
+
+				/**
+				 * Slots which were added to the shader.
+				 */
+				std::vector<unsigned int> slots;
+				std::vector<int> handles;
+			};
+			HandleTable attribs;
+			HandleTable uniforms;
+			HandleTable textures;
+
+			int instanceslot;
+			int instanceattrib;
+		private:
+			PipelineState *createPipelineState(VertexLayout *layout);
+
+			struct PipelineStateEntry
+			{
+				VertexLayout::Ptr layout;
+				unsigned int version;
+				PipelineState *state;
+			};
+			tbb::spin_rw_mutex pipelinestatemutex;
+			std::vector<PipelineStateEntry> pipelinestates;
+			/**
+			 * Outdated pipeline state objects which might still be used by
+			 * queued frames.
+			 */
+			std::vector<PipelineState*> retiredstates;
+			tbb::atomic<unsigned int> version;
 	};
 }
 }
@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_SHADERSLOTS_HPP_INCLUDED_
+#define _CORERENDER_RENDER_SHADERSLOTS_HPP_INCLUDED_
+
+#include "../core/Name.hpp"
+
+namespace cr
+{
+namespace render
+{
+	/**
+	 * Maps the names of shader attribs, uniforms and samplers to integer
+	 * slots. The slot of a name is the ID of the interned core::Name.
+	 *
+	 * Names are resolved once when shader texts, materials and vertex layouts
+	 * are loaded. While rendering, the slots are used as indices into the
+	 * handle tables of Shader and as keys in UniformData, so that no strings
+	 * have to be compared or hashed when jobs are submitted. Slots are never
+	 * freed and are only valid for the lifetime of the process.
+	 *
+	 * All functions are thread-safe.
+	 */
+	class ShaderSlots
+	{
+		public:
+			/**
+			 * Returns the slot for a name, interning the name if it has not
+			 * been used before.
+			 * @param name Attrib, uniform or sampler name.
+			 * @return Slot of the name.
+			 */
+			static unsigned int get(const std::string &name)
+			{
+				return core::Name(name).getID();
+			}
+			/**
+			 * Returns the slot for a name without interning it.
+			 * @param name Attrib, uniform or sampler name.
+			 * @param slot Set to the slot of the name if it exists.
+			 * @return True if the name was interned already.
+			 */
+			static bool find(const std::string &name, unsigned int &slot)
+			{
+				core::Name result;
+				if (!core::Name::find(name, result))
+					return false;
+				slot = result.getID();
+				return true;
+			}
+			/**
+			 * Returns the name belonging to a slot. The returned reference
+			 * stays valid until the program exits.
+			 * @param slot Slot as returned by get().
+			 * @return Name of the slot.
+			 */
+			static const std::string &getName(unsigned int slot)
+			{
+				return core::Name::fromID(slot).getString();
+			}
+	};
+}
+}
+
+#endif
@@ -27,8 +27,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Shader.hpp"
 #include "ShaderVariableType.hpp"
 #include "UniformData.hpp"
+#include "../core/Name.hpp"
+#include "../core/HashMap.hpp"
 
 #include <map>
+#include <tbb/spin_rw_mutex.h>
 
 namespace cr
 {
@@ -87,23 +90,30 @@ namespace render
 			 * shader.
 			 * @param ts Tesselation shader text name. Leave as "" for no
 			 * tesselation shader.
+			 * @param blendmode Blend mode used for the context.
+			 * @param instanceuniform Name of the per-instance uniform if the
+			 * context supports instancing, usually "worldMat". The shaders
+			 * are then compiled with INSTANCED defined and have to declare
+			 * an attrib with this name instead of the uniform. Leave as "" to
+			 * disable instancing.
 			 * @return Always returns true as this function currently does not
 			 * check whether the texts actually exist.
 			 * @todo Currently shader creation happens in getShader(). It has
 			 * to be done here though as getShader() is called too late.
 			 */
-			bool addContext(const std::string &name,
+			bool addContext(core::Name name,
 			                const std::string &vs,
 			                const std::string &fs,
 			                const std::string &gs = "",
 			                const std::string &ts = "",
-			                const BlendMode::List &blendmode = BlendMode::Solid);
+			                const BlendMode::List &blendmode = BlendMode::Solid,
+			                const std::string &instanceuniform = "");
 			/**
 			 * Returns whether this material has a certain context.
 			 * @param name Name of the context.
 			 * @return True if the context exists for this material.
 			 */
-			bool hasContext(const std::string &name);
+			bool hasContext(core::Name name);
 
 			/**
 			 * Adds a flag to the material. A flag can then be checked in
@@ -156,12 +166,14 @@ namespace render
 			 * Returns a shader instance for a context, taking a certain flag
 			 * set into account. Not that this must not called after
 			 * GraphicsEngine::beginFrame() as it might create a new resource.
+			 * This function is thread-safe and can be called by multiple
+			 * threads submitting jobs to a pipeline.
 			 * @param context Shader context.
 			 * @param flags Flag bitset as returned by getFlags().
 			 * @return Shader or 0 if no shader could be created.
-			 * @todo This (and other functions here) needs to be made threadsafe.
+			 * @todo The other functions here need to be made threadsafe.
 			 */
-			Shader::Ptr getShader(const std::string &context,
+			Shader::Ptr getShader(core::Name context,
 			                      unsigned int flags);
 
 			virtual const char *getType()
@@ -183,6 +195,7 @@ namespace render
 
 			typedef core::SharedPointer<ShaderText> Ptr;
 		private:
+			unsigned int parseFlags(const std::string &flagsset);
 			bool resolveIncludes(const std::string &text,
 			                     std::string &output,
 			                     const std::string &directory);
@@ -194,17 +207,28 @@ namespace render
 				std::string gs;
 				std::string ts;
 				BlendMode::List blendMode;
+				std::string instanceuniform;
 			};
 
 			std::map<std::string, std::string> texts;
-			std::map<std::string, Context> contexts;
+			typedef core::HashMap<core::Name, Context> ContextMap;
+			ContextMap contexts;
 
 			std::vector<std::string> flags;
 			unsigned int flagdefaults;
 			std::vector<std::string> attribs;
 			std::vector<std::string> textures;
 
-			std::vector<Shader::Ptr> shaders;
+			struct ShaderInfo
+			{
+				core::Name context;
+				unsigned int flags;
+				Shader::Ptr shader;
+			};
+
+			tbb::spin_rw_mutex shadermutex;
+			std::vector<ShaderInfo> shaders;
+			std::map<std::string, unsigned int> flagcache;
 
 			UniformData uniforms;
 	};
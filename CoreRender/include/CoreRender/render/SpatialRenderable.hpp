@@ -48,6 +48,7 @@ namespace render
 			SpatialRenderable()
 				: transmat(math::Matrix4::Identity()),
 				projmat(math::Matrix4::Identity()),
+				viewmat(math::Matrix4::Identity()), hasviewmat(false),
 				dirty(true)
 			{
 			}
@@ -76,6 +77,35 @@ namespace render
 				this->projmat = projmat;
 				dirty = true;
 			}
+			/**
+			 * Sets the view matrix of the camera. This is not used for
+			 * rendering (the projection matrix already has to contain the
+			 * camera transformation), but to compute the view space depth of
+			 * the render jobs for depth sorting. If no view matrix is set, the
+			 * jobs are submitted with depth 0.
+			 * @param viewmat New view matrix.
+			 */
+			void setViewMat(const math::Matrix4 &viewmat)
+			{
+				this->viewmat = viewmat;
+				hasviewmat = true;
+			}
+			/**
+			 * Returns the view matrix set with setViewMat().
+			 * @return View matrix.
+			 */
+			const math::Matrix4 &getViewMat()
+			{
+				return viewmat;
+			}
+			/**
+			 * Returns whether a view matrix was set with setViewMat().
+			 * @return True if a view matrix is available.
+			 */
+			bool hasViewMat()
+			{
+				return hasviewmat;
+			}
 			/**
 			 * Returns the transformation matrix.
 			 * @return Transformation matrix.
@@ -126,6 +156,8 @@ namespace render
 			}
 			math::Matrix4 transmat;
 			math::Matrix4 projmat;
+			math::Matrix4 viewmat;
+			bool hasviewmat;
 			math::Matrix4 worldmat;
 			math::Matrix4 worldnormalmat;
 			bool dirty;
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_STATECHANGES_HPP_INCLUDED_
+#define _CORERENDER_RENDER_STATECHANGES_HPP_INCLUDED_
+
+namespace cr
+{
+namespace render
+{
+	/**
+	 * Weights used to estimate the GPU cost of state changes. The values are
+	 * in arbitrary units, only the ratios between them matter.
+	 */
+	struct CostWeights
+	{
+		/**
+		 * Constructor. Sets default weights which roughly resemble the
+		 * relative driver overhead on desktop OpenGL implementations.
+		 */
+		CostWeights()
+			: program(10.0f), buffer(2.0f), texture(3.0f), uniform(1.0f),
+			rendertarget(25.0f), draw(4.0f)
+		{
+		}
+
+		float program;
+		float buffer;
+		float texture;
+		float uniform;
+		float rendertarget;
+		float draw;
+	};
+
+	/**
+	 * State changes made by the video driver while drawing. These are only
+	 * counted by the accounting null driver (VideoDriverType::NullAccounting).
+	 */
+	struct StateChanges
+	{
+		StateChanges()
+			: programs(0), buffers(0), textures(0), uniforms(0),
+			rendertargets(0), draws(0)
+		{
+		}
+
+		/**
+		 * Returns the estimated cost of the state changes.
+		 * @param weights Cost of every single state change.
+		 */
+		float getCost(const CostWeights &weights = CostWeights()) const
+		{
+			return programs * weights.program
+			     + buffers * weights.buffer
+			     + textures * weights.texture
+			     + uniforms * weights.uniform
+			     + rendertargets * weights.rendertarget
+			     + draws * weights.draw;
+		}
+
+		StateChanges &operator+=(const StateChanges &other)
+		{
+			programs += other.programs;
+			buffers += other.buffers;
+			textures += other.textures;
+			uniforms += other.uniforms;
+			rendertargets += other.rendertargets;
+			draws += other.draws;
+			return *this;
+		}
+
+		/**
+		 * Number of shader program switches.
+		 */
+		unsigned int programs;
+		/**
+		 * Number of vertex and index buffer binds, including uploads of
+		 * instance data.
+		 */
+		unsigned int buffers;
+		/**
+		 * Number of texture binds.
+		 */
+		unsigned int textures;
+		/**
+		 * Number of uniform uploads. Uniforms which the program already
+		 * holds are not uploaded again.
+		 */
+		unsigned int uniforms;
+		/**
+		 * Number of render target switches.
+		 */
+		unsigned int rendertargets;
+		/**
+		 * Number of draw calls.
+		 */
+		unsigned int draws;
+	};
+}
+}
+
+#endif
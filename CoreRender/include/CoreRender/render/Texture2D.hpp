@@ -116,6 +116,9 @@ namespace render
 			virtual bool load();
 			virtual bool unload();
 
+			virtual unsigned int getUploadSize();
+			virtual unsigned int getMemorySize();
+
 			/**
 			 * Returns the width of the texture.
 			 * @return Width.
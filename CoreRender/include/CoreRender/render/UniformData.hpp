@@ -46,6 +46,12 @@ namespace render
 			 * @param name Name of the uniform in shaders.
 			 */
 			Uniform(const std::string &name);
+			/**
+			 * Constructor.
+			 * @param slot Slot of the uniform name as returned by
+			 * ShaderSlots::get().
+			 */
+			Uniform(unsigned int slot);
 			/**
 			 * Constructor.
 			 * @param name Name of the uniform in shaders.
@@ -87,9 +93,14 @@ namespace render
 			 * Returns the name of the uniform.
 			 * @return Name.
 			 */
-			const std::string &getName() const
+			const std::string &getName() const;
+			/**
+			 * Returns the slot of the uniform name.
+			 * @return Slot as returned by ShaderSlots::get().
+			 */
+			unsigned int getSlot() const
 			{
-				return name;
+				return slot;
 			}
 
 			/**
@@ -136,7 +147,7 @@ namespace render
 				return shaderhandle;
 			}
 		private:
-			std::string name;
+			unsigned int slot;
 			ShaderVariableType::List type;
 			float data[16];
 			int shaderhandle;
@@ -173,6 +184,28 @@ namespace render
 			 * @return Uniform with the name.
 			 */
 			Uniform &add(const std::string &name);
+			/**
+			 * Adds a new uniform if no uniform with the slot exists and
+			 * returns it, or returns the existing uniform with this slot.
+			 * This is faster than add(const std::string&) as the name does
+			 * not have to be resolved.
+			 * @param slot Slot of the uniform name as returned by
+			 * ShaderSlots::get().
+			 * @return Uniform with the slot.
+			 */
+			Uniform &add(unsigned int slot);
+			/**
+			 * Returns the uniform with the given slot.
+			 * @param slot Slot of the uniform name.
+			 * @return Uniform with the slot or 0 if no uniform was found.
+			 */
+			Uniform *find(unsigned int slot);
+			/**
+			 * Returns the uniform with the given slot.
+			 * @param slot Slot of the uniform name.
+			 * @return Uniform with the slot or 0 if no uniform was found.
+			 */
+			const Uniform *find(unsigned int slot) const;
 
 			/**
 			 * Iterates through all uniforms in this instance and looks for them
@@ -197,12 +230,12 @@ namespace render
 			 */
 			const Uniform &operator[](const std::string &name) const;
 
-			typedef core::HashMap<std::string, Uniform>::Type UniformMap;
+			typedef core::HashMap<unsigned int, Uniform, 8> UniformMap;
 			/**
-			 * Returns all uniforms in a map.
+			 * Returns all uniforms in a map, indexed by their slot.
 			 * @return Uniform map.
 			 */
-			const UniformMap &getData()
+			const UniformMap &getData() const
 			{
 				return uniforms;
 			}
@@ -0,0 +1,83 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_UPLOADTHREAD_HPP_INCLUDED_
+#define _CORERENDER_RENDER_UPLOADTHREAD_HPP_INCLUDED_
+
+#include "RenderContext.hpp"
+#include "../core/Thread.hpp"
+#include "../core/Semaphore.hpp"
+
+#include <tbb/atomic.h>
+
+namespace cr
+{
+namespace render
+{
+	class Renderer;
+
+	/**
+	 * Thread which uploads resources with its own render context sharing the
+	 * resources with the one of the render thread. Every upload is followed
+	 * by a fence which the render thread waits for before it uses the
+	 * resource, so the render thread itself does not spend any time on
+	 * uploads.
+	 */
+	class UploadThread
+	{
+		public:
+			/**
+			 * Constructor.
+			 * @param renderer Renderer which queues the uploads.
+			 * @param context Context created with RenderContext::clone() which
+			 * is only used by this thread.
+			 */
+			UploadThread(Renderer *renderer, RenderContext::Ptr context);
+			~UploadThread();
+
+			bool start();
+			/**
+			 * Stops the thread. Uploads which have not been started yet remain
+			 * in the queue of the renderer.
+			 */
+			bool stop();
+
+			/**
+			 * Signals the thread that an upload has been queued. Called by
+			 * Renderer::registerUpload().
+			 */
+			void signalUpload();
+		private:
+			void entry();
+
+			core::Thread thread;
+			tbb::atomic<bool> stopping;
+
+			core::Semaphore uploads;
+
+			Renderer *renderer;
+			RenderContext::Ptr context;
+	};
+}
+}
+
+#endif
@@ -131,6 +131,8 @@ namespace render
 				return usage;
 			}
 
+			virtual unsigned int getMemorySize();
+
 			virtual const char *getType()
 			{
 				return "VertexBuffer";
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_RENDER_VERTEXLAYOUT_HPP_INCLUDED_
 
 #include "../core/ReferenceCounted.hpp"
+#include "ShaderSlots.hpp"
 
 #include <string>
 
@@ -55,6 +56,10 @@ namespace cr
 			 * Name of the attrib in shaders.
 			 */
 			std::string name;
+			/**
+			 * Slot of the attrib name (see ShaderSlots).
+			 */
+			unsigned int slot;
 			/**
 			 * Vertex buffer slot of this element.
 			 */
@@ -146,6 +151,7 @@ namespace cr
 				                unsigned int stride = 0)
 				{
 					elements[element].name = name;
+					elements[element].slot = ShaderSlots::get(name);
 					elements[element].vbslot = vbslot;
 					elements[element].components = components;
 					elements[element].offset = offset;
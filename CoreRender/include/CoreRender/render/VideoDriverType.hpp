@@ -39,6 +39,13 @@ namespace render
 			 * profile the application with relation to CPU load.
 			 */
 			Null,
+			/**
+			 * Null video driver which additionally simulates the bound state
+			 * and counts the state changes a real driver would have to make
+			 * (see RenderStats::getStateChanges()). Can be used to compare
+			 * sorting and batching strategies without a GPU.
+			 */
+			NullAccounting,
 			/**
 			 * OpenGL 2.0 video driver.
 			 */
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Resource.hpp"
 #include "CoreRender/core/Semaphore.hpp"
 #include "CoreRender/core/Thread.hpp"
+#include "CoreRender/core/TaskScheduler.hpp"
 #include "CoreRender/core/Log.hpp"
 
 #include <queue>
@@ -33,6 +34,24 @@ namespace cr
 {
 namespace res
 {
+	/**
+	 * Task which loads a single resource, used instead of LoadingThread if
+	 * the resource manager has a task scheduler.
+	 */
+	class LoadingTask : public core::Task
+	{
+		public:
+			LoadingTask(Resource::Ptr res, core::Log::Ptr log)
+				: core::Task(true), res(res), log(log)
+			{
+			}
+
+			virtual void run();
+		private:
+			Resource::Ptr res;
+			core::Log::Ptr log;
+	};
+
 	class LoadingThread
 	{
 		public:
@@ -49,7 +68,6 @@ namespace res
 			core::Thread thread;
 
 			core::Semaphore workavailable;
-			bool stopping;
 
 			tbb::spin_mutex queuemutex;
 			std::queue<Resource::Ptr> loadingqueue;
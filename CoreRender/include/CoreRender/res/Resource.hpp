@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define _CORERENDER_RES_RESOURCE_HPP_INCLUDED_
 
 #include "../core/ReferenceCounted.hpp"
+#include "../core/Name.hpp"
 
 #include <string>
 #include <tbb/spin_mutex.h>
@@ -63,7 +64,7 @@ namespace res
 			 * @param rmgr The ResourceManager this resource is inserted into.
 			 * @param name The unique name used for this resource.
 			 */
-			Resource(ResourceManager *rmgr, const std::string &name);
+			Resource(ResourceManager *rmgr, core::Name name);
 			/**
 			 * Destructor. Also removes the resource from the manager.
 			 */
@@ -73,7 +74,7 @@ namespace res
 			 * Returns the name of the resource.
 			 * @note This function is thread-safe.
 			 */
-			std::string getName();
+			core::Name getName();
 
 			/**
 			 * Queues the resource for loading from a file.
@@ -163,7 +164,7 @@ namespace res
 			bool loading;
 			std::vector<core::Semaphore*> waiting;
 
-			std::string name;
+			core::Name name;
 			std::string path;
 
 			ResourceManager *rmgr;
@@ -24,10 +24,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "../core/FileSystem.hpp"
 #include "../core/Log.hpp"
+#include "../core/TaskScheduler.hpp"
+#include "../core/HashMap.hpp"
 #include "Resource.hpp"
 #include "ResourceFactory.hpp"
 
-#include <map>
 #include <tbb/mutex.h>
 
 namespace cr
@@ -106,7 +107,7 @@ namespace res
 			 */
 			Resource::Ptr getOrLoad(const std::string &type,
 			                        const std::string &path,
-			                        const std::string &name = "");
+			                        core::Name name = core::Name());
 			/**
 			 * Checks whether a resource already exists and returns it or if no
 			 * resource was found creates one and queues it for loading.
@@ -122,7 +123,7 @@ namespace res
 			 */
 			template<class T> typename T::Ptr getOrLoad(const std::string &type,
 			                                            const std::string &path,
-			                                            const std::string &name = "")
+			                                            core::Name name = core::Name())
 			{
 				// TODO: Dynamic checks in debug version?
 				Resource::Ptr res = getOrLoad(type, path, name);
@@ -139,7 +140,7 @@ namespace res
 			 * created.
 			 */
 			Resource::Ptr getOrCreate(const std::string &type,
-			                          const std::string &name);
+			                          core::Name name);
 			/**
 			 * Checks whether a resource already exists and returns it or if no
 			 * resource was found creates one.
@@ -152,10 +153,10 @@ namespace res
 			 * class.
 			 */
 			template<class T> typename T::Ptr getOrCreate(const std::string &type,
-			                                              const std::string &name)
+			                                              core::Name name)
 			{
 				// TODO: Dynamic checks in debug version?
-				Resource::Ptr res = getOrLoad(type, name);
+				Resource::Ptr res = getOrCreate(type, name);
 				typename T::Ptr derived = (T*)res.get();
 				return derived;
 			}
@@ -168,7 +169,7 @@ namespace res
 			 * created.
 			 */
 			Resource::Ptr createResource(const std::string &type,
-			                             const std::string &name = "");
+			                             core::Name name = core::Name());
 			/**
 			 * Creates a new resource with of certain type.
 			 * @param type Resource type name.
@@ -180,7 +181,7 @@ namespace res
 			 * class.
 			 */
 			template<class T> typename T::Ptr createResource(const std::string &type,
-			                                                 const std::string &name = "")
+			                                                 core::Name name = core::Name())
 			{
 				// TODO: Dynamic checks in debug version?
 				Resource::Ptr res = createResource(type, name);
@@ -210,7 +211,7 @@ namespace res
 			 * @return Resource with the name or 0 if no resource was found.
 			 * @note This function is thread-safe.
 			 */
-			Resource::Ptr getResource(const std::string &name);
+			Resource::Ptr getResource(core::Name name);
 
 			/**
 			 * Queues a resource for loading. This is called by
@@ -256,12 +257,32 @@ namespace res
 			{
 				return log;
 			}
+
+			/**
+			 * Sets a task scheduler which is used for loading resources
+			 * instead of the loading thread. Waits until all resources which
+			 * were queued on the previous scheduler or the loading thread
+			 * have been loaded. The loading thread is stopped and only
+			 * started again when resources are queued without a scheduler.
+			 * Must not be called while other threads queue resources for
+			 * loading.
+			 * @param scheduler Task scheduler, or 0 to use the loading thread.
+			 */
+			void setTaskScheduler(core::TaskScheduler *scheduler);
+			/**
+			 * Returns the task scheduler used for loading resources.
+			 * @return Task scheduler or 0 if the loading thread is used.
+			 */
+			core::TaskScheduler *getTaskScheduler()
+			{
+				return scheduler;
+			}
 		private:
-			typedef std::map<std::string, Resource*> ResourceMap;
+			typedef core::HashMap<core::Name, Resource*> ResourceMap;
 			ResourceMap resources;
 
 			tbb::spin_mutex factorymutex;
-			typedef std::map<std::string, ResourceFactory::Ptr> FactoryMap;
+			typedef core::HashMap<std::string, ResourceFactory::Ptr> FactoryMap;
 			FactoryMap factories;
 
 			unsigned int namecounter;
@@ -269,7 +290,14 @@ namespace res
 			core::FileSystem::Ptr fs;
 			core::Log::Ptr log;
 
+			/**
+			 * Loading thread, created when the first resource is queued
+			 * without a task scheduler.
+			 */
 			LoadingThread *thread;
+			tbb::spin_mutex threadmutex;
+			core::TaskScheduler *scheduler;
+			core::TaskGroup loadinggroup;
 
 			tbb::mutex mutex;
 	};
@@ -0,0 +1,78 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CoreRender/core/AllocationCounter.hpp"
+
+#if defined(CORERENDER_DEBUG_ALLOCATIONS)
+	#include <tbb/atomic.h>
+	#include <cstdlib>
+	#include <new>
+
+static tbb::atomic<unsigned int> allocationcount;
+
+void *operator new(std::size_t size)
+{
+	allocationcount++;
+	void *memory = malloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+void *operator new[](std::size_t size)
+{
+	allocationcount++;
+	void *memory = malloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+void operator delete(void *memory) throw()
+{
+	free(memory);
+}
+void operator delete[](void *memory) throw()
+{
+	free(memory);
+}
+#endif
+
+namespace cr
+{
+namespace core
+{
+	bool AllocationCounter::isEnabled()
+	{
+#if defined(CORERENDER_DEBUG_ALLOCATIONS)
+		return true;
+#else
+		return false;
+#endif
+	}
+	unsigned int AllocationCounter::getCount()
+	{
+#if defined(CORERENDER_DEBUG_ALLOCATIONS)
+		return allocationcount;
+#else
+		return 0;
+#endif
+	}
+}
+}
@@ -32,47 +32,72 @@ namespace cr
 namespace core
 {
 	Log::Log(FileSystem::Ptr fs, const std::string &filename)
-		: consolelevel(LogLevel::Warning), filelevel(LogLevel::Information)
+		: consolelevel(LogLevel::Warning), filelevel(LogLevel::Information),
+		dequeuepos(0), direct(false)
 	{
+		enqueuepos = 0;
+		writtenpos = 0;
+		sleeping = 0;
+		stopping = false;
+		entries = new Entry[queuesize];
+		for (unsigned int i = 0; i < queuesize; i++)
+			entries[i].sequence = i;
+		// Get log start time
+		starttime = Time::Now();
 		// Open file
 		file = fs->open(filename, FileAccess::Write | FileAccess::Text, true);
 		if (!file)
 		{
 			std::cout << "Could not open log file." << std::endl;
-			return;
 		}
-		// Get log start time
-		starttime = Time::Now();
-		// Write file header
-		file->write("<html>\n<header>\n<title>CoreRender Log</title>\n");
-		file->write("<style type=\"text/css\">\ntable {\n");
-		file->write("border: thin solid lightgrey;");
-		file->write("border-spacing: 0px;");
-		file->write("}\ntd {\n");
-		file->write("border: 0px;");
-		file->write("}\n.error {\n");
-		file->write("background-color: #FFDDDD;");
-		file->write("}\n.warning {\n");
-		file->write("background-color: #FFFF80;");
-		file->write("}\n.debug {\n");
-		file->write("background-color: #FFFFFF;");
-		file->write("}\n.info {\n");
-		file->write("background-color: #FFFFFF;");
-		file->write("}\n</style>\n</header>\n");
-		file->write("<body>\n");
-		file->write("<h1>CoreRender</h1>");
-		file->write("<table border=\"1\" width=\"100%\">\n");
-		file->write("<tr><td>Time</td><td>Message</td></tr>\n");
+		else
+		{
+			// Write file header
+			file->write("<html>\n<header>\n<title>CoreRender Log</title>\n");
+			file->write("<style type=\"text/css\">\ntable {\n");
+			file->write("border: thin solid lightgrey;");
+			file->write("border-spacing: 0px;");
+			file->write("}\ntd {\n");
+			file->write("border: 0px;");
+			file->write("}\n.error {\n");
+			file->write("background-color: #FFDDDD;");
+			file->write("}\n.warning {\n");
+			file->write("background-color: #FFFF80;");
+			file->write("}\n.debug {\n");
+			file->write("background-color: #FFFFFF;");
+			file->write("}\n.info {\n");
+			file->write("background-color: #FFFFFF;");
+			file->write("}\n</style>\n</header>\n");
+			file->write("<body>\n");
+			file->write("<h1>CoreRender</h1>");
+			file->write("<table border=\"1\" width=\"100%\">\n");
+			file->write("<tr><td>Time</td><td>Message</td></tr>\n");
+		}
+		// Start the writer thread, without it messages are written by the
+		// calling threads
+		if (!writer.create(new ClassFunctor<Log>(this, &Log::writerThread)))
+		{
+			std::cout << "Could not start the log thread." << std::endl;
+			direct = true;
+		}
 		info("Log started on %s.", AbsoluteTime::Now().toString().c_str());
 	}
 	Log::~Log()
 	{
+		// Stop the writer thread, it writes all remaining messages first
+		if (!direct)
+		{
+			stopping = true;
+			wakeWriter();
+			writer.wait();
+		}
 		// Write file footer
 		if (file)
 		{
 			file->write("</table>\n");
 			file->write("</body></html>\n");
 		}
+		delete[] entries;
 	}
 	
 	void Log::setConsoleLevel(LogLevel::List level)
@@ -132,24 +157,123 @@ namespace core
 	                const char *format,
 	                std::va_list args)
 	{
+		if (level < CORERENDER_LOG_LEVEL
+		 || (level < consolelevel && level < filelevel))
+			return;
+		unsigned int position;
+		Entry *entry = reserveEntry(position);
 		// Construct message
-		char msg[1024];
-		vsnprintf(msg, 1024, format, args);
+		vsnprintf(entry->message, maxlength, format, args);
+		entry->level = level;
 		// Get time
 		Time currenttime = Time::Now();
-		float seconds = 0.001f * (currenttime - starttime).getMilliseconds();
+		entry->time = 0.001f * (currenttime - starttime).getMilliseconds();
+		// Publish the message
+		entry->sequence = position + 1;
+		if (direct)
+		{
+			// No writer thread, write the messages directly
+			tbb::spin_mutex::scoped_lock lock(directmutex);
+			writeEntries();
+			return;
+		}
+		wakeWriter();
+	}
+
+	void Log::flush()
+	{
+		unsigned int position = enqueuepos;
+		while ((int)(writtenpos - position) < 0)
+		{
+			wakeWriter();
+			Thread::yield();
+		}
+	}
+
+	Log::Entry *Log::reserveEntry(unsigned int &position)
+	{
+		// Bounded multi-producer queue, see Dmitry Vyukov's MPMC queue
+		position = enqueuepos;
+		while (true)
+		{
+			Entry *entry = &entries[position % queuesize];
+			int difference = (int)(entry->sequence - position);
+			if (difference == 0)
+			{
+				unsigned int current = enqueuepos.compare_and_swap(position + 1,
+				                                                   position);
+				if (current == position)
+					return entry;
+				position = current;
+			}
+			else if (difference < 0)
+			{
+				// The queue is full, wait for the writer to catch up
+				wakeWriter();
+				Thread::yield();
+				position = enqueuepos;
+			}
+			else
+			{
+				position = enqueuepos;
+			}
+		}
+	}
+
+	void Log::writerThread()
+	{
+		while (true)
+		{
+			if (writeEntries())
+				continue;
+			if (stopping)
+				return;
+			// Go to sleep, but check again for messages which were published
+			// before the writing threads could see the flag
+			sleeping.fetch_and_store(1);
+			if (entries[dequeuepos % queuesize].sequence == dequeuepos + 1
+			 || stopping)
+			{
+				// If a writing thread has already reset the flag it also
+				// posted the semaphore which has to be consumed
+				if (sleeping.compare_and_swap(0, 1) == 1)
+					continue;
+			}
+			wakeup.wait();
+		}
+	}
+	bool Log::writeEntries()
+	{
+		bool written = false;
+		while (true)
+		{
+			Entry &entry = entries[dequeuepos % queuesize];
+			if (entry.sequence != dequeuepos + 1)
+				break;
+			writeEntry(entry);
+			// Free the slot for the next round through the ring buffer
+			entry.sequence = dequeuepos + queuesize;
+			dequeuepos++;
+			writtenpos = dequeuepos;
+			written = true;
+		}
+		if (written)
+			std::cout.flush();
+		return written;
+	}
+	void Log::writeEntry(const Entry &entry)
+	{
 		// Write to console/file
-		tbb::mutex::scoped_lock lock(mutex);
-		if (level >= consolelevel)
+		if (entry.level >= consolelevel)
 		{
-			std::cout << msg << std::endl;
+			std::cout << entry.message << "\n";
 		}
-		if (level >= filelevel)
+		if (entry.level >= filelevel && file)
 		{
 			std::ostringstream stream;
 			stream.precision(3);
-			std::string cssclass;
-			switch (level)
+			const char *cssclass;
+			switch (entry.level)
 			{
 				case LogLevel::Error:
 					cssclass = "error";
@@ -164,15 +288,17 @@ namespace core
 				default:
 					cssclass = "debug";
 					break;
-					
 			}
 			stream << "<tr><td class=\"" << cssclass << "\">"
-				<< std::fixed << seconds << "</td><td class=\""
-				<< cssclass << "\">";
+				<< std::fixed << entry.time << "</td><td class=\""
+				<< cssclass << "\">" << entry.message << "</td></tr>\n";
 			file->write(stream.str());
-			file->write(msg);
-			file->write("</td></tr>\n");
 		}
 	}
+	void Log::wakeWriter()
+	{
+		if (sleeping.compare_and_swap(0, 1) == 1)
+			wakeup.post();
+	}
 }
 }
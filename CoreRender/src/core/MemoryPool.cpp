@@ -25,19 +25,232 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #if defined(CORERENDER_UNIX)
 	#include <sys/mman.h>
 #else
-	#include <cstdlib>
+	#include <windows.h>
 #endif
 
 namespace cr
 {
 namespace core
 {
+	/**
+	 * Size of a huge page on common systems.
+	 */
+	static const unsigned int hugepagesize = 2 * 1048576;
+
+	MemoryPool::MemoryPool(unsigned int pagesize, bool hugepages)
+		: hugepages(hugepages), used(0), largebytes(0), watermark(1),
+		recentpeak(0), lowframes(0), mapcalls(0)
+	{
+		// Round up page size to 4k pages or huge pages
+		if (hugepages)
+			pagesize = (pagesize + hugepagesize - 1) & ~(hugepagesize - 1);
+		else
+			pagesize = (pagesize + 0xFFF) & ~0xFFF;
+		this->pagesize = pagesize;
+		chunksize = getChunkSize(pagesize);
+		generation = 1;
+		stats.usedbytes = 0;
+		stats.peakbytes = 0;
+		stats.mappedpages = 1;
+		stats.mapcalls = 0;
+		// Allocate a single page
+		currentmemory = allocPage(pagesize);
+	}
+	MemoryPool::~MemoryPool()
+	{
+		freePage(currentmemory, pagesize);
+		for (unsigned int i = 0; i < usedmemory.size(); i++)
+			freePage(usedmemory[i], pagesize);
+		for (unsigned int i = 0; i < freememory.size(); i++)
+			freePage(freememory[i], pagesize);
+		freeLargeBlocks();
+	}
+
+	void MemoryPool::reset()
+	{
+		collectStatistics();
+		freeLargeBlocks();
+		// Adapt the number of retained pages to the usage of the last frames
+		unsigned int usedpages = usedmemory.size() + 1;
+		if (usedpages >= watermark)
+		{
+			watermark = usedpages;
+			recentpeak = 0;
+			lowframes = 0;
+		}
+		else
+		{
+			if (usedpages > recentpeak)
+				recentpeak = usedpages;
+			lowframes++;
+			if (lowframes >= retainframes)
+			{
+				watermark = recentpeak;
+				recentpeak = 0;
+				lowframes = 0;
+			}
+		}
+		// Move used pages to the free page list
+		freememory.insert(freememory.end(),
+		                  usedmemory.begin(),
+		                  usedmemory.end());
+		usedmemory.clear();
+		// Delete the pages above the watermark
+		while (freememory.size() + 1 > watermark)
+		{
+			freePage(freememory.back(), pagesize);
+			freememory.pop_back();
+		}
+		startFrame();
+	}
+	void MemoryPool::reset(unsigned int size)
+	{
+		collectStatistics();
+		freeLargeBlocks();
+		unsigned int pagecount = (size + pagesize - 1) / pagesize;
+		if (pagecount == 0)
+			pagecount = 1;
+		// Reuse existing pages, we have one page in currentmemory
+		freememory.insert(freememory.end(),
+		                  usedmemory.begin(),
+		                  usedmemory.end());
+		usedmemory.clear();
+		while (freememory.size() > pagecount - 1)
+		{
+			freePage(freememory.back(), pagesize);
+			freememory.pop_back();
+		}
+		while (freememory.size() < pagecount - 1)
+			freememory.push_back(allocPage(pagesize));
+		watermark = pagecount;
+		recentpeak = 0;
+		lowframes = 0;
+		startFrame();
+	}
+	void MemoryPool::reset(unsigned int size, unsigned int pagesize)
+	{
+		collectStatistics();
+		freeLargeBlocks();
+		// Free all existing pages
+		freePage(currentmemory, this->pagesize);
+		for (unsigned int i = 0; i < usedmemory.size(); i++)
+			freePage(usedmemory[i], this->pagesize);
+		for (unsigned int i = 0; i < freememory.size(); i++)
+			freePage(freememory[i], this->pagesize);
+		usedmemory.clear();
+		freememory.clear();
+		// Set new page size
+		if (hugepages)
+			pagesize = (pagesize + hugepagesize - 1) & ~(hugepagesize - 1);
+		else
+			pagesize = (pagesize + 0xFFF) & ~0xFFF;
+		this->pagesize = pagesize;
+		chunksize = getChunkSize(pagesize);
+		// Allocate new pages
+		unsigned int pagecount = (size + pagesize - 1) / pagesize;
+		if (pagecount == 0)
+			pagecount = 1;
+		currentmemory = allocPage(pagesize);
+		for (unsigned int i = 0; i < pagecount - 1; i++)
+			freememory.push_back(allocPage(pagesize));
+		watermark = pagecount;
+		recentpeak = 0;
+		lowframes = 0;
+		startFrame();
+	}
+
+	void *MemoryPool::allocateShared(unsigned int size, unsigned int alignment)
+	{
+		// Allocations this large would waste most of the page
+		if (size > pagesize / 2)
+			return allocateLarge(size);
+		tbb::spin_mutex::scoped_lock lock(mutex);
+		// Pages are aligned to at least 4k, so aligning the offset aligns
+		// the pointer
+		unsigned int offset = (used + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= pagesize)
+		{
+			// We have enough memory on this page
+			used = offset + size;
+			return (char*)currentmemory + offset;
+		}
+		// Start a new page
+		usedmemory.push_back(currentmemory);
+		if (freememory.empty())
+		{
+			currentmemory = allocPage(pagesize);
+		}
+		else
+		{
+			currentmemory = freememory.back();
+			freememory.pop_back();
+		}
+		used = size;
+		return currentmemory;
+	}
+	void *MemoryPool::allocateLarge(unsigned int size)
+	{
+		tbb::spin_mutex::scoped_lock lock(mutex);
+		LargeBlock block;
+		block.size = (size + 0xFFF) & ~0xFFF;
+		block.memory = allocPage(block.size);
+		largememory.push_back(block);
+		largebytes += size;
+		return block.memory;
+	}
+	void MemoryPool::collectStatistics()
+	{
+		stats.usedbytes = usedmemory.size() * pagesize + used + largebytes;
+		if (stats.usedbytes > stats.peakbytes)
+			stats.peakbytes = stats.usedbytes;
+		stats.mapcalls = mapcalls;
+		mapcalls = 0;
+	}
+	void MemoryPool::freeLargeBlocks()
+	{
+		for (unsigned int i = 0; i < largememory.size(); i++)
+			freePage(largememory[i].memory, largememory[i].size);
+		largememory.clear();
+		largebytes = 0;
+	}
+	void MemoryPool::startFrame()
+	{
+		stats.mappedpages = usedmemory.size() + freememory.size() + 1;
+		// Start at the current page from the beginning
+		used = 0;
+		// Invalidate the chunks of all threads
+		generation++;
+	}
+
 	void *MemoryPool::allocPage(unsigned int size)
 	{
+		mapcalls++;
 #if defined(CORERENDER_UNIX)
-		return mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+		void *page = MAP_FAILED;
+	#if defined(MAP_HUGETLB)
+		// Explicit huge pages need to be reserved by the administrator, if
+		// there are none, we fall back to normal pages
+		if (hugepages && size % hugepagesize == 0)
+		{
+			page = mmap(0, size, PROT_READ | PROT_WRITE,
+			            MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+		}
+	#endif
+		if (page == MAP_FAILED)
+		{
+			page = mmap(0, size, PROT_READ | PROT_WRITE,
+			            MAP_PRIVATE | MAP_ANON, -1, 0);
+	#if defined(MADV_HUGEPAGE)
+			// Transparent huge pages do not need any reservation
+			if (hugepages && page != MAP_FAILED)
+				madvise(page, size, MADV_HUGEPAGE);
+	#endif
+		}
+		if (page == MAP_FAILED)
+			return 0;
+		return page;
 #else
-		return malloc(size);
+		return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #endif
 	}
 	void MemoryPool::freePage(void *page, unsigned int size)
@@ -45,7 +258,7 @@ namespace core
 #if defined(CORERENDER_UNIX)
 		munmap(page, size);
 #else
-		free(size);
+		VirtualFree(page, 0, MEM_RELEASE);
 #endif
 	}
 }
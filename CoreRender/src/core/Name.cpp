@@ -0,0 +1,110 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CoreRender/core/Name.hpp"
+
+#include <tbb/spin_rw_mutex.h>
+#include <deque>
+#include <ostream>
+
+namespace cr
+{
+namespace core
+{
+	/**
+	 * Global string table. Created on first use so that names can be
+	 * constructed during static initialization.
+	 */
+	struct NameTable
+	{
+		NameTable()
+		{
+			strings.push_back("");
+			ids.insert(std::make_pair(std::string(), 0u));
+		}
+
+		HashMap<std::string, unsigned int, 1> ids;
+		// std::deque never moves its elements on push_back(), so references
+		// returned by getString() stay valid
+		std::deque<std::string> strings;
+		tbb::spin_rw_mutex mutex;
+	};
+	static NameTable &getNameTable()
+	{
+		static NameTable table;
+		return table;
+	}
+
+	static unsigned int intern(const std::string &name)
+	{
+		if (name.empty())
+			return 0;
+		NameTable &table = getNameTable();
+		tbb::spin_rw_mutex::scoped_lock lock(table.mutex, false);
+		HashMap<std::string, unsigned int, 1>::iterator it = table.ids.find(name);
+		if (it != table.ids.end())
+			return it->second;
+		// Another thread might have added the name while we upgrade the lock
+		if (!lock.upgrade_to_writer())
+		{
+			it = table.ids.find(name);
+			if (it != table.ids.end())
+				return it->second;
+		}
+		unsigned int id = table.strings.size();
+		table.strings.push_back(name);
+		table.ids.insert(std::make_pair(name, id));
+		return id;
+	}
+
+	Name::Name(const std::string &name)
+		: id(intern(name))
+	{
+	}
+	Name::Name(const char *name)
+		: id(intern(name))
+	{
+	}
+
+	bool Name::find(const std::string &name, Name &result)
+	{
+		NameTable &table = getNameTable();
+		tbb::spin_rw_mutex::scoped_lock lock(table.mutex, false);
+		HashMap<std::string, unsigned int, 1>::iterator it = table.ids.find(name);
+		if (it == table.ids.end())
+			return false;
+		result.id = it->second;
+		return true;
+	}
+
+	const std::string &Name::getString() const
+	{
+		NameTable &table = getNameTable();
+		tbb::spin_rw_mutex::scoped_lock lock(table.mutex, false);
+		return table.strings[id];
+	}
+
+	std::ostream &operator<<(std::ostream &stream, const Name &name)
+	{
+		return stream << name.getString();
+	}
+}
+}
@@ -23,7 +23,6 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/core/StandardFile.hpp"
 #include "CoreRender/core/Platform.hpp"
 
-#include <iostream>
 #include <cstring>
 
 #if defined(CORERENDER_UNIX)
@@ -91,7 +90,11 @@ namespace core
 				&& ((mountinfo[i].mode & modecheck) == modecheck))
 			{
 				std::string abspath = mountinfo[i].src + path.substr(mountinfo[i].dest.size());
-				std::cout << path << " mapped to " << abspath << std::endl;
+				if (log)
+				{
+					CR_LOG_DEBUG(log, "%s mapped to %s.", path.c_str(),
+					             abspath.c_str());
+				}
 				// Try to open the file
 				StandardFile *file = new StandardFile(path, abspath, mode);
 				if (!file->isOpen())
@@ -102,6 +105,12 @@ namespace core
 		}
 		return 0;
 	}
+	void StandardFileSystem::setLog(Log::Ptr log)
+	{
+		tbb::mutex::scoped_lock lock(mutex);
+		this->log = log;
+	}
+
 	std::string StandardFileSystem::getPath(const std::string &path, const std::string &currentdir)
 	{
 		if (path[0] == '/' || path[0] == '\\')
@@ -0,0 +1,323 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CoreRender/core/TaskScheduler.hpp"
+
+#if defined(CORERENDER_UNIX)
+	#include <unistd.h>
+#endif
+
+namespace cr
+{
+namespace core
+{
+	class TaskScheduler::WorkerFunctor : public Functor
+	{
+		public:
+			WorkerFunctor(TaskScheduler *scheduler, Worker *worker)
+				: scheduler(scheduler), worker(worker)
+			{
+			}
+
+			virtual void call()
+			{
+				scheduler->workerEntry(worker);
+			}
+		private:
+			TaskScheduler *scheduler;
+			Worker *worker;
+	};
+
+	TaskScheduler::TaskScheduler()
+		: threadindex(noworker)
+	{
+		external.index = noworker;
+		sleeping = 0;
+		stopping = false;
+	}
+	TaskScheduler::~TaskScheduler()
+	{
+		stop();
+	}
+
+	bool TaskScheduler::start(unsigned int threads)
+	{
+		if (threads == 0)
+		{
+			threads = getProcessorCount() - 1;
+			// Tasks spawned by threads which never wait still need a worker
+			if (threads == 0)
+				threads = 1;
+		}
+		stopping = false;
+		// All queues have to exist before the first worker steals tasks
+		workers.resize(threads);
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			workers[i] = new Worker;
+			workers[i]->index = i;
+		}
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			if (!workers[i]->thread.create(new WorkerFunctor(this, workers[i])))
+			{
+				// Only stop the threads which have been started
+				for (unsigned int j = i; j < threads; j++)
+					delete workers[j];
+				workers.resize(i);
+				for (unsigned int j = 0; j < i; j++)
+					started.wait();
+				stop();
+				return false;
+			}
+		}
+		for (unsigned int i = 0; i < threads; i++)
+			started.wait();
+		return true;
+	}
+	void TaskScheduler::stop()
+	{
+		if (workers.empty())
+			return;
+		stopping = true;
+		for (unsigned int i = 0; i < workers.size(); i++)
+			wakeup.post();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i]->thread.wait();
+		// Drop all tasks which have not been executed
+		workers.push_back(&external);
+		for (unsigned int i = 0; i < workers.size(); i++)
+		{
+			std::deque<Task*> &tasks = workers[i]->tasks;
+			for (unsigned int j = 0; j < tasks.size(); j++)
+			{
+				if (tasks[j]->autodelete)
+					delete tasks[j];
+			}
+			tasks.clear();
+			workers[i]->count = 0;
+			if (workers[i] != &external)
+				delete workers[i];
+		}
+		workers.clear();
+		// Consume the remaining wakeups
+		while (wakeup.get() > 0)
+			wakeup.wait();
+		sleeping = 0;
+	}
+
+	void TaskScheduler::spawn(Task *task, TaskGroup *group)
+	{
+		task->group = group;
+		group->pending++;
+		// Tasks with unfinished dependencies are queued by the last one
+		if (--task->pending == 0)
+			enqueue(task);
+	}
+	void TaskScheduler::wait(TaskGroup *group)
+	{
+		unsigned int index = threadindex.local();
+		while (!group->isFinished())
+		{
+			Task *task = findTask(index);
+			if (task)
+			{
+				execute(task);
+				continue;
+			}
+			// The remaining tasks are running on other threads or wait for
+			// running tasks, so sleep until the last one has finished instead
+			// of spinning
+			unsigned int pending = group->pending;
+			while ((pending & TaskGroup::countmask) != 0)
+			{
+				unsigned int previous = group->pending.compare_and_swap(
+					pending + TaskGroup::waiterunit, pending);
+				if (previous == pending)
+				{
+					group->finished.wait();
+					break;
+				}
+				pending = previous;
+			}
+		}
+	}
+
+	unsigned int TaskScheduler::getProcessorCount()
+	{
+#if defined(CORERENDER_UNIX)
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		if (count < 1)
+			return 1;
+		return count;
+#elif defined(CORERENDER_WINDOWS)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors;
+#endif
+	}
+
+	void TaskScheduler::workerEntry(Worker *worker)
+	{
+		threadindex.local() = worker->index;
+		started.post();
+		while (true)
+		{
+			Task *task = findTask(worker->index);
+			if (task)
+			{
+				execute(task);
+				continue;
+			}
+			if (stopping)
+				break;
+			// Announce that we are going to sleep and check again, otherwise
+			// a task spawned in between would not wake anyone up
+			sleeping++;
+			task = findTask(worker->index);
+			if (task || stopping)
+			{
+				// If a wakeup has already been sent, it has to be consumed
+				if (!cancelSleep())
+					wakeup.wait();
+				if (task)
+					execute(task);
+				continue;
+			}
+			wakeup.wait();
+		}
+	}
+	Task *TaskScheduler::findTask(unsigned int index)
+	{
+		unsigned int workercount = workers.size();
+		Task *task = 0;
+		// Newest task of the own queue
+		if (index < workercount)
+		{
+			task = popTask(workers[index], true);
+			if (task)
+				return task;
+		}
+		// Tasks spawned by other threads
+		task = popTask(&external, false);
+		if (task)
+			return task;
+		// Steal the oldest task of another worker
+		for (unsigned int i = 1; i <= workercount; i++)
+		{
+			unsigned int victim = (index + i) % workercount;
+			if (victim == index)
+				continue;
+			task = popTask(workers[victim], false);
+			if (task)
+				return task;
+		}
+		return 0;
+	}
+	Task *TaskScheduler::popTask(Worker *queue, bool newest)
+	{
+		if (queue->count == 0)
+			return 0;
+		tbb::spin_mutex::scoped_lock lock(queue->mutex);
+		if (queue->tasks.empty())
+			return 0;
+		Task *task;
+		if (newest)
+		{
+			task = queue->tasks.back();
+			queue->tasks.pop_back();
+		}
+		else
+		{
+			task = queue->tasks.front();
+			queue->tasks.pop_front();
+		}
+		queue->count--;
+		return task;
+	}
+	void TaskScheduler::execute(Task *task)
+	{
+		task->run();
+		TaskGroup *group = task->group;
+		// Restore the dependencies before any successor can run, the task
+		// might be spawned again afterwards
+		task->pending = task->dependencycount + 1;
+		for (unsigned int i = 0; i < task->successors.size(); i++)
+		{
+			Task *successor = task->successors[i];
+			if (--successor->pending == 0)
+				enqueue(successor);
+		}
+		if (task->autodelete)
+			delete task;
+		// The last task clears the waiter count and wakes up the threads
+		// blocked in wait()
+		unsigned int pending = group->pending;
+		unsigned int remaining;
+		while (true)
+		{
+			remaining = pending - 1;
+			if ((remaining & TaskGroup::countmask) == 0)
+				remaining = 0;
+			unsigned int previous = group->pending.compare_and_swap(remaining,
+			                                                        pending);
+			if (previous == pending)
+				break;
+			pending = previous;
+		}
+		if (remaining == 0)
+		{
+			for (unsigned int i = 0; i < pending / TaskGroup::waiterunit; i++)
+				group->finished.post();
+		}
+	}
+	void TaskScheduler::enqueue(Task *task)
+	{
+		unsigned int index = threadindex.local();
+		Worker *queue = &external;
+		if (index < workers.size())
+			queue = workers[index];
+		{
+			tbb::spin_mutex::scoped_lock lock(queue->mutex);
+			queue->tasks.push_back(task);
+			queue->count++;
+		}
+		wakeWorker();
+	}
+	void TaskScheduler::wakeWorker()
+	{
+		if (cancelSleep())
+			wakeup.post();
+	}
+	bool TaskScheduler::cancelSleep()
+	{
+		unsigned int count = sleeping;
+		while (count > 0)
+		{
+			unsigned int previous = sleeping.compare_and_swap(count - 1, count);
+			if (previous == count)
+				return true;
+			count = previous;
+		}
+		return false;
+	}
+}
+}
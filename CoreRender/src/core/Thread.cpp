@@ -21,6 +21,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CoreRender/core/Thread.hpp"
 
+#if defined(CORERENDER_UNIX)
+	#include <sched.h>
+#endif
+
 namespace cr
 {
 namespace core
@@ -75,6 +79,15 @@ namespace core
 		WaitForSingleObject(thread, INFINITE);
 		CloseHandle(thread);
 		thread = NULL;
+#endif
+	}
+
+	void Thread::yield()
+	{
+#if defined(CORERENDER_UNIX)
+		sched_yield();
+#elif defined(CORERENDER_WINDOWS)
+		SwitchToThread();
 #endif
 	}
 }
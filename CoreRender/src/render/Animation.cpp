@@ -60,41 +60,62 @@ namespace render
 		return fps;
 	}
 
-	Animation::Channel *Animation::addChannel(const std::string &node)
+	Animation::Channel *Animation::addChannel(core::Name node)
 	{
 		Animation::Channel *channel = new Animation::Channel;
 		channel->node = node;
 		channel->constant = false;
+		// Only the first channel for a node can be found by name
+		channelindices.insert(std::make_pair(node, (unsigned int)channels.size()));
 		channels.push_back(channel);
 		return channel;
 	}
-	void Animation::removeChannel(const std::string &node)
+	void Animation::removeChannel(core::Name node)
 	{
-		for (unsigned int i = 0; i < channels.size(); i++)
-		{
-			if (channels[i]->node == node)
-			{
-				removeChannel(i);
-				return;
-			}
-		}
+		ChannelMap::iterator it = channelindices.find(node);
+		if (it == channelindices.end())
+			return;
+		removeChannel(it->second);
 	}
 	void Animation::removeChannel(unsigned int index)
 	{
 		if (index >= channels.size())
 			return;
+		core::Name node = channels[index]->node;
+		ChannelMap::iterator it = channelindices.find(node);
+		bool indexed = it != channelindices.end() && it->second == index;
+		if (indexed)
+			channelindices.erase(it);
 		delete channels[index];
-		channels[index] = channels[channels.size() - 1];
+		unsigned int last = channels.size() - 1;
+		channels[index] = channels[last];
 		channels.pop_back();
-	}
-	Animation::Channel *Animation::getChannel(const std::string &node)
-	{
-		for (unsigned int i = 0; i < channels.size(); i++)
+		// Update the index of the moved channel
+		if (index != last)
+		{
+			it = channelindices.find(channels[index]->node);
+			if (it != channelindices.end() && it->second == last)
+				it->second = index;
+		}
+		// Another channel for the same node can now be found by name
+		if (indexed)
 		{
-			if (channels[i]->node == node)
-				return channels[i];
+			for (unsigned int i = 0; i < channels.size(); i++)
+			{
+				if (channels[i]->node == node)
+				{
+					channelindices.insert(std::make_pair(node, i));
+					break;
+				}
+			}
 		}
-		return 0;
+	}
+	Animation::Channel *Animation::getChannel(core::Name node)
+	{
+		ChannelMap::const_iterator it = channelindices.find(node);
+		if (it == channelindices.end())
+			return 0;
+		return channels[it->second];
 	}
 	Animation::Channel *Animation::getChannel(unsigned int index)
 	{
@@ -0,0 +1,245 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "CommandStream.hpp"
+#include "CoreRender/core/MemoryPool.hpp"
+
+#include <cstring>
+
+namespace cr
+{
+namespace render
+{
+	static bool isUniformEqual(const UniformMapping &a, const UniformMapping &b)
+	{
+		if (a.shaderhandle != b.shaderhandle || a.type != b.type)
+			return false;
+		if (a.data == b.data)
+			return true;
+		unsigned int size = ShaderVariableType::getSize(a.type);
+		return memcmp(a.data, b.data, size * sizeof(float)) == 0;
+	}
+
+	/**
+	 * Size of the memory blocks holding the command stream. Commands which
+	 * are larger get a block of their own.
+	 */
+	static const unsigned int blocksize = 65536;
+	/**
+	 * Space at the end of every block which is reserved for the jump to the
+	 * next block or the end of the stream.
+	 */
+	static const unsigned int blockreserve = sizeof(CommandHeader) + sizeof(char*);
+	/**
+	 * Alignment of every command. Commands contain pointers, so the size of
+	 * each command is rounded up to a multiple of the pointer size.
+	 */
+	static const unsigned int commandalignment = sizeof(void*);
+
+	static unsigned int alignCommandSize(unsigned int size)
+	{
+		return (size + commandalignment - 1) & ~(commandalignment - 1);
+	}
+
+	CommandWriter::CommandWriter(core::MemoryPool *memory)
+		: memory(memory), first(0), current(0), end(0), last(0), size(0),
+		previous(0), maxuniforms(0), batchcount(0)
+	{
+	}
+
+	void CommandWriter::write(const RenderBatch *batch)
+	{
+		const RenderBatch *prev = previous;
+		// State changes
+		if (!prev || prev->state != batch->state)
+		{
+			PipelineStateCommand *command;
+			command = (PipelineStateCommand*)append(RenderCommand::PipelineState,
+			                                        sizeof(PipelineStateCommand));
+			command->state = batch->state;
+		}
+		if (!prev || prev->vertices != batch->vertices
+		 || prev->indices != batch->indices
+		 || prev->indextype != batch->indextype
+		 || prev->basevertex != batch->basevertex
+		 || prev->vertexoffset != batch->vertexoffset)
+		{
+			BufferCommand *command = (BufferCommand*)append(RenderCommand::Buffers,
+			                                                sizeof(BufferCommand));
+			command->vertices = batch->vertices;
+			command->indices = batch->indices;
+			command->indextype = batch->indextype;
+			command->basevertex = batch->basevertex;
+			command->vertexoffset = batch->vertexoffset;
+		}
+		if (!prev || prev->renderflags != batch->renderflags)
+		{
+			StateCommand *command = (StateCommand*)append(RenderCommand::State,
+			                                              sizeof(StateCommand));
+			command->renderflags = batch->renderflags;
+		}
+		if (!prev || prev->texcount != batch->texcount
+		 || (prev->textures != batch->textures
+		  && memcmp(prev->textures, batch->textures,
+		            batch->texcount * sizeof(TextureEntry))))
+		{
+			unsigned int memsize = batch->texcount * sizeof(TextureEntry);
+			ArrayCommand *command = (ArrayCommand*)append(RenderCommand::Textures,
+			                                              sizeof(ArrayCommand) + memsize);
+			command->count = batch->texcount;
+			memcpy(command + 1, batch->textures, memsize);
+		}
+		writeUniforms(batch);
+		// Draw call
+		if (batch->instancecount > 0)
+		{
+			unsigned int datasize = ShaderVariableType::getSize(batch->instancetype)
+			                      * batch->instancecount * sizeof(float);
+			DrawInstancedCommand *command;
+			command = (DrawInstancedCommand*)append(RenderCommand::DrawInstanced,
+			                                        sizeof(DrawInstancedCommand) + datasize);
+			command->startindex = batch->startindex;
+			command->endindex = batch->endindex;
+			command->instancecount = batch->instancecount;
+			command->instanceattrib = batch->instanceattrib;
+			command->instancetype = batch->instancetype;
+			command->instanceuniform = batch->instanceuniform;
+			memcpy(command + 1, batch->instancedata, datasize);
+		}
+		else
+		{
+			DrawCommand *command = (DrawCommand*)append(RenderCommand::Draw,
+			                                            sizeof(DrawCommand));
+			command->startindex = batch->startindex;
+			command->endindex = batch->endindex;
+		}
+		if (batch->uniformcount > maxuniforms)
+			maxuniforms = batch->uniformcount;
+		previous = batch;
+		batchcount++;
+	}
+
+	void CommandWriter::finish(RenderPassInfo *info)
+	{
+		append(RenderCommand::End, 0);
+		info->commands = first;
+		info->commandsize = size;
+		unsigned int memsize = maxuniforms * sizeof(UniformMapping);
+		info->uniforms = (UniformMapping*)memory->allocate(memsize);
+		info->batchcount = batchcount;
+	}
+
+	void *CommandWriter::append(RenderCommand::List type, unsigned int size)
+	{
+		unsigned int commandsize = alignCommandSize(sizeof(CommandHeader) + size);
+		// The end command is always placed in the reserved space
+		if (type != RenderCommand::End
+		 && (!current || current + commandsize + blockreserve > end))
+			allocateBlock(commandsize);
+		else if (!current)
+			allocateBlock(0);
+		CommandHeader *header = (CommandHeader*)current;
+		header->type = type;
+		header->size = commandsize;
+		// Clear the padding so that the stream does not depend on the
+		// previous content of the frame memory
+		unsigned int used = sizeof(CommandHeader) + size;
+		memset(current + used, 0, commandsize - used);
+		last = header;
+		current += commandsize;
+		this->size += commandsize;
+		return header + 1;
+	}
+	void CommandWriter::allocateBlock(unsigned int size)
+	{
+		unsigned int memsize = size + blockreserve;
+		if (memsize < blocksize)
+			memsize = blocksize;
+		char *block = (char*)memory->allocate(memsize);
+		if (current)
+		{
+			// Link the previous block to the new one
+			CommandHeader *header = (CommandHeader*)current;
+			header->type = RenderCommand::Jump;
+			header->size = blockreserve;
+			memcpy(header + 1, &block, sizeof(char*));
+			this->size += blockreserve;
+		}
+		else
+			first = block;
+		current = block;
+		end = block + memsize;
+	}
+
+	void CommandWriter::writeUniforms(const RenderBatch *batch)
+	{
+		const RenderBatch *prev = previous;
+		// Reserve space for all uniforms and then only write the ones which
+		// differ from the previous batch
+		unsigned int maxsize = sizeof(UniformsCommand);
+		for (unsigned int i = 0; i < batch->uniformcount; i++)
+		{
+			maxsize += sizeof(UniformEntry)
+			         + ShaderVariableType::getSize(batch->uniforms[i].type) * sizeof(float);
+		}
+		UniformsCommand *command = (UniformsCommand*)append(RenderCommand::Uniforms,
+		                                                    maxsize);
+		command->count = batch->uniformcount;
+		command->changed = 0;
+		char *data = (char*)(command + 1);
+		for (unsigned int i = 0; i < batch->uniformcount; i++)
+		{
+			const UniformMapping &uniform = batch->uniforms[i];
+			if (prev && i < prev->uniformcount
+			 && isUniformEqual(prev->uniforms[i], uniform))
+				continue;
+			UniformEntry *entry = (UniformEntry*)data;
+			entry->index = i;
+			entry->shaderhandle = uniform.shaderhandle;
+			entry->type = uniform.type;
+			unsigned int size = ShaderVariableType::getSize(uniform.type);
+			memcpy(entry + 1, uniform.data, size * sizeof(float));
+			data += sizeof(UniformEntry) + size * sizeof(float);
+			command->changed++;
+		}
+		// Drop the command completely if nothing changed
+		if (command->changed == 0 && prev
+		 && prev->uniformcount == batch->uniformcount)
+			data = (char*)last;
+		truncate(data);
+	}
+	void CommandWriter::truncate(char *commandend)
+	{
+		if (commandend != (char*)last)
+		{
+			unsigned int commandsize = commandend - (char*)last;
+			unsigned int alignedsize = alignCommandSize(commandsize);
+			memset(commandend, 0, alignedsize - commandsize);
+			commandend = (char*)last + alignedsize;
+		}
+		size -= current - commandend;
+		current = commandend;
+		if (commandend != (char*)last)
+			last->size = commandend - (char*)last;
+	}
+}
+}
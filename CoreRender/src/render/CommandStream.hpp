@@ -0,0 +1,207 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_COMMANDSTREAM_HPP_INCLUDED_
+#define _CORERENDER_RENDER_COMMANDSTREAM_HPP_INCLUDED_
+
+#include "FrameData.hpp"
+
+namespace cr
+{
+namespace core
+{
+	class MemoryPool;
+}
+namespace render
+{
+	/**
+	 * Type of a command in the command stream of a render pass.
+	 */
+	struct RenderCommand
+	{
+		enum List
+		{
+			/**
+			 * Changes the shader and the vertex layout
+			 * (PipelineStateCommand).
+			 */
+			PipelineState,
+			/**
+			 * Changes the vertex and index buffers (BufferCommand).
+			 */
+			Buffers,
+			/**
+			 * Changes the render flags (StateCommand).
+			 */
+			State,
+			/**
+			 * Replaces the texture list (ArrayCommand followed by the
+			 * TextureEntry entries).
+			 */
+			Textures,
+			/**
+			 * Changes some uniforms (UniformsCommand followed by the changed
+			 * uniforms, each an UniformEntry followed by its data).
+			 */
+			Uniforms,
+			/**
+			 * Draws a batch with the current state (DrawCommand).
+			 */
+			Draw,
+			/**
+			 * Draws multiple instances with the current state
+			 * (DrawInstancedCommand followed by the instance data).
+			 */
+			DrawInstanced,
+			/**
+			 * Continues the stream in another block of memory (followed by
+			 * a pointer to the next command).
+			 */
+			Jump,
+			/**
+			 * Ends the stream.
+			 */
+			End
+		};
+	};
+
+	/**
+	 * Header in front of every command. The size of every command is a
+	 * multiple of the pointer size so that all commands are suitably aligned
+	 * for the pointers they contain.
+	 */
+	struct CommandHeader
+	{
+		unsigned int type;
+		/**
+		 * Size of the command including the header, in bytes.
+		 */
+		unsigned int size;
+	};
+	struct PipelineStateCommand
+	{
+		PipelineState *state;
+	};
+	struct BufferCommand
+	{
+		int vertices;
+		int indices;
+		unsigned int indextype;
+		unsigned int basevertex;
+		unsigned int vertexoffset;
+	};
+	struct StateCommand
+	{
+		unsigned int renderflags;
+	};
+	struct ArrayCommand
+	{
+		unsigned int count;
+	};
+	struct UniformsCommand
+	{
+		/**
+		 * Total number of uniforms of the following batches.
+		 */
+		unsigned int count;
+		/**
+		 * Number of changed uniforms in this command.
+		 */
+		unsigned int changed;
+	};
+	struct UniformEntry
+	{
+		unsigned int index;
+		int shaderhandle;
+		ShaderVariableType::List type;
+	};
+	struct DrawCommand
+	{
+		unsigned int startindex;
+		unsigned int endindex;
+	};
+	struct DrawInstancedCommand
+	{
+		unsigned int startindex;
+		unsigned int endindex;
+		unsigned int instancecount;
+		int instanceattrib;
+		ShaderVariableType::List instancetype;
+		unsigned int instanceuniform;
+	};
+
+	/**
+	 * Encodes the sorted batches of a render pass into a linear command
+	 * stream which the render thread can read sequentially. Only state which
+	 * differs from the previous batch is written, all data (including
+	 * uniform values and instance data) is stored inline.
+	 *
+	 * The stream is written directly into frame memory in large blocks which
+	 * are connected with RenderCommand::Jump.
+	 */
+	class CommandWriter
+	{
+		public:
+			/**
+			 * Constructor.
+			 * @param memory Frame memory pool the stream is allocated from.
+			 */
+			CommandWriter(core::MemoryPool *memory);
+
+			/**
+			 * Appends the commands needed to draw a batch.
+			 * @param batch Batch to be drawn.
+			 */
+			void write(const RenderBatch *batch);
+
+			/**
+			 * Terminates the stream and fills in the command stream info of
+			 * the pass.
+			 * @param info Render pass info.
+			 */
+			void finish(RenderPassInfo *info);
+		private:
+			void *append(RenderCommand::List type, unsigned int size);
+			void allocateBlock(unsigned int size);
+			/**
+			 * Shortens the last command so that it ends at the given
+			 * position. If the position is the beginning of the command, the
+			 * command is removed.
+			 */
+			void truncate(char *commandend);
+
+			void writeUniforms(const RenderBatch *batch);
+
+			core::MemoryPool *memory;
+			char *first;
+			char *current;
+			char *end;
+			CommandHeader *last;
+			unsigned int size;
+			const RenderBatch *previous;
+			unsigned int maxuniforms;
+			unsigned int batchcount;
+	};
+}
+}
+
+#endif
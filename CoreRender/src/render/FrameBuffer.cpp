@@ -34,6 +34,8 @@ namespace render
 		config.handle = 0;
 		config.depthbuffer = 0;
 		config.defaultdepthbuffer = 0;
+		config.drawbuffers = 0xFFFFFFFF;
+		config.changed = true;
 	}
 	FrameBuffer::~FrameBuffer()
 	{
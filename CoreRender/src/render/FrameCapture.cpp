@@ -0,0 +1,534 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "CoreRender/render/FrameCapture.hpp"
+#include "CoreRender/render/VertexLayout.hpp"
+#include "FrameData.hpp"
+#include "CommandStream.hpp"
+#include "VideoDriver.hpp"
+
+#include <cstring>
+
+namespace cr
+{
+namespace render
+{
+	/**
+	 * Collects the resources referenced by a frame.
+	 */
+	class ResourceCollector
+	{
+		public:
+			void add(FrameCaptureFile::ResourceType::List type,
+			         int handle,
+			         unsigned int size)
+			{
+				std::pair<unsigned int, int> key(type, handle);
+				std::map<std::pair<unsigned int, int>, unsigned int>::iterator it;
+				it = indices.find(key);
+				if (it != indices.end())
+				{
+					// Buffers have to be large enough for all batches
+					FrameCaptureFile::Resource &resource = resources[it->second];
+					if (type != FrameCaptureFile::ResourceType::Texture
+					 && size > resource.size)
+						resource.size = size;
+					return;
+				}
+				FrameCaptureFile::Resource resource;
+				resource.type = type;
+				resource.handle = handle;
+				resource.size = size;
+				indices.insert(std::make_pair(key, resources.size()));
+				resources.push_back(resource);
+			}
+
+			/**
+			 * Adds a pipeline state and the shader it references.
+			 * @return Index of the pipeline state in the capture.
+			 */
+			unsigned int addPipelineState(PipelineState *state)
+			{
+				std::map<PipelineState*, unsigned int>::iterator it;
+				it = stateindices.find(state);
+				if (it != stateindices.end())
+					return it->second;
+				add(FrameCaptureFile::ResourceType::Shader, state->shader, 0);
+				unsigned int index = states.size();
+				stateindices.insert(std::make_pair(state, index));
+				states.push_back(state);
+				return index;
+			}
+
+			std::vector<FrameCaptureFile::Resource> resources;
+			std::vector<PipelineState*> states;
+		private:
+			std::map<std::pair<unsigned int, int>, unsigned int> indices;
+			std::map<PipelineState*, unsigned int> stateindices;
+	};
+
+	/**
+	 * Copies a command stream into contiguous memory, removing all jumps, and
+	 * collects the resources used by the stream.
+	 */
+	static void flattenCommands(char *command,
+	                            std::vector<char> &output,
+	                            unsigned int &uniformcount,
+	                            ResourceCollector &collector)
+	{
+		BufferCommand buffers;
+		memset(&buffers, 0, sizeof(buffers));
+		PipelineState *state = 0;
+		uniformcount = 0;
+		while (true)
+		{
+			CommandHeader *header = (CommandHeader*)command;
+			void *data = header + 1;
+			if (header->type == RenderCommand::Jump)
+			{
+				memcpy(&command, data, sizeof(char*));
+				continue;
+			}
+			output.insert(output.end(), command, command + header->size);
+			switch (header->type)
+			{
+				case RenderCommand::PipelineState:
+				{
+					// Pointers are replaced with indices into the state table
+					state = ((PipelineStateCommand*)data)->state;
+					uintptr_t index = collector.addPipelineState(state);
+					char *copy = &output[output.size() - header->size];
+					((PipelineStateCommand*)(copy + sizeof(CommandHeader)))->state
+						= (PipelineState*)index;
+					break;
+				}
+				case RenderCommand::Buffers:
+					buffers = *(BufferCommand*)data;
+					break;
+				case RenderCommand::Textures:
+				{
+					ArrayCommand *textures = (ArrayCommand*)data;
+					TextureEntry *entries = (TextureEntry*)(textures + 1);
+					for (unsigned int i = 0; i < textures->count; i++)
+					{
+						if (entries[i].texhandle == -1)
+							continue;
+						collector.add(FrameCaptureFile::ResourceType::Texture,
+						              entries[i].texhandle, entries[i].type);
+					}
+					break;
+				}
+				case RenderCommand::Uniforms:
+					if (((UniformsCommand*)data)->count > uniformcount)
+						uniformcount = ((UniformsCommand*)data)->count;
+					break;
+				case RenderCommand::Draw:
+				case RenderCommand::DrawInstanced:
+				{
+					// Both commands start with the index range
+					DrawCommand *draw = (DrawCommand*)data;
+					collector.add(FrameCaptureFile::ResourceType::IndexBuffer,
+					              buffers.indices,
+					              draw->endindex * buffers.indextype);
+					// Zeroed stand-in index buffers only reference the
+					// first vertex
+					unsigned int vertexsize = 0;
+					AttribMapping *mappings = state ? state->attribs : 0;
+					for (unsigned int i = 0; state && i < state->attribcount; i++)
+					{
+						unsigned int end = mappings[i].address + buffers.vertexoffset
+						                 + mappings[i].components
+						                 * VertexLayout::getElementSize(mappings[i].type);
+						if (end > vertexsize)
+							vertexsize = end;
+					}
+					collector.add(FrameCaptureFile::ResourceType::VertexBuffer,
+					              buffers.vertices, vertexsize);
+					break;
+				}
+				case RenderCommand::End:
+					return;
+			}
+			command += header->size;
+		}
+	}
+
+	/**
+	 * Checks that a loaded command stream can be executed safely: It has to
+	 * be terminated, every command has to be large enough for its data, and
+	 * it may only reference existing pipeline states and entries of the
+	 * uniform table which have been set before. Jumps are only valid in
+	 * frame memory and are rejected.
+	 */
+	static bool checkCommands(const std::vector<char> &commands,
+	                          unsigned int statecount,
+	                          unsigned int uniformcount)
+	{
+		std::vector<bool> uniformset(uniformcount, false);
+		unsigned int currentuniforms = 0;
+		bool hasstate = false;
+		unsigned int offset = 0;
+		while (offset + sizeof(CommandHeader) <= commands.size())
+		{
+			const CommandHeader *header = (const CommandHeader*)&commands[offset];
+			if (header->type == RenderCommand::End)
+				return true;
+			if (header->size < sizeof(CommandHeader)
+			 || header->size > commands.size() - offset
+			 || header->size % sizeof(void*) != 0)
+				return false;
+			const char *data = (const char*)(header + 1);
+			unsigned int datasize = header->size - sizeof(CommandHeader);
+			switch (header->type)
+			{
+				case RenderCommand::PipelineState:
+				{
+					if (datasize < sizeof(PipelineStateCommand))
+						return false;
+					PipelineStateCommand *command = (PipelineStateCommand*)data;
+					if ((uintptr_t)command->state >= statecount)
+						return false;
+					hasstate = true;
+					break;
+				}
+				case RenderCommand::Buffers:
+					if (datasize < sizeof(BufferCommand))
+						return false;
+					break;
+				case RenderCommand::State:
+					if (datasize < sizeof(StateCommand))
+						return false;
+					break;
+				case RenderCommand::Textures:
+				{
+					if (datasize < sizeof(ArrayCommand))
+						return false;
+					const ArrayCommand *textures = (const ArrayCommand*)data;
+					if (textures->count > (datasize - sizeof(ArrayCommand))
+					                      / sizeof(TextureEntry))
+						return false;
+					break;
+				}
+				case RenderCommand::Uniforms:
+				{
+					if (datasize < sizeof(UniformsCommand))
+						return false;
+					const UniformsCommand *uniforms = (const UniformsCommand*)data;
+					if (uniforms->count > uniformcount)
+						return false;
+					unsigned int entryoffset = sizeof(UniformsCommand);
+					for (unsigned int i = 0; i < uniforms->changed; i++)
+					{
+						if (datasize - entryoffset < sizeof(UniformEntry))
+							return false;
+						const UniformEntry *entry = (const UniformEntry*)(data + entryoffset);
+						if (entry->index >= uniforms->count)
+							return false;
+						entryoffset += sizeof(UniformEntry);
+						unsigned int size = ShaderVariableType::getSize(entry->type)
+						                  * sizeof(float);
+						if (datasize - entryoffset < size)
+							return false;
+						entryoffset += size;
+						uniformset[entry->index] = true;
+					}
+					currentuniforms = uniforms->count;
+					break;
+				}
+				case RenderCommand::Draw:
+				case RenderCommand::DrawInstanced:
+				{
+					if (!hasstate)
+						return false;
+					for (unsigned int i = 0; i < currentuniforms; i++)
+					{
+						if (!uniformset[i])
+							return false;
+					}
+					if (header->type == RenderCommand::Draw)
+					{
+						if (datasize < sizeof(DrawCommand))
+							return false;
+						break;
+					}
+					if (datasize < sizeof(DrawInstancedCommand))
+						return false;
+					const DrawInstancedCommand *draw = (const DrawInstancedCommand*)data;
+					unsigned int size = ShaderVariableType::getSize(draw->instancetype)
+					                  * sizeof(float);
+					if (size != 0 && draw->instancecount
+					    > (datasize - sizeof(DrawInstancedCommand)) / size)
+						return false;
+					break;
+				}
+				default:
+					return false;
+			}
+			offset += header->size;
+		}
+		return false;
+	}
+
+	FrameCapture::FrameCapture()
+		: width(0), height(0)
+	{
+	}
+	FrameCapture::~FrameCapture()
+	{
+		for (unsigned int i = 0; i < states.size(); i++)
+		{
+			delete[] states[i]->attribs;
+			delete states[i];
+		}
+	}
+
+	bool FrameCapture::load(core::File::Ptr file)
+	{
+		FrameCaptureFile::Header header;
+		if (file->read(sizeof(header), &header) != sizeof(header))
+			return false;
+		if (header.tag != FrameCaptureFile::tag
+		 || header.version != FrameCaptureFile::version)
+			return false;
+		width = header.width;
+		height = header.height;
+		// The counts are checked against the file size before anything is
+		// allocated
+		unsigned int filesize = file->getSize();
+		if (header.resourcecount > filesize / sizeof(FrameCaptureFile::Resource)
+		 || header.pipelinestatecount > filesize / sizeof(FrameCaptureFile::PipelineState)
+		 || header.passcount > filesize / sizeof(FrameCaptureFile::Pass))
+			return false;
+		// Read resource info
+		resources.resize(header.resourcecount);
+		unsigned int memsize = header.resourcecount * sizeof(FrameCaptureFile::Resource);
+		if (memsize > 0 && file->read(memsize, &resources[0]) != (int)memsize)
+			return false;
+		for (unsigned int i = 0; i < resources.size(); i++)
+		{
+			if (resources[i].type > FrameCaptureFile::ResourceType::Texture)
+				return false;
+		}
+		// Read pipeline states
+		for (unsigned int i = 0; i < header.pipelinestatecount; i++)
+		{
+			FrameCaptureFile::PipelineState entry;
+			if (file->read(sizeof(entry), &entry) != sizeof(entry))
+				return false;
+			if (entry.attribcount > FrameCaptureFile::maxattribs)
+				return false;
+			PipelineState *state = new PipelineState;
+			state->shader = entry.shader;
+			state->blendMode = entry.blendmode;
+			state->attribcount = entry.attribcount;
+			state->attribs = new AttribMapping[entry.attribcount];
+			state->driverdata = 0;
+			states.push_back(state);
+			stateshaders.push_back(entry.shader);
+			memsize = entry.attribcount * sizeof(AttribMapping);
+			if (memsize > 0 && file->read(memsize, state->attribs) != (int)memsize)
+				return false;
+		}
+		// Read render passes
+		passes.resize(header.passcount);
+		for (unsigned int i = 0; i < header.passcount; i++)
+		{
+			Pass &pass = passes[i];
+			if (file->read(sizeof(pass.info), &pass.info) != sizeof(pass.info))
+				return false;
+			// Every entry of the uniform table is set by the command stream
+			if (pass.info.commandsize < sizeof(CommandHeader)
+			 || pass.info.commandsize > filesize
+			 || pass.info.uniformcount > pass.info.commandsize / sizeof(UniformEntry))
+				return false;
+			pass.original.resize(pass.info.commandsize);
+			if (file->read(pass.info.commandsize, &pass.original[0])
+			    != (int)pass.info.commandsize)
+				return false;
+			if (!checkCommands(pass.original, states.size(),
+			                   pass.info.uniformcount))
+				return false;
+			// The pipeline state indices are resolved in remapCommands()
+			pass.dirty = true;
+		}
+		return true;
+	}
+	bool FrameCapture::save(core::File::Ptr file,
+	                        PipelineInfo *pipelines,
+	                        unsigned int pipelinecount,
+	                        unsigned int width,
+	                        unsigned int height)
+	{
+		// Flatten all command streams first to collect the resources
+		ResourceCollector collector;
+		std::vector<FrameCaptureFile::Pass> passinfo;
+		std::vector<std::vector<char> > commands;
+		for (unsigned int i = 0; i < pipelinecount; i++)
+		{
+			for (unsigned int j = 0; j < pipelines[i].passcount; j++)
+			{
+				RenderPassInfo &info = pipelines[i].passes[j];
+				FrameCaptureFile::Pass pass;
+				memset(&pass, 0, sizeof(pass));
+				pass.width = info.target.width;
+				pass.height = info.target.height;
+				pass.clearcolor = info.clear.clearcolor;
+				pass.cleardepth = info.clear.cleardepth;
+				pass.color = info.clear.color;
+				pass.depth = info.clear.depth;
+				pass.batchcount = info.batchcount;
+				commands.push_back(std::vector<char>());
+				unsigned int uniformcount = 0;
+				flattenCommands(info.commands, commands.back(),
+				                uniformcount, collector);
+				pass.uniformcount = uniformcount;
+				pass.commandsize = commands.back().size();
+				passinfo.push_back(pass);
+			}
+		}
+		// Write the file
+		FrameCaptureFile::Header header;
+		header.tag = FrameCaptureFile::tag;
+		header.version = FrameCaptureFile::version;
+		header.width = width;
+		header.height = height;
+		header.resourcecount = collector.resources.size();
+		header.pipelinestatecount = collector.states.size();
+		header.passcount = passinfo.size();
+		if (file->write(sizeof(header), &header) != sizeof(header))
+			return false;
+		unsigned int memsize = header.resourcecount * sizeof(FrameCaptureFile::Resource);
+		if (memsize > 0
+		 && file->write(memsize, &collector.resources[0]) != (int)memsize)
+			return false;
+		for (unsigned int i = 0; i < collector.states.size(); i++)
+		{
+			PipelineState *state = collector.states[i];
+			FrameCaptureFile::PipelineState entry;
+			entry.shader = state->shader;
+			entry.blendmode = state->blendMode;
+			entry.attribcount = state->attribcount;
+			if (file->write(sizeof(entry), &entry) != sizeof(entry))
+				return false;
+			memsize = state->attribcount * sizeof(AttribMapping);
+			if (memsize > 0
+			 && file->write(memsize, state->attribs) != (int)memsize)
+				return false;
+		}
+		for (unsigned int i = 0; i < passinfo.size(); i++)
+		{
+			if (file->write(sizeof(passinfo[i]), &passinfo[i]) != sizeof(passinfo[i]))
+				return false;
+			if (file->write(commands[i].size(), &commands[i][0])
+			    != (int)commands[i].size())
+				return false;
+		}
+		return true;
+	}
+
+	void FrameCapture::setResourceHandle(unsigned int index, int handle)
+	{
+		const FrameCaptureFile::Resource &resource = resources[index];
+		handles[resource.type][resource.handle] = handle;
+		if (resource.type == FrameCaptureFile::ResourceType::Shader)
+		{
+			for (unsigned int i = 0; i < states.size(); i++)
+			{
+				if (stateshaders[i] == resource.handle)
+					states[i]->shader = handle;
+			}
+		}
+		for (unsigned int i = 0; i < passes.size(); i++)
+			passes[i].dirty = true;
+	}
+
+	char *FrameCapture::getCommands(unsigned int pass)
+	{
+		if (passes[pass].dirty)
+			remapCommands(pass);
+		return &passes[pass].commands[0];
+	}
+
+	void FrameCapture::releaseDriverData(VideoDriver *driver)
+	{
+		for (unsigned int i = 0; i < states.size(); i++)
+		{
+			if (states[i]->driverdata)
+				driver->destroyPipelineState(states[i]);
+		}
+	}
+
+	static int remapHandle(std::map<int, int> &handles, int handle)
+	{
+		std::map<int, int>::iterator it = handles.find(handle);
+		if (it == handles.end())
+			return handle;
+		return it->second;
+	}
+
+	void FrameCapture::remapCommands(unsigned int pass)
+	{
+		std::vector<char> &commands = passes[pass].commands;
+		commands = passes[pass].original;
+		char *command = &commands[0];
+		while (true)
+		{
+			CommandHeader *header = (CommandHeader*)command;
+			void *data = header + 1;
+			switch (header->type)
+			{
+				case RenderCommand::PipelineState:
+				{
+					PipelineStateCommand *command = (PipelineStateCommand*)data;
+					uintptr_t index = (uintptr_t)command->state;
+					command->state = states[index];
+					break;
+				}
+				case RenderCommand::Buffers:
+				{
+					BufferCommand *buffers = (BufferCommand*)data;
+					buffers->vertices = remapHandle(handles[FrameCaptureFile::ResourceType::VertexBuffer],
+					                                buffers->vertices);
+					buffers->indices = remapHandle(handles[FrameCaptureFile::ResourceType::IndexBuffer],
+					                               buffers->indices);
+					break;
+				}
+				case RenderCommand::Textures:
+				{
+					ArrayCommand *textures = (ArrayCommand*)data;
+					TextureEntry *entries = (TextureEntry*)(textures + 1);
+					for (unsigned int i = 0; i < textures->count; i++)
+					{
+						entries[i].texhandle = remapHandle(handles[FrameCaptureFile::ResourceType::Texture],
+						                                   entries[i].texhandle);
+					}
+					break;
+				}
+				case RenderCommand::End:
+					passes[pass].dirty = false;
+					return;
+			}
+			command += header->size;
+		}
+	}
+}
+}
@@ -25,7 +25,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/VertexLayout.hpp"
 #include "CoreRender/render/ShaderVariableType.hpp"
 #include "CoreRender/render/FrameBuffer.hpp"
+#include "CoreRender/render/RenderTarget.hpp"
 #include "CoreRender/render/BlendMode.hpp"
+#include "CoreRender/math/StdInt.hpp"
 
 namespace cr
 {
@@ -52,6 +54,25 @@ namespace render
 		unsigned int components;
 		VertexElementType::List type;
 	};
+	/**
+	 * Immutable pipeline state object combining a shader, a vertex layout and
+	 * the blend mode of the shader. Pipeline state objects are created by
+	 * Shader::getPipelineState() and live until the shader is destroyed.
+	 */
+	struct PipelineState
+	{
+		int shader;
+		unsigned int blendMode;
+		AttribMapping *attribs;
+		unsigned int attribcount;
+		/**
+		 * Driver specific version of the state (e.g. a vertex array object),
+		 * created by the video driver in the render thread when the state is
+		 * used for the first time and freed with
+		 * VideoDriver::destroyPipelineState().
+		 */
+		void *driverdata;
+	};
 	/**
 	 * Raw optimized batch data to be passed to the render thread.
 	 */
@@ -59,25 +80,49 @@ namespace render
 	{
 		TextureEntry *textures;
 		UniformMapping *uniforms;
-		AttribMapping *attribs;
+		PipelineState *state;
 
 		unsigned int texcount;
 		unsigned int uniformcount;
-		unsigned int attribcount;
 
-		int shader;
 		int vertices;
 		int indices;
 
-		float sortkey;
+		uint64_t sortkey;
 		unsigned int startindex;
 		unsigned int endindex;
 		unsigned int basevertex;
 		unsigned int vertexoffset;
 		unsigned int indextype;
 
-		unsigned int blendMode;
 		unsigned int renderflags;
+
+		/**
+		 * Number of instances drawn by this batch. This is 0 if the shader
+		 * is not instanced, in this case VideoDriver::draw() is used instead
+		 * of VideoDriver::drawInstanced().
+		 */
+		unsigned int instancecount;
+		/**
+		 * Values of the per-instance uniform for all instances, stored one
+		 * after another.
+		 */
+		float *instancedata;
+		/**
+		 * Type of the per-instance uniform.
+		 */
+		ShaderVariableType::List instancetype;
+		/**
+		 * Shader handle of the attrib which receives the per-instance
+		 * uniform.
+		 */
+		int instanceattrib;
+		/**
+		 * Index of the per-instance uniform in the uniform list. Batches
+		 * which only differ in the value of this uniform can be merged into
+		 * a single instanced batch.
+		 */
+		unsigned int instanceuniform;
 	};
 
 	struct RenderTargetInfo
@@ -88,6 +133,11 @@ namespace render
 		unsigned int depthbuffer;
 		unsigned int colorbuffercount;
 		unsigned int *colorbuffers;
+		/**
+		 * Mipmap policy of each color buffer for this frame, see
+		 * RenderTarget::getFrameMipmapPolicy().
+		 */
+		MipmapPolicy::List *mipmaps;
 	};
 	struct ClearInfo
 	{
@@ -101,7 +151,20 @@ namespace render
 		RenderTargetInfo target;
 		ClearInfo clear;
 		unsigned int colorbuffers;
-		RenderBatch **batches;
+		/**
+		 * Command stream containing the batches of the pass (see
+		 * CommandStream.hpp).
+		 */
+		char *commands;
+		/**
+		 * Size of the command stream in bytes.
+		 */
+		unsigned int commandsize;
+		/**
+		 * Table which holds the current uniforms while the command stream is
+		 * read, large enough for every batch in the stream.
+		 */
+		UniformMapping *uniforms;
 		unsigned int batchcount;
 	};
 
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/RenderContextNull.hpp"
 #include "CoreRender/render/Renderer.hpp"
 #include "CoreRender/render/RenderThread.hpp"
+#include "CoreRender/render/UploadThread.hpp"
 #include "CoreRender/res/DefaultResourceFactory.hpp"
 #include "CoreRender/render/Animation.hpp"
 #include "FrameData.hpp"
@@ -39,6 +40,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 #include "opengl/VideoDriverOpenGL.hpp"
 #include "null/VideoDriverNull.hpp"
+#include "null/VideoDriverAccounting.hpp"
 
 namespace cr
 {
@@ -151,7 +153,8 @@ namespace render
 	};
 
 	GraphicsEngine::GraphicsEngine()
-		: rmgr(0), multithreaded(true), renderer(0), renderthread(0)
+		: rmgr(0), multithreaded(true), renderer(0), renderthread(0),
+		uploadthread(0), scheduler(0)
 	{
 	}
 	GraphicsEngine::~GraphicsEngine()
@@ -163,18 +166,24 @@ namespace render
 	                          unsigned int height,
 	                          bool fullscreen,
 	                          RenderContext::Ptr context,
-	                          bool multithreaded)
+	                          bool multithreaded,
+	                          unsigned int framesinflight,
+	                          bool asyncuploads)
 	{
 		// Initialize file system
+		core::StandardFileSystem::Ptr newfs;
 		if (!fs)
 		{
-			core::StandardFileSystem::Ptr newfs = new core::StandardFileSystem();
+			newfs = new core::StandardFileSystem();
 			newfs->mount("", "/");
 			fs = newfs;
 		}
 		// Initialize log file
 		if (!log)
 			log = new core::Log(fs, "/CoreRenderLog.html");
+		// Trace file accesses of the default file system
+		if (newfs)
+			newfs->setLog(log);
 		log->info("CoreRender initializing.");
 		// TODO: Version information
 		// Create context of no was provided
@@ -204,6 +213,17 @@ namespace render
 			}
 		}
 		this->multithreaded = multithreaded;
+		if (!multithreaded)
+		{
+			// The frame is rendered directly, nothing can be queued
+			framesinflight = 1;
+		}
+		else if (framesinflight < 1 || framesinflight > 4)
+		{
+			log->warning("Invalid number of frames in flight (%d), using %d.",
+			             framesinflight, framesinflight < 1 ? 1 : 4);
+			framesinflight = framesinflight < 1 ? 1 : 4;
+		}
 		// Initialize resource manager
 		rmgr = new res::ResourceManager(fs, log);
 		if (!rmgr->init())
@@ -228,7 +248,8 @@ namespace render
 			secondcontext = 0;
 			return false;
 		}
-		renderer = new Renderer(context, secondcontext, log, driver, this);
+		renderer = new Renderer(context, secondcontext, log, driver, this,
+		                        framesinflight);
 		// Create render thread
 		if (multithreaded)
 		{
@@ -247,6 +268,43 @@ namespace render
 				return false;
 			}
 		}
+		// Create upload thread with a third context
+		if (asyncuploads)
+		{
+			RenderContext::Ptr uploadcontext = context->clone();
+			if (uploadcontext)
+			{
+				uploadthread = new UploadThread(renderer, uploadcontext);
+				renderer->setUploadThread(uploadthread);
+				if (!uploadthread->start())
+				{
+					log->warning("Could not start upload thread. "
+					             "Uploading in the render thread.");
+					renderer->setUploadThread(0);
+					delete uploadthread;
+					uploadthread = 0;
+				}
+			}
+			else
+			{
+				log->warning("Could not clone the rendering context. "
+				             "Uploading in the render thread.");
+			}
+		}
+		// Start the worker threads shared by resource loading and the
+		// application
+		scheduler = new core::TaskScheduler();
+		if (scheduler->start())
+		{
+			rmgr->setTaskScheduler(scheduler);
+		}
+		else
+		{
+			log->warning("Could not start the task scheduler. "
+			             "Loading resources in a single thread.");
+			delete scheduler;
+			scheduler = 0;
+		}
 		// Register resource types
 		res::ResourceFactory::Ptr factory;
 		factory = new res::DefaultResourceFactory<Material>(rmgr);
@@ -280,6 +338,14 @@ namespace render
 	}
 	void GraphicsEngine::shutdown()
 	{
+		// Finish loading resources, the loading tasks use the renderer
+		if (scheduler)
+		{
+			rmgr->setTaskScheduler(0);
+			scheduler->stop();
+			delete scheduler;
+			scheduler = 0;
+		}
 		// Stop and destroy render thread
 		if (multithreaded)
 		{
@@ -287,6 +353,15 @@ namespace render
 			delete renderthread;
 			renderthread = 0;
 		}
+		// The render thread might have been waiting for uploads, so the
+		// upload thread is stopped afterwards
+		if (uploadthread)
+		{
+			uploadthread->stop();
+			renderer->setUploadThread(0);
+			delete uploadthread;
+			uploadthread = 0;
+		}
 		// Clean up render resources
 		// TODO
 		// Delete pipelines
@@ -329,12 +404,14 @@ namespace render
 		{
 			pipelines[i]->prepare(&renderdata[i]);
 		}
-		// Wait for last frame to end
+		// Wait until there is a free slot for the frame
+		core::Time waitbegin = core::Time::Now();
 		if (multithreaded)
 			renderthread->waitForFrame();
+		core::Duration submitwaittime = core::Time::Now() - waitbegin;
 		// Fetch statistics from the last frame
-		stats = driver->getStats();
-		driver->getStats().reset();
+		stats = renderer->getStats();
+		stats.setSubmitWaitTime(submitwaittime);
 		// Render
 		renderer->prepareRendering(renderdata, pipelines.size());
 		if (multithreaded)
@@ -345,6 +422,7 @@ namespace render
 			driver->getStats().setRenderBegin(core::Time::Now());
 			renderer->render();
 			driver->getStats().setFrameEnd(core::Time::Now());
+			renderer->storeStats();
 		}
 		// Update input in secondary context
 		// SDL needs this.
@@ -353,6 +431,49 @@ namespace render
 		return true;
 	}
 
+	bool GraphicsEngine::captureFrame(const std::string &filename)
+	{
+		core::File::Ptr file = fs->open(filename,
+		                                core::FileAccess::Write,
+		                                true);
+		if (!file)
+		{
+			log->error("Could not open frame capture file \"%s\".",
+			           filename.c_str());
+			return false;
+		}
+		renderer->captureFrame(file);
+		return true;
+	}
+	bool GraphicsEngine::replayFrame(FrameCapture::Ptr capture,
+	                                 std::vector<core::Duration> *passtimes)
+	{
+		if (multithreaded)
+		{
+			log->error("Frames can only be replayed in single-threaded mode.");
+			return false;
+		}
+		renderer->uploadNewObjects();
+		driver->getStats().setFrameBegin(core::Time::Now());
+		driver->getStats().setRenderBegin(core::Time::Now());
+		renderer->uploadObjects(true);
+		renderer->replayFrame(capture, passtimes);
+		driver->getStats().setFrameEnd(core::Time::Now());
+		renderer->storeStats();
+		stats = renderer->getStats();
+		return true;
+	}
+
+	void GraphicsEngine::setUploadBudget(unsigned int bytes,
+	                                     core::Duration time)
+	{
+		renderer->setUploadBudget(bytes, time);
+	}
+	void GraphicsEngine::setDeletionBudget(unsigned int resources)
+	{
+		renderer->setDeletionBudget(resources);
+	}
+
 	void GraphicsEngine::addPipeline(Pipeline::Ptr pipeline)
 	{
 		pipeline->setRenderer(renderer);
@@ -450,7 +571,8 @@ namespace render
 			return 0;
 #endif
 		}
-		else if (type == VideoDriverType::Null)
+		else if (type == VideoDriverType::Null
+		      || type == VideoDriverType::NullAccounting)
 		{
 			return new RenderContextNull();
 		}
@@ -476,6 +598,10 @@ namespace render
 		{
 			return new null::VideoDriverNull();
 		}
+		else if (type == VideoDriverType::NullAccounting)
+		{
+			return new null::VideoDriverAccounting();
+		}
 		else
 		{
 			return 0;
@@ -77,5 +77,11 @@ namespace render
 	{
 		// TODO
 	}
+
+	unsigned int IndexBuffer::getMemorySize()
+	{
+		tbb::spin_mutex::scoped_lock lock(datamutex);
+		return size;
+	}
 }
 }
@@ -22,6 +22,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/Material.hpp"
 #include "CoreRender/res/ResourceManager.hpp"
 #include "CoreRender/render/Texture2D.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
 #include "../3rdparty/tinyxml.h"
 
 #include <sstream>
@@ -52,6 +53,7 @@ namespace render
 	{
 		TextureInfo info;
 		info.name = name;
+		info.slot = ShaderSlots::get(name);
 		info.texture = texture;
 		textures.push_back(info);
 	}
@@ -98,8 +100,8 @@ namespace render
 			     node != 0;
 			     node = root->IterateChildren("Shader", node))
 			{
-				getManager()->getLog()->debug("%s: Text.",
-				                              getName().c_str());
+				CR_LOG_DEBUG(getManager()->getLog(), "%s: Text.",
+				             getName().c_str());
 				shaderelem = node->ToElement();
 				if (shaderelem)
 					break;
@@ -83,7 +83,7 @@ namespace render
 		return meshes.size();
 	}
 
-	Model::Node *Model::addNode(const std::string &name, Model::Node *parent)
+	Model::Node *Model::addNode(core::Name name, Model::Node *parent)
 	{
 		Node *node = new Node(name, this, parent);
 		if (!parent)
@@ -95,7 +95,7 @@ namespace render
 		}
 		return node;
 	}
-	void Model::removeNode(const std::string &name)
+	void Model::removeNode(core::Name name)
 	{
 		Node *node = getNode(name);
 		if (node)
@@ -111,7 +111,7 @@ namespace render
 	{
 		return rootnode;
 	}
-	Model::Node *Model::getNode(const std::string &name)
+	Model::Node *Model::getNode(core::Name name)
 	{
 		NodeMap::iterator it = nodes.find(name);
 		if (it == nodes.end())
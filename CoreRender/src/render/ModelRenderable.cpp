@@ -21,6 +21,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CoreRender/render/ModelRenderable.hpp"
 #include "CoreRender/render/RenderJob.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
 
 #include <cstdio>
 
@@ -29,12 +30,16 @@ namespace cr
 namespace render
 {
 	ModelRenderable::ModelRenderable()
+		: nodecachemodel(0)
 	{
-		uniforms.add("worldMat");
-		uniforms.add("worldNormalMat");
+		worldmatslot = ShaderSlots::get("worldMat");
+		worldnormalmatslot = ShaderSlots::get("worldNormalMat");
+		uniforms.add(worldmatslot);
+		uniforms.add(worldnormalmatslot);
 	}
 	ModelRenderable::~ModelRenderable()
 	{
+		clearNodeCache();
 	}
 
 	void ModelRenderable::setModel(Model::Ptr model)
@@ -82,9 +87,17 @@ namespace render
 		if (!model)
 			return 0;
 		// Get list with model nodes (needed for joints)
-		// TODO: Cache these
-		Model::AnimationNodeMap nodes;
-		model->getNodeList(nodes);
+		if (nodecachemodel != model.get()
+		 || meshnodes.size() != model->getMeshCount()
+		 || jointnodes.size() != model->getBatchCount())
+			updateNodeCache();
+		for (unsigned int i = 0; i < nodeinfo.size(); i++)
+		{
+			Model::AnimationNode *animnode = nodeinfo[i].animnode;
+			animnode->transformation = nodeinfo[i].node->getTransformation();
+			animnode->transinverse = nodeinfo[i].node->getInvTrans();
+			animnode->dirty = true;
+		}
 		// Prepare skeletal animation
 		for (Model::AnimationNodeMap::iterator it = nodes.begin();
 		     it != nodes.end(); it++)
@@ -105,19 +118,26 @@ namespace render
 			}
 		}
 		// Update absolute transformation
-		for (Model::AnimationNodeMap::iterator it = nodes.begin();
-		     it != nodes.end(); it++)
+		for (unsigned int i = 0; i < nodeinfo.size(); i++)
 		{
-			it->second->computeAbsTrans();
+			nodeinfo[i].animnode->computeAbsTrans();
 		}
 		// Prepare batches
-		jobs.resize(model->getMeshCount());
+		// The jobs are kept between frames so that their uniform data does
+		// not have to be reallocated
+		if (jobs.size() != model->getMeshCount())
+			jobs.resize(model->getMeshCount());
 		for (unsigned int i = 0; i < model->getMeshCount(); i++)
 		{
 			Model::Mesh *mesh = model->getMesh(i);
 			Model::Batch *batch = model->getBatch(mesh->batch);
 			// Get node this mesh is attached to
-			Model::AnimationNode *node = nodes.find(mesh->node->getName())->second;
+			Model::AnimationNode *node = meshnodes[i];
+			// Set standard uniforms
+			// TODO: We only have to do this if we do not use skinning
+			math::Matrix4 worldmat = getWorldMat() * node->abstrans;
+			uniforms.add(worldmatslot) = worldmat;
+			uniforms.add(worldnormalmatslot) = getWorldNormalMat();
 			// Create job
 			RenderJob &job = jobs[i];
 			job.vertices = model->getVertexBuffer();
@@ -130,41 +150,38 @@ namespace render
 			job.vertexoffset = batch->vertexoffset;
 			job.indextype = batch->indextype;
 			job.basevertex = 0;
-			job.uniforms = uniforms;
+			const UniformData::UniformMap &uniformdata = uniforms.getData();
+			for (UniformData::UniformMap::const_iterator it = uniformdata.begin();
+			     it != uniformdata.end(); it++)
+			{
+				job.uniforms.add(it->first) = it->second;
+			}
+			// Use the view space depth of the node origin for sorting, the
+			// camera looks along the negative z axis
+			if (hasViewMat())
+			{
+				math::Matrix4 viewtrans = getViewMat() * getTransMat()
+					* node->abstrans;
+				job.depth = -viewtrans(2, 3);
+			}
+			else
+				job.depth = 0.0f;
 			// Apply animations
-			Model::AnimationNodeMap::iterator it;
+			std::vector<Model::AnimationNode*> &joints = jointnodes[mesh->batch];
 			for (unsigned int i = 0; i < batch->joints.size(); i++)
 			{
-				// Get uniform name
-				char uniformname[20];
-				snprintf(uniformname, 20, "skinMat[%u]", i);
-				// Find joint node
-				Model::Joint &joint = batch->joints[i];
-				std::string jointname = joint.name;
-				it = nodes.find(jointname);
-				if (it == nodes.end())
+				Model::AnimationNode *jointnode = joints[i];
+				if (!jointnode)
 				{
 					// TODO: Log warning
-					job.uniforms.add(uniformname) = math::Matrix4::Identity();
+					job.uniforms.add(skinmatslots[i]) = math::Matrix4::Identity();
 					continue;
 				}
-				Model::AnimationNode *jointnode = it->second;
 				// Compute and set joint matrix
-				math::Matrix4 matrix = joint.jointmat;
+				Model::Joint &joint = batch->joints[i];
 				// TODO: Slow.
-				job.uniforms.add(uniformname) = node->abstransinverse * jointnode->abstrans * joint.jointmat;
+				job.uniforms.add(skinmatslots[i]) = node->abstransinverse * jointnode->abstrans * joint.jointmat;
 			}
-			// Set standard uniforms
-			// TODO: We only have to do this if we do not use skinning
-			math::Matrix4 oldtransmat = getTransMat();
-			uniforms["worldMat"] = getWorldMat() * node->abstrans;
-			uniforms["worldNormalMat"] = getWorldNormalMat();
-		}
-		// Clear node list again
-		for (Model::AnimationNodeMap::iterator it = nodes.begin();
-		     it != nodes.end(); it++)
-		{
-			delete it->second;
 		}
 		return model->getMeshCount();
 	}
@@ -174,7 +191,65 @@ namespace render
 	}
 	void ModelRenderable::endRendering()
 	{
-		jobs.clear();
+	}
+
+	void ModelRenderable::updateNodeCache()
+	{
+		clearNodeCache();
+		nodecachemodel = model.get();
+		// Create animation nodes
+		model->getNodeList(nodes);
+		for (Model::AnimationNodeMap::iterator it = nodes.begin();
+		     it != nodes.end(); it++)
+		{
+			NodeInfo info;
+			info.node = model->getNode(it->first);
+			info.animnode = it->second;
+			nodeinfo.push_back(info);
+		}
+		// Get the nodes the meshes are attached to
+		meshnodes.resize(model->getMeshCount());
+		for (unsigned int i = 0; i < model->getMeshCount(); i++)
+		{
+			Model::Mesh *mesh = model->getMesh(i);
+			meshnodes[i] = nodes.find(mesh->node->getName())->second;
+		}
+		// Get joint nodes
+		jointnodes.resize(model->getBatchCount());
+		for (unsigned int i = 0; i < model->getBatchCount(); i++)
+		{
+			Model::Batch *batch = model->getBatch(i);
+			jointnodes[i].resize(batch->joints.size());
+			for (unsigned int j = 0; j < batch->joints.size(); j++)
+			{
+				Model::AnimationNodeMap::iterator it;
+				it = nodes.find(batch->joints[j].name);
+				if (it == nodes.end())
+					jointnodes[i][j] = 0;
+				else
+					jointnodes[i][j] = it->second;
+			}
+			// Create uniform slots for the joints
+			for (unsigned int j = skinmatslots.size(); j < batch->joints.size(); j++)
+			{
+				char uniformname[20];
+				snprintf(uniformname, 20, "skinMat[%u]", j);
+				skinmatslots.push_back(ShaderSlots::get(uniformname));
+			}
+		}
+	}
+	void ModelRenderable::clearNodeCache()
+	{
+		for (Model::AnimationNodeMap::iterator it = nodes.begin();
+		     it != nodes.end(); it++)
+		{
+			delete it->second;
+		}
+		nodes.clear();
+		nodeinfo.clear();
+		meshnodes.clear();
+		jointnodes.clear();
+		nodecachemodel = 0;
 	}
 }
 }
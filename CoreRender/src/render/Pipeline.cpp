@@ -31,12 +31,101 @@ namespace cr
 {
 namespace render
 {
+	static unsigned int alignSize(unsigned int size)
+	{
+		return (size + 7) & ~7;
+	}
+	/**
+	 * Returns the size of a batch including all data referenced by it.
+	 */
+	static unsigned int getBatchSize(const RenderBatch *batch)
+	{
+		unsigned int size = alignSize(sizeof(RenderBatch));
+		size += alignSize(sizeof(UniformMapping) * batch->uniformcount);
+		for (unsigned int i = 0; i < batch->uniformcount; i++)
+		{
+			unsigned int datasize = ShaderVariableType::getSize(batch->uniforms[i].type);
+			size += alignSize(datasize * sizeof(float));
+		}
+		size += alignSize(sizeof(TextureEntry) * batch->texcount);
+		return size;
+	}
+	/**
+	 * Copies a batch and all data referenced by it to memory and advances the
+	 * memory pointer.
+	 */
+	static RenderBatch *copyBatch(const RenderBatch *batch, char *&memory)
+	{
+		RenderBatch *copy = (RenderBatch*)memory;
+		memory += alignSize(sizeof(RenderBatch));
+		*copy = *batch;
+		if (batch->uniformcount > 0)
+		{
+			unsigned int size = sizeof(UniformMapping) * batch->uniformcount;
+			copy->uniforms = (UniformMapping*)memory;
+			memcpy(copy->uniforms, batch->uniforms, size);
+			memory += alignSize(size);
+			for (unsigned int i = 0; i < batch->uniformcount; i++)
+			{
+				unsigned int datasize = ShaderVariableType::getSize(batch->uniforms[i].type);
+				datasize *= sizeof(float);
+				copy->uniforms[i].data = (float*)memory;
+				memcpy(copy->uniforms[i].data, batch->uniforms[i].data, datasize);
+				memory += alignSize(datasize);
+			}
+			if (batch->instancecount > 0)
+				copy->instancedata = copy->uniforms[batch->instanceuniform].data;
+		}
+		if (batch->texcount > 0)
+		{
+			unsigned int size = sizeof(TextureEntry) * batch->texcount;
+			copy->textures = (TextureEntry*)memory;
+			memcpy(copy->textures, batch->textures, size);
+			memory += alignSize(size);
+		}
+		return copy;
+	}
+	/**
+	 * Marks the resources of a batch as used by the frame which is being
+	 * built so that pending uploads are not deferred past the frame.
+	 */
+	static void markUsed(const VertexBuffer::Ptr &vertices,
+	                     const IndexBuffer::Ptr &indices,
+	                     const Material::Ptr &material)
+	{
+		vertices->markUsed();
+		indices->markUsed();
+		const std::vector<Material::TextureInfo> &textures = material->getTextures();
+		for (unsigned int i = 0; i < textures.size(); i++)
+			textures[i].texture->markUsed();
+	}
+	/**
+	 * Returns the sum of the revisions of the resources of a batch. The
+	 * revisions only increase, so the sum changes whenever one of the
+	 * resources is changed.
+	 */
+	static unsigned int getRevision(const VertexBuffer::Ptr &vertices,
+	                                const IndexBuffer::Ptr &indices,
+	                                const Material::Ptr &material)
+	{
+		unsigned int revision = vertices->getRevision() + indices->getRevision();
+		const std::vector<Material::TextureInfo> &textures = material->getTextures();
+		for (unsigned int i = 0; i < textures.size(); i++)
+			revision += textures[i].texture->getRevision();
+		return revision;
+	}
+
 	Pipeline::Pipeline()
 		: renderer(0)
 	{
+		submitindex = 0;
 	}
 	Pipeline::~Pipeline()
 	{
+		for (unsigned int i = 0; i < retained.size(); i++)
+			delete[] retained[i].memory;
+		for (unsigned int i = 0; i < retiredmemory.size(); i++)
+			delete[] retiredmemory[i].memory;
 	}
 
 	void Pipeline::addPass(RenderPass::Ptr pass)
@@ -70,33 +159,143 @@ namespace render
 	}
 
 	void Pipeline::submit(Renderable *renderable)
+	{
+		submit(renderable, submitindex++);
+	}
+	void Pipeline::submit(Renderable *renderable, unsigned int index)
 	{
 		unsigned int jobcount = renderable->beginRendering();
 		// TODO: Reduce these calls to one?
 		for (unsigned int i = 0; i < jobcount; i++)
-			submit(renderable->getJob(i));
+			submitJob(renderable->getJob(i), ((uint64_t)index << 32) + i);
 		renderable->endRendering();
 	}
 	void Pipeline::submit(RenderJob *job)
 	{
-		if (!job->material->getShader())
+		submit(job, submitindex++);
+	}
+	void Pipeline::submit(RenderJob *job, unsigned int index)
+	{
+		submitJob(job, (uint64_t)index << 32);
+	}
+
+	unsigned int Pipeline::registerRenderable(Renderable *renderable)
+	{
+		unsigned int handle;
+		if (freeretained.size() > 0)
+		{
+			handle = freeretained.back();
+			freeretained.pop_back();
+		}
+		else
+		{
+			handle = retained.size();
+			retained.push_back(RetainedRenderable());
+		}
+		retained[handle].renderable = renderable;
+		retained[handle].dirty = true;
+		retained[handle].memory = 0;
+		return handle;
+	}
+	void Pipeline::unregisterRenderable(unsigned int handle)
+	{
+		RetainedRenderable &entry = retained[handle];
+		// The batches might still be used by the render thread
+		if (entry.memory)
+			retireMemory(entry.memory);
+		entry.renderable = 0;
+		entry.memory = 0;
+		entry.batches.clear();
+		freeretained.push_back(handle);
+	}
+	void Pipeline::updateRenderable(unsigned int handle)
+	{
+		retained[handle].dirty = true;
+	}
+
+	void Pipeline::beginFrame()
+	{
+		submitindex = 0;
+		// Free the batches which are not used by any queued frame anymore
+		unsigned int renderedframes = renderer->getRenderedFrames();
+		unsigned int freed = 0;
+		while (freed < retiredmemory.size()
+		    && retiredmemory[freed].frame <= renderedframes)
+		{
+			delete[] retiredmemory[freed].memory;
+			freed++;
+		}
+		retiredmemory.erase(retiredmemory.begin(),
+		                    retiredmemory.begin() + freed);
+		for (unsigned int i = 0; i < passes.size(); i++)
+		{
+			passes[i]->beginFrame();
+		}
+	}
+	void Pipeline::prepare(PipelineInfo *info)
+	{
+		info->passcount = passes.size();
+		unsigned int memsize = sizeof(RenderPassInfo) * info->passcount;
+		core::MemoryPool *memory = renderer->getNextFrameMemory();
+		info->passes = (RenderPassInfo*)memory->allocate(memsize);
+		submitRetained();
+		for (unsigned int i = 0; i < passes.size(); i++)
+		{
+			passes[i]->prepare(&info->passes[i], memory,
+			                   renderer->getBuildFrame());
+		}
+	}
+
+	void Pipeline::submitJob(RenderJob *job,
+	                         uint64_t sequence,
+	                         std::vector<RetainedBatch> *retainedbatches)
+	{
+		ShaderText::Ptr text = job->material->getShader();
+		if (!text)
 			return;
+		core::MemoryPool *memory = renderer->getNextFrameMemory();
 		// Get uniform data
-		UniformData uniforms = job->material->getShader()->getUniformData();
-		uniforms.setValues(job->material->getUniformData());
-		uniforms.setValues(job->uniforms);
+		// The default values from the shader text are overridden by the
+		// material which in turn is overridden by the job. The values are
+		// looked up directly instead of merging copies of the uniform data
+		// to prevent heap allocations, and are shared by all passes.
+		const UniformData::UniformMap &defaults = text->getUniformData().getData();
+		const UniformData::UniformMap &materialuniforms = job->material->getUniformData().getData();
+		const UniformData::UniformMap &jobuniforms = job->uniforms.getData();
+		unsigned int uniformcount = defaults.size();
+		UniformMapping *uniforms = (UniformMapping*)memory->allocate(sizeof(UniformMapping) * uniformcount);
+		{
+			unsigned int i = 0;
+			for (UniformData::UniformMap::const_iterator it = defaults.begin();
+			     it != defaults.end(); ++it, ++i)
+			{
+				const Uniform *uniform = &it->second;
+				UniformData::UniformMap::const_iterator it2 = jobuniforms.find(it->first);
+				if (it2 != jobuniforms.end())
+					uniform = &it2->second;
+				else
+				{
+					it2 = materialuniforms.find(it->first);
+					if (it2 != materialuniforms.end())
+						uniform = &it2->second;
+				}
+				uniforms[i].type = uniform->getType();
+				unsigned int size = ShaderVariableType::getSize(uniforms[i].type);
+				uniforms[i].data = (float*)memory->allocate(size * sizeof(float));
+				memcpy(uniforms[i].data, uniform->getData(), size * sizeof(float));
+			}
+		}
+		markUsed(job->vertices, job->indices, job->material);
 		// Get flag values
-		ShaderText::Ptr text = job->material->getShader();
 		unsigned int flags = text->getFlags(job->material->getShaderFlags());
 		// Collect batch info
 		for (unsigned int i = 0; i < passes.size(); i++)
 		{
-			std::string context = passes[i]->getContext();
+			core::Name context = passes[i]->getContext();
 			Shader::Ptr shader = text->getShader(context, flags);
 			if (!shader)
 				continue;
 			// Allocate render batch
-			core::MemoryPool *memory = renderer->getNextFrameMemory();
 			RenderBatch *batch = (RenderBatch*)memory->allocate(sizeof(RenderBatch));
 			batch->startindex = job->startindex;
 			batch->endindex = job->endindex;
@@ -105,51 +304,35 @@ namespace render
 			batch->indextype = job->indextype;
 			batch->vertices = job->vertices->getHandle();
 			batch->indices = job->indices->getHandle();
-			batch->shader = shader->getHandle();
-			batch->blendMode = shader->getBlendMode();
-			batch->sortkey = 0.0f; // TODO
+			batch->state = shader->getPipelineState(job->layout);
+			batch->sortkey = 0;
 			batch->renderflags = 0;
-			// Attribs
-			if (job->layout->getElementCount() > 0)
-			{
-				batch->attribcount = job->layout->getElementCount();
-				unsigned int memsize = sizeof(AttribMapping) * batch->attribcount;
-				batch->attribs = (AttribMapping*)memory->allocate(memsize);
-				AttribMapping *attribs = batch->attribs;
-				for (unsigned int i = 0; i < batch->attribcount; i++)
-				{
-					VertexLayoutElement *attrib = job->layout->getElement(i);
-					attribs[i].shaderhandle = shader->getAttrib(attrib->name);
-					attribs[i].components = attrib->components;
-					attribs[i].stride = attrib->stride;
-					attribs[i].type = attrib->type;
-					attribs[i].address = job->layout->getSlotOffset(job->vertexcount,
-					                                                attrib->vbslot)
-					                   + attrib->offset;
-				}
-			}
-			else
-			{
-				batch->attribcount = 0;
-				batch->attribs = 0;
-			}
+			batch->instancecount = 0;
+			batch->instancedata = 0;
+			batch->instancetype = ShaderVariableType::Invalid;
+			batch->instanceattrib = shader->getInstanceAttrib();
+			batch->instanceuniform = 0;
 			// Uniforms
-			const UniformData::UniformMap &uniformdata = uniforms.getData();
-			batch->uniformcount = uniformdata.size();
+			batch->uniformcount = uniformcount;
 			unsigned int memsize = sizeof(UniformMapping) * batch->uniformcount;
 			batch->uniforms = (UniformMapping*)memory->allocate(memsize);
 			{
+				int instanceslot = shader->getInstanceUniform();
 				unsigned int i = 0;
-				for (UniformData::UniformMap::const_iterator it = uniformdata.begin();
-				     it != uniformdata.end(); ++it, ++i)
+				for (UniformData::UniformMap::const_iterator it = defaults.begin();
+				     it != defaults.end(); ++it, ++i)
 				{
-					batch->uniforms[i].type = it->second.getType();
-					unsigned int size = ShaderVariableType::getSize(batch->uniforms[i].type);
-					batch->uniforms[i].shaderhandle = shader->getUniform(it->second.getName());
-					batch->uniforms[i].data = (float*)memory->allocate(size * sizeof(float));
-					memcpy(batch->uniforms[i].data,
-					       it->second.getData(),
-					       size * sizeof(float));
+					batch->uniforms[i].type = uniforms[i].type;
+					batch->uniforms[i].shaderhandle = shader->getUniform(it->first);
+					batch->uniforms[i].data = uniforms[i].data;
+					// Instanced shaders get the value as a vertex attrib
+					if ((int)it->first == instanceslot)
+					{
+						batch->instancecount = 1;
+						batch->instancedata = uniforms[i].data;
+						batch->instancetype = uniforms[i].type;
+						batch->instanceuniform = i;
+					}
 				}
 			}
 			// TODO
@@ -163,7 +346,7 @@ namespace render
 				TextureEntry *textures = (TextureEntry*)memory->allocate(memsize);
 				for (unsigned int i = 0; i < textureinfo.size(); i++)
 				{
-					textures[i].shaderhandle = shader->getTexture(textureinfo[i].name);
+					textures[i].shaderhandle = shader->getTexture(textureinfo[i].slot);
 					textures[i].textureindex = i;
 					textures[i].texhandle = textureinfo[i].texture->getHandle();
 					textures[i].type = textureinfo[i].texture->getTextureType();
@@ -174,27 +357,111 @@ namespace render
 			{
 				batch->textures = 0;
 			}
-			passes[i]->insert(batch);
+			if (retainedbatches)
+			{
+				RetainedBatch retainedbatch;
+				retainedbatch.batch = batch;
+				retainedbatch.pass = i;
+				retainedbatch.depth = job->depth;
+				retainedbatch.sequence = sequence;
+				retainedbatch.shader = shader;
+				retainedbatch.vertices = job->vertices;
+				retainedbatch.indices = job->indices;
+				retainedbatch.material = job->material;
+				retainedbatch.revision = getRevision(job->vertices,
+				                                     job->indices,
+				                                     job->material);
+				retainedbatches->push_back(retainedbatch);
+			}
+			else
+				passes[i]->insert(batch, job->depth, sequence);
 		}
 	}
 
-	void Pipeline::beginFrame()
+	void Pipeline::submitRetained()
 	{
-		for (unsigned int i = 0; i < passes.size(); i++)
+		for (unsigned int i = 0; i < retained.size(); i++)
 		{
-			passes[i]->beginFrame();
+			RetainedRenderable &entry = retained[i];
+			if (!entry.renderable)
+				continue;
+			// Rebuild the batches if the renderable or the resources changed
+			bool rebuild = entry.dirty;
+			for (unsigned int j = 0; j < entry.batches.size() && !rebuild; j++)
+			{
+				if (!isRetainedBatchValid(entry.batches[j]))
+					rebuild = true;
+			}
+			if (rebuild)
+				rebuildRetained(i);
+			for (unsigned int j = 0; j < entry.batches.size(); j++)
+			{
+				RetainedBatch &batch = entry.batches[j];
+				if (!rebuild)
+					markUsed(batch.vertices, batch.indices, batch.material);
+				passes[batch.pass]->insert(batch.batch, batch.depth, batch.sequence);
+			}
 		}
 	}
-	void Pipeline::prepare(PipelineInfo *info)
+	void Pipeline::rebuildRetained(unsigned int handle)
 	{
-		info->passcount = passes.size();
-		unsigned int memsize = sizeof(RenderPassInfo) * info->passcount;
-		core::MemoryPool *memory = renderer->getNextFrameMemory();
-		info->passes = (RenderPassInfo*)memory->allocate(memsize);
-		for (unsigned int i = 0; i < passes.size(); i++)
+		RetainedRenderable &entry = retained[handle];
+		// Create the batches in frame memory first
+		std::vector<RetainedBatch> batches;
+		// Retained renderables are sorted behind all submitted ones
+		uint64_t sequence = (uint64_t)(0x80000000 | handle) << 32;
+		unsigned int jobcount = entry.renderable->beginRendering();
+		for (unsigned int i = 0; i < jobcount; i++)
+			submitJob(entry.renderable->getJob(i), sequence + i, &batches);
+		entry.renderable->endRendering();
+		// Copy them into a single persistent memory block
+		unsigned int memsize = 0;
+		for (unsigned int i = 0; i < batches.size(); i++)
+			memsize += getBatchSize(batches[i].batch);
+		char *memory = new char[memsize];
+		char *current = memory;
+		for (unsigned int i = 0; i < batches.size(); i++)
+			batches[i].batch = copyBatch(batches[i].batch, current);
+		// The old batches might still be used by the render thread
+		if (entry.memory)
+			retireMemory(entry.memory);
+		entry.memory = memory;
+		entry.batches.swap(batches);
+		entry.dirty = false;
+	}
+	void Pipeline::retireMemory(char *memory)
+	{
+		if (!renderer)
+		{
+			// Never passed to the render thread
+			delete[] memory;
+			return;
+		}
+		// The memory was at most used by the frame before the one which is
+		// currently being built
+		RetiredMemory retired = { memory, renderer->getBuildFrame() };
+		retiredmemory.push_back(retired);
+	}
+	bool Pipeline::isRetainedBatchValid(const RetainedBatch &retainedbatch)
+	{
+		RenderBatch *batch = retainedbatch.batch;
+		if (batch->state->shader != retainedbatch.shader->getHandle()
+		 || batch->vertices != retainedbatch.vertices->getHandle()
+		 || batch->indices != retainedbatch.indices->getHandle())
+			return false;
+		const std::vector<Material::TextureInfo> &textures = retainedbatch.material->getTextures();
+		if (textures.size() != batch->texcount)
+			return false;
+		if (getRevision(retainedbatch.vertices,
+		                retainedbatch.indices,
+		                retainedbatch.material) != retainedbatch.revision)
+			return false;
+		for (unsigned int i = 0; i < textures.size(); i++)
 		{
-			passes[i]->prepare(&info->passes[i]);
+			if (textures[i].texture->getHandle() != batch->textures[i].texhandle)
+				return false;
 		}
+		return true;
 	}
 }
 }
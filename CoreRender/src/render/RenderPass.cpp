@@ -22,6 +22,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "CoreRender/render/RenderPass.hpp"
 #include "VideoDriver.hpp"
 #include "FrameData.hpp"
+#include "CommandStream.hpp"
+#include "CoreRender/core/MemoryPool.hpp"
 
 #include <cstring>
 
@@ -29,8 +31,142 @@ namespace cr
 {
 namespace render
 {
-	RenderPass::RenderPass(const std::string &context)
-		: clearcolor(true), cleardepth(true), color(0), depth(1.0f), context(context)
+	/**
+	 * Maps a view space depth value to an unsigned integer with the given
+	 * number of bits. Positive IEEE floats compare like their bit patterns,
+	 * so the upper bits below the sign bit keep the order of arbitrary depth
+	 * ranges with constant relative precision. Geometry behind the camera is
+	 * clamped to 0.
+	 */
+	static uint64_t quantizeDepth(float depth, unsigned int bits)
+	{
+		if (!(depth > 0.0f))
+			return 0;
+		uint32_t depthbits;
+		std::memcpy(&depthbits, &depth, sizeof(depthbits));
+		return depthbits >> (31 - bits);
+	}
+	static uint64_t getTextureKey(RenderBatch *batch)
+	{
+		uint64_t key = 0;
+		for (unsigned int i = 0; i < batch->texcount; i++)
+			key = key * 31 + (uint64_t)batch->textures[i].texhandle;
+		return key;
+	}
+	/**
+	 * Returns whether two batches can be drawn with a single instanced draw
+	 * call, i.e. whether they only differ in the per-instance uniform.
+	 */
+	static bool canMergeInstances(const RenderBatch *a, const RenderBatch *b)
+	{
+		if (a->instancecount == 0 || b->instancecount == 0)
+			return false;
+		if (a->state != b->state
+		 || a->vertices != b->vertices
+		 || a->indices != b->indices
+		 || a->startindex != b->startindex
+		 || a->endindex != b->endindex
+		 || a->basevertex != b->basevertex
+		 || a->vertexoffset != b->vertexoffset
+		 || a->indextype != b->indextype
+		 || a->renderflags != b->renderflags
+		 || a->instanceuniform != b->instanceuniform
+		 || a->instancetype != b->instancetype
+		 || a->uniformcount != b->uniformcount
+		 || a->texcount != b->texcount)
+			return false;
+		if (a->textures != b->textures
+		 && memcmp(a->textures, b->textures, a->texcount * sizeof(TextureEntry)))
+			return false;
+		for (unsigned int i = 0; i < a->uniformcount; i++)
+		{
+			if (i == a->instanceuniform)
+				continue;
+			const UniformMapping &ua = a->uniforms[i];
+			const UniformMapping &ub = b->uniforms[i];
+			if (ua.type != ub.type || ua.shaderhandle != ub.shaderhandle)
+				return false;
+			unsigned int size = ShaderVariableType::getSize(ua.type);
+			if (ua.data != ub.data
+			 && memcmp(ua.data, ub.data, size * sizeof(float)))
+				return false;
+		}
+		return true;
+	}
+	/**
+	 * Computes the 64 bit sort key for a batch. Batches are drawn in
+	 * ascending key order.
+	 *
+	 * State-major layout (bits):
+	 * 63 blended, 61-62 blend mode, 49-60 shader, 37-48 texture set,
+	 * 29-36 vertex buffer, 21-28 index buffer, 0-20 depth
+	 *
+	 * Depth-major layout (bits):
+	 * 63 blended, 39-62 depth, 27-38 shader, 15-26 texture set,
+	 * 7-14 vertex buffer, 0-6 index buffer
+	 */
+	static uint64_t computeSortKey(RenderBatch *batch,
+	                               float depth,
+	                               BatchSortMode::List mode)
+	{
+		bool blended = batch->state->blendMode != BlendMode::Solid;
+		uint64_t shader = (uint64_t)batch->state->shader;
+		uint64_t textures = getTextureKey(batch);
+		uint64_t vertices = (uint64_t)batch->vertices;
+		uint64_t indices = (uint64_t)batch->indices;
+		bool depthmajor = false;
+		bool backtofront = false;
+		switch (mode)
+		{
+			case BatchSortMode::SubmissionOrder:
+				return 0;
+			case BatchSortMode::State:
+				blended = false;
+				break;
+			case BatchSortMode::FrontToBack:
+				blended = false;
+				depthmajor = true;
+				break;
+			case BatchSortMode::BackToFront:
+				blended = false;
+				depthmajor = true;
+				backtofront = true;
+				break;
+			case BatchSortMode::Automatic:
+				depthmajor = blended;
+				backtofront = blended;
+				break;
+		}
+		uint64_t key = (uint64_t)blended << 63;
+		if (!depthmajor)
+		{
+			uint64_t depthbits = quantizeDepth(depth, 21);
+			if (backtofront)
+				depthbits = 0x1FFFFF - depthbits;
+			key |= ((uint64_t)batch->state->blendMode & 0x3) << 61;
+			key |= (shader & 0xFFF) << 49;
+			key |= (textures & 0xFFF) << 37;
+			key |= (vertices & 0xFF) << 29;
+			key |= (indices & 0xFF) << 21;
+			key |= depthbits;
+		}
+		else
+		{
+			uint64_t depthbits = quantizeDepth(depth, 24);
+			if (backtofront)
+				depthbits = 0xFFFFFF - depthbits;
+			key |= depthbits << 39;
+			key |= (shader & 0xFFF) << 27;
+			key |= (textures & 0xFFF) << 15;
+			key |= (vertices & 0xFF) << 7;
+			key |= indices & 0x7F;
+		}
+		return key;
+	}
+
+	RenderPass::RenderPass(core::Name context)
+		: sortmode(BatchSortMode::Automatic), instancing(true), clearcolor(true),
+		cleardepth(true), color(0), depth(1.0f), context(context)
 	{
 	}
 	RenderPass::~RenderPass()
@@ -57,17 +193,43 @@ namespace render
 		this->color = color;
 	}
 
+	void RenderPass::setSortMode(BatchSortMode::List sortmode)
+	{
+		this->sortmode = sortmode;
+	}
+	BatchSortMode::List RenderPass::getSortMode()
+	{
+		return sortmode;
+	}
+	void RenderPass::setInstancing(bool instancing)
+	{
+		this->instancing = instancing;
+	}
+	bool RenderPass::getInstancing()
+	{
+		return instancing;
+	}
+
 	void RenderPass::beginFrame()
 	{
 	}
-	void RenderPass::insert(RenderBatch *batch)
+	void RenderPass::insert(RenderBatch *batch, float depth, uint64_t sequence)
 	{
-		batches.push_back(batch);
+		batch->sortkey = computeSortKey(batch, depth, sortmode);
+		SortEntry entry;
+		entry.key = batch->sortkey;
+		entry.sequence = sequence;
+		entry.batch = batch;
+		threadbatches.local().push_back(entry);
 	}
-	void RenderPass::prepare(RenderPassInfo *info)
+	void RenderPass::prepare(RenderPassInfo *info,
+	                         core::MemoryPool *memory,
+	                         unsigned int frame)
 	{
-		// Optimize batches
-		// TODO
+		// Merge and optimize batches
+		sortBatches();
+		if (instancing)
+			mergeInstances(memory);
 		// Set clear info
 		info->clear.clearcolor = clearcolor;
 		info->clear.cleardepth = cleardepth;
@@ -96,18 +258,133 @@ namespace render
 			// Fill in color buffer info
 			unsigned int colorbuffercount = target->getColorBufferCount();
 			info->target.colorbuffercount = colorbuffercount;
-			info->target.colorbuffers = new unsigned int[colorbuffercount];
+			unsigned int memsize = sizeof(unsigned int) * colorbuffercount;
+			info->target.colorbuffers = (unsigned int*)memory->allocate(memsize);
+			memsize = sizeof(MipmapPolicy::List) * colorbuffercount;
+			info->target.mipmaps = (MipmapPolicy::List*)memory->allocate(memsize);
 			for (unsigned int i = 0; i < colorbuffercount; i++)
 			{
 				info->target.colorbuffers[i] = target->getColorBuffer(i)->getHandle();
+				info->target.mipmaps[i] = target->getFrameMipmapPolicy(i, frame);
 			}
 		}
-		// Copy batches for the rendering thread
-		info->batches = new RenderBatch*[batches.size()];
-		memcpy(info->batches, &batches[0], sizeof(RenderBatch*) * batches.size());
-		info->batchcount = batches.size();
+		// Encode the batches for the rendering thread
+		CommandWriter writer(memory);
+		for (unsigned int i = 0; i < batches.size(); i++)
+			writer.write(batches[i]);
+		writer.finish(info);
 		// Clean up
 		batches.clear();
 	}
+
+	void RenderPass::mergeInstances(core::MemoryPool *memory)
+	{
+		// Batches with the same state are next to each other after sorting,
+		// so only runs of consecutive batches are merged
+		unsigned int count = 0;
+		unsigned int first = 0;
+		while (first < batches.size())
+		{
+			unsigned int end = first + 1;
+			while (end < batches.size()
+			    && canMergeInstances(batches[first], batches[end]))
+				end++;
+			if (end - first == 1)
+			{
+				batches[count++] = batches[first];
+				first = end;
+				continue;
+			}
+			// Create a new batch with the values of all instances
+			RenderBatch *merged = (RenderBatch*)memory->allocate(sizeof(RenderBatch));
+			*merged = *batches[first];
+			merged->instancecount = end - first;
+			unsigned int size = ShaderVariableType::getSize(merged->instancetype);
+			unsigned int memsize = size * sizeof(float) * merged->instancecount;
+			merged->instancedata = (float*)memory->allocate(memsize);
+			for (unsigned int i = first; i < end; i++)
+			{
+				memcpy(merged->instancedata + (i - first) * size,
+				       batches[i]->instancedata,
+				       size * sizeof(float));
+			}
+			batches[count++] = merged;
+			first = end;
+		}
+		batches.resize(count);
+	}
+
+	void RenderPass::sortBatches()
+	{
+		// Merge the batch lists of all threads
+		unsigned int count = 0;
+		tbb::enumerable_thread_specific<SortEntryList>::iterator it;
+		for (it = threadbatches.begin(); it != threadbatches.end(); it++)
+			count += it->size();
+		batches.resize(count);
+		if (count == 0)
+			return;
+		// The buffers are kept between frames to prevent reallocation
+		sortentries.resize(count);
+		sorttemp.resize(count);
+		unsigned int index = 0;
+		for (it = threadbatches.begin(); it != threadbatches.end(); it++)
+		{
+			if (it->size() == 0)
+				continue;
+			memcpy(&sortentries[index], &(*it)[0], it->size() * sizeof(SortEntry));
+			index += it->size();
+			it->clear();
+		}
+		// Build histograms for all digits in a single pass, the first 8
+		// digits are the sequence number, the last 8 the sort key
+		unsigned int histogram[16][256];
+		memset(histogram, 0, sizeof(histogram));
+		bool ordered = true;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			uint64_t sequence = sortentries[i].sequence;
+			uint64_t key = sortentries[i].key;
+			if (i > 0 && sequence < sortentries[i - 1].sequence)
+				ordered = false;
+			for (unsigned int digit = 0; digit < 8; digit++)
+			{
+				histogram[digit][(sequence >> (digit * 8)) & 0xFF]++;
+				histogram[digit + 8][(key >> (digit * 8)) & 0xFF]++;
+			}
+		}
+		// LSD radix sort by (key, sequence), the result thus does not
+		// depend on the thread which submitted a batch
+		SortEntry *src = &sortentries[0];
+		SortEntry *dst = &sorttemp[0];
+		unsigned int firstdigit = ordered ? 8 : 0;
+		unsigned int lastdigit = sortmode == BatchSortMode::SubmissionOrder ? 8 : 16;
+		for (unsigned int digit = firstdigit; digit < lastdigit; digit++)
+		{
+			unsigned int shift = (digit % 8) * 8;
+			bool iskey = digit >= 8;
+			uint64_t first = iskey ? src[0].key : src[0].sequence;
+			// Skip digits which are equal for all entries
+			if (histogram[digit][(first >> shift) & 0xFF] == count)
+				continue;
+			unsigned int offsets[256];
+			unsigned int offset = 0;
+			for (unsigned int i = 0; i < 256; i++)
+			{
+				offsets[i] = offset;
+				offset += histogram[digit][i];
+			}
+			for (unsigned int i = 0; i < count; i++)
+			{
+				uint64_t value = iskey ? src[i].key : src[i].sequence;
+				dst[offsets[(value >> shift) & 0xFF]++] = src[i];
+			}
+			SortEntry *tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+		for (unsigned int i = 0; i < count; i++)
+			batches[i] = src[i].batch;
+	}
 }
 }
@@ -33,12 +33,26 @@ namespace render
 	                               const std::string &name)
 		: Resource(rmgr, name), renderer(renderer), uploading(false), waiting(0)
 	{
+		// Not used by any frame yet
+		usedframe = renderer->getBuildFrame() - 1;
+		revision = 0;
+		created = false;
 		renderer->registerNew(this);
 	}
 	RenderResource::~RenderResource()
 	{
 	}
 
+	void RenderResource::markUsed()
+	{
+		unsigned int frame = renderer->getBuildFrame();
+		if (usedframe.fetch_and_store(frame) == frame)
+			return;
+		// A pending upload is now needed by a queued frame
+		if (uploading)
+			renderer->prioritizeUpload(this);
+	}
+
 	bool RenderResource::create()
 	{
 		return true;
@@ -52,9 +66,22 @@ namespace render
 		uploadFinished();
 		return true;
 	}
+	unsigned int RenderResource::getUploadSize()
+	{
+		return getMemorySize();
+	}
+	unsigned int RenderResource::getMemorySize()
+	{
+		return 0;
+	}
+	bool RenderResource::isSharedBetweenContexts()
+	{
+		return true;
+	}
 
 	void RenderResource::registerUpload()
 	{
+		revision++;
 		{
 			tbb::spin_mutex::scoped_lock lock(uploadmutex);
 			// Do not submit this several times
@@ -71,6 +98,7 @@ namespace render
 			tbb::spin_mutex::scoped_lock lock(uploadmutex);
 			uploading = false;
 			wait = waiting;
+			waiting = 0;
 		}
 		if (wait)
 		{
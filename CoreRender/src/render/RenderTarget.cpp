@@ -52,15 +52,21 @@ namespace render
 		return depthbuffer;
 	}
 
-	void RenderTarget::addColorBuffer(Texture2D::Ptr texture)
+	void RenderTarget::addColorBuffer(Texture2D::Ptr texture,
+	                                  MipmapPolicy::List mipmaps,
+	                                  unsigned int interval)
 	{
-		colorbuffers.push_back(texture);
+		ColorBuffer colorbuffer;
+		colorbuffer.texture = texture;
+		colorbuffer.mipmaps = mipmaps;
+		colorbuffer.interval = interval > 0 ? interval : 1;
+		colorbuffers.push_back(colorbuffer);
 	}
 	Texture2D::Ptr RenderTarget::getColorBuffer(unsigned int index)
 	{
 		if (index >= colorbuffers.size())
 			return 0;
-		return colorbuffers[index];
+		return colorbuffers[index].texture;
 	}
 	void RenderTarget::removeColorBuffer(unsigned int index)
 	{
@@ -72,5 +78,36 @@ namespace render
 	{
 		return colorbuffers.size();
 	}
+
+	void RenderTarget::setMipmapPolicy(unsigned int index,
+	                                   MipmapPolicy::List mipmaps,
+	                                   unsigned int interval)
+	{
+		if (index >= colorbuffers.size())
+			return;
+		colorbuffers[index].mipmaps = mipmaps;
+		colorbuffers[index].interval = interval > 0 ? interval : 1;
+	}
+	MipmapPolicy::List RenderTarget::getMipmapPolicy(unsigned int index)
+	{
+		if (index >= colorbuffers.size())
+			return MipmapPolicy::Disabled;
+		return colorbuffers[index].mipmaps;
+	}
+	unsigned int RenderTarget::getMipmapInterval(unsigned int index)
+	{
+		if (index >= colorbuffers.size())
+			return 1;
+		return colorbuffers[index].interval;
+	}
+	MipmapPolicy::List RenderTarget::getFrameMipmapPolicy(unsigned int index,
+	                                                      unsigned int frame)
+	{
+		MipmapPolicy::List mipmaps = getMipmapPolicy(index);
+		if (mipmaps == MipmapPolicy::Interval
+		 && frame % colorbuffers[index].interval != 0)
+			return MipmapPolicy::Disabled;
+		return mipmaps;
+	}
 }
 }
@@ -66,8 +66,10 @@ namespace render
 	{
 		// Register thread in the renderer
 		renderer->enterThread();
-		// We do not want the first access to waitForFrame() to deadlock
-		frameend.post();
+		// frameend counts the free frame slots, so the main thread can queue
+		// this many frames before it has to wait
+		for (unsigned int i = 0; i < renderer->getFramesInFlight(); i++)
+			frameend.post();
 		// Render loop
 		core::Time time = core::Time::Now();
 		while (true)
@@ -85,6 +87,7 @@ namespace render
 			renderer->render();
 			time = core::Time::Now();
 			renderer->getDriver()->getStats().setFrameEnd(time);
+			renderer->storeStats();
 			// Notify other thread that the frame has ended
 			frameend.post();
 		}
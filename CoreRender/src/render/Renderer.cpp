@@ -20,10 +20,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "CoreRender/render/Renderer.hpp"
+#include "CoreRender/render/UploadThread.hpp"
 #include "CoreRender/core/MemoryPool.hpp"
 #include "VideoDriver.hpp"
 #include "CoreRender/core/Time.hpp"
 #include "FrameData.hpp"
+#include "CommandStream.hpp"
+
+#include <cstring>
 
 namespace cr
 {
@@ -33,26 +37,47 @@ namespace render
 	                   RenderContext::Ptr secondary,
 	                   core::Log::Ptr log,
 	                   VideoDriver *driver,
-	                   GraphicsEngine *input)
-		: primary(primary), secondary(secondary), log(log), driver(driver),
-		input(input)
+	                   GraphicsEngine *input,
+	                   unsigned int framesinflight)
+		: primary(primary), secondary(secondary), log(log),
+		framesinflight(framesinflight), driver(driver), uploadbytebudget(0),
+		uploadtimebudget(core::Duration::Nanoseconds(0)), uploadthread(0),
+		currentupload(0), uploaddrains(0), uploadwaiting(false),
+		uploadsequence(0), priorityuploadcount(0), asyncuploadbytes(0),
+		checkedgeneration(0), input(input)
 	{
 		// Make context active for this thread
 		if (secondary)
 			secondary->makeCurrent();
 		else
 			primary->makeCurrent();
-		// Create memory pools
-		memory[0] = new core::MemoryPool();
-		memory[1] = new core::MemoryPool();
+		// Create memory pools, one for every queued frame and one for the
+		// frame which is currently being built
+		memory.resize(framesinflight + 1);
+		for (unsigned int i = 0; i < memory.size(); i++)
+			memory[i] = new core::MemoryPool();
+		FrameInfo emptyframe = { 0, 0 };
+		frames.resize(memory.size(), emptyframe);
+		buildframe = 0;
+		renderedframes = 0;
+		creategeneration = 0;
+		deletionbudget = 0;
+		completedframes = 0;
 	}
 	Renderer::~Renderer()
 	{
 		// Delete remaining render resources
 		// TODO: Do we have to upload objects here? They will not be used.
 		uploadNewObjects();
-		uploadObjects();
-		deleteObjects();
+		uploadObjects(true);
+		deleteObjects(true);
+		for (unsigned int i = 0; i < framefences.size(); i++)
+			driver->deleteFence(framefences[i].fence);
+		if (replayedcapture)
+			replayedcapture->releaseDriverData(driver);
+		// Delete memory pools
+		for (unsigned int i = 0; i < memory.size(); i++)
+			delete memory[i];
 		// Release context
 		if (secondary)
 			secondary->makeCurrent(false);
@@ -62,23 +87,45 @@ namespace render
 
 	void Renderer::registerNew(RenderResource::Ptr res)
 	{
-		tbb::spin_mutex::scoped_lock lock(newmutex);
 		newqueue.push(res);
 	}
 	void Renderer::registerShaderUpload(Shader::Ptr shader)
 	{
-		tbb::spin_mutex::scoped_lock lock(shaderuploadmutex);
 		shaderuploadqueue.push(shader);
 	}
 	void Renderer::registerUpload(RenderResource::Ptr res)
 	{
-		tbb::spin_mutex::scoped_lock lock(uploadmutex);
-		uploadqueue.push(res);
+		UploadEntry entry;
+		entry.resource = res;
+		entry.time = core::Time::Now();
+		entry.size = res->getUploadSize();
+		entry.sequence = 0;
+		entry.prioritized = false;
+		if (!res->isSharedBetweenContexts())
+		{
+			renderuploadqueue.push(entry);
+			return;
+		}
+		uploadqueue.push(entry);
+		if (uploadthread)
+			uploadthread->signalUpload();
+	}
+	void Renderer::prioritizeUpload(RenderResource::Ptr res)
+	{
+		// Without upload thread, the render thread checks the used
+		// resources itself
+		if (uploadthread)
+		{
+			prioritizequeue.push(res);
+			uploadthread->signalUpload();
+		}
 	}
 	void Renderer::registerDelete(RenderResource *res)
 	{
-		tbb::spin_mutex::scoped_lock lock(deletemutex);
-		deletequeue.push(res);
+		// The resource might still be used by any frame up to the one which
+		// is currently being built
+		DeleteEntry entry = { res, buildframe + 1, res->getMemorySize() };
+		deletequeue.push(entry);
 	}
 
 	void Renderer::enterThread()
@@ -95,73 +142,376 @@ namespace render
 	void Renderer::uploadNewObjects()
 	{
 		// Upload new objects
-		while (true)
+		if (newqueue.drain(newobjects) > 0)
 		{
-			RenderResource::Ptr next;
+			for (unsigned int i = 0; i < newobjects.size(); i++)
 			{
-				tbb::spin_mutex::scoped_lock lock(newmutex);
-				if (newqueue.size() == 0)
-					break;
-				next = newqueue.front();
-				newqueue.pop();
+				newobjects[i]->create();
+				newobjects[i]->created = true;
 			}
-			next->create();
+			newobjects.clear();
+			creategeneration++;
+			// The upload thread skipped the uploads of these resources so far
+			if (uploadthread)
+				uploadthread->signalUpload();
 		}
 		// Upload shaders
-		while (true)
+		shaderuploadqueue.drain(newshaders);
+		for (unsigned int i = 0; i < newshaders.size(); i++)
+		{
+			newshaders[i]->uploadShader();
+			newshaders[i]->invalidatePipelineStates();
+		}
+		newshaders.clear();
+	}
+	void Renderer::prepareRendering(PipelineInfo *renderdata,
+	                                unsigned int pipelinecount)
+	{
+		// Store rendering data in the slot belonging to the frame memory
+		FrameInfo &frame = frames[buildframe % frames.size()];
+		frame.renderdata = renderdata;
+		frame.pipelinecount = pipelinecount;
+		// Continue with the next memory pool
+		buildframe++;
+	}
+	void Renderer::uploadObjects(bool all)
+	{
+		RenderStats &stats = driver->getStats();
+		// Container objects like framebuffers only exist in the context of
+		// the render thread, they are always uploaded here
+		renderuploadqueue.drain(renderuploads);
+		for (unsigned int i = 0; i < renderuploads.size(); i++)
+		{
+			UploadEntry &entry = renderuploads[i];
+			unsigned int size = entry.resource->getUploadSize();
+			entry.resource->upload();
+			stats.addUpload(size, core::Time::Now() - entry.time);
+		}
+		renderuploads.clear();
+		if (uploadthread && !all)
 		{
-			Shader::Ptr next;
+			waitForUploadThread();
+			return;
+		}
+		// Uploads which were finished before the upload thread was stopped
+		collectUploadFences();
+		core::Time start = core::Time::Now();
+		unsigned int bytebudget;
+		core::Duration timebudget;
+		{
+			tbb::spin_mutex::scoped_lock lock(uploadmutex);
+			// Uploads left over by a stopped upload thread come first
+			sortAsyncUploads();
+			UploadEntry entry;
+			while (takeAsyncUpload(entry))
+				deferreduploads.push_back(entry);
+			for (unsigned int i = 0; i < uncreateduploads.size(); i++)
 			{
-				tbb::spin_mutex::scoped_lock lock(shaderuploadmutex);
-				if (shaderuploadqueue.size() == 0)
+				AsyncUploadMap::iterator it;
+				it = asyncuploads.find(uncreateduploads[i].resource);
+				if (it != asyncuploads.end())
+					deferreduploads.push_back(it->second);
+			}
+			uncreateduploads.clear();
+			asyncuploads.clear();
+			priorityuploadcount = 0;
+			asyncuploadbytes = 0;
+			// New uploads are queued behind the deferred ones
+			uploadqueue.drain(deferreduploads);
+			bytebudget = uploadbytebudget;
+			timebudget = uploadtimebudget;
+		}
+		// Upload everything the frame needs regardless of the budget
+		unsigned int uploadedbytes = 0;
+		unsigned int remaining = 0;
+		for (unsigned int i = 0; i < deferreduploads.size(); i++)
+		{
+			UploadEntry &entry = deferreduploads[i];
+			RenderResource *resource = entry.resource.get();
+			unsigned int size = resource->getUploadSize();
+			// Resources without data (e.g. framebuffers) are not limited
+			if (all || size == 0 || isUsedByQueuedFrame(resource))
+			{
+				resource->upload();
+				stats.addUpload(size, core::Time::Now() - entry.time);
+				uploadedbytes += size;
+			}
+			else
+			{
+				if (remaining != i)
+					deferreduploads[remaining] = entry;
+				remaining++;
+			}
+		}
+		deferreduploads.resize(remaining);
+		// Spend the rest of the budget on the oldest other uploads
+		unsigned int uploaded = 0;
+		for (; uploaded < deferreduploads.size(); uploaded++)
+		{
+			UploadEntry &entry = deferreduploads[uploaded];
+			unsigned int size = entry.resource->getUploadSize();
+			if (uploaded > 0)
+			{
+				if (bytebudget != 0 && uploadedbytes + size > bytebudget)
+					break;
+				core::Duration elapsed = core::Time::Now() - start;
+				if (timebudget.getNanoseconds() != 0 && elapsed >= timebudget)
 					break;
-				next = shaderuploadqueue.front();
-				shaderuploadqueue.pop();
 			}
-			next->uploadShader();
+			entry.resource->upload();
+			stats.addUpload(size, core::Time::Now() - entry.time);
+			uploadedbytes += size;
 		}
+		deferreduploads.erase(deferreduploads.begin(),
+		                      deferreduploads.begin() + uploaded);
+		unsigned int queuedbytes = 0;
+		for (unsigned int i = 0; i < deferreduploads.size(); i++)
+			queuedbytes += deferreduploads[i].resource->getUploadSize();
+		stats.setQueuedUploads(deferreduploads.size(), queuedbytes);
 	}
-	void Renderer::prepareRendering(PipelineInfo *renderdata,
-	                                unsigned int pipelinecount)
+	void Renderer::setUploadBudget(unsigned int bytes, core::Duration time)
 	{
-		// Store rendering data
-		this->renderdata = renderdata;
-		this->pipelinecount = pipelinecount;
-		// Swap memory pools
-		core::MemoryPool *pool = memory[1];
-		memory[1] = memory[0];
-		memory[0] = pool;
+		tbb::spin_mutex::scoped_lock lock(uploadmutex);
+		uploadbytebudget = bytes;
+		uploadtimebudget = time;
+	}
+	void Renderer::setUploadThread(UploadThread *thread)
+	{
+		uploadthread = thread;
 	}
-	void Renderer::uploadObjects()
+	bool Renderer::uploadNextObject()
 	{
+		UploadEntry entry;
+		{
+			tbb::spin_mutex::scoped_lock lock(uploadmutex);
+			sortAsyncUploads();
+			uploaddrains++;
+			// The render thread might already be waiting for the resources
+			// of the next frame, those are taken first
+			if (!takeAsyncUpload(entry))
+			{
+				// The render thread might wait for the queue to be drained
+				if (uploadwaiting)
+				{
+					uploadwaiting = false;
+					uploaddone.post();
+				}
+				return false;
+			}
+			currentupload = entry.resource.get();
+		}
+		UploadFence fence;
+		fence.size = entry.resource->getUploadSize();
+		entry.resource->upload();
+		fence.fence = driver->createFence();
+		fence.latency = core::Time::Now() - entry.time;
+		{
+			tbb::spin_mutex::scoped_lock lock(uploadmutex);
+			uploadfences.push_back(fence);
+			currentupload = 0;
+			if (uploadwaiting)
+			{
+				uploadwaiting = false;
+				uploaddone.post();
+			}
+		}
+		return true;
+	}
+	void Renderer::waitForUploadThread()
+	{
+		// Wait until the upload thread has uploaded everything the frame
+		// needs
+		bool firstcheck = true;
+		unsigned int drains = 0;
 		while (true)
 		{
-			RenderResource::Ptr next;
 			{
 				tbb::spin_mutex::scoped_lock lock(uploadmutex);
-				if (uploadqueue.size() == 0)
+				if (firstcheck)
+				{
+					drains = uploaddrains;
+					firstcheck = false;
+				}
+				// Uploads which were queued before the frame but have not
+				// been drained by the upload thread yet might be needed as
+				// well, later ones do not matter
+				bool pending = drains == uploaddrains && !uploadqueue.empty();
+				if (!prioritizequeue.empty() || priorityuploadcount != 0)
+					pending = true;
+				if (currentupload && isUsedByQueuedFrame(currentupload))
+					pending = true;
+				// Resources created since the upload thread last checked might
+				// be used as well
+				if (!uncreateduploads.empty()
+				 && checkedgeneration != creategeneration)
+					pending = true;
+				if (!pending)
+				{
+					driver->getStats().setQueuedUploads(asyncuploads.size(),
+					                                    asyncuploadbytes);
 					break;
-				next = uploadqueue.front();
-				uploadqueue.pop();
+				}
+				uploadwaiting = true;
 			}
-			next->upload();
+			uploaddone.wait();
 		}
+		collectUploadFences();
 	}
-	void Renderer::deleteObjects()
+	void Renderer::sortAsyncUploads()
 	{
-		while (true)
+		uploadqueue.drain(drainedasyncuploads);
+		for (unsigned int i = 0; i < drainedasyncuploads.size(); i++)
 		{
-			RenderResource *next;
+			UploadEntry &entry = drainedasyncuploads[i];
+			RenderResource *resource = entry.resource.get();
+			// Replace an older registration of the same resource
+			AsyncUploadMap::iterator previous = asyncuploads.find(resource);
+			if (previous != asyncuploads.end())
 			{
-				tbb::spin_mutex::scoped_lock lock(deletemutex);
-				if (deletequeue.size() == 0)
+				if (previous->second.prioritized)
+					priorityuploadcount--;
+				asyncuploadbytes -= previous->second.size;
+			}
+			entry.sequence = ++uploadsequence;
+			AsyncUploadRef ref = { resource, entry.sequence };
+			if (!resource->created)
+				uncreateduploads.push_back(ref);
+			else if (isUsedByQueuedFrame(resource))
+			{
+				entry.prioritized = true;
+				priorityuploadcount++;
+				priorityuploads.push_back(ref);
+			}
+			else
+				olduploads.push_back(ref);
+			asyncuploadbytes += entry.size;
+			asyncuploads[resource] = entry;
+		}
+		drainedasyncuploads.clear();
+		// Sort the resources which have been created in the meantime
+		unsigned int generation = creategeneration;
+		if (generation != checkedgeneration)
+		{
+			checkedgeneration = generation;
+			unsigned int remaining = 0;
+			for (unsigned int i = 0; i < uncreateduploads.size(); i++)
+			{
+				AsyncUploadRef &ref = uncreateduploads[i];
+				AsyncUploadMap::iterator it = asyncuploads.find(ref.resource);
+				if (it == asyncuploads.end() || it->second.sequence != ref.sequence)
+					continue;
+				if (!ref.resource->created)
+				{
+					uncreateduploads[remaining++] = ref;
+					continue;
+				}
+				if (isUsedByQueuedFrame(ref.resource))
+				{
+					it->second.prioritized = true;
+					priorityuploadcount++;
+					priorityuploads.push_back(ref);
+				}
+				else
+					olduploads.push_back(ref);
+			}
+			uncreateduploads.resize(remaining);
+		}
+		// Move the uploads used by queued frames to the front
+		prioritizequeue.drain(prioritized);
+		for (unsigned int i = 0; i < prioritized.size(); i++)
+		{
+			RenderResource *resource = prioritized[i].get();
+			AsyncUploadMap::iterator it = asyncuploads.find(resource);
+			if (it == asyncuploads.end() || it->second.prioritized
+			 || !resource->created)
+				continue;
+			it->second.prioritized = true;
+			priorityuploadcount++;
+			AsyncUploadRef ref = { resource, it->second.sequence };
+			priorityuploads.push_back(ref);
+		}
+		prioritized.clear();
+	}
+	bool Renderer::takeAsyncUpload(UploadEntry &entry)
+	{
+		// Uploads which have been prioritized later are still in olduploads,
+		// these entries are stale once the upload has been taken
+		while (!priorityuploads.empty() || !olduploads.empty())
+		{
+			std::deque<AsyncUploadRef> &list = priorityuploads.empty()
+			                                 ? olduploads : priorityuploads;
+			AsyncUploadRef ref = list.front();
+			list.pop_front();
+			AsyncUploadMap::iterator it = asyncuploads.find(ref.resource);
+			if (it == asyncuploads.end() || it->second.sequence != ref.sequence)
+				continue;
+			entry = it->second;
+			if (entry.prioritized)
+				priorityuploadcount--;
+			asyncuploadbytes -= entry.size;
+			asyncuploads.erase(it);
+			return true;
+		}
+		return false;
+	}
+	void Renderer::collectUploadFences()
+	{
+		{
+			tbb::spin_mutex::scoped_lock lock(uploadmutex);
+			renderfences.swap(uploadfences);
+		}
+		RenderStats &stats = driver->getStats();
+		for (unsigned int i = 0; i < renderfences.size(); i++)
+		{
+			// Commands of this context must not use the resource before the
+			// upload has finished
+			driver->waitForFence(renderfences[i].fence);
+			stats.addUpload(renderfences[i].size, renderfences[i].latency);
+		}
+		renderfences.clear();
+	}
+	void Renderer::deleteObjects(bool all)
+	{
+		// Check which frames the GPU has finished
+		if (driver->getCaps().getFlag(RenderCaps::Flag::Fences))
+		{
+			unsigned int passed = 0;
+			for (; passed < framefences.size(); passed++)
+			{
+				FrameFence &fence = framefences[passed];
+				if (!driver->isFenceSignaled(fence.fence))
 					break;
-				next = deletequeue.front();
-				deletequeue.pop();
+				driver->deleteFence(fence.fence);
+				completedframes = fence.frames;
 			}
-			next->destroy();
-			delete next;
+			framefences.erase(framefences.begin(),
+			                  framefences.begin() + passed);
 		}
+		else
+			completedframes = renderedframes;
+		deletequeue.drain(pendingdeletes);
+		// Entries are sorted by frame, so we can stop at the first resource
+		// which still might be in use
+		unsigned int budget = deletionbudget;
+		unsigned int deleted = 0;
+		for (; deleted < pendingdeletes.size(); deleted++)
+		{
+			DeleteEntry &entry = pendingdeletes[deleted];
+			if (!all && entry.frame > completedframes)
+				break;
+			if (!all && budget != 0 && deleted == budget)
+				break;
+			entry.resource->destroy();
+			delete entry.resource;
+		}
+		pendingdeletes.erase(pendingdeletes.begin(),
+		                     pendingdeletes.begin() + deleted);
+		unsigned int pendingbytes = 0;
+		for (unsigned int i = 0; i < pendingdeletes.size(); i++)
+			pendingbytes += pendingdeletes[i].size;
+		RenderStats &stats = driver->getStats();
+		stats.increaseDeletionCount(deleted);
+		stats.setPendingDeletions(pendingdeletes.size(), pendingbytes);
 	}
 
 	void Renderer::render()
@@ -172,20 +522,116 @@ namespace render
 		// Upload changed objects
 		uploadObjects();
 		// Render passes
-		for (unsigned int i = 0; i < pipelinecount; i++)
+		FrameInfo &frame = frames[renderedframes % frames.size()];
+		for (unsigned int i = 0; i < frame.pipelinecount; i++)
+		{
+			renderPipeline(&frame.renderdata[i]);
+		}
+		// Write the frame data to a file if requested
+		core::File::Ptr file;
 		{
-			renderPipeline(&renderdata[i]);
+			tbb::spin_mutex::scoped_lock lock(capturemutex);
+			file = capturefile;
+			capturefile = 0;
+		}
+		if (file)
+		{
+			if (!FrameCapture::save(file, frame.renderdata, frame.pipelinecount,
+			                        primary->getWidth(), primary->getHeight()))
+				log->error("Could not write frame capture \"%s\".",
+				           file->getPath().c_str());
+			else
+				log->info("Frame captured to \"%s\".", file->getPath().c_str());
 		}
 		// Reset memory pool
-		getCurrentFrameMemory()->reset();
+		core::MemoryPool *framememory = getCurrentFrameMemory();
+		framememory->reset();
+		{
+			const core::MemoryPool::Statistics &poolstats = framememory->getStatistics();
+			unsigned int peak = 0;
+			unsigned int pages = 0;
+			for (unsigned int i = 0; i < memory.size(); i++)
+			{
+				const core::MemoryPool::Statistics &other = memory[i]->getStatistics();
+				if (other.peakbytes > peak)
+					peak = other.peakbytes;
+				pages += other.mappedpages;
+			}
+			driver->getStats().setFrameMemory(poolstats.usedbytes, peak, pages,
+			                                  poolstats.mapcalls);
+		}
 		// Signal end of frame
 		driver->endFrame();
 		// Swap buffers
 		primary->swapBuffers();
+		// Resources used by the frame can be deleted once the GPU has passed
+		// this fence
+		if (driver->getCaps().getFlag(RenderCaps::Flag::Fences))
+		{
+			FrameFence fence = { driver->createFence(), renderedframes + 1 };
+			framefences.push_back(fence);
+		}
+		// The frame memory may now be reused by the main thread
+		renderedframes++;
 		// Delete unused objects
 		deleteObjects();
 	}
 
+	void Renderer::storeStats()
+	{
+		tbb::spin_mutex::scoped_lock lock(statsmutex);
+		stats = driver->getStats();
+		driver->getStats().reset();
+	}
+	RenderStats Renderer::getStats()
+	{
+		tbb::spin_mutex::scoped_lock lock(statsmutex);
+		return stats;
+	}
+
+	void Renderer::captureFrame(core::File::Ptr file)
+	{
+		tbb::spin_mutex::scoped_lock lock(capturemutex);
+		capturefile = file;
+	}
+	void Renderer::replayFrame(FrameCapture::Ptr capture,
+	                           std::vector<core::Duration> *passtimes)
+	{
+		// The driver data of the pipeline states is kept for further
+		// replays of the same capture
+		if (replayedcapture != capture)
+		{
+			if (replayedcapture)
+				replayedcapture->releaseDriverData(driver);
+			replayedcapture = capture;
+		}
+		core::MemoryPool *memory = getCurrentFrameMemory();
+		for (unsigned int i = 0; i < capture->getPassCount(); i++)
+		{
+			const FrameCaptureFile::Pass &pass = capture->getPass(i);
+			// Render targets are not captured, all passes are drawn into the
+			// render window
+			RenderPassInfo info;
+			memset(&info, 0, sizeof(info));
+			info.clear.clearcolor = pass.clearcolor != 0;
+			info.clear.cleardepth = pass.cleardepth != 0;
+			info.clear.color = pass.color;
+			info.clear.depth = pass.depth;
+			info.commands = capture->getCommands(i);
+			info.commandsize = pass.commandsize;
+			unsigned int memsize = sizeof(UniformMapping) * pass.uniformcount;
+			info.uniforms = (UniformMapping*)memory->allocate(memsize);
+			info.batchcount = pass.batchcount;
+			core::Time start = core::Time::Now();
+			renderPass(&info);
+			if (passtimes)
+				passtimes->push_back(core::Time::Now() - start);
+		}
+		memory->reset();
+		driver->endFrame();
+		primary->swapBuffers();
+	}
+
 	void Renderer::renderPipeline(PipelineInfo *info)
 	{
 		for (unsigned int i = 0; i < info->passcount; i++)
@@ -208,9 +654,86 @@ namespace render
 		              core::Color(info->clear.color),
 		              info->clear.depth);
 		// Draw batches
-		for (unsigned int i = 0; i < info->batchcount; i++)
+		driver->getStats().increaseCommandBytes(info->commandsize);
+		executeCommands(info);
+	}
+	void Renderer::executeCommands(RenderPassInfo *info)
+	{
+		// The batch holds the current state, the commands only contain the
+		// changes from one batch to the next
+		RenderBatch batch;
+		memset(&batch, 0, sizeof(batch));
+		batch.uniforms = info->uniforms;
+		char *command = info->commands;
+		while (true)
 		{
-			driver->draw(info->batches[i]);
+			CommandHeader *header = (CommandHeader*)command;
+			void *data = header + 1;
+			switch (header->type)
+			{
+				case RenderCommand::PipelineState:
+					batch.state = ((PipelineStateCommand*)data)->state;
+					break;
+				case RenderCommand::Buffers:
+				{
+					BufferCommand *buffers = (BufferCommand*)data;
+					batch.vertices = buffers->vertices;
+					batch.indices = buffers->indices;
+					batch.indextype = buffers->indextype;
+					batch.basevertex = buffers->basevertex;
+					batch.vertexoffset = buffers->vertexoffset;
+					break;
+				}
+				case RenderCommand::State:
+					batch.renderflags = ((StateCommand*)data)->renderflags;
+					break;
+				case RenderCommand::Textures:
+					batch.texcount = ((ArrayCommand*)data)->count;
+					batch.textures = (TextureEntry*)((ArrayCommand*)data + 1);
+					break;
+				case RenderCommand::Uniforms:
+				{
+					UniformsCommand *uniforms = (UniformsCommand*)data;
+					batch.uniformcount = uniforms->count;
+					char *entrydata = (char*)(uniforms + 1);
+					for (unsigned int i = 0; i < uniforms->changed; i++)
+					{
+						UniformEntry *entry = (UniformEntry*)entrydata;
+						UniformMapping &uniform = info->uniforms[entry->index];
+						uniform.shaderhandle = entry->shaderhandle;
+						uniform.type = entry->type;
+						uniform.data = (float*)(entry + 1);
+						entrydata += sizeof(UniformEntry)
+						           + ShaderVariableType::getSize(entry->type) * sizeof(float);
+					}
+					break;
+				}
+				case RenderCommand::Draw:
+					batch.startindex = ((DrawCommand*)data)->startindex;
+					batch.endindex = ((DrawCommand*)data)->endindex;
+					batch.instancecount = 0;
+					driver->draw(&batch);
+					break;
+				case RenderCommand::DrawInstanced:
+				{
+					DrawInstancedCommand *draw = (DrawInstancedCommand*)data;
+					batch.startindex = draw->startindex;
+					batch.endindex = draw->endindex;
+					batch.instancecount = draw->instancecount;
+					batch.instanceattrib = draw->instanceattrib;
+					batch.instancetype = draw->instancetype;
+					batch.instanceuniform = draw->instanceuniform;
+					batch.instancedata = (float*)(draw + 1);
+					driver->drawInstanced(&batch);
+					break;
+				}
+				case RenderCommand::Jump:
+					memcpy(&command, data, sizeof(char*));
+					continue;
+				case RenderCommand::End:
+					return;
+			}
+			command += header->size;
 		}
 	}
 }
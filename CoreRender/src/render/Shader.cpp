@@ -21,6 +21,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CoreRender/render/Shader.hpp"
 #include "CoreRender/render/Renderer.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
+#include "VideoDriver.hpp"
+#include "FrameData.hpp"
 
 namespace cr
 {
@@ -29,11 +32,25 @@ namespace render
 	Shader::Shader(Renderer *renderer,
 	               res::ResourceManager *rmgr,
 	               const std::string &name)
-		: RenderResource(renderer, rmgr, name), handle(0), oldhandle(0), text(0)
+		: RenderResource(renderer, rmgr, name), handle(0), oldhandle(0), text(0),
+		instanceslot(-1), instanceattrib(-1)
 	{
+		version = 0;
 	}
 	Shader::~Shader()
 	{
+		// The shader is destroyed in the render thread after all frames
+		// using it have been rendered
+		for (unsigned int i = 0; i < pipelinestates.size(); i++)
+			retiredstates.push_back(pipelinestates[i].state);
+		for (unsigned int i = 0; i < retiredstates.size(); i++)
+		{
+			PipelineState *state = retiredstates[i];
+			if (state->driverdata)
+				getRenderer()->getDriver()->destroyPipelineState(state);
+			delete[] state->attribs;
+			delete state;
+		}
 	}
 
 	void Shader::setVertexShader(const std::string &vs)
@@ -59,36 +76,114 @@ namespace render
 
 	void Shader::addAttrib(const std::string &name)
 	{
-		attribs.insert(std::make_pair(name, -1));
+		attribs.add(ShaderSlots::get(name));
 	}
 	int Shader::getAttrib(const std::string &name)
 	{
-		HandleMap::iterator it = attribs.find(name);
-		if (it == attribs.end())
+		unsigned int slot;
+		if (!ShaderSlots::find(name, slot))
 			return -1;
-		return it->second;
+		return attribs.get(slot);
 	}
 	void Shader::addUniform(const std::string &name)
 	{
-		uniforms.insert(std::make_pair(name, -1));
+		uniforms.add(ShaderSlots::get(name));
 	}
 	int Shader::getUniform(const std::string &name)
 	{
-		HandleMap::iterator it = uniforms.find(name);
-		if (it == uniforms.end())
+		unsigned int slot;
+		if (!ShaderSlots::find(name, slot))
 			return -1;
-		return it->second;
+		return uniforms.get(slot);
 	}
 	void Shader::addTexture(const std::string &name)
 	{
-		textures.insert(std::make_pair(name, -1));
+		textures.add(ShaderSlots::get(name));
 	}
 	int Shader::getTexture(const std::string &name)
 	{
-		HandleMap::iterator it = textures.find(name);
-		if (it == textures.end())
+		unsigned int slot;
+		if (!ShaderSlots::find(name, slot))
 			return -1;
-		return it->second;
+		return textures.get(slot);
+	}
+
+	void Shader::setInstanceUniform(const std::string &name)
+	{
+		instanceslot = ShaderSlots::get(name);
+	}
+
+	PipelineState *Shader::getPipelineState(VertexLayout::Ptr layout)
+	{
+		// The version has to be read before the shader handles so that a
+		// state created during an upload is recreated on the next call
+		unsigned int currentversion = version;
+		{
+			tbb::spin_rw_mutex::scoped_lock lock(pipelinestatemutex, false);
+			for (unsigned int i = 0; i < pipelinestates.size(); i++)
+			{
+				if (pipelinestates[i].layout == layout
+				 && pipelinestates[i].version == currentversion)
+					return pipelinestates[i].state;
+			}
+		}
+		tbb::spin_rw_mutex::scoped_lock lock(pipelinestatemutex, true);
+		for (unsigned int i = 0; i < pipelinestates.size(); i++)
+		{
+			PipelineStateEntry &entry = pipelinestates[i];
+			if (entry.layout != layout)
+				continue;
+			if (entry.version == currentversion)
+				return entry.state;
+			// Replace the outdated state
+			retiredstates.push_back(entry.state);
+			entry.state = createPipelineState(layout.get());
+			entry.version = currentversion;
+			return entry.state;
+		}
+		PipelineStateEntry entry;
+		entry.layout = layout;
+		entry.version = currentversion;
+		entry.state = createPipelineState(layout.get());
+		pipelinestates.push_back(entry);
+		return entry.state;
+	}
+	PipelineState *Shader::createPipelineState(VertexLayout *layout)
+	{
+		PipelineState *state = new PipelineState;
+		state->shader = handle;
+		state->blendMode = blendMode;
+		state->attribcount = layout->getElementCount();
+		state->attribs = 0;
+		state->driverdata = 0;
+		if (state->attribcount > 0)
+			state->attribs = new AttribMapping[state->attribcount];
+		for (unsigned int i = 0; i < state->attribcount; i++)
+		{
+			VertexLayoutElement *element = layout->getElement(i);
+			AttribMapping &attrib = state->attribs[i];
+			attrib.shaderhandle = getAttrib(element->slot);
+			attrib.components = element->components;
+			attrib.stride = element->stride;
+			attrib.type = element->type;
+			// Vertex buffer slots are not supported yet, so the address does
+			// not depend on the vertex count
+			attrib.address = layout->getSlotOffset(0, element->vbslot)
+			               + element->offset;
+		}
+		return state;
+	}
+
+	void Shader::HandleTable::add(unsigned int slot)
+	{
+		for (unsigned int i = 0; i < slots.size(); i++)
+		{
+			if (slots[i] == slot)
+				return;
+		}
+		slots.push_back(slot);
+		if (handles.size() <= slot)
+			handles.resize(slot + 1, -1);
 	}
 
 	void Shader::updateShader()
@@ -60,20 +60,25 @@ namespace render
 		return true;
 	}
 
-	bool ShaderText::addContext(const std::string &name,
+	bool ShaderText::addContext(core::Name name,
 	                            const std::string &vs,
 	                            const std::string &fs,
 	                            const std::string &gs,
 	                            const std::string &ts,
-	                            const BlendMode::List &blendmode)
+	                            const BlendMode::List &blendmode,
+	                            const std::string &instanceuniform)
 	{	
 		Context context = {
-			vs, fs, gs, ts, blendmode
+			vs, fs, gs, ts, blendmode, instanceuniform
 		};
 		// Store context info
 		contexts[name] = context;
 		return true;
 	}
+	bool ShaderText::hasContext(core::Name name)
+	{
+		return contexts.find(name) != contexts.end();
+	}
 
 	void ShaderText::addFlag(const std::string &flag, bool defaultvalue)
 	{
@@ -87,6 +92,9 @@ namespace render
 		flags.push_back(flag);
 		if (defaultvalue)
 			flagdefaults |= (1 << index);
+		// Cached flag sets are not valid anymore
+		tbb::spin_rw_mutex::scoped_lock lock(shadermutex, true);
+		flagcache.clear();
 	}
 
 	void ShaderText::addAttrib(const std::string &name)
@@ -105,6 +113,21 @@ namespace render
 	}
 
 	unsigned int ShaderText::getFlags(const std::string &flagsset)
+	{
+		// Look whether the flag set already was parsed
+		{
+			tbb::spin_rw_mutex::scoped_lock lock(shadermutex, false);
+			std::map<std::string, unsigned int>::iterator it;
+			it = flagcache.find(flagsset);
+			if (it != flagcache.end())
+				return it->second;
+		}
+		unsigned int output = parseFlags(flagsset);
+		tbb::spin_rw_mutex::scoped_lock lock(shadermutex, true);
+		flagcache.insert(std::make_pair(flagsset, output));
+		return output;
+	}
+	unsigned int ShaderText::parseFlags(const std::string &flagsset)
 	{
 		std::istringstream stream(flagsset);
 		unsigned int output = flagdefaults;
@@ -157,20 +180,30 @@ namespace render
 		// TODO: Do we need this?
 	}
 
-	Shader::Ptr ShaderText::getShader(const std::string &context,
+	Shader::Ptr ShaderText::getShader(core::Name context,
 	                                  unsigned int flags)
 	{
-		// Get shader name
-		std::ostringstream shadername;
-		shadername << "__" << getName() << "_Shader" << context << "_" << flags;
 		// Look whether the shader already exists
+		tbb::spin_rw_mutex::scoped_lock lock(shadermutex, false);
 		for (unsigned int i = 0; i < shaders.size(); i++)
 		{
-			if (shaders[i]->getName() == shadername.str())
-				return shaders[i];
+			if (shaders[i].flags == flags && shaders[i].context == context)
+				return shaders[i].shader;
+		}
+		if (!lock.upgrade_to_writer())
+		{
+			// Another thread might have created the shader in the meantime
+			for (unsigned int i = 0; i < shaders.size(); i++)
+			{
+				if (shaders[i].flags == flags && shaders[i].context == context)
+					return shaders[i].shader;
+			}
 		}
+		// Get shader name
+		std::ostringstream shadername;
+		shadername << "__" << getName() << "_Shader" << context << "_" << flags;
 		// Get context info
-		std::map<std::string, Context>::iterator it;
+		ContextMap::iterator it;
 		it = contexts.find(context);
 		if (it == contexts.end())
 			return 0;
@@ -189,6 +222,9 @@ namespace render
 			else
 				flagtext += "0\n";
 		}
+		// Instanced shaders read the per-instance uniform from an attrib
+		if (ctx.instanceuniform != "")
+			flagtext += "#define INSTANCED 1\n";
 		// Check whether texts exists
 		if (texts.find(ctx.vs) == texts.end())
 		{
@@ -212,6 +248,8 @@ namespace render
 		}
 		// Set shader data
 		shader->setBlendMode(ctx.blendMode);
+		if (ctx.instanceuniform != "")
+			shader->setInstanceUniform(ctx.instanceuniform);
 		shader->setVertexShader(flagtext + texts[ctx.vs]);
 		shader->setFragmentShader(flagtext + texts[ctx.fs]);
 		if (ctx.gs != "")
@@ -237,7 +275,11 @@ namespace render
 		// Finish shader
 		shader->setShaderText(this);
 		shader->updateShader();
-		shaders.push_back(shader);
+		ShaderInfo info;
+		info.context = context;
+		info.flags = flags;
+		info.shader = shader;
+		shaders.push_back(info);
 		return shader;
 	}
 
@@ -266,8 +308,8 @@ namespace render
 		     node = root->IterateChildren("Text", node))
 		{
 			// TODO: Load texts directly from files
-			getManager()->getLog()->debug("%s: Text.",
-			                              getName().c_str());
+			CR_LOG_DEBUG(getManager()->getLog(), "%s: Text.",
+			             getName().c_str());
 			TiXmlElement *element = node->ToElement();
 			if (!element)
 				continue;
@@ -286,8 +328,8 @@ namespace render
 				                                getName().c_str());
 				continue;
 			}
-			getManager()->getLog()->debug("%s: Adding text %s.",
-			                                getName().c_str(), name);
+			CR_LOG_DEBUG(getManager()->getLog(), "%s: Adding text %s.",
+			             getName().c_str(), name);
 			addText(name, content, true);
 		}
 		// Load contexts
@@ -336,8 +378,14 @@ namespace render
 					blendMode = BlendMode::Additive;
 			}
 			
+			// Instanced contexts name the per-instance uniform
+			const char *instanceattrib = element->Attribute("instanced");
+			std::string instanceuniform = "";
+			if (instanceattrib)
+				instanceuniform = instanceattrib;
 			// Add context
-			addContext(name, vsname, fsname, gsname, tsname, blendMode);
+			addContext(name, vsname, fsname, gsname, tsname, blendMode,
+			           instanceuniform);
 		}
 		// Add attribs
 		for (TiXmlNode *node = root->FirstChild("Attrib");
@@ -219,5 +219,20 @@ namespace render
 		discardImageData();
 		return true;
 	}
+
+	unsigned int Texture2D::getUploadSize()
+	{
+		tbb::spin_mutex::scoped_lock lock(imagemutex);
+		// Textures without data still need the memory to be allocated
+		if (data)
+			return TextureFormat::getSize(format, width * height);
+		else
+			return TextureFormat::getSize(internalformat, width * height);
+	}
+	unsigned int Texture2D::getMemorySize()
+	{
+		tbb::spin_mutex::scoped_lock lock(imagemutex);
+		return TextureFormat::getSize(internalformat, width * height);
+	}
 }
 }
@@ -20,6 +20,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "CoreRender/render/UniformData.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
 
 #include <cstring>
 
@@ -28,20 +29,24 @@ namespace cr
 namespace render
 {
 	Uniform::Uniform(const std::string &name)
-		: name(name), type(ShaderVariableType::Invalid),
+		: slot(ShaderSlots::get(name)), type(ShaderVariableType::Invalid),
 		shaderhandle(-1)
 	{
 	}
+	Uniform::Uniform(unsigned int slot)
+		: slot(slot), type(ShaderVariableType::Invalid), shaderhandle(-1)
+	{
+	}
 	Uniform::Uniform(const std::string &name,
 	                 ShaderVariableType::List type,
 	                 float *data)
-		: name(name), type(type), shaderhandle(-1)
+		: slot(ShaderSlots::get(name)), type(type), shaderhandle(-1)
 	{
 		unsigned int size = ShaderVariableType::getSize(type);
 		memcpy(this->data, data, size * sizeof(float));
 	}
 	Uniform::Uniform(const Uniform &other)
-		: name(other.name), type(other.type), shaderhandle(other.shaderhandle)
+		: slot(other.slot), type(other.type), shaderhandle(other.shaderhandle)
 	{
 		unsigned int size = ShaderVariableType::getSize(other.type);
 		memcpy(this->data, other.data, size * sizeof(float));
@@ -50,6 +55,11 @@ namespace render
 	{
 	}
 
+	const std::string &Uniform::getName() const
+	{
+		return ShaderSlots::getName(slot);
+	}
+
 	Uniform &Uniform::operator=(float f)
 	{
 		type = ShaderVariableType::Float;
@@ -128,9 +138,8 @@ namespace render
 	{
 	}
 	UniformData::UniformData(const UniformData &data)
-		: invalid("_invalid")
+		: uniforms(data.uniforms), invalid("_invalid")
 	{
-		uniforms = data.uniforms;
 	}
 	UniformData::~UniformData()
 	{
@@ -138,13 +147,34 @@ namespace render
 
 	Uniform &UniformData::add(const std::string &name)
 	{
+		return add(ShaderSlots::get(name));
+	}
+	Uniform &UniformData::add(unsigned int slot)
+	{
+		// Reset existing uniforms without allocating a new entry
+		UniformMap::iterator it = uniforms.find(slot);
+		if (it != uniforms.end())
+		{
+			it->second.set(ShaderVariableType::Invalid);
+			return it->second;
+		}
 		std::pair<UniformMap::iterator, bool> inserted;
-		inserted = uniforms.insert(std::make_pair(name, Uniform(name)));
-		if (inserted.second)
-			return inserted.first->second;
-		UniformMap::iterator it = uniforms.find(name);
-		it->second = Uniform(name);
-		return it->second;
+		inserted = uniforms.insert(std::make_pair(slot, Uniform(slot)));
+		return inserted.first->second;
+	}
+	Uniform *UniformData::find(unsigned int slot)
+	{
+		UniformMap::iterator it = uniforms.find(slot);
+		if (it == uniforms.end())
+			return 0;
+		return &it->second;
+	}
+	const Uniform *UniformData::find(unsigned int slot) const
+	{
+		UniformMap::const_iterator it = uniforms.find(slot);
+		if (it == uniforms.end())
+			return 0;
+		return &it->second;
 	}
 
 	void UniformData::setValues(const UniformData &other)
@@ -166,17 +196,23 @@ namespace render
 	}
 	Uniform &UniformData::operator[](const std::string &name)
 	{
-		UniformMap::iterator it = uniforms.find(name);
-		if (it == uniforms.end())
+		unsigned int slot;
+		if (!ShaderSlots::find(name, slot))
+			return invalid;
+		Uniform *uniform = find(slot);
+		if (!uniform)
 			return invalid;
-		return it->second;
+		return *uniform;
 	}
 	const Uniform &UniformData::operator[](const std::string &name) const
 	{
-		UniformMap::const_iterator it = uniforms.find(name);
-		if (it == uniforms.end())
+		unsigned int slot;
+		if (!ShaderSlots::find(name, slot))
+			return invalid;
+		const Uniform *uniform = find(slot);
+		if (!uniform)
 			return invalid;
-		return it->second;
+		return *uniform;
 	}
 }
 }
@@ -80,5 +80,11 @@ namespace render
 	{
 		// TODO
 	}
+
+	unsigned int VertexBuffer::getMemorySize()
+	{
+		tbb::spin_mutex::scoped_lock lock(datamutex);
+		return size;
+	}
 }
 }
@@ -42,6 +42,7 @@ namespace render
 {
 	struct RenderBatch;
 	struct RenderTargetInfo;
+	struct PipelineState;
 	class Renderer;
 
 	/**
@@ -131,6 +132,46 @@ namespace render
 			 * @param batch Batch to be drawn.
 			 */
 			virtual void draw(RenderBatch *batch) = 0;
+			/**
+			 * Draws a batch with an instanced shader. The per-instance
+			 * uniform values in RenderBatch::instancedata are passed to the
+			 * shader as a vertex attrib with an attrib divisor of 1.
+			 * @param batch Batch with RenderBatch::instancecount > 0.
+			 */
+			virtual void drawInstanced(RenderBatch *batch) = 0;
+			/**
+			 * Frees the driver specific data of a pipeline state object.
+			 * Called in the render thread before the object is deleted.
+			 * @param state Pipeline state with PipelineState::driverdata set.
+			 */
+			virtual void destroyPipelineState(PipelineState *state) = 0;
+
+			/**
+			 * Inserts a fence behind the commands which were issued in the
+			 * render context of the calling thread. Called by the upload
+			 * thread after every upload.
+			 * @return Fence which is passed to waitForFence(), or 0 if the
+			 * commands have already been completed.
+			 */
+			virtual void *createFence() = 0;
+			/**
+			 * Makes all following commands in the render context of the
+			 * calling thread wait for the fence and frees the fence. Called by
+			 * the render thread before it uses uploaded resources.
+			 * @param fence Fence returned by createFence().
+			 */
+			virtual void waitForFence(void *fence) = 0;
+			/**
+			 * Checks without blocking whether the GPU has executed all
+			 * commands before the fence.
+			 * @param fence Fence returned by createFence(). 0 is always
+			 * signaled.
+			 */
+			virtual bool isFenceSignaled(void *fence) = 0;
+			/**
+			 * Frees a fence which is not passed to waitForFence().
+			 */
+			virtual void deleteFence(void *fence) = 0;
 
 			/**
 			 * Called at the end of the frame. This cleans up currently bound
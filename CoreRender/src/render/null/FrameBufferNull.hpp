@@ -55,6 +55,7 @@ namespace null
 			}
 			virtual bool upload()
 			{
+				uploadFinished();
 				return true;
 			}
 	};
@@ -43,6 +43,8 @@ namespace null
 				flags |= 1 << Flag::VertexHalfFloat;
 				flags |= 1 << Flag::PointSprite;
 				flags |= 1 << Flag::TextureRG;
+				flags |= 1 << Flag::Instancing;
+				flags |= 1 << Flag::Fences;
 				maxtexsize1d = 4096;
 				maxtexsize2d[0] = 4096;
 				maxtexsize2d[1] = 4096;
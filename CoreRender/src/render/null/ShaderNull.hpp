@@ -24,6 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CoreRender/render/Shader.hpp"
 
+#include <tbb/atomic.h>
+
 namespace cr
 {
 namespace render
@@ -58,7 +60,21 @@ namespace null
 			}
 			virtual void uploadShader()
 			{
-				handle = 1;
+				// Unique program handles and consecutive variable handles
+				// let VideoDriverAccounting tell shaders and uniforms apart
+				static tbb::atomic<int> nexthandle;
+				handle = ++nexthandle;
+				assignHandles(attribs);
+				if (instanceslot != -1)
+					instanceattrib = attribs.slots.size();
+				assignHandles(uniforms);
+				assignHandles(textures);
+			}
+		private:
+			static void assignHandles(HandleTable &table)
+			{
+				for (unsigned int i = 0; i < table.slots.size(); i++)
+					table.handles[table.slots[i]] = i;
 			}
 	};
 }
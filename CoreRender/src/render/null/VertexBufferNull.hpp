@@ -24,6 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "CoreRender/render/VertexBuffer.hpp"
 
+#include <tbb/atomic.h>
+
 namespace cr
 {
 namespace render
@@ -45,7 +47,10 @@ namespace null
 
 			virtual bool create()
 			{
-				handle = 1;
+				// Unique handles let VideoDriverAccounting tell the
+				// resources apart
+				static tbb::atomic<int> nexthandle;
+				handle = ++nexthandle;
 				return true;
 			}
 			virtual bool destroy()
@@ -55,6 +60,7 @@ namespace null
 			}
 			virtual bool upload()
 			{
+				uploadFinished();
 				return true;
 			}
 	};
@@ -0,0 +1,210 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_NULL_VIDEODRIVERACCOUNTING_HPP_INCLUDED_
+#define _CORERENDER_RENDER_NULL_VIDEODRIVERACCOUNTING_HPP_INCLUDED_
+
+#include "VideoDriverNull.hpp"
+#include "../FrameData.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace cr
+{
+namespace render
+{
+namespace null
+{
+	/**
+	 * Null video driver which simulates the state a real driver would have
+	 * bound and counts the state changes needed for every render pass (see
+	 * VideoDriverType::NullAccounting). Like the OpenGL driver, uniforms are
+	 * only uploaded if the program holds a different value.
+	 *
+	 * Every frame starts with no program, buffers or textures bound. Uniform
+	 * values belong to the programs and are kept across frames as in OpenGL,
+	 * so uniforms which never change are only uploaded once.
+	 */
+	class VideoDriverAccounting : public VideoDriverNull
+	{
+		public:
+			VideoDriverAccounting()
+				: inpass(false)
+			{
+				resetState();
+			}
+			virtual ~VideoDriverAccounting()
+			{
+			}
+
+			virtual void setRenderTarget(const RenderTargetInfo &target)
+			{
+				VideoDriverNull::setRenderTarget(target);
+				finishPass();
+				inpass = true;
+				if (target.framebuffer != rendertarget)
+				{
+					changes.rendertargets++;
+					rendertarget = target.framebuffer;
+				}
+			}
+
+			virtual void draw(RenderBatch *batch)
+			{
+				VideoDriverNull::draw(batch);
+				applyState(batch);
+				changes.draws++;
+			}
+			virtual void drawInstanced(RenderBatch *batch)
+			{
+				VideoDriverNull::drawInstanced(batch);
+				applyState(batch);
+				// The instance data is streamed into a buffer
+				changes.buffers++;
+				changes.draws++;
+			}
+
+			virtual void endFrame()
+			{
+				VideoDriverNull::endFrame();
+				finishPass();
+				resetState();
+			}
+
+			virtual VideoDriverType::List getType()
+			{
+				return VideoDriverType::NullAccounting;
+			}
+		private:
+			void applyState(RenderBatch *batch)
+			{
+				PipelineState *state = batch->state;
+				if (state->shader != program)
+				{
+					changes.programs++;
+					program = state->shader;
+				}
+				if (batch->vertices != vertexbuffer)
+				{
+					changes.buffers++;
+					vertexbuffer = batch->vertices;
+				}
+				if (batch->indices != indexbuffer)
+				{
+					changes.buffers++;
+					indexbuffer = batch->indices;
+				}
+				for (unsigned int i = 0; i < batch->texcount; i++)
+				{
+					TextureEntry &texture = batch->textures[i];
+					if (texture.shaderhandle == -1 || texture.texhandle == -1)
+						continue;
+					unsigned int unit = texture.textureindex;
+					if (unit >= textures.size())
+						textures.resize(unit + 1, -1);
+					if (textures[unit] == texture.texhandle)
+						continue;
+					changes.textures++;
+					textures[unit] = texture.texhandle;
+				}
+				if (program < 0)
+					return;
+				if ((unsigned int)program >= programs.size())
+					programs.resize(program + 1);
+				std::vector<UniformValue> &values = programs[program].uniforms;
+				for (unsigned int i = 0; i < batch->uniformcount; i++)
+				{
+					UniformMapping &uniform = batch->uniforms[i];
+					unsigned int size = ShaderVariableType::getSize(uniform.type)
+					                  * sizeof(float);
+					if (uniform.shaderhandle == -1 || size == 0)
+						continue;
+					unsigned int location = uniform.shaderhandle;
+					if (location >= values.size())
+					{
+						UniformValue unknown;
+						unknown.size = 0;
+						values.resize(location + 1, unknown);
+					}
+					UniformValue &value = values[location];
+					if (value.size == size && !memcmp(value.data, uniform.data, size))
+						continue;
+					changes.uniforms++;
+					value.size = size;
+					memcpy(value.data, uniform.data, size);
+				}
+			}
+			/**
+			 * Adds the changes of the current pass to the render stats.
+			 */
+			void finishPass()
+			{
+				if (!inpass)
+					return;
+				getStats().addPassStateChanges(changes);
+				changes = StateChanges();
+				inpass = false;
+			}
+			void resetState()
+			{
+				rendertarget = 0;
+				program = -1;
+				vertexbuffer = -1;
+				indexbuffer = -1;
+				textures.clear();
+			}
+
+			bool inpass;
+			StateChanges changes;
+
+			FrameBuffer::Configuration *rendertarget;
+			int program;
+			int vertexbuffer;
+			int indexbuffer;
+			/**
+			 * Bound texture for every texture unit.
+			 */
+			std::vector<int> textures;
+			struct UniformValue
+			{
+				unsigned int size;
+				float data[16];
+			};
+			/**
+			 * Uniform values of a program, indexed by the uniform handle.
+			 */
+			struct ProgramState
+			{
+				std::vector<UniformValue> uniforms;
+			};
+			/**
+			 * State of all programs, indexed by the program handle. The null
+			 * driver never reuses program handles.
+			 */
+			std::vector<ProgramState> programs;
+	};
+}
+}
+}
+
+#endif
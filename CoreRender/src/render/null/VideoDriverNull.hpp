@@ -40,6 +40,7 @@ namespace null
 	{
 		public:
 			VideoDriverNull()
+				: checksum(0)
 			{
 			}
 			virtual ~VideoDriverNull()
@@ -99,10 +100,42 @@ namespace null
 
 			virtual void draw(RenderBatch *batch)
 			{
+				readState(batch);
 				// Increase polygon/batch counters
 				getStats().increaseBatchCount(1);
 				getStats().increasePolygonCount((batch->endindex - batch->startindex) / 3);
 			}
+			virtual void drawInstanced(RenderBatch *batch)
+			{
+				readState(batch);
+				unsigned int size = ShaderVariableType::getSize(batch->instancetype);
+				for (unsigned int i = 0; i < batch->instancecount * size; i++)
+					checksum += (unsigned int)batch->instancedata[i];
+				unsigned int polygons = (batch->endindex - batch->startindex) / 3;
+				getStats().increaseBatchCount(1);
+				getStats().increaseMergedBatchCount(batch->instancecount - 1);
+				getStats().increasePolygonCount(polygons * batch->instancecount);
+			}
+
+			virtual void destroyPipelineState(PipelineState *state)
+			{
+			}
+
+			virtual void *createFence()
+			{
+				// Nothing is executed asynchronously
+				return 0;
+			}
+			virtual void waitForFence(void *fence)
+			{
+			}
+			virtual bool isFenceSignaled(void *fence)
+			{
+				return true;
+			}
+			virtual void deleteFence(void *fence)
+			{
+			}
 
 			virtual void endFrame()
 			{
@@ -117,7 +150,38 @@ namespace null
 				return caps;
 			}
 		private:
+			/**
+			 * Reads all state of the batch like a real driver would, so that
+			 * benchmarks with this driver include the cost of accessing the
+			 * frame data.
+			 */
+			void readState(RenderBatch *batch)
+			{
+				PipelineState *state = batch->state;
+				checksum += state->shader + batch->vertices + batch->indices;
+				checksum += state->blendMode + batch->renderflags;
+				for (unsigned int i = 0; i < state->attribcount; i++)
+				{
+					checksum += state->attribs[i].shaderhandle
+					          + state->attribs[i].address
+					          + state->attribs[i].stride;
+				}
+				for (unsigned int i = 0; i < batch->uniformcount; i++)
+				{
+					UniformMapping &uniform = batch->uniforms[i];
+					unsigned int size = ShaderVariableType::getSize(uniform.type);
+					for (unsigned int j = 0; j < size; j++)
+						checksum += (unsigned int)uniform.data[j];
+				}
+				for (unsigned int i = 0; i < batch->texcount; i++)
+				{
+					checksum += batch->textures[i].texhandle
+					          + batch->textures[i].shaderhandle;
+				}
+			}
+
 			RenderCapsNull caps;
+			unsigned int checksum;
 	};
 
 }
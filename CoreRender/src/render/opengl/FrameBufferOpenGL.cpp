@@ -86,13 +86,17 @@ namespace opengl
 			                             GL_RENDERBUFFER_EXT,
 			                             config.defaultdepthbuffer);
 			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+			config.depthbuffer = 0;
+			config.changed = true;
 		}
 		else if (config.defaultdepthbuffer)
 		{
 			// Destroy depth buffer
 			glDeleteRenderbuffersEXT(1, &config.defaultdepthbuffer);
 			config.defaultdepthbuffer = 0;
+			config.changed = true;
 		}
+		uploadFinished();
 		return true;
 	}
 }
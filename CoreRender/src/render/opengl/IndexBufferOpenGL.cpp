@@ -64,6 +64,7 @@ namespace opengl
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		uploadFinished();
 		return true;
 	}
 }
@@ -76,10 +76,18 @@ namespace opengl
 		{
 			flags |= 1 << Flag::TextureRG;
 		}
+		if (GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced)
+		{
+			flags |= 1 << Flag::Instancing;
+		}
 		if (GLEW_ARB_geometry_shader4)
 		{
 			flags |= 1 << Flag::GeometryShader;
 		}
+		if (GLEW_ARB_sync)
+		{
+			flags |= 1 << Flag::Fences;
+		}
 		// TODO: Tesselation shader?
 		return true;
 	}
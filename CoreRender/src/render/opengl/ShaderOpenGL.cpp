@@ -20,7 +20,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "ShaderOpenGL.hpp"
+#include "VideoDriverOpenGL.hpp"
 #include "CoreRender/render/Renderer.hpp"
+#include "CoreRender/render/ShaderSlots.hpp"
 
 #include <GL/glew.h>
 #include <sstream>
@@ -57,6 +59,7 @@ namespace opengl
 				glDeleteShader(shaders[i]);
 			}
 			glDeleteProgram(handle);
+			removeProgramState(handle);
 			shaders.clear();
 			handle = 0;
 		}
@@ -69,6 +72,7 @@ namespace opengl
 				glDeleteShader(oldshaders[i]);
 			}
 			glDeleteProgram(oldhandle);
+			removeProgramState(oldhandle);
 			oldshaders.clear();
 			oldhandle = 0;
 		}
@@ -85,6 +89,7 @@ namespace opengl
 				glDeleteShader(oldshaders[i]);
 			}
 			glDeleteProgram(oldhandle);
+			removeProgramState(oldhandle);
 			oldshaders.clear();
 			oldhandle = 0;
 		}
@@ -202,26 +207,43 @@ namespace opengl
 			return;
 		}
 		printProgramInfoLog(handle);
+		// The handle might have been used by a deleted program before
+		removeProgramState(handle);
 		// Get attrib locations
-		for (HandleMap::iterator it = attribs.begin();
-		     it != attribs.end(); it++)
+		for (unsigned int i = 0; i < attribs.slots.size(); i++)
 		{
-			it->second = glGetAttribLocation(handle, it->first.c_str());
+			unsigned int slot = attribs.slots[i];
+			const std::string &name = ShaderSlots::getName(slot);
+			attribs.handles[slot] = glGetAttribLocation(handle, name.c_str());
+		}
+		// The per-instance uniform is an attrib in instanced shaders
+		if (instanceslot != -1)
+		{
+			const std::string &name = ShaderSlots::getName(instanceslot);
+			instanceattrib = glGetAttribLocation(handle, name.c_str());
 		}
 		// Get uniform locations
-		for (HandleMap::iterator it = uniforms.begin();
-		     it != uniforms.end(); it++)
+		for (unsigned int i = 0; i < uniforms.slots.size(); i++)
 		{
-			it->second = glGetUniformLocation(handle, it->first.c_str());
+			unsigned int slot = uniforms.slots[i];
+			const std::string &name = ShaderSlots::getName(slot);
+			uniforms.handles[slot] = glGetUniformLocation(handle, name.c_str());
 		}
 		// Get texture locations
-		for (HandleMap::iterator it = textures.begin();
-		     it != textures.end(); it++)
+		for (unsigned int i = 0; i < textures.slots.size(); i++)
 		{
-			it->second = glGetUniformLocation(handle, it->first.c_str());
+			unsigned int slot = textures.slots[i];
+			const std::string &name = ShaderSlots::getName(slot);
+			textures.handles[slot] = glGetUniformLocation(handle, name.c_str());
 		}
 	}
 
+	void ShaderOpenGL::removeProgramState(unsigned int program)
+	{
+		VideoDriverOpenGL *driver = (VideoDriverOpenGL*)getRenderer()->getDriver();
+		driver->getStateCache().removeProgram(program);
+	}
+
 	void ShaderOpenGL::printShaderInfoLog(unsigned int shader)
 	{
 		// Get length
@@ -43,6 +43,11 @@ namespace opengl
 			virtual bool upload();
 			virtual void uploadShader();
 		private:
+			/**
+			 * Discards the uniform values cached for a program by the video
+			 * driver.
+			 */
+			void removeProgramState(unsigned int program);
 			void printShaderInfoLog(unsigned int shader);
 			void printProgramInfoLog(unsigned int program);
 
@@ -0,0 +1,464 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "StateCacheOpenGL.hpp"
+
+#include <cstring>
+
+namespace cr
+{
+namespace render
+{
+namespace opengl
+{
+	StateCacheOpenGL::VertexArrayState::VertexArrayState()
+		: indexbuffer(unknown), enabledattribs(0), frame(unknown)
+	{
+		// Divisors are only changed by this class and are always known
+		for (unsigned int i = 0; i < maxattribs; i++)
+		{
+			attribs[i].buffer = unknown;
+			attribs[i].divisor = 0;
+		}
+	}
+
+	StateCacheOpenGL::StateCacheOpenGL()
+		: calls(0), skippeduniforms(0), frame(0), vertexarray(0),
+		currentvao(&defaultvao), currentprogram(0)
+	{
+		memset(&gl, 0, sizeof(gl));
+		invalidate();
+	}
+	StateCacheOpenGL::~StateCacheOpenGL()
+	{
+	}
+
+	void StateCacheOpenGL::loadFunctions()
+	{
+		gl.useProgram = glUseProgram;
+		gl.bindBuffer = glBindBuffer;
+		if (GLEW_ARB_vertex_array_object)
+		{
+			gl.genVertexArrays = glGenVertexArrays;
+			gl.deleteVertexArrays = glDeleteVertexArrays;
+			gl.bindVertexArray = glBindVertexArray;
+		}
+		gl.bufferData = glBufferData;
+		gl.enableVertexAttribArray = glEnableVertexAttribArray;
+		gl.disableVertexAttribArray = glDisableVertexAttribArray;
+		gl.vertexAttribPointer = glVertexAttribPointer;
+		gl.vertexAttribDivisor = glVertexAttribDivisorARB;
+		gl.vertexAttrib4fv = glVertexAttrib4fv;
+		gl.uniform1i = glUniform1i;
+		gl.uniform1fv = glUniform1fv;
+		gl.uniform2fv = glUniform2fv;
+		gl.uniform3fv = glUniform3fv;
+		gl.uniform4fv = glUniform4fv;
+		gl.uniformMatrix3fv = glUniformMatrix3fv;
+		gl.uniformMatrix4fv = glUniformMatrix4fv;
+		gl.uniformMatrix4x3fv = glUniformMatrix4x3fv;
+		gl.uniformMatrix3x4fv = glUniformMatrix3x4fv;
+		gl.activeTexture = glActiveTexture;
+		gl.bindTexture = glBindTexture;
+		gl.generateMipmap = glGenerateMipmapEXT;
+		gl.viewport = glViewport;
+		gl.bindFramebuffer = glBindFramebufferEXT;
+		gl.framebufferTexture2D = glFramebufferTexture2DEXT;
+		gl.framebufferRenderbuffer = glFramebufferRenderbufferEXT;
+		gl.drawBuffers = glDrawBuffers;
+		gl.checkFramebufferStatus = glCheckFramebufferStatusEXT;
+		gl.enable = glEnable;
+		gl.disable = glDisable;
+		gl.blendFunc = glBlendFunc;
+		gl.drawElements = glDrawElements;
+		gl.drawElementsInstanced = glDrawElementsInstancedARB;
+	}
+	void StateCacheOpenGL::setFunctions(const FunctionsOpenGL &functions)
+	{
+		gl = functions;
+	}
+
+	void StateCacheOpenGL::reset()
+	{
+		bindVertexArray(0, &defaultvao);
+		useProgram(0);
+		bindVertexBuffer(0);
+		bindIndexBuffer(0);
+		setAttribArrays(0);
+		invalidate();
+	}
+
+	void StateCacheOpenGL::useProgram(unsigned int program)
+	{
+		if (program == this->program)
+			return;
+		gl.useProgram(program);
+		calls++;
+		this->program = program;
+		currentprogram = &programs[program];
+	}
+	void StateCacheOpenGL::bindVertexBuffer(unsigned int buffer)
+	{
+		if (buffer == vertexbuffer)
+			return;
+		gl.bindBuffer(GL_ARRAY_BUFFER, buffer);
+		calls++;
+		vertexbuffer = buffer;
+	}
+	void StateCacheOpenGL::bindIndexBuffer(unsigned int buffer)
+	{
+		if (buffer == currentvao->indexbuffer)
+			return;
+		gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		calls++;
+		currentvao->indexbuffer = buffer;
+	}
+	unsigned int StateCacheOpenGL::createVertexArray()
+	{
+		GLuint vao = 0;
+		gl.genVertexArrays(1, &vao);
+		calls++;
+		return vao;
+	}
+	void StateCacheOpenGL::deleteVertexArray(unsigned int vao)
+	{
+		// OpenGL falls back to the default vertex array
+		if (vao == vertexarray)
+		{
+			vertexarray = 0;
+			currentvao = &defaultvao;
+		}
+		GLuint handle = vao;
+		gl.deleteVertexArrays(1, &handle);
+		calls++;
+	}
+	void StateCacheOpenGL::bindVertexArray(unsigned int vao,
+	                                       VertexArrayState *state)
+	{
+		if (state->frame != frame)
+			forgetBuffers(state);
+		currentvao = state;
+		if (vao == vertexarray)
+			return;
+		gl.bindVertexArray(vao);
+		calls++;
+		vertexarray = vao;
+	}
+	void StateCacheOpenGL::setBlendState(bool enabled,
+	                                     unsigned int src,
+	                                     unsigned int dst)
+	{
+		if ((int)enabled != blendenabled)
+		{
+			if (enabled)
+				gl.enable(GL_BLEND);
+			else
+				gl.disable(GL_BLEND);
+			calls++;
+			blendenabled = enabled;
+		}
+		if (src == unknown)
+			return;
+		if (blendsrc != src || blenddst != dst)
+		{
+			gl.blendFunc(src, dst);
+			calls++;
+			blendsrc = src;
+			blenddst = dst;
+		}
+	}
+	void StateCacheOpenGL::setAttribArrays(unsigned int mask)
+	{
+		unsigned int &enabledattribs = currentvao->enabledattribs;
+		unsigned int changed = mask ^ enabledattribs;
+		for (unsigned int i = 0; changed != 0; i++, changed >>= 1)
+		{
+			if (!(changed & 1))
+				continue;
+			if (mask & (1u << i))
+				gl.enableVertexAttribArray(i);
+			else
+				gl.disableVertexAttribArray(i);
+			calls++;
+		}
+		enabledattribs = mask;
+	}
+	void StateCacheOpenGL::setAttribPointer(unsigned int index,
+	                                        unsigned int components,
+	                                        unsigned int type,
+	                                        unsigned int stride,
+	                                        uintptr_t offset,
+	                                        unsigned int divisor)
+	{
+		AttribState &attrib = currentvao->attribs[index];
+		if (attrib.buffer != vertexbuffer
+		 || attrib.components != components
+		 || attrib.type != type
+		 || attrib.stride != stride
+		 || attrib.offset != offset)
+		{
+			gl.vertexAttribPointer(index,
+			                       components,
+			                       type,
+			                       GL_FALSE,
+			                       stride,
+			                       (void*)offset);
+			calls++;
+			attrib.buffer = vertexbuffer;
+			attrib.components = components;
+			attrib.type = type;
+			attrib.stride = stride;
+			attrib.offset = offset;
+		}
+		if (attrib.divisor != divisor)
+		{
+			gl.vertexAttribDivisor(index, divisor);
+			calls++;
+			attrib.divisor = divisor;
+		}
+	}
+	void StateCacheOpenGL::setAttribValue(unsigned int index,
+	                                      const float *value)
+	{
+		gl.vertexAttrib4fv(index, value);
+		calls++;
+	}
+	void StateCacheOpenGL::bindTexture(unsigned int unit,
+	                                   unsigned int target,
+	                                   unsigned int texture)
+	{
+		if (unit < maxtextures)
+		{
+			TextureState &state = textures[unit];
+			if (state.target == target && state.texture == texture)
+				return;
+			state.target = target;
+			state.texture = texture;
+		}
+		if (activetexture != unit)
+		{
+			gl.activeTexture(GL_TEXTURE0 + unit);
+			calls++;
+			activetexture = unit;
+		}
+		gl.bindTexture(target, texture);
+		calls++;
+	}
+	void StateCacheOpenGL::generateMipmaps(unsigned int unit,
+	                                       unsigned int target,
+	                                       unsigned int texture)
+	{
+		bindTexture(unit, target, texture);
+		// The texture might already have been bound to a unit which is not
+		// active
+		if (activetexture != unit)
+		{
+			gl.activeTexture(GL_TEXTURE0 + unit);
+			calls++;
+			activetexture = unit;
+		}
+		gl.generateMipmap(target);
+		calls++;
+	}
+	void StateCacheOpenGL::setSampler(int location, int unit)
+	{
+		std::vector<int> &units = currentprogram->samplers;
+		if ((unsigned int)location >= units.size())
+			units.resize(location + 1, -1);
+		if (units[location] == unit)
+			return;
+		gl.uniform1i(location, unit);
+		calls++;
+		units[location] = unit;
+	}
+	void StateCacheOpenGL::setUniform(int location,
+	                                  ShaderVariableType::List type,
+	                                  const float *data)
+	{
+		unsigned int size = ShaderVariableType::getSize(type) * sizeof(float);
+		if (size == 0)
+			return;
+		// Compare with the last value uploaded to the program
+		if (location < maxuniformlocation)
+		{
+			std::vector<UniformValue> &uniforms = currentprogram->uniforms;
+			if ((unsigned int)location >= uniforms.size())
+			{
+				UniformValue unknown;
+				unknown.size = 0;
+				uniforms.resize(location + 1, unknown);
+			}
+			UniformValue &value = uniforms[location];
+			if (value.size == size && !memcmp(value.data, data, size))
+			{
+				skippeduniforms++;
+				return;
+			}
+			value.size = size;
+			memcpy(value.data, data, size);
+		}
+		switch (type)
+		{
+			case ShaderVariableType::Float:
+				gl.uniform1fv(location, 1, data);
+				break;
+			case ShaderVariableType::Float2:
+				gl.uniform2fv(location, 1, data);
+				break;
+			case ShaderVariableType::Float3:
+				gl.uniform3fv(location, 1, data);
+				break;
+			case ShaderVariableType::Float4:
+				gl.uniform4fv(location, 1, data);
+				break;
+			case ShaderVariableType::Float4x4:
+				gl.uniformMatrix4fv(location, 1, GL_FALSE, data);
+				break;
+			case ShaderVariableType::Float3x3:
+				gl.uniformMatrix3fv(location, 1, GL_FALSE, data);
+				break;
+			case ShaderVariableType::Float4x3:
+				gl.uniformMatrix4x3fv(location, 1, GL_FALSE, data);
+				break;
+			case ShaderVariableType::Float3x4:
+				gl.uniformMatrix3x4fv(location, 1, GL_FALSE, data);
+				break;
+			default:
+				return;
+		}
+		calls++;
+	}
+	void StateCacheOpenGL::removeProgram(unsigned int program)
+	{
+		std::map<unsigned int, ProgramState>::iterator it;
+		it = programs.find(program);
+		if (it == programs.end())
+			return;
+		if (currentprogram == &it->second)
+		{
+			this->program = unknown;
+			currentprogram = 0;
+		}
+		programs.erase(it);
+	}
+	void StateCacheOpenGL::setViewport(unsigned int width, unsigned int height)
+	{
+		gl.viewport(0, 0, width, height);
+		calls++;
+	}
+	void StateCacheOpenGL::bindFramebuffer(unsigned int framebuffer)
+	{
+		gl.bindFramebuffer(GL_FRAMEBUFFER_EXT, framebuffer);
+		calls++;
+	}
+	void StateCacheOpenGL::attachColorBuffer(unsigned int index,
+	                                         unsigned int texture)
+	{
+		gl.framebufferTexture2D(GL_FRAMEBUFFER_EXT,
+		                        GL_COLOR_ATTACHMENT0_EXT + index,
+		                        GL_TEXTURE_2D,
+		                        texture,
+		                        0);
+		calls++;
+	}
+	void StateCacheOpenGL::attachDepthTexture(unsigned int texture)
+	{
+		gl.framebufferTexture2D(GL_FRAMEBUFFER_EXT,
+		                        GL_DEPTH_ATTACHMENT_EXT,
+		                        GL_TEXTURE_2D,
+		                        texture,
+		                        0);
+		calls++;
+	}
+	void StateCacheOpenGL::attachDepthRenderbuffer(unsigned int renderbuffer)
+	{
+		gl.framebufferRenderbuffer(GL_FRAMEBUFFER_EXT,
+		                           GL_DEPTH_ATTACHMENT_EXT,
+		                           GL_RENDERBUFFER_EXT,
+		                           renderbuffer);
+		calls++;
+	}
+	void StateCacheOpenGL::setDrawBuffers(unsigned int count)
+	{
+		GLenum drawbuffers[16];
+		if (count > 16)
+			count = 16;
+		for (unsigned int i = 0; i < count; i++)
+			drawbuffers[i] = GL_COLOR_ATTACHMENT0_EXT + i;
+		gl.drawBuffers(count, drawbuffers);
+		calls++;
+	}
+	unsigned int StateCacheOpenGL::checkFramebufferStatus()
+	{
+		calls++;
+		return gl.checkFramebufferStatus(GL_FRAMEBUFFER_EXT);
+	}
+	void StateCacheOpenGL::setBufferData(unsigned int size, const void *data)
+	{
+		gl.bufferData(GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW);
+		calls++;
+	}
+
+	void StateCacheOpenGL::drawElements(unsigned int count,
+	                                    unsigned int indextype,
+	                                    uintptr_t offset,
+	                                    unsigned int instances)
+	{
+		if (instances == 0)
+			gl.drawElements(GL_TRIANGLES, count, indextype, (void*)offset);
+		else
+			gl.drawElementsInstanced(GL_TRIANGLES, count, indextype,
+			                         (void*)offset, instances);
+		calls++;
+	}
+
+	void StateCacheOpenGL::invalidate()
+	{
+		// Attrib arrays are disabled explicitly in reset(), everything else
+		// except for the program state is set again when it is used the next
+		// time
+		program = unknown;
+		vertexbuffer = unknown;
+		blendenabled = -1;
+		blendsrc = unknown;
+		blenddst = unknown;
+		// The buffer bindings of the other vertex arrays are forgotten when
+		// they are bound the next time
+		frame++;
+		forgetBuffers(currentvao);
+		activetexture = unknown;
+		for (unsigned int i = 0; i < maxtextures; i++)
+		{
+			textures[i].target = unknown;
+			textures[i].texture = unknown;
+		}
+	}
+	void StateCacheOpenGL::forgetBuffers(VertexArrayState *state)
+	{
+		state->indexbuffer = unknown;
+		for (unsigned int i = 0; i < maxattribs; i++)
+			state->attribs[i].buffer = unknown;
+		state->frame = frame;
+	}
+}
+}
+}
@@ -0,0 +1,377 @@
+/*
+Copyright (C) 2010, Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#ifndef _CORERENDER_RENDER_OPENGL_STATECACHEOPENGL_HPP_INCLUDED_
+#define _CORERENDER_RENDER_OPENGL_STATECACHEOPENGL_HPP_INCLUDED_
+
+#include "CoreRender/render/ShaderVariableType.hpp"
+#include "CoreRender/math/StdInt.hpp"
+
+#include <GL/glew.h>
+#include <map>
+#include <vector>
+
+namespace cr
+{
+namespace render
+{
+namespace opengl
+{
+	/**
+	 * Table of all OpenGL entry points used for drawing. Usually this
+	 * contains the functions of the OpenGL implementation, but tests can
+	 * replace them with stubs to check which calls the driver makes.
+	 */
+	struct FunctionsOpenGL
+	{
+		void (GLAPIENTRY *useProgram)(GLuint program);
+		void (GLAPIENTRY *bindBuffer)(GLenum target, GLuint buffer);
+		/**
+		 * Vertex array object functions, 0 if vertex array objects are not
+		 * supported.
+		 */
+		void (GLAPIENTRY *genVertexArrays)(GLsizei n, GLuint *arrays);
+		void (GLAPIENTRY *deleteVertexArrays)(GLsizei n, const GLuint *arrays);
+		void (GLAPIENTRY *bindVertexArray)(GLuint array);
+		void (GLAPIENTRY *bufferData)(GLenum target,
+		                              GLsizeiptr size,
+		                              const GLvoid *data,
+		                              GLenum usage);
+		void (GLAPIENTRY *enableVertexAttribArray)(GLuint index);
+		void (GLAPIENTRY *disableVertexAttribArray)(GLuint index);
+		void (GLAPIENTRY *vertexAttribPointer)(GLuint index,
+		                                       GLint size,
+		                                       GLenum type,
+		                                       GLboolean normalized,
+		                                       GLsizei stride,
+		                                       const GLvoid *pointer);
+		void (GLAPIENTRY *vertexAttribDivisor)(GLuint index, GLuint divisor);
+		void (GLAPIENTRY *vertexAttrib4fv)(GLuint index, const GLfloat *v);
+		void (GLAPIENTRY *uniform1i)(GLint location, GLint v0);
+		void (GLAPIENTRY *uniform1fv)(GLint location,
+		                              GLsizei count,
+		                              const GLfloat *value);
+		void (GLAPIENTRY *uniform2fv)(GLint location,
+		                              GLsizei count,
+		                              const GLfloat *value);
+		void (GLAPIENTRY *uniform3fv)(GLint location,
+		                              GLsizei count,
+		                              const GLfloat *value);
+		void (GLAPIENTRY *uniform4fv)(GLint location,
+		                              GLsizei count,
+		                              const GLfloat *value);
+		void (GLAPIENTRY *uniformMatrix3fv)(GLint location,
+		                                    GLsizei count,
+		                                    GLboolean transpose,
+		                                    const GLfloat *value);
+		void (GLAPIENTRY *uniformMatrix4fv)(GLint location,
+		                                    GLsizei count,
+		                                    GLboolean transpose,
+		                                    const GLfloat *value);
+		void (GLAPIENTRY *uniformMatrix4x3fv)(GLint location,
+		                                      GLsizei count,
+		                                      GLboolean transpose,
+		                                      const GLfloat *value);
+		void (GLAPIENTRY *uniformMatrix3x4fv)(GLint location,
+		                                      GLsizei count,
+		                                      GLboolean transpose,
+		                                      const GLfloat *value);
+		void (GLAPIENTRY *activeTexture)(GLenum texture);
+		void (GLAPIENTRY *bindTexture)(GLenum target, GLuint texture);
+		void (GLAPIENTRY *generateMipmap)(GLenum target);
+		void (GLAPIENTRY *viewport)(GLint x,
+		                            GLint y,
+		                            GLsizei width,
+		                            GLsizei height);
+		void (GLAPIENTRY *bindFramebuffer)(GLenum target, GLuint framebuffer);
+		void (GLAPIENTRY *framebufferTexture2D)(GLenum target,
+		                                        GLenum attachment,
+		                                        GLenum textarget,
+		                                        GLuint texture,
+		                                        GLint level);
+		void (GLAPIENTRY *framebufferRenderbuffer)(GLenum target,
+		                                           GLenum attachment,
+		                                           GLenum renderbuffertarget,
+		                                           GLuint renderbuffer);
+		void (GLAPIENTRY *drawBuffers)(GLsizei n, const GLenum *bufs);
+		GLenum (GLAPIENTRY *checkFramebufferStatus)(GLenum target);
+		void (GLAPIENTRY *enable)(GLenum cap);
+		void (GLAPIENTRY *disable)(GLenum cap);
+		void (GLAPIENTRY *blendFunc)(GLenum sfactor, GLenum dfactor);
+		void (GLAPIENTRY *drawElements)(GLenum mode,
+		                                GLsizei count,
+		                                GLenum type,
+		                                const GLvoid *indices);
+		void (GLAPIENTRY *drawElementsInstanced)(GLenum mode,
+		                                         GLsizei count,
+		                                         GLenum type,
+		                                         const GLvoid *indices,
+		                                         GLsizei primcount);
+	};
+
+	/**
+	 * Shadow copy of the OpenGL state used for drawing. All draw calls of
+	 * VideoDriverOpenGL go through this class, which only passes state
+	 * changes on to OpenGL and counts the OpenGL calls made.
+	 *
+	 * Other code changing the state (e.g. texture uploads) has to happen
+	 * outside of render passes, the driver calls reset() at the end of
+	 * every frame. Uniform values and sampler units belong to the program
+	 * objects and are kept until removeProgram() is called. Attrib arrays
+	 * and the index buffer binding belong to the bound vertex array object.
+	 */
+	class StateCacheOpenGL
+	{
+		public:
+			/**
+			 * Maximum number of attrib arrays and texture units tracked.
+			 */
+			static const unsigned int maxattribs = 32;
+			static const unsigned int maxtextures = 32;
+			/**
+			 * Uniforms with higher locations are always uploaded.
+			 */
+			static const int maxuniformlocation = 1024;
+			/**
+			 * Handle value used for state which is not known.
+			 */
+			static const unsigned int unknown = 0xFFFFFFFF;
+
+			struct AttribState
+			{
+				unsigned int buffer;
+				unsigned int components;
+				unsigned int type;
+				unsigned int stride;
+				uintptr_t offset;
+				unsigned int divisor;
+			};
+			/**
+			 * Shadow copy of the state contained in a vertex array object.
+			 */
+			struct VertexArrayState
+			{
+				VertexArrayState();
+
+				unsigned int indexbuffer;
+				unsigned int enabledattribs;
+				AttribState attribs[maxattribs];
+				/**
+				 * Frame in which the buffer bindings were validated. Buffer
+				 * handles might be reused after a buffer was deleted, so the
+				 * bindings are forgotten at the end of every frame.
+				 */
+				unsigned int frame;
+			};
+
+			StateCacheOpenGL();
+			~StateCacheOpenGL();
+
+			/**
+			 * Loads the entry points of the OpenGL implementation. Has to be
+			 * called after GLEW has been initialized.
+			 */
+			void loadFunctions();
+			/**
+			 * Replaces the OpenGL entry points, e.g. with stubs for testing.
+			 */
+			void setFunctions(const FunctionsOpenGL &functions);
+
+			/**
+			 * Unbinds the program and the buffers, disables all attrib
+			 * arrays and forgets all other state. Has to be called whenever
+			 * OpenGL state could have been changed outside of this class.
+			 */
+			void reset();
+
+			void useProgram(unsigned int program);
+			void bindVertexBuffer(unsigned int buffer);
+			void bindIndexBuffer(unsigned int buffer);
+			/**
+			 * Returns whether vertex array objects can be used.
+			 */
+			bool hasVertexArrays()
+			{
+				return gl.bindVertexArray != 0;
+			}
+			unsigned int createVertexArray();
+			/**
+			 * Deletes a vertex array object, binding the default vertex array
+			 * if the object was bound.
+			 */
+			void deleteVertexArray(unsigned int vao);
+			/**
+			 * Binds a vertex array object. Following calls to
+			 * setAttribArrays(), setAttribPointer() and bindIndexBuffer()
+			 * only change the state of this object.
+			 * @param vao Vertex array object, 0 for the default vertex array.
+			 * @param state Shadow copy of the state of the object, has to
+			 * stay valid until the object is deleted.
+			 */
+			void bindVertexArray(unsigned int vao, VertexArrayState *state);
+			/**
+			 * Enables or disables blending.
+			 * @param enabled If true, blending is enabled.
+			 * @param src Source factor or unknown to keep the blend function.
+			 * @param dst Destination factor.
+			 */
+			void setBlendState(bool enabled,
+			                   unsigned int src = unknown,
+			                   unsigned int dst = unknown);
+			/**
+			 * Enables exactly the attrib arrays set in the mask and disables
+			 * all others.
+			 * @param mask Bitmask with one bit per attrib index.
+			 */
+			void setAttribArrays(unsigned int mask);
+			/**
+			 * Sets the source of an attrib array. The array reads from the
+			 * currently bound vertex buffer.
+			 */
+			void setAttribPointer(unsigned int index,
+			                      unsigned int components,
+			                      unsigned int type,
+			                      unsigned int stride,
+			                      uintptr_t offset,
+			                      unsigned int divisor = 0);
+			void setAttribValue(unsigned int index, const float *value);
+			void bindTexture(unsigned int unit,
+			                 unsigned int target,
+			                 unsigned int texture);
+			/**
+			 * Binds a texture and generates all mipmap levels from the first
+			 * level.
+			 */
+			void generateMipmaps(unsigned int unit,
+			                     unsigned int target,
+			                     unsigned int texture);
+			/**
+			 * Sets the texture unit of a sampler uniform of the current
+			 * program.
+			 */
+			void setSampler(int location, int unit);
+			/**
+			 * Sets a uniform of the current program. The upload is skipped if
+			 * the program already holds the same value.
+			 */
+			void setUniform(int location,
+			                ShaderVariableType::List type,
+			                const float *data);
+			/**
+			 * Forgets the uniform values of a program. Has to be called from
+			 * the render thread whenever a program is linked or deleted.
+			 */
+			void removeProgram(unsigned int program);
+			/**
+			 * Framebuffer functions. These are passed on unconditionally,
+			 * the driver tracks the framebuffer configuration itself.
+			 */
+			void setViewport(unsigned int width, unsigned int height);
+			void bindFramebuffer(unsigned int framebuffer);
+			void attachColorBuffer(unsigned int index, unsigned int texture);
+			void attachDepthTexture(unsigned int texture);
+			void attachDepthRenderbuffer(unsigned int renderbuffer);
+			/**
+			 * Enables the first color attachments of the bound framebuffer
+			 * object as draw buffers.
+			 */
+			void setDrawBuffers(unsigned int count);
+			unsigned int checkFramebufferStatus();
+			void setBufferData(unsigned int size, const void *data);
+
+			void drawElements(unsigned int count,
+			                  unsigned int indextype,
+			                  uintptr_t offset,
+			                  unsigned int instances = 0);
+
+			/**
+			 * Returns the number of OpenGL calls made since the last call to
+			 * resetCallCount().
+			 */
+			unsigned int getCallCount()
+			{
+				return calls;
+			}
+			/**
+			 * Returns the number of uniform uploads which were skipped because
+			 * the value did not change since the last call to
+			 * resetCallCount().
+			 */
+			unsigned int getSkippedUniformCount()
+			{
+				return skippeduniforms;
+			}
+			void resetCallCount()
+			{
+				calls = 0;
+				skippeduniforms = 0;
+			}
+		private:
+			void invalidate();
+			void forgetBuffers(VertexArrayState *state);
+
+			FunctionsOpenGL gl;
+			unsigned int calls;
+			unsigned int skippeduniforms;
+
+			unsigned int program;
+			unsigned int vertexbuffer;
+
+			int blendenabled;
+			unsigned int blendsrc;
+			unsigned int blenddst;
+
+			unsigned int frame;
+			unsigned int vertexarray;
+			VertexArrayState *currentvao;
+			VertexArrayState defaultvao;
+
+			unsigned int activetexture;
+			struct TextureState
+			{
+				unsigned int target;
+				unsigned int texture;
+			};
+			TextureState textures[maxtextures];
+
+			struct UniformValue
+			{
+				unsigned int size;
+				float data[16];
+			};
+			/**
+			 * Shadow copy of the uniforms of a program, indexed by the
+			 * uniform location.
+			 */
+			struct ProgramState
+			{
+				std::vector<int> samplers;
+				std::vector<UniformValue> uniforms;
+			};
+			std::map<unsigned int, ProgramState> programs;
+			ProgramState *currentprogram;
+	};
+}
+}
+}
+
+#endif
@@ -21,7 +21,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Texture2DOpenGL.hpp"
 #include "CoreRender/render/Renderer.hpp"
-#include "../VideoDriver.hpp"
+#include "VideoDriverOpenGL.hpp"
 
 #include <GL/glew.h>
 
@@ -134,6 +134,8 @@ namespace opengl
 	}
 	bool Texture2DOpenGL::destroy()
 	{
+		VideoDriverOpenGL *driver = (VideoDriverOpenGL*)getRenderer()->getDriver();
+		driver->removeTexture(handle);
 		glDeleteTextures(1, &handle);
 		return true;
 	}
@@ -28,6 +28,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../FrameData.hpp"
 
 #include <GL/glew.h>
+#include <cstring>
 
 namespace cr
 {
@@ -36,8 +37,7 @@ namespace render
 namespace opengl
 {
 	VideoDriverOpenGL::VideoDriverOpenGL(core::Log::Ptr log)
-		: log(log), currentfb(0), currentshader(0), currentvertices(0),
-		currentindices(0), currentBlendMode(BlendMode::Solid)
+		: log(log), currentfb(0), dirtymipmapcount(0), instancebuffer(0)
 	{
 	}
 	VideoDriverOpenGL::~VideoDriverOpenGL()
@@ -67,6 +67,9 @@ namespace opengl
 			log->error("Could not initialize capabilities.");
 			return false;
 		}
+		state.loadFunctions();
+		// Create the buffer for per-instance data
+		glGenBuffers(1, &instancebuffer);
 		// Init static OpenGL states
 		glCullFace(GL_BACK);
 		glEnable(GL_CULL_FACE);
@@ -76,6 +79,9 @@ namespace opengl
 	}
 	bool VideoDriverOpenGL::shutdown()
 	{
+		if (instancebuffer)
+			glDeleteBuffers(1, &instancebuffer);
+		instancebuffer = 0;
 		return true;
 	}
 
@@ -113,24 +119,29 @@ namespace opengl
 	void VideoDriverOpenGL::setRenderTarget(const RenderTargetInfo &target)
 	{
 		// Set viewport
-		glViewport(0, 0, target.width, target.height);
+		state.setViewport(target.width, target.height);
 		// Bind frame buffer object
 		FrameBuffer::Configuration *newfb = target.framebuffer;
+		// Generate mipmaps for the color buffers which are not rendered to
+		// anymore
+		for (unsigned int i = 0; i < currentmipmaps.size(); i++)
+		{
+			if (newfb == currentfb && i < target.colorbuffercount
+			 && target.colorbuffers[i] == currentfb->colorbuffers[i])
+				continue;
+			finishColorBuffer(currentfb->colorbuffers[i], currentmipmaps[i]);
+		}
+		currentmipmaps.clear();
 		if (newfb != currentfb)
 		{
-			// Generate mipmaps
-			if (currentfb)
-			{
-				generateMipmaps(currentfb);
-			}
 			// Bind new framebuffer object
 			if (newfb)
 			{
-				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, newfb->handle);
+				state.bindFramebuffer(newfb->handle);
 			}
 			else
 			{
-				glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+				state.bindFramebuffer(0);
 				// TODO: Set draw buffers here?
 			}
 			currentfb = newfb;
@@ -141,65 +152,49 @@ namespace opengl
 		for (unsigned int i = target.colorbuffercount;
 			i < currentfb->colorbuffers.size(); i++)
 		{
-			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
-			                          GL_COLOR_ATTACHMENT0_EXT + i,
-			                          GL_TEXTURE_2D,
-			                          0,
-			                          0);
-		}
-		// Enlarge color buffer array if necessary
-		for (unsigned int i = currentfb->colorbuffers.size();
-			i < target.colorbuffercount; i++)
-		{
-			currentfb->colorbuffers.push_back(0);
+			state.attachColorBuffer(i, 0);
+			currentfb->changed = true;
 		}
+		// Resize the color buffer array, new entries are not attached yet
+		currentfb->colorbuffers.resize(target.colorbuffercount, 0);
 		// Bind color buffers
 		for (unsigned int i = 0; i < target.colorbuffercount; i++)
 		{
 			if (target.colorbuffers[i] == currentfb->colorbuffers[i])
 				continue;
-			glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
-			                          GL_COLOR_ATTACHMENT0_EXT + i,
-			                          GL_TEXTURE_2D,
-			                          target.colorbuffers[i],
-			                          0);
+			state.attachColorBuffer(i, target.colorbuffers[i]);
 			currentfb->colorbuffers[i] = target.colorbuffers[i];
+			currentfb->changed = true;
 		}
+		currentmipmaps.assign(target.mipmaps,
+		                      target.mipmaps + target.colorbuffercount);
 		// Bind depth buffer
 		if (target.depthbuffer != currentfb->depthbuffer)
 		{
 			if (!target.depthbuffer)
-			{
-				glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT,
-				                             GL_DEPTH_ATTACHMENT_EXT,
-				                             GL_RENDERBUFFER_EXT,
-				                             currentfb->defaultdepthbuffer);
-			}
+				state.attachDepthRenderbuffer(currentfb->defaultdepthbuffer);
 			else
-			{
-				glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
-				                          GL_DEPTH_ATTACHMENT_EXT,
-				                          GL_TEXTURE_2D,
-				                          target.depthbuffer,
-				                          0);
-			}
-			log->info("Bound depth buffer.");
+				state.attachDepthTexture(target.depthbuffer);
 			currentfb->depthbuffer = target.depthbuffer;
+			currentfb->changed = true;
 		}
-		// Change draw buffers
-		// TODO: This should not be done unconditionally
-		std::vector<unsigned int> drawbuffers(target.colorbuffercount, 0);
-		for (unsigned int i = 0; i < drawbuffers.size(); i++)
+		if (!currentfb->changed)
+			return;
+		// Draw buffers are part of the framebuffer object state and only
+		// have to be changed if the number of color buffers changed
+		if (currentfb->drawbuffers != target.colorbuffercount)
 		{
-			drawbuffers[i] = GL_COLOR_ATTACHMENT0_EXT + i;
+			state.setDrawBuffers(target.colorbuffercount);
+			currentfb->drawbuffers = target.colorbuffercount;
 		}
-		glDrawBuffers(drawbuffers.size(), &drawbuffers[0]);
-		// Check fbo state
-		GLenum status = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
+		// Check fbo state, this is expensive, so it is only done when the
+		// attachments have changed
+		unsigned int status = state.checkFramebufferStatus();
 		if (status != GL_FRAMEBUFFER_COMPLETE_EXT)
 		{
 			log->error("Invalid framebuffer (%d).", status);
 		}
+		currentfb->changed = false;
 	}
 	void VideoDriverOpenGL::clear(bool colorbuffer,
 	                              bool zbuffer,
@@ -223,55 +218,163 @@ namespace opengl
 
 	void VideoDriverOpenGL::draw(RenderBatch *batch)
 	{
-		// TODO: Keep track of state changes, do not change too much
-		// Bind buffers/shader
-		// TODO: Error checking
-		if (currentshader != batch->shader)
+		state.setAttribArrays(applyBatchState(batch));
+		// Render triangles
+		drawElements(batch, 0);
+		// Increase polygon/batch counters
+		unsigned int indexcount = batch->endindex - batch->startindex;
+		getStats().increaseBatchCount(1);
+		getStats().increasePolygonCount(indexcount / 3);
+		countCalls();
+	}
+	void VideoDriverOpenGL::drawInstanced(RenderBatch *batch)
+	{
+		// Matrices are passed as one attrib per column
+		unsigned int columns = 1;
+		unsigned int rows = ShaderVariableType::getSize(batch->instancetype);
+		switch (batch->instancetype)
 		{
-			glUseProgram(batch->shader);
-			currentshader = batch->shader;
+			case ShaderVariableType::Float4x4:
+				columns = 4;
+				rows = 4;
+				break;
+			case ShaderVariableType::Float3x3:
+				columns = 3;
+				rows = 3;
+				break;
+			case ShaderVariableType::Float4x3:
+				columns = 4;
+				rows = 3;
+				break;
+			case ShaderVariableType::Float3x4:
+				columns = 3;
+				rows = 4;
+				break;
+			default:
+				break;
 		}
-		
-		if (batch->blendMode != currentBlendMode)// different mode
+		int attrib = batch->instanceattrib;
+		if (attrib != -1 && attrib + columns > StateCacheOpenGL::maxattribs)
+			attrib = -1;
+		unsigned int indexcount = batch->endindex - batch->startindex;
+		if (attrib != -1 && caps.getFlag(RenderCaps::Flag::Instancing))
 		{
-			
-			// If move from a Solid mode to another Mode enableBlend
-			if (currentBlendMode == BlendMode::Solid)
+			// The instance attribs belong to the vertex array of the batch,
+			// so the batch state has to be applied first
+			unsigned int attribmask = applyBatchState(batch);
+			// Stream the instance data into the instance buffer
+			unsigned int stride = columns * rows * sizeof(float);
+			state.bindVertexBuffer(instancebuffer);
+			state.setBufferData(stride * batch->instancecount,
+			                    batch->instancedata);
+			for (unsigned int i = 0; i < columns; i++)
 			{
-				glEnable(GL_BLEND);
+				state.setAttribPointer(attrib + i,
+				                       rows,
+				                       GL_FLOAT,
+				                       stride,
+				                       i * rows * sizeof(float),
+				                       1);
+				attribmask |= 1u << (attrib + i);
 			}
-			
-			currentBlendMode = batch->blendMode;
-			
-			switch (currentBlendMode)
+			state.setAttribArrays(attribmask);
+			drawElements(batch, batch->instancecount);
+			getStats().increaseBatchCount(1);
+			getStats().increaseMergedBatchCount(batch->instancecount - 1);
+		}
+		else
+		{
+			// Without instanced arrays, pass the instance values as constant
+			// attribs and draw the instances one after another
+			state.setAttribArrays(applyBatchState(batch));
+			for (unsigned int instance = 0; instance < batch->instancecount; instance++)
 			{
-				case BlendMode::Solid :
-					glDisable(GL_BLEND);
-					break;
-				case BlendMode::Additive :
-					glBlendFunc(GL_SRC_ALPHA,GL_DST_ALPHA);
-					break;
+				float *data = batch->instancedata + instance * columns * rows;
+				for (unsigned int i = 0; i < columns && attrib != -1; i++)
+				{
+					float column[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+					memcpy(column, data + i * rows, rows * sizeof(float));
+					state.setAttribValue(attrib + i, column);
+				}
+				drawElements(batch, 0);
 			}
-			
+			getStats().increaseBatchCount(batch->instancecount);
 		}
+		getStats().increasePolygonCount(indexcount / 3 * batch->instancecount);
+		countCalls();
+	}
 
-		if (batch->vertices != currentvertices)
+	void VideoDriverOpenGL::destroyPipelineState(PipelineState *pso)
+	{
+		PipelineStateOpenGL *glstate = (PipelineStateOpenGL*)pso->driverdata;
+		if (glstate->vao != 0)
+			state.deleteVertexArray(glstate->vao);
+		delete glstate;
+		pso->driverdata = 0;
+	}
+
+	void *VideoDriverOpenGL::createFence()
+	{
+		if (!GLEW_ARB_sync)
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, batch->vertices);
-			currentvertices = batch->vertices;
+			// Without sync objects we have to make sure the upload is
+			// complete before the render thread can use it
+			glFinish();
+			return 0;
 		}
-		if (batch->indices != currentindices)
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// Other contexts can only wait for fences which reached the GPU
+		glFlush();
+		return fence;
+	}
+	void VideoDriverOpenGL::waitForFence(void *fence)
+	{
+		if (!fence)
+			return;
+		glWaitSync((GLsync)fence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync((GLsync)fence);
+	}
+	bool VideoDriverOpenGL::isFenceSignaled(void *fence)
+	{
+		if (!fence)
+			return true;
+		GLenum status = glClientWaitSync((GLsync)fence, 0, 0);
+		return status == GL_ALREADY_SIGNALED
+		    || status == GL_CONDITION_SATISFIED;
+	}
+	void VideoDriverOpenGL::deleteFence(void *fence)
+	{
+		if (fence)
+			glDeleteSync((GLsync)fence);
+	}
+
+	VideoDriverOpenGL::PipelineStateOpenGL *VideoDriverOpenGL::getPipelineState(PipelineState *pso)
+	{
+		if (pso->driverdata)
+			return (PipelineStateOpenGL*)pso->driverdata;
+		PipelineStateOpenGL *glstate = new PipelineStateOpenGL;
+		glstate->vao = 0;
+		if (state.hasVertexArrays())
+			glstate->vao = state.createVertexArray();
+		// Translate the blend mode
+		glstate->blend = pso->blendMode != BlendMode::Solid;
+		glstate->blendsrc = StateCacheOpenGL::unknown;
+		glstate->blenddst = StateCacheOpenGL::unknown;
+		if (pso->blendMode == BlendMode::Additive)
 		{
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->indices);
-			currentindices = batch->indices;
+			glstate->blendsrc = GL_SRC_ALPHA;
+			glstate->blenddst = GL_DST_ALPHA;
 		}
-		// Apply attribs
-		for (unsigned int i = 0; i < batch->attribcount; i++)
+		// Translate the attribs
+		glstate->attribcount = 0;
+		glstate->attribmask = 0;
+		for (unsigned int i = 0; i < pso->attribcount; i++)
 		{
-			if (batch->attribs[i].shaderhandle == -1)
+			int handle = pso->attribs[i].shaderhandle;
+			if (handle == -1 || handle >= (int)StateCacheOpenGL::maxattribs)
 				continue;
 			unsigned int opengltype = GL_FLOAT;
-			switch (batch->attribs[i].type)
+			switch (pso->attribs[i].type)
 			{
 				case VertexElementType::Float:
 					opengltype = GL_FLOAT;
@@ -293,72 +396,48 @@ namespace opengl
 					opengltype = GL_BYTE;
 					break;
 			}
-			glEnableVertexAttribArray(batch->attribs[i].shaderhandle);
-			glVertexAttribPointer(batch->attribs[i].shaderhandle,
-			                      batch->attribs[i].components,
-			                      opengltype,
-			                      GL_FALSE,
-			                      batch->attribs[i].stride,
-			                      (void*)(batch->attribs[i].address + batch->vertexoffset));
+			PipelineStateOpenGL::Attrib &attrib = glstate->attribs[glstate->attribcount];
+			attrib.index = handle;
+			attrib.components = pso->attribs[i].components;
+			attrib.type = opengltype;
+			attrib.stride = pso->attribs[i].stride;
+			attrib.address = pso->attribs[i].address;
+			glstate->attribcount++;
+			glstate->attribmask |= 1u << handle;
+		}
+		pso->driverdata = glstate;
+		return glstate;
+	}
+
+	unsigned int VideoDriverOpenGL::applyBatchState(RenderBatch *batch)
+	{
+		// TODO: Error checking
+		PipelineStateOpenGL *glstate = getPipelineState(batch->state);
+		state.useProgram(batch->state->shader);
+		state.setBlendState(glstate->blend, glstate->blendsrc, glstate->blenddst);
+		if (glstate->vao != 0)
+			state.bindVertexArray(glstate->vao, &glstate->vertexarray);
+		state.bindVertexBuffer(batch->vertices);
+		state.bindIndexBuffer(batch->indices);
+		// Apply attribs, the caller enables the returned attrib arrays
+		for (unsigned int i = 0; i < glstate->attribcount; i++)
+		{
+			PipelineStateOpenGL::Attrib &attrib = glstate->attribs[i];
+			state.setAttribPointer(attrib.index,
+			                       attrib.components,
+			                       attrib.type,
+			                       attrib.stride,
+			                       attrib.address + batch->vertexoffset);
 		}
 		// Apply uniforms
 		for (unsigned int i = 0; i < batch->uniformcount; i++)
 		{
 			if (batch->uniforms[i].shaderhandle == -1)
 				continue;
-			switch (batch->uniforms[i].type)
-			{
-				case ShaderVariableType::Float:
-					glUniform1f(batch->uniforms[i].shaderhandle,
-					            batch->uniforms[i].data[0]);
-					break;
-				case ShaderVariableType::Float2:
-					glUniform2f(batch->uniforms[i].shaderhandle,
-					            batch->uniforms[i].data[0],
-					            batch->uniforms[i].data[1]);
-					break;
-				case ShaderVariableType::Float3:
-					glUniform3f(batch->uniforms[i].shaderhandle,
-					            batch->uniforms[i].data[0],
-					            batch->uniforms[i].data[1],
-					            batch->uniforms[i].data[2]);
-					break;
-				case ShaderVariableType::Float4:
-					glUniform4f(batch->uniforms[i].shaderhandle,
-					            batch->uniforms[i].data[0],
-					            batch->uniforms[i].data[1],
-					            batch->uniforms[i].data[2],
-					            batch->uniforms[i].data[3]);
-					break;
-				case ShaderVariableType::Float4x4:
-					glUniformMatrix4fv(batch->uniforms[i].shaderhandle,
-					                   1,
-					                   GL_FALSE,
-					                   batch->uniforms[i].data);
-					break;
-				case ShaderVariableType::Float3x3:
-					glUniformMatrix3fv(batch->uniforms[i].shaderhandle,
-					                   1,
-					                   GL_FALSE,
-					                   batch->uniforms[i].data);
-					break;
-				case ShaderVariableType::Float4x3:
-					glUniformMatrix4x3fv(batch->uniforms[i].shaderhandle,
-					                     1,
-					                     GL_FALSE,
-					                     batch->uniforms[i].data);
-					break;
-				case ShaderVariableType::Float3x4:
-					glUniformMatrix3x4fv(batch->uniforms[i].shaderhandle,
-					                     1,
-					                     GL_FALSE,
-					                     batch->uniforms[i].data);
-					break;
-				default:
-					break;
-			}
+			state.setUniform(batch->uniforms[i].shaderhandle,
+			                 batch->uniforms[i].type,
+			                 batch->uniforms[i].data);
 		}
-		// TODO
 		// Apply textures
 		for (unsigned int i = 0; i < batch->texcount; i++)
 		{
@@ -382,44 +461,57 @@ namespace opengl
 					opengltype = GL_TEXTURE_CUBE_MAP;
 					break;
 			}
-			glActiveTexture(GL_TEXTURE0 + batch->textures[i].textureindex);
-			glBindTexture(opengltype, batch->textures[i].texhandle);
-			glUniform1i(batch->textures[i].shaderhandle,
-			            batch->textures[i].textureindex);
-		}
-		// Render triangles
-		unsigned int indexcount = batch->endindex - batch->startindex;
-		if (batch->indextype == 1)
-		{
-			glDrawElements(GL_TRIANGLES,
-			               indexcount,
-			               GL_UNSIGNED_BYTE,
-			               (void*)(batch->startindex));
-		}
-		else if (batch->indextype == 2)
-		{
-			glDrawElements(GL_TRIANGLES,
-			               indexcount,
-			               GL_UNSIGNED_SHORT,
-			               (void*)(batch->startindex * 2));
-		}
-		else if (batch->indextype == 4)
-		{
-			glDrawElements(GL_TRIANGLES,
-			               indexcount,
-			               GL_UNSIGNED_INT,
-			               (void*)(batch->startindex * 4));
+			// Render targets get their mipmaps when they are first used
+			if (dirtymipmapcount > 0)
+			{
+				TextureMap::iterator it;
+				it = textures.find((unsigned int)batch->textures[i].texhandle);
+				if (it != textures.end() && it->second.dirtymipmaps)
+				{
+					state.generateMipmaps(batch->textures[i].textureindex,
+					                      opengltype,
+					                      batch->textures[i].texhandle);
+					it->second.dirtymipmaps = false;
+					dirtymipmapcount--;
+				}
+			}
+			state.bindTexture(batch->textures[i].textureindex,
+			                  opengltype,
+			                  batch->textures[i].texhandle);
+			state.setSampler(batch->textures[i].shaderhandle,
+			                 batch->textures[i].textureindex);
 		}
-		// Increase polygon/batch counters
-		getStats().increaseBatchCount(1);
-		getStats().increasePolygonCount(indexcount / 3);
-		// Clean up attribs
-		for (unsigned int i = 0; i < batch->attribcount; i++)
+		return glstate->attribmask;
+	}
+	void VideoDriverOpenGL::drawElements(RenderBatch *batch,
+	                                     unsigned int instances)
+	{
+		GLenum indextype;
+		switch (batch->indextype)
 		{
-			if (batch->attribs[i].shaderhandle == -1)
-				continue;
-			glDisableVertexAttribArray(batch->attribs[i].shaderhandle);
+			case 1:
+				indextype = GL_UNSIGNED_BYTE;
+				break;
+			case 2:
+				indextype = GL_UNSIGNED_SHORT;
+				break;
+			case 4:
+				indextype = GL_UNSIGNED_INT;
+				break;
+			default:
+				return;
 		}
+		unsigned int indexcount = batch->endindex - batch->startindex;
+		state.drawElements(indexcount,
+		                   indextype,
+		                   batch->startindex * batch->indextype,
+		                   instances);
+	}
+	void VideoDriverOpenGL::countCalls()
+	{
+		getStats().increaseAPICallCount(state.getCallCount());
+		getStats().increaseSkippedUniformCount(state.getSkippedUniformCount());
+		state.resetCallCount();
 	}
 
 	void VideoDriverOpenGL::endFrame()
@@ -427,27 +519,59 @@ namespace opengl
 		// Unbind render target
 		if (currentfb)
 		{
-			generateMipmaps(currentfb);
-			glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+			for (unsigned int i = 0; i < currentmipmaps.size(); i++)
+				finishColorBuffer(currentfb->colorbuffers[i], currentmipmaps[i]);
+			currentmipmaps.clear();
+			state.bindFramebuffer(0);
 			currentfb = 0;
 		}
-		// TODO: Unbind buffers, textures, program
-		glUseProgram(0);
-		currentshader = 0;
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		currentvertices = 0;
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-		currentindices = 0;
+		// Unbind program and buffers, resources might be changed before the
+		// next frame so the shadowed state is discarded
+		state.reset();
+		countCalls();
 	}
 
-	void VideoDriverOpenGL::generateMipmaps(FrameBuffer::Configuration *fb)
+	void VideoDriverOpenGL::invalidateMipmaps(unsigned int texture)
+	{
+		TextureOpenGL &data = textures[texture];
+		if (!data.dirtymipmaps)
+		{
+			data.dirtymipmaps = true;
+			dirtymipmapcount++;
+		}
+	}
+	void VideoDriverOpenGL::removeTexture(unsigned int texture)
 	{
-		for (unsigned int i = 0; i < fb->colorbuffers.size(); i++)
+		TextureMap::iterator it = textures.find(texture);
+		if (it == textures.end())
+			return;
+		if (it->second.dirtymipmaps)
+			dirtymipmapcount--;
+		textures.erase(it);
+	}
+	void VideoDriverOpenGL::finishColorBuffer(unsigned int texture,
+	                                          MipmapPolicy::List mipmaps)
+	{
+		switch (mipmaps)
 		{
-			glBindTexture(GL_TEXTURE_2D, fb->colorbuffers[i]);
-			glGenerateMipmapEXT(GL_TEXTURE_2D);
+			case MipmapPolicy::Disabled:
+				break;
+			case MipmapPolicy::OnDemand:
+				invalidateMipmaps(texture);
+				break;
+			case MipmapPolicy::Interval:
+			{
+				state.generateMipmaps(0, GL_TEXTURE_2D, texture);
+				state.bindTexture(0, GL_TEXTURE_2D, 0);
+				TextureMap::iterator it = textures.find(texture);
+				if (it != textures.end() && it->second.dirtymipmaps)
+				{
+					it->second.dirtymipmaps = false;
+					dirtymipmapcount--;
+				}
+				break;
+			}
 		}
-		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 }
 }
@@ -24,7 +24,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "../VideoDriver.hpp"
 #include "RenderCapsOpenGL.hpp"
+#include "StateCacheOpenGL.hpp"
 #include "CoreRender/core/Log.hpp"
+#include "CoreRender/core/HashMap.hpp"
+#include "CoreRender/render/RenderTarget.hpp"
 
 namespace cr
 {
@@ -64,6 +67,13 @@ namespace opengl
 			                   float depth = 1.0f);
 
 			virtual void draw(RenderBatch *batch);
+			virtual void drawInstanced(RenderBatch *batch);
+			virtual void destroyPipelineState(PipelineState *pso);
+
+			virtual void *createFence();
+			virtual void waitForFence(void *fence);
+			virtual bool isFenceSignaled(void *fence);
+			virtual void deleteFence(void *fence);
 
 			virtual void endFrame();
 
@@ -75,19 +85,104 @@ namespace opengl
 			{
 				return caps;
 			}
+
+			/**
+			 * Returns the shadowed OpenGL state through which all draw calls
+			 * are made.
+			 */
+			StateCacheOpenGL &getStateCache()
+			{
+				return state;
+			}
+			/**
+			 * Marks the mipmaps of a texture as outdated. They are generated
+			 * before the texture is bound by the next batch.
+			 */
+			void invalidateMipmaps(unsigned int texture);
+			/**
+			 * Removes the driver data of a texture. Called when the texture
+			 * is deleted, as OpenGL reuses the texture name afterwards.
+			 */
+			void removeTexture(unsigned int texture);
 		private:
-			void generateMipmaps(FrameBuffer::Configuration *fb);
+			/**
+			 * Driver data of a texture, created when the texture is rendered
+			 * to for the first time.
+			 */
+			struct TextureOpenGL
+			{
+				TextureOpenGL()
+					: dirtymipmaps(false)
+				{
+				}
+
+				/**
+				 * True if the texture was rendered to with
+				 * MipmapPolicy::OnDemand and has not been bound since.
+				 */
+				bool dirtymipmaps;
+			};
+			typedef core::HashMap<unsigned int, TextureOpenGL> TextureMap;
+
+			/**
+			 * OpenGL version of a pipeline state object. The attribs are
+			 * translated to OpenGL types once and are stored in a vertex
+			 * array object if the implementation supports it.
+			 */
+			struct PipelineStateOpenGL
+			{
+				unsigned int vao;
+				StateCacheOpenGL::VertexArrayState vertexarray;
+
+				bool blend;
+				unsigned int blendsrc;
+				unsigned int blenddst;
+
+				struct Attrib
+				{
+					unsigned int index;
+					unsigned int components;
+					unsigned int type;
+					unsigned int stride;
+					unsigned int address;
+				};
+				Attrib attribs[StateCacheOpenGL::maxattribs];
+				unsigned int attribcount;
+				unsigned int attribmask;
+			};
+
+			PipelineStateOpenGL *getPipelineState(PipelineState *pso);
+			/**
+			 * Applies the mipmap policy of a color buffer after rendering to
+			 * it has finished.
+			 */
+			void finishColorBuffer(unsigned int texture,
+			                       MipmapPolicy::List mipmaps);
+			unsigned int applyBatchState(RenderBatch *batch);
+			void drawElements(RenderBatch *batch, unsigned int instances);
+			void countCalls();
 
 			RenderCapsOpenGL caps;
 
 			core::Log::Ptr log;
 
 			FrameBuffer::Configuration *currentfb;
-			unsigned int currentshader;
-			unsigned int currentvertices;
-			unsigned int currentindices;
-			
-			unsigned int currentBlendMode;
+			/**
+			 * Mipmap policies of the color buffers currently rendered to.
+			 */
+			std::vector<MipmapPolicy::List> currentmipmaps;
+			/**
+			 * Driver data of the textures by OpenGL texture name.
+			 */
+			TextureMap textures;
+			/**
+			 * Number of textures with outdated mipmaps, textures are only
+			 * looked up if this is not 0.
+			 */
+			unsigned int dirtymipmapcount;
+			StateCacheOpenGL state;
+
+			unsigned int instancebuffer;
 	};
 
 }
@@ -25,8 +25,21 @@ namespace cr
 {
 namespace res
 {
+	static void loadResource(Resource::Ptr res, core::Log::Ptr log)
+	{
+		if (!res->load())
+			log->error("Could not load resource \"%s\"", res->getName().c_str());
+		else
+			CR_LOG_DEBUG(log, "Loaded resource \"%s\"", res->getName().c_str());
+	}
+
+	void LoadingTask::run()
+	{
+		loadResource(res, log);
+	}
+
 	LoadingThread::LoadingThread(core::Log::Ptr log)
-		: stopping(false), log(log)
+		: log(log)
 	{
 	}
 	LoadingThread::~LoadingThread()
@@ -35,7 +48,6 @@ namespace res
 
 	bool LoadingThread::start()
 	{
-		stopping = false;
 		core::ClassFunctor<LoadingThread> *threadstart;
 		threadstart = new core::ClassFunctor<LoadingThread>(this,
 		                                                   &LoadingThread::entry);
@@ -43,7 +55,7 @@ namespace res
 	}
 	void LoadingThread::stop()
 	{
-		stopping = true;
+		// Wakes the thread up without queueing a resource
 		workavailable.post();
 		thread.wait();
 	}
@@ -63,19 +75,17 @@ namespace res
 		{
 			// Wait for loadable resources
 			workavailable.wait();
-			if (stopping)
-				break;
-			// Take one resource and load it
+			// Take one resource and load it, the queue is only empty once
+			// all resources have been loaded and stop() was called
 			Resource::Ptr res;
 			{
 				tbb::spin_mutex::scoped_lock lock(queuemutex);
+				if (loadingqueue.empty())
+					break;
 				res = loadingqueue.front();
 				loadingqueue.pop();
 			}
-			if (!res->load())
-				log->error("Could not load resource \"%s\"", res->getName().c_str());
-			else
-				log->info("Loaded resource \"%s\"", res->getName().c_str());
+			loadResource(res, log);
 		}
 	}
 }
@@ -28,7 +28,7 @@ namespace cr
 {
 namespace res
 {
-	Resource::Resource(ResourceManager *rmgr, const std::string &name)
+	Resource::Resource(ResourceManager *rmgr, core::Name name)
 		: loaded(false), loading(false), name(name), rmgr(rmgr)
 	{
 		rmgr->addResource(this);
@@ -38,7 +38,7 @@ namespace res
 		rmgr->removeResource(this);
 	}
 	
-	std::string Resource::getName()
+	core::Name Resource::getName()
 	{
 		return name;
 	}
@@ -37,16 +37,17 @@ namespace res
 {
 	ResourceManager::ResourceManager(core::FileSystem::Ptr fs,
 		core::Log::Ptr log)
-		: namecounter(0), fs(fs), log(log)
+		: namecounter(0), fs(fs), log(log), thread(0), scheduler(0)
 	{
-		// Start loading thread
-		thread = new LoadingThread(log);
-		thread->start();
 	}
 	ResourceManager::~ResourceManager()
 	{
-		thread->stop();
-		delete thread;
+		setTaskScheduler(0);
+		if (thread)
+		{
+			thread->stop();
+			delete thread;
+		}
 	}
 
 	bool ResourceManager::init()
@@ -95,12 +96,12 @@ namespace res
 
 	Resource::Ptr ResourceManager::getOrLoad(const std::string &type,
 	                                         const std::string &path,
-	                                         const std::string &name)
+	                                         core::Name name)
 	{
 		// TODO: This is not thread-safe!
 		// Get existing resource
 		Resource::Ptr existing;
-		if (name == "")
+		if (name.empty())
 			existing = getResource(path);
 		else
 			existing = getResource(name);
@@ -116,16 +117,16 @@ namespace res
 		if (!factory)
 			return 0;
 		Resource::Ptr created;
-		if (name == "")
+		if (name.empty())
 			created = factory->create(path);
 		else
-			created = factory->create(name);
+			created = factory->create(name.getString());
 		// Load resource
 		created->loadFromFile(path);
 		return created;
 	}
 	Resource::Ptr ResourceManager::getOrCreate(const std::string &type,
-	                                           const std::string &name)
+	                                           core::Name name)
 	{
 		// Get existing resource
 		Resource::Ptr existing = getResource(name);
@@ -140,15 +141,17 @@ namespace res
 		ResourceFactory::Ptr factory = getFactory(type);
 		if (!factory)
 			return 0;
-		Resource::Ptr created = factory->create(name);
+		Resource::Ptr created = factory->create(name.getString());
 		return created;
 	}
 	Resource::Ptr ResourceManager::createResource(const std::string &type,
-	                                              const std::string &name)
+	                                              core::Name name)
 	{
-		std::string resname = name;
-		if (resname == "")
+		std::string resname;
+		if (name.empty())
 			resname = getInternalName();
+		else
+			resname = name.getString();
 		// Create resource
 		ResourceFactory::Ptr factory = getFactory(type);
 		if (!factory)
@@ -177,7 +180,7 @@ namespace res
 		resources.erase(it);
 	}
 
-	Resource::Ptr ResourceManager::getResource(const std::string &name)
+	Resource::Ptr ResourceManager::getResource(core::Name name)
 	{
 		tbb::mutex::scoped_lock lock(mutex);
 		ResourceMap::iterator it = resources.find(name);
@@ -188,6 +191,18 @@ namespace res
 
 	void ResourceManager::queueForLoading(Resource::Ptr res)
 	{
+		if (scheduler)
+		{
+			scheduler->spawn(new LoadingTask(res, log), &loadinggroup);
+			return;
+		}
+		// The loading thread is only needed without a task scheduler
+		tbb::spin_mutex::scoped_lock lock(threadmutex);
+		if (!thread)
+		{
+			thread = new LoadingThread(log);
+			thread->start();
+		}
 		thread->queueForLoading(res);
 	}
 	void ResourceManager::prioritize(Resource::Ptr res)
@@ -195,6 +210,20 @@ namespace res
 		// TODO
 	}
 
+	void ResourceManager::setTaskScheduler(core::TaskScheduler *scheduler)
+	{
+		if (this->scheduler)
+			this->scheduler->wait(&loadinggroup);
+		// Resources queued before are loaded before the thread stops
+		if (scheduler && thread)
+		{
+			thread->stop();
+			delete thread;
+			thread = 0;
+		}
+		this->scheduler = scheduler;
+	}
+
 	std::string ResourceManager::getInternalName()
 	{
 		while (1)
@@ -202,9 +231,13 @@ namespace res
 			// Generate new name
 			char name[32];
 			snprintf(name, 32, "_internal_%u", ++namecounter);
-			// Test whether the name is available
+			// Test whether the name is available, names which were never
+			// interned cannot belong to a resource
+			core::Name existing;
+			if (!core::Name::find(name, existing))
+				return name;
 			tbb::mutex::scoped_lock lock(mutex);
-			ResourceMap::iterator it = resources.find(name);
+			ResourceMap::iterator it = resources.find(existing);
 			if (it == resources.end())
 				return name;
 			// TODO: _Theoretically_ this could be not thread-safe
@@ -0,0 +1,74 @@
+#include "CoreRender/core/HashMap.hpp"
+#include "CoreRender/core/Time.hpp"
+#include "CoreRender/render/UniformData.hpp"
+
+#include <iostream>
+#include <map>
+#include <tr1/unordered_map>
+
+using namespace cr;
+using namespace core;
+using namespace render;
+
+static const unsigned int iterations = 200000;
+
+/**
+ * Runs inserts, lookups and copies on a map with "size" uniforms, which
+ * is what UniformData does during Pipeline::submit().
+ */
+template<typename Map> static unsigned int benchmark(const char *name,
+                                                     unsigned int size)
+{
+	unsigned int found = 0;
+	Time start = Time::Now();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		Map map;
+		for (unsigned int j = 0; j < size; j++)
+			map.insert(std::make_pair(j * 7, Uniform(j * 7)));
+	}
+	Time inserted = Time::Now();
+	Map map;
+	for (unsigned int j = 0; j < size; j++)
+		map.insert(std::make_pair(j * 7, Uniform(j * 7)));
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (unsigned int j = 0; j < size; j++)
+		{
+			if (map.find(((i + j) % (size * 2)) * 7) != map.end())
+				found++;
+		}
+	}
+	Time lookedup = Time::Now();
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		Map copy(map);
+		found += copy.size();
+	}
+	Time copied = Time::Now();
+	std::cout << name << ", " << size << " entries: insert "
+		<< (inserted - start).getMicroseconds() * 1000 / (iterations * size)
+		<< " ns, lookup "
+		<< (lookedup - inserted).getMicroseconds() * 1000 / (iterations * size)
+		<< " ns, copy "
+		<< (copied - lookedup).getMicroseconds() * 1000 / iterations
+		<< " ns" << std::endl;
+	return found;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	unsigned int sizes[] = { 4, 8, 16, 64 };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		unsigned int size = sizes[i];
+		unsigned int a = benchmark<HashMap<unsigned int, Uniform, 8> >("HashMap", size);
+		unsigned int b = benchmark<std::tr1::unordered_map<unsigned int, Uniform> >("unordered_map", size);
+		unsigned int c = benchmark<std::map<unsigned int, Uniform> >("std::map", size);
+		if (a != b || a != c)
+			errors++;
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,146 @@
+#include "CoreRender/core/HashMap.hpp"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <cstdlib>
+
+using namespace cr;
+using namespace core;
+
+/**
+ * Value without default constructor and with an assignment operator which
+ * does not copy everything, like render::Uniform.
+ */
+class PartialValue
+{
+	public:
+		PartialValue(unsigned int key, unsigned int value)
+			: key(key), value(value)
+		{
+		}
+		PartialValue &operator=(const PartialValue &other)
+		{
+			value = other.value;
+			return *this;
+		}
+
+		unsigned int key;
+		unsigned int value;
+};
+
+template<typename Map> static unsigned int compare(const Map &map,
+                                                   const std::map<unsigned int, unsigned int> &reference)
+{
+	unsigned int errors = 0;
+	if (map.size() != reference.size())
+		errors++;
+	for (std::map<unsigned int, unsigned int>::const_iterator it = reference.begin();
+	     it != reference.end(); it++)
+	{
+		typename Map::const_iterator it2 = map.find(it->first);
+		if (it2 == map.end() || it2->second.value != it->second
+		 || it2->second.key != it->first)
+			errors++;
+	}
+	unsigned int iterated = 0;
+	for (typename Map::const_iterator it = map.begin(); it != map.end(); it++)
+		iterated++;
+	if (iterated != reference.size())
+		errors++;
+	return errors;
+}
+
+static unsigned int testRandom(unsigned int keyrange)
+{
+	typedef HashMap<unsigned int, PartialValue, 4> Map;
+	Map map;
+	std::map<unsigned int, unsigned int> reference;
+	unsigned int errors = 0;
+	srand(keyrange);
+	for (unsigned int i = 0; i < 20000; i++)
+	{
+		unsigned int key = rand() % keyrange;
+		if (rand() % 3 == 0)
+		{
+			unsigned int erased = map.erase(key);
+			if (erased != reference.erase(key))
+				errors++;
+		}
+		else
+		{
+			std::pair<Map::iterator, bool> inserted;
+			inserted = map.insert(std::make_pair(key, PartialValue(key, i)));
+			if (inserted.second)
+				reference[key] = i;
+			if (inserted.second != (reference[key] == i))
+				errors++;
+		}
+		// Copies of small and large maps
+		if (i % 1000 == 0)
+		{
+			Map copy(map);
+			errors += compare(copy, reference);
+			Map assigned;
+			assigned.insert(std::make_pair(1000000u, PartialValue(1000000, 0)));
+			assigned = map;
+			errors += compare(assigned, reference);
+		}
+	}
+	errors += compare(map, reference);
+	// Erasing everything while iterating
+	for (Map::iterator it = map.begin(); it != map.end();)
+		it = map.erase(it);
+	if (!map.empty() || map.find(0) != map.end())
+		errors++;
+	if (errors != 0)
+		std::cout << "Key range " << keyrange << ": " << errors << " errors." << std::endl;
+	return errors;
+}
+
+static unsigned int testStrings()
+{
+	HashMap<std::string, unsigned int> map;
+	unsigned int errors = 0;
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		std::ostringstream name;
+		name << "resource" << i;
+		map[name.str()] = i;
+	}
+	for (unsigned int i = 0; i < 1000; i += 2)
+	{
+		std::ostringstream name;
+		name << "resource" << i;
+		map.erase(name.str());
+	}
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		std::ostringstream name;
+		name << "resource" << i;
+		HashMap<std::string, unsigned int>::iterator it = map.find(name.str());
+		if ((it != map.end()) != (i % 2 == 1))
+			errors++;
+		else if (it != map.end() && it->second != i)
+			errors++;
+	}
+	if (map.size() != 500)
+		errors++;
+	map.clear();
+	if (map.size() != 0 || map.find("resource1") != map.end())
+		errors++;
+	if (errors != 0)
+		std::cout << "String keys: " << errors << " errors." << std::endl;
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	errors += testRandom(6);
+	errors += testRandom(64);
+	errors += testRandom(5000);
+	errors += testStrings();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
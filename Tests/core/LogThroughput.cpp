@@ -0,0 +1,105 @@
+#include "CoreRender/core/Log.hpp"
+#include "CoreRender/core/StandardFileSystem.hpp"
+#include "CoreRender/core/Thread.hpp"
+#include "CoreRender/core/Time.hpp"
+
+#include <iostream>
+
+using namespace cr;
+using namespace core;
+
+static const unsigned int messagesperthread = 20000;
+
+class LogThread
+{
+	public:
+		LogThread()
+			: index(0)
+		{
+		}
+
+		void run()
+		{
+			for (unsigned int i = 0; i < messagesperthread; i++)
+				log->info("Message %u from thread %u.", i, index);
+		}
+
+		Log::Ptr log;
+		unsigned int index;
+};
+
+static unsigned int evaluated = 0;
+static unsigned int evaluate()
+{
+	return ++evaluated;
+}
+
+static unsigned int countMessages(FileSystem::Ptr fs)
+{
+	File::Ptr file = fs->open("/LogThroughputTest.html", FileAccess::Read);
+	if (!file)
+		return 0;
+	std::string content = file->readAll();
+	unsigned int count = 0;
+	size_t position = 0;
+	while ((position = content.find("Message ", position)) != std::string::npos)
+	{
+		count++;
+		position++;
+	}
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	StandardFileSystem::Ptr fs = new StandardFileSystem();
+	fs->mount("", "/");
+	for (unsigned int threadcount = 1; threadcount <= 8; threadcount *= 2)
+	{
+		Log::Ptr log = new Log(fs, "/LogThroughputTest.html");
+		LogThread logthreads[8];
+		Thread threads[8];
+		Time start = Time::Now();
+		for (unsigned int i = 0; i < threadcount; i++)
+		{
+			logthreads[i].log = log;
+			logthreads[i].index = i;
+			threads[i].create(new ClassFunctor<LogThread>(&logthreads[i],
+			                                              &LogThread::run));
+		}
+		for (unsigned int i = 0; i < threadcount; i++)
+			threads[i].wait();
+		Time end = Time::Now();
+		log->flush();
+		Time written = Time::Now();
+		// Messages below the compiled log level must not even be evaluated
+		CR_LOG_DEBUG(log, "Debug message %u.", evaluate());
+		for (unsigned int i = 0; i < threadcount; i++)
+			logthreads[i].log = 0;
+		log = 0;
+		unsigned int count = countMessages(fs.get());
+		if (count != threadcount * messagesperthread)
+		{
+			std::cout << threadcount << " threads: " << count
+				<< " messages written (correct: "
+				<< threadcount * messagesperthread << ")" << std::endl;
+			errors++;
+		}
+		uint64_t messages = (uint64_t)messagesperthread * threadcount;
+		int64_t time = (end - start).getMicroseconds();
+		if (time == 0)
+			time = 1;
+		std::cout << threadcount << " threads: " << messages * 1000 / time
+			<< " messages/ms queued, " << (written - start).getMicroseconds() / 1000
+			<< " ms until written" << std::endl;
+	}
+	if (evaluated != (CORERENDER_LOG_LEVEL <= 0 ? 4 : 0))
+	{
+		std::cout << "Debug messages were evaluated " << evaluated
+			<< " times." << std::endl;
+		errors++;
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
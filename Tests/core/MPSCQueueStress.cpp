@@ -0,0 +1,130 @@
+#include "CoreRender/core/MPSCQueue.hpp"
+#include "CoreRender/core/Thread.hpp"
+#include "CoreRender/core/Time.hpp"
+
+#include <iostream>
+#include <vector>
+
+using namespace cr;
+using namespace core;
+
+static const unsigned int producercount = 16;
+static const unsigned int pushesperthread = 200000;
+
+struct Element
+{
+	unsigned int producer;
+	unsigned int index;
+};
+
+/**
+ * Loader thread which pushes numbered elements.
+ */
+class ProducerThread
+{
+	public:
+		ProducerThread()
+			: queue(0), producer(0)
+		{
+		}
+
+		void run()
+		{
+			for (unsigned int i = 0; i < pushesperthread; i++)
+			{
+				Element element = { producer, i };
+				queue->push(element);
+			}
+		}
+
+		MPSCQueue<Element> *queue;
+		unsigned int producer;
+};
+
+/**
+ * Render thread which drains the queue until all elements have arrived and
+ * checks that the elements of every producer arrive in order.
+ */
+class ConsumerThread
+{
+	public:
+		ConsumerThread()
+			: queue(0), received(0), drains(0), errors(0)
+		{
+			for (unsigned int i = 0; i < producercount; i++)
+				next[i] = 0;
+		}
+
+		void run()
+		{
+			std::vector<Element> elements;
+			while (received < producercount * pushesperthread && errors == 0)
+			{
+				if (queue->drain(elements) == 0)
+					continue;
+				drains++;
+				for (unsigned int i = 0; i < elements.size(); i++)
+				{
+					Element &element = elements[i];
+					if (element.producer >= producercount
+					 || element.index != next[element.producer])
+					{
+						errors++;
+						break;
+					}
+					next[element.producer]++;
+				}
+				received += elements.size();
+				elements.clear();
+			}
+		}
+
+		MPSCQueue<Element> *queue;
+		unsigned int next[producercount];
+		unsigned int received;
+		unsigned int drains;
+		unsigned int errors;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	MPSCQueue<Element> queue;
+	ConsumerThread consumer;
+	consumer.queue = &queue;
+	ProducerThread producers[producercount];
+	Thread threads[producercount + 1];
+	Time start = Time::Now();
+	threads[producercount].create(new ClassFunctor<ConsumerThread>(&consumer,
+	                                                              &ConsumerThread::run));
+	for (unsigned int i = 0; i < producercount; i++)
+	{
+		producers[i].queue = &queue;
+		producers[i].producer = i;
+		threads[i].create(new ClassFunctor<ProducerThread>(&producers[i],
+		                                                   &ProducerThread::run));
+	}
+	for (unsigned int i = 0; i < producercount + 1; i++)
+		threads[i].wait();
+	Time end = Time::Now();
+	if (consumer.errors != 0)
+	{
+		std::cout << "Elements arrived out of order." << std::endl;
+		errors++;
+	}
+	if (consumer.received != producercount * pushesperthread
+	 || !queue.empty())
+	{
+		std::cout << "Received " << consumer.received << " elements (correct: "
+			<< producercount * pushesperthread << ")." << std::endl;
+		errors++;
+	}
+	int64_t time = (end - start).getMicroseconds();
+	if (time == 0)
+		time = 1;
+	std::cout << producercount << " threads: "
+		<< (uint64_t)consumer.received * 1000 / time << " pushes/ms, "
+		<< consumer.drains << " drains" << std::endl;
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
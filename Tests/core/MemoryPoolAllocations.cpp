@@ -0,0 +1,116 @@
+#include "CoreRender/core/MemoryPool.hpp"
+
+#include <iostream>
+#include <cstring>
+
+using namespace cr;
+using namespace core;
+
+static unsigned int checkPages(const char *name,
+                               MemoryPool &memory,
+                               unsigned int pages,
+                               unsigned int mapcalls)
+{
+	const MemoryPool::Statistics &stats = memory.getStatistics();
+	if (stats.mappedpages == pages && stats.mapcalls == mapcalls)
+		return 0;
+	std::cout << name << ": " << stats.mappedpages << " pages, "
+		<< stats.mapcalls << " map calls (correct: " << pages << " pages, "
+		<< mapcalls << " map calls)" << std::endl;
+	return 1;
+}
+
+/**
+ * Allocates the given number of pages.
+ */
+static void fillPages(MemoryPool &memory, unsigned int pages)
+{
+	unsigned int size = memory.getPageSize() / 4;
+	for (unsigned int i = 0; i < pages * 4; i++)
+		memset(memory.allocate(size, 4096), 0, size);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	MemoryPool memory(65536);
+	// Alignment
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		unsigned int alignment = 1 << (i % 8);
+		char *data = (char*)memory.allocate(1 + i % 37, alignment);
+		if ((size_t)data % alignment != 0)
+		{
+			std::cout << "Allocation " << i << " is not aligned to "
+				<< alignment << " bytes." << std::endl;
+			errors++;
+			break;
+		}
+		char *standard = (char*)memory.allocate(3);
+		if ((size_t)standard % MemoryPool::defaultalignment != 0)
+		{
+			std::cout << "Allocation " << i << " has no default alignment."
+				<< std::endl;
+			errors++;
+			break;
+		}
+	}
+	memory.reset();
+	// Allocations larger than a page
+	char *large[3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		large[i] = (char*)memory.allocate(200000);
+		memset(large[i], i + 1, 200000);
+	}
+	char *small = (char*)memory.allocate(100);
+	memset(small, 0xFF, 100);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (large[i][0] != (char)(i + 1) || large[i][199999] != (char)(i + 1))
+		{
+			std::cout << "Large allocation " << i << " was overwritten."
+				<< std::endl;
+			errors++;
+		}
+	}
+	memory.reset();
+	if (memory.getStatistics().usedbytes < 600000)
+	{
+		std::cout << "Large allocations were not counted: "
+			<< memory.getStatistics().usedbytes << " bytes." << std::endl;
+		errors++;
+	}
+	// Pages are kept while the usage is high
+	fillPages(memory, 8);
+	memory.reset();
+	errors += checkPages("First large frame", memory, 8, 7);
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		fillPages(memory, 8);
+		memory.reset();
+	}
+	errors += checkPages("Constant usage", memory, 8, 0);
+	// Pages are only released after the usage has been lower for a while
+	for (unsigned int i = 0; i < MemoryPool::retainframes - 1; i++)
+	{
+		fillPages(memory, i % 2 == 0 ? 2 : 4);
+		memory.reset();
+	}
+	errors += checkPages("Lower usage", memory, 8, 0);
+	fillPages(memory, 2);
+	memory.reset();
+	errors += checkPages("Released pages", memory, 4, 0);
+	if (memory.getStatistics().peakbytes < 8 * memory.getPageSize())
+	{
+		std::cout << "Peak usage: " << memory.getStatistics().peakbytes
+			<< " bytes." << std::endl;
+		errors++;
+	}
+	// Huge pages fall back to normal pages if there are none
+	MemoryPool hugememory(1048576, true);
+	memset(hugememory.allocate(1000000), 0, 1000000);
+	hugememory.reset();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,81 @@
+#include "CoreRender/core/MemoryPool.hpp"
+#include "CoreRender/core/Thread.hpp"
+#include "CoreRender/core/Time.hpp"
+
+#include <iostream>
+
+using namespace cr;
+using namespace core;
+
+/**
+ * Allocation pattern similar to what Pipeline::submit() does for a single
+ * batch (batch, attribs, uniforms, uniform data, textures).
+ */
+static const unsigned int allocsizes[] = { 64, 96, 80, 64, 64, 64, 48 };
+static const unsigned int allocsizecount = 7;
+static const unsigned int allocsperthread = 1000000;
+static const unsigned int framecount = 5;
+
+class AllocThread
+{
+	public:
+		AllocThread()
+			: memory(0), errors(0)
+		{
+		}
+
+		void run()
+		{
+			for (unsigned int i = 0; i < allocsperthread; i++)
+			{
+				unsigned int size = allocsizes[i % allocsizecount];
+				char *data = (char*)memory->allocate(size);
+				if (!data)
+				{
+					errors++;
+					return;
+				}
+				// Touch the memory so that page faults are included
+				data[0] = 0;
+			}
+		}
+
+		MemoryPool *memory;
+		unsigned int errors;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	MemoryPool memory;
+	for (unsigned int threadcount = 1; threadcount <= 16; threadcount *= 2)
+	{
+		AllocThread allocthreads[16];
+		Thread threads[16];
+		Time start = Time::Now();
+		for (unsigned int frame = 0; frame < framecount; frame++)
+		{
+			for (unsigned int i = 0; i < threadcount; i++)
+			{
+				allocthreads[i].memory = &memory;
+				threads[i].create(new ClassFunctor<AllocThread>(&allocthreads[i],
+				                                                &AllocThread::run));
+			}
+			for (unsigned int i = 0; i < threadcount; i++)
+				threads[i].wait();
+			memory.reset();
+		}
+		Time end = Time::Now();
+		for (unsigned int i = 0; i < threadcount; i++)
+			errors += allocthreads[i].errors;
+		// Print allocation throughput
+		uint64_t allocs = (uint64_t)allocsperthread * threadcount * framecount;
+		int64_t time = (end - start).getMicroseconds();
+		if (time == 0)
+			time = 1;
+		std::cout << threadcount << " threads: " << allocs * 1000 / time
+			<< " allocations/ms (" << time / 1000 << " ms)" << std::endl;
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,93 @@
+#include "CoreRender/core/Name.hpp"
+#include "CoreRender/core/Thread.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace cr;
+using namespace core;
+
+static const unsigned int namecount = 10000;
+
+/**
+ * Interns the same set of strings as all other threads, but in a different
+ * order.
+ */
+class InternThread
+{
+	public:
+		InternThread()
+			: offset(0)
+		{
+		}
+
+		void run()
+		{
+			names.resize(namecount);
+			for (unsigned int i = 0; i < namecount; i++)
+			{
+				unsigned int index = (i + offset) % namecount;
+				std::ostringstream name;
+				name << "node" << index;
+				names[index] = Name(name.str());
+			}
+		}
+
+		unsigned int offset;
+		std::vector<Name> names;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	// Empty names
+	if (!Name().empty() || !Name("").empty() || Name("a").empty()
+	 || Name().getString() != "")
+	{
+		std::cout << "Empty names are broken." << std::endl;
+		errors++;
+	}
+	// Concurrent interning has to produce one ID per string
+	InternThread internthreads[8];
+	Thread threads[8];
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		internthreads[i].offset = i * namecount / 8;
+		threads[i].create(new ClassFunctor<InternThread>(&internthreads[i],
+		                                                 &InternThread::run));
+	}
+	for (unsigned int i = 0; i < 8; i++)
+		threads[i].wait();
+	unsigned int wrong = 0;
+	for (unsigned int i = 0; i < namecount; i++)
+	{
+		Name name = internthreads[0].names[i];
+		std::ostringstream string;
+		string << "node" << i;
+		if (name.getString() != string.str())
+			wrong++;
+		for (unsigned int j = 1; j < 8; j++)
+		{
+			if (internthreads[j].names[i] != name)
+				wrong++;
+		}
+		if (i > 0 && name == internthreads[0].names[i - 1])
+			wrong++;
+	}
+	if (wrong != 0)
+	{
+		std::cout << wrong << " names were interned incorrectly." << std::endl;
+		errors++;
+	}
+	// Lookup without interning
+	Name found;
+	if (!Name::find("node5", found) || found != internthreads[0].names[5]
+	 || Name::find("notinterned", found))
+	{
+		std::cout << "Name::find() failed." << std::endl;
+		errors++;
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,143 @@
+#include "CoreRender/core/TaskScheduler.hpp"
+
+#include <iostream>
+#include <vector>
+
+using namespace cr;
+using namespace core;
+
+static tbb::atomic<unsigned int> counter;
+
+class CountTask : public Task
+{
+	public:
+		CountTask()
+			: Task(true)
+		{
+		}
+
+		virtual void run()
+		{
+			counter++;
+		}
+};
+
+/**
+ * Task which records the order in which the tasks of a graph are executed.
+ */
+class OrderTask : public Task
+{
+	public:
+		OrderTask()
+			: order(0)
+		{
+		}
+
+		virtual void run()
+		{
+			order = ++counter;
+		}
+
+		unsigned int order;
+};
+
+/**
+ * Computes a Fibonacci number by recursively spawning tasks and waiting for
+ * them, which only works if wait() executes other tasks.
+ */
+class FibonacciTask : public Task
+{
+	public:
+		FibonacciTask(TaskScheduler *scheduler, unsigned int n)
+			: scheduler(scheduler), n(n), result(0)
+		{
+		}
+
+		virtual void run()
+		{
+			if (n < 2)
+			{
+				result = n;
+				return;
+			}
+			FibonacciTask a(scheduler, n - 1);
+			FibonacciTask b(scheduler, n - 2);
+			TaskGroup group;
+			scheduler->spawn(&a, &group);
+			scheduler->spawn(&b, &group);
+			scheduler->wait(&group);
+			result = a.result + b.result;
+		}
+
+		TaskScheduler *scheduler;
+		unsigned int n;
+		unsigned int result;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	TaskScheduler scheduler;
+	if (!scheduler.start(4))
+	{
+		std::cout << "Could not start the task scheduler." << std::endl;
+		return 1;
+	}
+	// Independent tasks
+	counter = 0;
+	TaskGroup group;
+	for (unsigned int i = 0; i < 10000; i++)
+		scheduler.spawn(new CountTask, &group);
+	scheduler.wait(&group);
+	if (counter != 10000)
+	{
+		std::cout << "Independent tasks: " << counter
+			<< " executed (correct: 10000)" << std::endl;
+		errors++;
+	}
+	// Chain of 50 tasks, all other 50 tasks wait for the last one, the
+	// graph is executed twice
+	std::vector<OrderTask> tasks(100);
+	for (unsigned int i = 1; i < 50; i++)
+		tasks[i].addDependency(&tasks[i - 1]);
+	for (unsigned int i = 50; i < 100; i++)
+		tasks[i].addDependency(&tasks[49]);
+	for (unsigned int run = 0; run < 2; run++)
+	{
+		counter = 0;
+		// Spawn in reverse order so that the dependencies matter
+		for (unsigned int i = 100; i > 0; i--)
+			scheduler.spawn(&tasks[i - 1], &group);
+		scheduler.wait(&group);
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < 50; i++)
+		{
+			if (tasks[i].order != i + 1)
+				wrong++;
+		}
+		for (unsigned int i = 50; i < 100; i++)
+		{
+			if (tasks[i].order <= 50)
+				wrong++;
+		}
+		if (counter != 100 || wrong != 0)
+		{
+			std::cout << "Run " << run << ": " << counter << " tasks, "
+				<< wrong << " in the wrong order." << std::endl;
+			errors++;
+		}
+	}
+	// Nested tasks waiting for their children
+	FibonacciTask fibonacci(&scheduler, 20);
+	scheduler.spawn(&fibonacci, &group);
+	scheduler.wait(&group);
+	if (fibonacci.result != 6765)
+	{
+		std::cout << "Nested tasks: " << fibonacci.result
+			<< " (correct: 6765)" << std::endl;
+		errors++;
+	}
+	scheduler.stop();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
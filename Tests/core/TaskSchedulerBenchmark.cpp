@@ -0,0 +1,99 @@
+#include "CoreRender/core/TaskScheduler.hpp"
+#include "CoreRender/core/Time.hpp"
+
+#include <iostream>
+#include <cmath>
+
+using namespace cr;
+using namespace core;
+
+static const unsigned int itemcount = 1 << 16;
+static const unsigned int itemsize = 2000;
+/**
+ * Ranges with less items are not split any further.
+ */
+static const unsigned int grainsize = 64;
+
+static float results[itemcount];
+
+/**
+ * Splits the range recursively so that idle workers have to steal the
+ * larger halves, similar to what culling or animating many objects would do.
+ */
+class RangeTask : public Task
+{
+	public:
+		RangeTask(TaskScheduler *scheduler, unsigned int begin, unsigned int end)
+			: Task(true), scheduler(scheduler), begin(begin), end(end)
+		{
+		}
+
+		virtual void run()
+		{
+			if (end - begin > grainsize)
+			{
+				unsigned int middle = (begin + end) / 2;
+				TaskGroup group;
+				scheduler->spawn(new RangeTask(scheduler, begin, middle), &group);
+				scheduler->spawn(new RangeTask(scheduler, middle, end), &group);
+				scheduler->wait(&group);
+				return;
+			}
+			for (unsigned int i = begin; i < end; i++)
+			{
+				float value = (float)i;
+				for (unsigned int j = 0; j < itemsize; j++)
+					value = std::sin(value) + 1.0f;
+				results[i] = value;
+			}
+		}
+	private:
+		TaskScheduler *scheduler;
+		unsigned int begin;
+		unsigned int end;
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	unsigned int processors = TaskScheduler::getProcessorCount();
+	int64_t singletime = 0;
+	for (unsigned int threads = 1; threads <= processors; threads++)
+	{
+		TaskScheduler scheduler;
+		// The main thread helps while waiting, so one worker less is needed.
+		// With a single thread, no worker is started and the main thread
+		// executes all tasks in wait().
+		if (threads > 1 && !scheduler.start(threads - 1))
+		{
+			std::cout << "Could not start " << threads << " threads." << std::endl;
+			errors++;
+			break;
+		}
+		for (unsigned int i = 0; i < itemcount; i++)
+			results[i] = 0.0f;
+		Time start = Time::Now();
+		TaskGroup group;
+		scheduler.spawn(new RangeTask(&scheduler, 0, itemcount), &group);
+		scheduler.wait(&group);
+		Time end = Time::Now();
+		scheduler.stop();
+		for (unsigned int i = 0; i < itemcount; i++)
+		{
+			if (results[i] == 0.0f)
+			{
+				errors++;
+				break;
+			}
+		}
+		int64_t time = (end - start).getMicroseconds();
+		if (time == 0)
+			time = 1;
+		if (threads == 1)
+			singletime = time;
+		std::cout << threads << " threads: " << time / 1000 << " ms, speedup "
+			<< (float)singletime / time << std::endl;
+	}
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,74 @@
+#include "CoreRender.hpp"
+
+#include <iostream>
+
+using namespace cr;
+using namespace render;
+
+static unsigned int checkDeletions(const char *name,
+                                   const RenderStats &stats,
+                                   unsigned int deletions,
+                                   unsigned int pending,
+                                   unsigned int pendingbytes)
+{
+	if (stats.getDeletionCount() == deletions
+	 && stats.getPendingDeletionCount() == pending
+	 && stats.getPendingDeletionBytes() == pendingbytes)
+		return 0;
+	std::cout << name << ": " << stats.getDeletionCount() << " deletions, "
+		<< stats.getPendingDeletionCount() << " pending, "
+		<< stats.getPendingDeletionBytes() << " bytes (correct: "
+		<< deletions << " deletions, " << pending << " pending, "
+		<< pendingbytes << " bytes)" << std::endl;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		// Five textures with 1024 bytes each
+		Texture2D::Ptr textures[5];
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			textures[i] = rmgr->createResource<Texture2D>("Texture2D");
+			textures[i]->set(16, 16, TextureFormat::RGBA8);
+		}
+		graphics.beginFrame();
+		graphics.endFrame();
+		graphics.setDeletionBudget(2);
+		// Released while the next frame is built, so the textures must not
+		// be destroyed before that frame has been completed
+		graphics.beginFrame();
+		for (unsigned int i = 0; i < 5; i++)
+			textures[i] = 0;
+		graphics.endFrame();
+		// The statistics always belong to the previous frame
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkDeletions("Budget", graphics.getRenderStats(),
+		                         2, 3, 3 * 1024);
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkDeletions("Budget 2", graphics.getRenderStats(),
+		                         2, 1, 1024);
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkDeletions("Last deletion", graphics.getRenderStats(),
+		                         1, 0, 0);
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkDeletions("Nothing pending", graphics.getRenderStats(),
+		                         0, 0, 0);
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,136 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+#include <sstream>
+
+/**
+ * Creates a model with one triangle mesh per child node of the root node.
+ * The nodes are placed along the negative z axis.
+ */
+static Model::Ptr createTestModel(res::ResourceManager *rmgr,
+                                  const RenderJob &triangle,
+                                  unsigned int meshcount)
+{
+	Model::Ptr model = rmgr->createResource<Model>("Model");
+	model->setVertexBuffer(triangle.vertices);
+	model->setIndexBuffer(triangle.indices);
+	Model::Batch batch;
+	batch.layout = triangle.layout;
+	batch.indextype = 2;
+	batch.startindex = 0;
+	batch.indexcount = 3;
+	batch.basevertex = 0;
+	batch.vertexoffset = 0;
+	batch.vertexcount = 3;
+	model->addBatch(batch);
+	Model::Node *root = model->addNode("root", 0);
+	root->setTransformation(math::Matrix4::Identity());
+	for (unsigned int i = 0; i < meshcount; i++)
+	{
+		std::ostringstream nodename;
+		nodename << "node" << i;
+		Model::Node *node = model->addNode(nodename.str(), root);
+		node->setTransformation(math::Matrix4::TransMat(
+			math::Vector3F(0, 0, -(float)i)));
+		Model::Mesh mesh;
+		mesh.batch = 0;
+		mesh.material = triangle.material;
+		mesh.node = node;
+		model->addMesh(mesh);
+	}
+	return model;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		// Create resources
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addUniform("color", ShaderVariableType::Float4);
+		text->addUniform("worldMat", ShaderVariableType::Float4x4);
+		text->addUniform("worldNormalMat", ShaderVariableType::Float4x4);
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		float color[4] = { 1, 0, 0, 1 };
+		material->getUniformData().add("color").set(ShaderVariableType::Float4,
+		                                            color);
+		RenderJob job = createTriangleJob(rmgr, material);
+		job.uniforms.add("worldMat") = math::Matrix4::Identity();
+		TestRenderable renderable(job, 100);
+		renderable.spreadDepth();
+		ModelRenderable model;
+		model.setModel(createTestModel(rmgr, job, 10));
+		model.setViewMat(math::Matrix4::Identity());
+		// Create pipeline
+		Pipeline::Ptr pipeline = new Pipeline();
+		RenderPass::Ptr pass = new RenderPass("AMBIENT");
+		pipeline->addPass(pass);
+		graphics.addPipeline(pipeline);
+		// The first frames create shaders and upload resources. All resources
+		// are created in memory, so nothing is left for the resource loading
+		// thread, and the frames are rendered synchronously in endFrame(). The
+		// warmup is done once a frame has drawn all batches without any
+		// pending uploads.
+		const RenderStats &stats = graphics.getRenderStats();
+		unsigned int warmupframes = 0;
+		while (stats.getBatchCount() != 110 || stats.getQueuedUploadCount() != 0)
+		{
+			if (warmupframes == 10)
+			{
+				std::cout << "Warmup not finished after 10 frames (batch count: "
+					<< stats.getBatchCount() << ", queued uploads: "
+					<< stats.getQueuedUploadCount() << ")." << std::endl;
+				errors++;
+				break;
+			}
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			pipeline->submit(&model);
+			graphics.endFrame();
+			warmupframes++;
+		}
+		// The messages logged during the warmup are formatted by the log
+		// thread, which must not happen while allocations are counted
+		graphics.getLog()->flush();
+		// Starting with the first steady-state frame there must not be any heap
+		// allocations
+		unsigned int allocations = core::AllocationCounter::getCount();
+		for (unsigned int i = 0; i < 10; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			pipeline->submit(&model);
+			graphics.endFrame();
+		}
+		allocations = core::AllocationCounter::getCount() - allocations;
+		if (!core::AllocationCounter::isEnabled())
+		{
+			std::cout << "Allocation counting disabled." << std::endl;
+			errors++;
+		}
+		else if (allocations != 0)
+		{
+			std::cout << allocations << " heap allocations in 10 frames."
+				<< std::endl;
+			errors++;
+		}
+		if (stats.getBatchCount() != 110)
+		{
+			std::cout << "Batch count: " << stats.getBatchCount()
+				<< " (correct: 110)" << std::endl;
+			errors++;
+		}
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,242 @@
+#include "TestScene.hpp"
+#include "render/CommandStream.hpp"
+
+#include <iostream>
+
+/**
+ * Returns the offset of the first command of a type in the command stream of
+ * a pass within the capture file data, or 0 if there is no such command.
+ */
+static unsigned int findCommand(const std::vector<char> &data,
+                                unsigned int pass,
+                                RenderCommand::List type)
+{
+	const FrameCaptureFile::Header *header = (const FrameCaptureFile::Header*)&data[0];
+	unsigned int offset = sizeof(*header)
+	                    + header->resourcecount * sizeof(FrameCaptureFile::Resource);
+	for (unsigned int i = 0; i < header->pipelinestatecount; i++)
+	{
+		const FrameCaptureFile::PipelineState *state;
+		state = (const FrameCaptureFile::PipelineState*)&data[offset];
+		offset += sizeof(*state) + state->attribcount * sizeof(AttribMapping);
+	}
+	for (unsigned int i = 0; i < header->passcount; i++)
+	{
+		const FrameCaptureFile::Pass *info = (const FrameCaptureFile::Pass*)&data[offset];
+		offset += sizeof(*info);
+		unsigned int end = offset + info->commandsize;
+		while (i == pass && offset < end)
+		{
+			const CommandHeader *command = (const CommandHeader*)&data[offset];
+			if (command->type == (unsigned int)type)
+				return offset;
+			if (command->type == RenderCommand::End)
+				return 0;
+			offset += command->size;
+		}
+		offset = end;
+	}
+	return 0;
+}
+
+/**
+ * Writes capture file data to a file and tries to load it.
+ */
+static bool loadCapture(core::FileSystem::Ptr fs, const std::vector<char> &data)
+{
+	const char *path = "/FrameCaptureCorrupted.crf";
+	core::File::Ptr file = fs->open(path, core::FileAccess::Write, true);
+	if (!file || file->write(data.size(), &data[0]) != (int)data.size())
+		return false;
+	file = fs->open(path, core::FileAccess::Read);
+	FrameCapture::Ptr capture = new FrameCapture();
+	return file && capture->load(file);
+}
+
+/**
+ * Checks that captures with invalid command streams or counts are rejected.
+ */
+static unsigned int testCorruptedCaptures(core::FileSystem::Ptr fs, const char *path)
+{
+	unsigned int errors = 0;
+	std::vector<char> original;
+	core::File::Ptr file = fs->open(path, core::FileAccess::Read);
+	if (file)
+	{
+		original.resize(file->getSize());
+		if (!original.empty()
+		 && file->read(original.size(), &original[0]) != (int)original.size())
+			original.clear();
+	}
+	if (original.empty() || !loadCapture(fs, original))
+	{
+		std::cout << "Could not reload the capture." << std::endl;
+		return 1;
+	}
+	// The first pass draws instanced, the second one only uses normal draw
+	// calls
+	unsigned int state = findCommand(original, 1, RenderCommand::PipelineState);
+	unsigned int uniforms = findCommand(original, 1, RenderCommand::Uniforms);
+	unsigned int draw = findCommand(original, 1, RenderCommand::Draw);
+	unsigned int instanced = findCommand(original, 0, RenderCommand::DrawInstanced);
+	if (!state || !uniforms || !draw || !instanced)
+	{
+		std::cout << "Could not find the commands to corrupt." << std::endl;
+		return 1;
+	}
+	const char *names[] = {
+		"jump",
+		"unknown command",
+		"uniform index",
+		"uniform count",
+		"texture count",
+		"instance count",
+		"attrib count"
+	};
+	for (unsigned int i = 0; i < 7; i++)
+	{
+		std::vector<char> data = original;
+		switch (i)
+		{
+			case 0:
+				// The pipeline state command is large enough for a pointer
+				((CommandHeader*)&data[state])->type = RenderCommand::Jump;
+				break;
+			case 1:
+				((CommandHeader*)&data[state])->type = RenderCommand::End + 1;
+				break;
+			case 2:
+			{
+				UniformsCommand *command = (UniformsCommand*)&data[uniforms + sizeof(CommandHeader)];
+				((UniformEntry*)(command + 1))->index = command->count;
+				break;
+			}
+			case 3:
+				((UniformsCommand*)&data[uniforms + sizeof(CommandHeader)])->count++;
+				break;
+			case 4:
+				// The draw command is too small for a single texture entry
+				((CommandHeader*)&data[draw])->type = RenderCommand::Textures;
+				((ArrayCommand*)&data[draw + sizeof(CommandHeader)])->count = 1000;
+				break;
+			case 5:
+				((DrawInstancedCommand*)&data[instanced + sizeof(CommandHeader)])->instancecount++;
+				break;
+			case 6:
+			{
+				const FrameCaptureFile::Header *header = (const FrameCaptureFile::Header*)&data[0];
+				unsigned int offset = sizeof(*header)
+				                    + header->resourcecount * sizeof(FrameCaptureFile::Resource);
+				((FrameCaptureFile::PipelineState*)&data[offset])->attribcount = 0x10000000;
+				break;
+			}
+		}
+		if (loadCapture(fs, data))
+		{
+			std::cout << "Capture with invalid " << names[i] << " was loaded."
+				<< std::endl;
+			errors++;
+		}
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("INSTANCED", "VS", "FS", "", "", BlendMode::Solid,
+		                 "worldMat");
+		text->addContext("PLAIN", "VS", "FS");
+		text->addUniform("worldMat", ShaderVariableType::Float4x4);
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		TestRenderable renderable(createTriangleJob(rmgr, material), 100);
+		renderable.translateJobs();
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("INSTANCED"));
+		pipeline->addPass(new RenderPass("PLAIN"));
+		graphics.addPipeline(pipeline);
+		// Capture the second frame as the first one only uploads resources
+		const char *path = "/FrameCaptureTest.crf";
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			if (i == 1)
+				graphics.captureFrame(path);
+			graphics.endFrame();
+		}
+		unsigned int batches = graphics.getRenderStats().getBatchCount();
+		// Load the capture again
+		core::File::Ptr file = graphics.getFileSystem()->open(path,
+		                                                      core::FileAccess::Read);
+		FrameCapture::Ptr capture = new FrameCapture();
+		if (!file || !capture->load(file))
+		{
+			std::cout << "Could not load the capture." << std::endl;
+			errors++;
+		}
+		else
+		{
+			file = 0;
+			if (capture->getPassCount() != 2)
+			{
+				std::cout << "Pass count: " << capture->getPassCount()
+					<< " (correct: 2)" << std::endl;
+				errors++;
+			}
+			else
+			{
+				// One instanced draw call plus 100 normal ones
+				if (capture->getPass(0).batchcount != 1
+				 || capture->getPass(1).batchcount != 100)
+				{
+					std::cout << "Batch counts: " << capture->getPass(0).batchcount
+						<< "/" << capture->getPass(1).batchcount
+						<< " (correct: 1/100)" << std::endl;
+					errors++;
+				}
+			}
+			// Two shaders, vertex buffer and index buffer
+			if (capture->getResourceCount() != 4)
+			{
+				std::cout << "Resource count: " << capture->getResourceCount()
+					<< " (correct: 4)" << std::endl;
+				errors++;
+			}
+			// Replaying has to produce the same draw calls
+			std::vector<core::Duration> passtimes;
+			if (!graphics.replayFrame(capture, &passtimes))
+			{
+				std::cout << "Replay failed." << std::endl;
+				errors++;
+			}
+			if (passtimes.size() != capture->getPassCount())
+			{
+				std::cout << "Pass times: " << passtimes.size() << " (correct: "
+					<< capture->getPassCount() << ")" << std::endl;
+				errors++;
+			}
+			if (graphics.getRenderStats().getBatchCount() != batches)
+			{
+				std::cout << "Replayed batch count: "
+					<< graphics.getRenderStats().getBatchCount()
+					<< " (correct: " << batches << ")" << std::endl;
+				errors++;
+			}
+		}
+		errors += testCorruptedCaptures(graphics.getFileSystem(), path);
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
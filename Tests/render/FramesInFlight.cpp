@@ -0,0 +1,73 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static unsigned int runFrames(unsigned int framesinflight)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, true,
+	                   framesinflight))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		RenderJob job = createTriangleJob(rmgr, material);
+		TestRenderable submitted(job, 100);
+		TestRenderable retained(job, 50);
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		graphics.addPipeline(pipeline);
+		unsigned int handle = pipeline->registerRenderable(&retained);
+		int64_t waittime = 0;
+		int64_t submitwaittime = 0;
+		const unsigned int framecount = 200;
+		for (unsigned int i = 0; i < framecount; i++)
+		{
+			// Every frame uses buffers which are released directly afterwards
+			// while the frame is still queued
+			TestRenderable single(createTriangleJob(rmgr, material));
+			graphics.beginFrame();
+			pipeline->submit(&submitted);
+			pipeline->submit(&single);
+			// Replaces the retained batches of the queued frames
+			pipeline->updateRenderable(handle);
+			graphics.endFrame();
+			// The statistics lag behind by up to framesinflight frames
+			if (i < 10)
+				continue;
+			const RenderStats &stats = graphics.getRenderStats();
+			if (stats.getBatchCount() != 151)
+			{
+				std::cout << framesinflight << " frames in flight: Batch count: "
+					<< stats.getBatchCount() << " (correct: 151)" << std::endl;
+				errors++;
+			}
+			waittime += stats.getWaitTime().getNanoseconds();
+			submitwaittime += stats.getSubmitWaitTime().getNanoseconds();
+		}
+		std::cout << framesinflight << " frames in flight: render thread wait "
+			<< waittime / (framecount - 10) << " ns/frame, "
+			<< "main thread wait "
+			<< submitwaittime / (framecount - 10)
+			<< " ns/frame" << std::endl;
+		pipeline->unregisterRenderable(handle);
+	}
+	graphics.shutdown();
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	for (unsigned int framesinflight = 1; framesinflight <= 4; framesinflight++)
+		errors += runFrames(framesinflight);
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
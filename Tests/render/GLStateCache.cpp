@@ -0,0 +1,604 @@
+#include "CoreRender.hpp"
+#include "render/opengl/VideoDriverOpenGL.hpp"
+#include "render/FrameData.hpp"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace cr;
+using namespace render;
+
+/**
+ * Minimal emulation of the OpenGL state which is changed by the stubs below.
+ */
+struct GLState
+{
+	GLState()
+		: calls(0), pointercalls(0), program(0), arraybuffer(0),
+		vertexarray(0), nextvertexarray(1), activetexture(0), blend(false),
+		framebuffer(0), framebufferbinds(0), attachments(0), drawbuffers(0),
+		validations(0), draws(0), errors(0)
+	{
+		for (unsigned int i = 0; i < 32; i++)
+			textures[i] = 0;
+		vertexarrays[0] = VertexArray();
+	}
+
+	unsigned int calls;
+	unsigned int pointercalls;
+	GLuint program;
+	GLuint arraybuffer;
+	struct Attrib
+	{
+		bool enabled;
+		GLuint buffer;
+		GLint size;
+		GLenum type;
+		GLsizei stride;
+		uintptr_t offset;
+		GLuint divisor;
+	};
+	struct VertexArray
+	{
+		VertexArray()
+			: elementbuffer(0)
+		{
+			for (unsigned int i = 0; i < 32; i++)
+			{
+				attribs[i].enabled = false;
+				attribs[i].buffer = 0;
+				attribs[i].size = 0;
+				attribs[i].type = 0;
+				attribs[i].stride = 0;
+				attribs[i].offset = 0;
+				attribs[i].divisor = 0;
+			}
+		}
+
+		GLuint elementbuffer;
+		Attrib attribs[32];
+	};
+	std::map<GLuint, VertexArray> vertexarrays;
+	GLuint vertexarray;
+	GLuint nextvertexarray;
+	VertexArray &current()
+	{
+		return vertexarrays[vertexarray];
+	}
+	GLenum activetexture;
+	GLuint textures[32];
+	std::map<std::pair<GLuint, GLint>, GLint> samplers;
+	std::map<std::pair<GLuint, GLint>, std::vector<float> > uniforms;
+	bool blend;
+	/**
+	 * Textures for which mipmaps were generated.
+	 */
+	std::vector<GLuint> mipmaps;
+	GLuint framebuffer;
+	unsigned int framebufferbinds;
+	unsigned int attachments;
+	unsigned int drawbuffers;
+	unsigned int validations;
+
+	/**
+	 * Batch which the next draw call is expected to draw.
+	 */
+	RenderBatch *expected;
+	unsigned int draws;
+	unsigned int errors;
+};
+static GLState gl;
+
+static void checkDraw()
+{
+	RenderBatch *batch = gl.expected;
+	PipelineState *state = batch->state;
+	GLState::VertexArray &vertexarray = gl.current();
+	unsigned int errors = 0;
+	if (gl.program != (GLuint)state->shader)
+		errors++;
+	if (vertexarray.elementbuffer != (GLuint)batch->indices)
+		errors++;
+	if (gl.blend != (state->blendMode != BlendMode::Solid))
+		errors++;
+	unsigned int attribmask = 0;
+	for (unsigned int i = 0; i < state->attribcount; i++)
+	{
+		AttribMapping &mapping = state->attribs[i];
+		GLState::Attrib &attrib = vertexarray.attribs[mapping.shaderhandle];
+		attribmask |= 1 << mapping.shaderhandle;
+		if (!attrib.enabled
+		 || attrib.buffer != (GLuint)batch->vertices
+		 || attrib.size != (GLint)mapping.components
+		 || attrib.stride != (GLsizei)mapping.stride
+		 || attrib.offset != mapping.address + batch->vertexoffset
+		 || attrib.divisor != 0)
+			errors++;
+	}
+	for (unsigned int i = 0; i < 32; i++)
+	{
+		if (vertexarray.attribs[i].enabled && !(attribmask & (1 << i)))
+			errors++;
+	}
+	for (unsigned int i = 0; i < batch->uniformcount; i++)
+	{
+		UniformMapping &uniform = batch->uniforms[i];
+		std::vector<float> &value = gl.uniforms[std::make_pair(gl.program,
+		                                                       uniform.shaderhandle)];
+		unsigned int size = ShaderVariableType::getSize(uniform.type);
+		if (value.size() != size
+		 || memcmp(&value[0], uniform.data, size * sizeof(float)))
+			errors++;
+	}
+	for (unsigned int i = 0; i < batch->texcount; i++)
+	{
+		TextureEntry &texture = batch->textures[i];
+		if (gl.textures[texture.textureindex] != (GLuint)texture.texhandle)
+			errors++;
+		std::pair<GLuint, GLint> sampler(gl.program, texture.shaderhandle);
+		if (gl.samplers.find(sampler) == gl.samplers.end()
+		 || gl.samplers[sampler] != texture.textureindex)
+			errors++;
+	}
+	if (errors)
+	{
+		std::cout << "Draw " << gl.draws << ": State does not match the batch."
+			<< std::endl;
+		gl.errors += errors;
+	}
+	gl.draws++;
+}
+
+static void GLAPIENTRY useProgram(GLuint program)
+{
+	gl.calls++;
+	gl.program = program;
+}
+static void GLAPIENTRY bindBuffer(GLenum target, GLuint buffer)
+{
+	gl.calls++;
+	if (target == GL_ARRAY_BUFFER)
+		gl.arraybuffer = buffer;
+	else
+		gl.current().elementbuffer = buffer;
+}
+static void GLAPIENTRY genVertexArrays(GLsizei n, GLuint *arrays)
+{
+	gl.calls++;
+	for (GLsizei i = 0; i < n; i++)
+	{
+		arrays[i] = gl.nextvertexarray++;
+		gl.vertexarrays[arrays[i]] = GLState::VertexArray();
+	}
+}
+static void GLAPIENTRY deleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+	gl.calls++;
+	for (GLsizei i = 0; i < n; i++)
+	{
+		if (gl.vertexarray == arrays[i])
+			gl.vertexarray = 0;
+		gl.vertexarrays.erase(arrays[i]);
+	}
+}
+static void GLAPIENTRY bindVertexArray(GLuint array)
+{
+	gl.calls++;
+	gl.vertexarray = array;
+}
+static void GLAPIENTRY bufferData(GLenum target, GLsizeiptr size,
+                                  const GLvoid *data, GLenum usage)
+{
+	gl.calls++;
+}
+static void GLAPIENTRY enableVertexAttribArray(GLuint index)
+{
+	gl.calls++;
+	gl.current().attribs[index].enabled = true;
+}
+static void GLAPIENTRY disableVertexAttribArray(GLuint index)
+{
+	gl.calls++;
+	gl.current().attribs[index].enabled = false;
+}
+static void GLAPIENTRY vertexAttribPointer(GLuint index, GLint size,
+                                           GLenum type, GLboolean normalized,
+                                           GLsizei stride,
+                                           const GLvoid *pointer)
+{
+	gl.calls++;
+	gl.pointercalls++;
+	GLState::Attrib &attrib = gl.current().attribs[index];
+	attrib.buffer = gl.arraybuffer;
+	attrib.size = size;
+	attrib.type = type;
+	attrib.stride = stride;
+	attrib.offset = (uintptr_t)pointer;
+}
+static void GLAPIENTRY vertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	gl.calls++;
+	gl.current().attribs[index].divisor = divisor;
+}
+static void GLAPIENTRY vertexAttrib4fv(GLuint index, const GLfloat *v)
+{
+	gl.calls++;
+}
+static void GLAPIENTRY uniform1i(GLint location, GLint v0)
+{
+	gl.calls++;
+	gl.samplers[std::make_pair(gl.program, location)] = v0;
+}
+template<unsigned int size> static void GLAPIENTRY uniformfv(GLint location,
+                                                             GLsizei count,
+                                                             const GLfloat *value)
+{
+	gl.calls++;
+	gl.uniforms[std::make_pair(gl.program, location)].assign(value,
+	                                                         value + size);
+}
+template<unsigned int size> static void GLAPIENTRY uniformMatrixfv(GLint location,
+                                                                   GLsizei count,
+                                                                   GLboolean transpose,
+                                                                   const GLfloat *value)
+{
+	gl.calls++;
+	gl.uniforms[std::make_pair(gl.program, location)].assign(value,
+	                                                         value + size);
+}
+static void GLAPIENTRY activeTexture(GLenum texture)
+{
+	gl.calls++;
+	gl.activetexture = texture - GL_TEXTURE0;
+}
+static void GLAPIENTRY bindTexture(GLenum target, GLuint texture)
+{
+	gl.calls++;
+	gl.textures[gl.activetexture] = texture;
+}
+static void GLAPIENTRY generateMipmap(GLenum target)
+{
+	gl.calls++;
+	gl.mipmaps.push_back(gl.textures[gl.activetexture]);
+}
+static void GLAPIENTRY viewport(GLint x, GLint y, GLsizei width,
+                               GLsizei height)
+{
+	gl.calls++;
+}
+static void GLAPIENTRY bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	gl.calls++;
+	gl.framebufferbinds++;
+	gl.framebuffer = framebuffer;
+}
+static void GLAPIENTRY framebufferTexture2D(GLenum target, GLenum attachment,
+                                           GLenum textarget, GLuint texture,
+                                           GLint level)
+{
+	gl.calls++;
+	gl.attachments++;
+}
+static void GLAPIENTRY framebufferRenderbuffer(GLenum target,
+                                              GLenum attachment,
+                                              GLenum renderbuffertarget,
+                                              GLuint renderbuffer)
+{
+	gl.calls++;
+	gl.attachments++;
+}
+static void GLAPIENTRY drawBuffers(GLsizei n, const GLenum *bufs)
+{
+	gl.calls++;
+	gl.drawbuffers++;
+}
+static GLenum GLAPIENTRY checkFramebufferStatus(GLenum target)
+{
+	gl.calls++;
+	gl.validations++;
+	return GL_FRAMEBUFFER_COMPLETE_EXT;
+}
+static void GLAPIENTRY enable(GLenum cap)
+{
+	gl.calls++;
+	if (cap == GL_BLEND)
+		gl.blend = true;
+}
+static void GLAPIENTRY disable(GLenum cap)
+{
+	gl.calls++;
+	if (cap == GL_BLEND)
+		gl.blend = false;
+}
+static void GLAPIENTRY blendFunc(GLenum sfactor, GLenum dfactor)
+{
+	gl.calls++;
+}
+static void GLAPIENTRY drawElements(GLenum mode, GLsizei count, GLenum type,
+                                    const GLvoid *indices)
+{
+	gl.calls++;
+	checkDraw();
+}
+static void GLAPIENTRY drawElementsInstanced(GLenum mode, GLsizei count,
+                                             GLenum type,
+                                             const GLvoid *indices,
+                                             GLsizei primcount)
+{
+	gl.calls++;
+	checkDraw();
+}
+
+static opengl::FunctionsOpenGL getStubs(bool vertexarrays)
+{
+	opengl::FunctionsOpenGL functions;
+	functions.useProgram = useProgram;
+	functions.bindBuffer = bindBuffer;
+	functions.genVertexArrays = vertexarrays ? genVertexArrays : 0;
+	functions.deleteVertexArrays = vertexarrays ? deleteVertexArrays : 0;
+	functions.bindVertexArray = vertexarrays ? bindVertexArray : 0;
+	functions.bufferData = bufferData;
+	functions.enableVertexAttribArray = enableVertexAttribArray;
+	functions.disableVertexAttribArray = disableVertexAttribArray;
+	functions.vertexAttribPointer = vertexAttribPointer;
+	functions.vertexAttribDivisor = vertexAttribDivisor;
+	functions.vertexAttrib4fv = vertexAttrib4fv;
+	functions.uniform1i = uniform1i;
+	functions.uniform1fv = uniformfv<1>;
+	functions.uniform2fv = uniformfv<2>;
+	functions.uniform3fv = uniformfv<3>;
+	functions.uniform4fv = uniformfv<4>;
+	functions.uniformMatrix3fv = uniformMatrixfv<9>;
+	functions.uniformMatrix4fv = uniformMatrixfv<16>;
+	functions.uniformMatrix4x3fv = uniformMatrixfv<12>;
+	functions.uniformMatrix3x4fv = uniformMatrixfv<12>;
+	functions.activeTexture = activeTexture;
+	functions.bindTexture = bindTexture;
+	functions.generateMipmap = generateMipmap;
+	functions.viewport = viewport;
+	functions.bindFramebuffer = bindFramebuffer;
+	functions.framebufferTexture2D = framebufferTexture2D;
+	functions.framebufferRenderbuffer = framebufferRenderbuffer;
+	functions.drawBuffers = drawBuffers;
+	functions.checkFramebufferStatus = checkFramebufferStatus;
+	functions.enable = enable;
+	functions.disable = disable;
+	functions.blendFunc = blendFunc;
+	functions.drawElements = drawElements;
+	functions.drawElementsInstanced = drawElementsInstanced;
+	return functions;
+}
+
+static void draw(opengl::VideoDriverOpenGL &driver, RenderBatch *batch)
+{
+	gl.expected = batch;
+	driver.draw(batch);
+}
+
+static unsigned int runBatches(bool vertexarrays)
+{
+	const char *name = vertexarrays ? "Vertex arrays" : "No vertex arrays";
+	unsigned int errors = 0;
+	gl = GLState();
+	opengl::VideoDriverOpenGL driver(0);
+	driver.getStateCache().setFunctions(getStubs(vertexarrays));
+	// Two materials with different shaders, attribs, textures and blending
+	AttribMapping attribs[2] = {
+		{ 0, 0, 20, 3, VertexElementType::Float },
+		{ 1, 12, 20, 2, VertexElementType::Float }
+	};
+	PipelineState state1 = { 1, BlendMode::Solid, attribs, 2, 0 };
+	PipelineState state2 = { 2, BlendMode::Additive, attribs, 1, 0 };
+	TextureEntry textures1[2] = {
+		{ 5, TextureType::Texture2D, 3, 0 },
+		{ 6, TextureType::Texture2D, 4, 1 }
+	};
+	TextureEntry textures2[1] = {
+		{ 7, TextureType::Texture2D, 2, 0 }
+	};
+	float matrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	UniformMapping uniforms[1] = {
+		{ 1, ShaderVariableType::Float4x4, matrix }
+	};
+	RenderBatch batch1;
+	memset(&batch1, 0, sizeof(batch1));
+	batch1.state = &state1;
+	batch1.vertices = 10;
+	batch1.indices = 11;
+	batch1.indextype = 2;
+	batch1.endindex = 3;
+	batch1.textures = textures1;
+	batch1.texcount = 2;
+	batch1.uniforms = uniforms;
+	batch1.uniformcount = 1;
+	RenderBatch batch2 = batch1;
+	batch2.state = &state2;
+	batch2.vertices = 12;
+	batch2.textures = textures2;
+	batch2.texcount = 1;
+	// Identical batches only need the draw call
+	draw(driver, &batch1);
+	unsigned int calls = gl.calls;
+	for (unsigned int i = 0; i < 99; i++)
+		draw(driver, &batch1);
+	unsigned int percall = (gl.calls - calls) / 99;
+	if (percall != 1)
+	{
+		std::cout << name << ": Identical batches: " << percall
+			<< " calls per batch (correct: 1)" << std::endl;
+		errors++;
+	}
+	if (driver.getStats().getSkippedUniformCount() != 99)
+	{
+		std::cout << name << ": Skipped uniforms: "
+			<< driver.getStats().getSkippedUniformCount() << " (correct: 99)"
+			<< std::endl;
+		errors++;
+	}
+	// Alternating materials, only the differences are applied
+	unsigned int pointercalls = gl.pointercalls;
+	for (unsigned int i = 0; i < 100; i++)
+	{
+		matrix[12] = (float)(i / 2);
+		draw(driver, &batch1);
+		draw(driver, &batch2);
+	}
+	// Vertex array objects keep the attribs of both batches
+	pointercalls = gl.pointercalls - pointercalls;
+	if (vertexarrays && pointercalls != 1)
+	{
+		std::cout << name << ": Attrib pointer calls: " << pointercalls
+			<< " (correct: 1)" << std::endl;
+		errors++;
+	}
+	// Relinked programs have to get all uniforms again
+	draw(driver, &batch1);
+	driver.getStateCache().removeProgram(1);
+	calls = gl.calls;
+	draw(driver, &batch1);
+	if (gl.calls - calls != 5)
+	{
+		std::cout << name << ": Relinked program: " << gl.calls - calls
+			<< " calls (correct: 5)" << std::endl;
+		errors++;
+	}
+	// Mipmaps of rendered textures are only generated once a batch uses them
+	driver.invalidateMipmaps(6);
+	driver.invalidateMipmaps(8);
+	draw(driver, &batch1);
+	draw(driver, &batch1);
+	if (gl.mipmaps.size() != 1 || gl.mipmaps[0] != 6)
+	{
+		std::cout << name << ": " << gl.mipmaps.size()
+			<< " mipmap generations (correct: 1, texture 6)" << std::endl;
+		errors++;
+	}
+	// Deleted textures are forgotten as their names are reused
+	driver.invalidateMipmaps(6);
+	driver.removeTexture(6);
+	driver.removeTexture(8);
+	draw(driver, &batch1);
+	if (gl.mipmaps.size() != 1)
+	{
+		std::cout << name << ": " << gl.mipmaps.size()
+			<< " mipmap generations after deleting the texture (correct: 1)"
+			<< std::endl;
+		errors++;
+	}
+	// Everything has to be set again after the end of the frame
+	driver.endFrame();
+	draw(driver, &batch2);
+	draw(driver, &batch1);
+	driver.endFrame();
+	// The counter of the driver has to match the calls made
+	unsigned int counted = driver.getStats().getAPICallCount();
+	if (counted != gl.calls)
+	{
+		std::cout << name << ": Call counter: " << counted << " (correct: "
+			<< gl.calls << ")" << std::endl;
+		errors++;
+	}
+	std::cout << name << ": " << gl.draws << " batches: " << gl.calls
+		<< " OpenGL calls" << std::endl;
+	// The vertex array objects are deleted with the pipeline states
+	driver.destroyPipelineState(&state1);
+	driver.destroyPipelineState(&state2);
+	if (gl.vertexarrays.size() != 1)
+	{
+		std::cout << name << ": " << gl.vertexarrays.size() - 1
+			<< " vertex arrays not deleted." << std::endl;
+		errors++;
+	}
+	errors += gl.errors;
+	return errors;
+}
+
+static unsigned int checkFramebuffer(const char *name,
+                                     unsigned int binds,
+                                     unsigned int attachments,
+                                     unsigned int drawbuffers,
+                                     unsigned int validations)
+{
+	unsigned int errors = 0;
+	if (gl.framebufferbinds != binds || gl.attachments != attachments
+	 || gl.drawbuffers != drawbuffers || gl.validations != validations)
+	{
+		std::cout << name << ": " << gl.framebufferbinds << " binds, "
+			<< gl.attachments << " attachments, " << gl.drawbuffers
+			<< " draw buffer changes, " << gl.validations
+			<< " validations (correct: " << binds << ", " << attachments
+			<< ", " << drawbuffers << ", " << validations << ")"
+			<< std::endl;
+		errors++;
+	}
+	gl.framebufferbinds = 0;
+	gl.attachments = 0;
+	gl.drawbuffers = 0;
+	gl.validations = 0;
+	return errors;
+}
+
+static unsigned int runRenderTargets()
+{
+	unsigned int errors = 0;
+	gl = GLState();
+	opengl::VideoDriverOpenGL driver(0);
+	driver.getStateCache().setFunctions(getStubs(true));
+	FrameBuffer::Configuration config;
+	config.handle = 3;
+	config.depthbuffer = 0;
+	config.defaultdepthbuffer = 4;
+	config.drawbuffers = 0xFFFFFFFF;
+	config.changed = true;
+	unsigned int colorbuffers[2] = { 5, 6 };
+	MipmapPolicy::List mipmaps[2] = {
+		MipmapPolicy::Disabled,
+		MipmapPolicy::Disabled
+	};
+	RenderTargetInfo target;
+	target.width = 256;
+	target.height = 256;
+	target.framebuffer = &config;
+	target.depthbuffer = 0;
+	target.colorbuffercount = 2;
+	target.colorbuffers = colorbuffers;
+	target.mipmaps = mipmaps;
+	// The first use attaches the textures and validates the framebuffer
+	driver.setRenderTarget(target);
+	driver.endFrame();
+	errors += checkFramebuffer("First use", 2, 2, 1, 1);
+	// Later frames only bind the framebuffer
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		driver.setRenderTarget(target);
+		driver.setRenderTarget(target);
+		driver.endFrame();
+	}
+	errors += checkFramebuffer("Unchanged", 20, 0, 0, 0);
+	// Changed attachments are validated again
+	target.colorbuffercount = 1;
+	target.depthbuffer = 7;
+	driver.setRenderTarget(target);
+	errors += checkFramebuffer("Changed attachments", 1, 2, 1, 1);
+	colorbuffers[0] = 8;
+	driver.setRenderTarget(target);
+	driver.endFrame();
+	errors += checkFramebuffer("Changed texture", 1, 1, 0, 1);
+	if (gl.framebuffer != 0)
+	{
+		std::cout << "Framebuffer still bound after the frame." << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	errors += runBatches(false);
+	errors += runBatches(true);
+	errors += runRenderTargets();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,105 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static unsigned int checkStats(GraphicsEngine &graphics,
+                               const char *name,
+                               unsigned int batches,
+                               unsigned int merged)
+{
+	unsigned int errors = 0;
+	const RenderStats &stats = graphics.getRenderStats();
+	if (stats.getBatchCount() != batches)
+	{
+		std::cout << name << ": Batch count: " << stats.getBatchCount()
+			<< " (correct: " << batches << ")" << std::endl;
+		errors++;
+	}
+	if (stats.getMergedBatchCount() != merged)
+	{
+		std::cout << name << ": Merged batch count: "
+			<< stats.getMergedBatchCount() << " (correct: " << merged << ")"
+			<< std::endl;
+		errors++;
+	}
+	if (stats.getPolygonCount() != 300)
+	{
+		std::cout << name << ": Polygon count: " << stats.getPolygonCount()
+			<< " (correct: 300)" << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		// Create a shader with one instanced and one normal context
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("INSTANCED", "VS", "FS", "", "", BlendMode::Solid,
+		                 "worldMat");
+		text->addContext("PLAIN", "VS", "FS");
+		text->addUniform("color", ShaderVariableType::Float3);
+		text->addUniform("worldMat", ShaderVariableType::Float4x4);
+		// Two materials which only differ in a uniform value
+		Material::Ptr red = rmgr->createResource<Material>("Material");
+		red->setShader(text);
+		red->getUniformData().add("color") = math::Vector3F(1, 0, 0);
+		Material::Ptr green = rmgr->createResource<Material>("Material");
+		green->setShader(text);
+		green->getUniformData().add("color") = math::Vector3F(0, 1, 0);
+		RenderJob job = createTriangleJob(rmgr);
+		RenderJob redjob = job;
+		redjob.material = red;
+		RenderJob greenjob = job;
+		greenjob.material = green;
+		TestRenderable renderable(redjob, 100);
+		renderable.addJobs(greenjob, 50);
+		renderable.translateJobs();
+		// Create pipeline
+		Pipeline::Ptr pipeline = new Pipeline();
+		RenderPass::Ptr instanced = new RenderPass("INSTANCED");
+		pipeline->addPass(instanced);
+		RenderPass::Ptr plain = new RenderPass("PLAIN");
+		pipeline->addPass(plain);
+		graphics.addPipeline(pipeline);
+		// The statistics always belong to the previous frame
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		// One instanced draw call per material plus 150 normal ones
+		errors += checkStats(graphics, "Submitted", 152, 148);
+		// Retained batches are merged as well
+		unsigned int handle = pipeline->registerRenderable(&renderable);
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			graphics.beginFrame();
+			graphics.endFrame();
+		}
+		errors += checkStats(graphics, "Retained", 152, 148);
+		pipeline->unregisterRenderable(handle);
+		// Every batch is drawn on its own without merging
+		instanced->setInstancing(false);
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		errors += checkStats(graphics, "Not merged", 300, 0);
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
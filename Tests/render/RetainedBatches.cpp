@@ -0,0 +1,118 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+/**
+ * Renderable which counts how often its batches were built.
+ */
+class CountingRenderable : public TestRenderable
+{
+	public:
+		CountingRenderable(const RenderJob &job, unsigned int count)
+			: TestRenderable(job, count), builds(0)
+		{
+		}
+
+		virtual unsigned int beginRendering()
+		{
+			builds++;
+			return TestRenderable::beginRendering();
+		}
+
+		unsigned int builds;
+};
+
+static void renderFrames(GraphicsEngine &graphics, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		graphics.beginFrame();
+		graphics.endFrame();
+	}
+}
+
+static unsigned int checkCount(const char *name,
+                               const char *counter,
+                               unsigned int value,
+                               unsigned int correct)
+{
+	if (value == correct)
+		return 0;
+	std::cout << name << ": " << counter << ": " << value << " (correct: "
+		<< correct << ")" << std::endl;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addTexture("tex");
+		Texture2D::Ptr texture = rmgr->createResource<Texture2D>("Texture2D");
+		texture->set(1, 1, TextureFormat::RGBA8);
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		material->addTexture("tex", texture);
+		RenderJob job = createTriangleJob(rmgr, material);
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		graphics.addPipeline(pipeline);
+		// The batches are built once and drawn in every frame
+		CountingRenderable first(job, 10);
+		unsigned int handle = pipeline->registerRenderable(&first);
+		renderFrames(graphics, 3);
+		errors += checkCount("Registered", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 10);
+		// The batches were rebuilt once more when the shader was uploaded
+		errors += checkCount("Registered", "Builds", first.builds, 2);
+		renderFrames(graphics, 3);
+		errors += checkCount("Unchanged", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 10);
+		errors += checkCount("Unchanged", "Builds", first.builds, 2);
+		// Explicit updates rebuild the batches once
+		pipeline->updateRenderable(handle);
+		renderFrames(graphics, 3);
+		errors += checkCount("Updated", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 10);
+		errors += checkCount("Updated", "Builds", first.builds, 3);
+		// Uploading the buffers or textures again rebuilds the batches
+		float vertices[9] = { 0, 0, 0, 2, 0, 0, 0, 2, 0 };
+		job.vertices->set(sizeof(vertices), vertices);
+		renderFrames(graphics, 3);
+		errors += checkCount("Vertex upload", "Builds", first.builds, 4);
+		texture->set(1, 1, TextureFormat::RGBA8);
+		renderFrames(graphics, 3);
+		errors += checkCount("Texture upload", "Builds", first.builds, 5);
+		errors += checkCount("Texture upload", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 10);
+		// Unregistered renderables are not drawn anymore
+		pipeline->unregisterRenderable(handle);
+		renderFrames(graphics, 3);
+		errors += checkCount("Unregistered", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 0);
+		errors += checkCount("Unregistered", "Builds", first.builds, 5);
+		// A reused handle does not keep any batches of the old renderable
+		CountingRenderable second(job, 5);
+		unsigned int reused = pipeline->registerRenderable(&second);
+		errors += checkCount("Reused", "Handle", reused, handle);
+		renderFrames(graphics, 3);
+		errors += checkCount("Reused", "Batch count",
+		                     graphics.getRenderStats().getBatchCount(), 5);
+		errors += checkCount("Reused", "Builds", second.builds, 1);
+		errors += checkCount("Reused", "Builds of the old renderable",
+		                     first.builds, 5);
+		pipeline->unregisterRenderable(reused);
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,158 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static ShaderText::Ptr createShader(res::ResourceManager *rmgr)
+{
+	ShaderText::Ptr text = createTestShader(rmgr);
+	text->addContext("AMBIENT", "VS", "FS");
+	text->addUniform("color", ShaderVariableType::Float3);
+	text->addTexture("tex");
+	return text;
+}
+
+static unsigned int checkCount(const char *name,
+                               const char *counter,
+                               unsigned int value,
+                               unsigned int correct)
+{
+	if (value == correct)
+		return 0;
+	std::cout << name << ": " << counter << ": " << value << " (correct: "
+		<< correct << ")" << std::endl;
+	return 1;
+}
+
+static unsigned int checkChanges(const char *name,
+                                 const StateChanges &changes,
+                                 unsigned int programs,
+                                 unsigned int textures,
+                                 unsigned int uniforms)
+{
+	unsigned int errors = 0;
+	errors += checkCount(name, "Program switches", changes.programs, programs);
+	errors += checkCount(name, "Texture binds", changes.textures, textures);
+	errors += checkCount(name, "Uniform uploads", changes.uniforms, uniforms);
+	errors += checkCount(name, "Buffer binds", changes.buffers, 2);
+	errors += checkCount(name, "Render target switches",
+	                     changes.rendertargets, 0);
+	errors += checkCount(name, "Draw calls", changes.draws, 100);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::NullAccounting, 800, 600, false, 0,
+	                   false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		ShaderText::Ptr shaders[2] = {
+			createShader(rmgr),
+			createShader(rmgr)
+		};
+		Texture2D::Ptr textures[2];
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			textures[i] = rmgr->createResource<Texture2D>("Texture2D");
+			textures[i]->set(1, 1, TextureFormat::RGBA8);
+		}
+		// Both shaders are used with both textures, every texture with its
+		// own color
+		Material::Ptr materials[4];
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			materials[i] = rmgr->createResource<Material>("Material");
+			materials[i]->setShader(shaders[i % 2]);
+			materials[i]->addTexture("tex", textures[i / 2]);
+			materials[i]->getUniformData().add("color")
+				= math::Vector3F((float)(i / 2), 0, 0);
+		}
+		TestRenderable renderable(createTriangleJob(rmgr), 100);
+		// Alternate between the materials
+		for (unsigned int i = 0; i < 100; i++)
+			renderable.getJobs()[i].material = materials[i % 4];
+		Pipeline::Ptr pipeline = new Pipeline();
+		RenderPass::Ptr pass = new RenderPass("AMBIENT");
+		pipeline->addPass(pass);
+		graphics.addPipeline(pipeline);
+		// Every batch switches the program, every second one the texture
+		pass->setSortMode(BatchSortMode::SubmissionOrder);
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		RenderStats unsorted = graphics.getRenderStats();
+		errors += checkChanges("Submission order", unsorted.getStateChanges(),
+		                       100, 50, 100);
+		errors += checkCount("Submission order", "Passes",
+		                     unsorted.getPassStateChanges().size(), 1);
+		// Sorting by state only needs one change per shader/texture pair
+		pass->setSortMode(BatchSortMode::State);
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		RenderStats sorted = graphics.getRenderStats();
+		errors += checkChanges("State order", sorted.getStateChanges(),
+		                       2, 4, 4);
+		// Every frame starts without bound state and the uniforms of both
+		// programs alternate, so the numbers do not change from frame to frame
+		graphics.beginFrame();
+		pipeline->submit(&renderable);
+		graphics.endFrame();
+		if (graphics.getRenderStats().getEstimatedCost() != sorted.getEstimatedCost())
+		{
+			std::cout << "Estimated cost changed between frames." << std::endl;
+			errors++;
+		}
+		if (sorted.getEstimatedCost() >= unsorted.getEstimatedCost())
+		{
+			std::cout << "Sorting did not reduce the estimated cost." << std::endl;
+			errors++;
+		}
+		// Custom weights
+		CostWeights weights;
+		weights.program = 1.0f;
+		weights.buffer = 0.0f;
+		weights.texture = 0.0f;
+		weights.uniform = 0.0f;
+		weights.rendertarget = 0.0f;
+		weights.draw = 0.0f;
+		if (sorted.getEstimatedCost(weights) != 2.0f)
+		{
+			std::cout << "Estimated cost with custom weights: "
+				<< sorted.getEstimatedCost(weights) << " (correct: 2)"
+				<< std::endl;
+			errors++;
+		}
+		// The programs keep their uniform values, so uniforms which do not
+		// change are not uploaded again in the next frame
+		for (unsigned int i = 0; i < 100; i++)
+			renderable.getJobs()[i].material = materials[0];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		errors += checkChanges("Constant uniforms",
+		                       graphics.getRenderStats().getStateChanges(),
+		                       1, 1, 0);
+		std::cout << "Estimated cost: " << unsorted.getEstimatedCost()
+			<< " (submission order), " << sorted.getEstimatedCost()
+			<< " (state order)" << std::endl;
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
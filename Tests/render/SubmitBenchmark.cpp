@@ -0,0 +1,149 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static const unsigned int jobcount = 10000;
+static const unsigned int framecount = 20;
+
+int main(int argc, char **argv)
+{
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	int errors = 0;
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		// Create a shader with a typical number of inputs
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addContext("LIGHT", "VS", "FS", "", "", BlendMode::Additive);
+		text->addAttrib("normal");
+		text->addAttrib("texcoord0");
+		text->addUniform("worldMat", ShaderVariableType::Float4x4);
+		text->addUniform("worldNormalMat", ShaderVariableType::Float4x4);
+		text->addUniform("lightPos", ShaderVariableType::Float3);
+		text->addUniform("lightColor", ShaderVariableType::Float3);
+		text->addUniform("ambient", ShaderVariableType::Float3);
+		text->addUniform("diffuse", ShaderVariableType::Float4);
+		text->addUniform("specular", ShaderVariableType::Float4);
+		text->addUniform("shininess", ShaderVariableType::Float);
+		text->addTexture("diffuseTex");
+		text->addTexture("normalTex");
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		material->getUniformData().add("diffuse") = math::Vector3F(1, 0, 0);
+		material->getUniformData().add("specular") = math::Vector3F(1, 1, 1);
+		material->getUniformData().add("shininess") = 20.0f;
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			Texture2D::Ptr texture = rmgr->createResource<Texture2D>("Texture2D");
+			texture->set(4, 4, TextureFormat::RGBA8);
+			material->addTexture(i == 0 ? "diffuseTex" : "normalTex", texture);
+		}
+		float vertices[24] = { 0 };
+		VertexBuffer::Ptr vertexbuffer = rmgr->createResource<VertexBuffer>("VertexBuffer");
+		vertexbuffer->set(sizeof(vertices), vertices);
+		unsigned short indices[3] = { 0, 1, 2 };
+		IndexBuffer::Ptr indexbuffer = rmgr->createResource<IndexBuffer>("IndexBuffer");
+		indexbuffer->set(sizeof(indices), indices);
+		VertexLayout::Ptr layout = new VertexLayout(3);
+		layout->setElement(0, "pos", 0, 3, 0, VertexElementType::Float, 32);
+		layout->setElement(1, "normal", 0, 3, 12, VertexElementType::Float, 32);
+		layout->setElement(2, "texcoord0", 0, 2, 24, VertexElementType::Float, 32);
+		RenderJob job;
+		job.vertices = vertexbuffer;
+		job.vertexcount = 3;
+		job.indices = indexbuffer;
+		job.endindex = 3;
+		job.material = material;
+		job.layout = layout;
+		TestRenderable renderable(job, jobcount);
+		renderable.translateJobs();
+		renderable.spreadDepth();
+		// Create pipeline
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		pipeline->addPass(new RenderPass("LIGHT"));
+		graphics.addPipeline(pipeline);
+		// The first frames create shaders and upload resources
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		// Measure the time spent in submit(), in the render thread and in the
+		// whole frame
+		int64_t submittime = 0;
+		int64_t rendertime = 0;
+		core::Time start = core::Time::Now();
+		for (unsigned int i = 0; i < framecount; i++)
+		{
+			graphics.beginFrame();
+			core::Time submitstart = core::Time::Now();
+			pipeline->submit(&renderable);
+			core::Time submitend = core::Time::Now();
+			submittime += (submitend - submitstart).getNanoseconds();
+			graphics.endFrame();
+			// The statistics belong to the previous frame
+			if (i > 0)
+				rendertime += graphics.getRenderStats().getRenderTime().getNanoseconds();
+		}
+		core::Time end = core::Time::Now();
+		int64_t frametime = (end - start).getNanoseconds();
+		std::cout << jobcount << " jobs, 2 passes, "
+			<< graphics.getRenderStats().getBatchCount() << " batches"
+			<< std::endl;
+		std::cout << "submit: " << submittime / framecount / jobcount
+			<< " ns/job" << std::endl;
+		std::cout << "render: " << rendertime / (framecount - 1) / 1000
+			<< " us/frame" << std::endl;
+		std::cout << "frame: " << frametime / framecount / 1000
+			<< " us/frame" << std::endl;
+		unsigned int batchcount = graphics.getRenderStats().getBatchCount();
+		std::cout << "command stream: "
+			<< graphics.getRenderStats().getCommandBytes() / batchcount
+			<< " bytes/batch" << std::endl;
+		// Measure the same scene with retained batches
+		unsigned int handle = pipeline->registerRenderable(&renderable);
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			graphics.beginFrame();
+			graphics.endFrame();
+		}
+		start = core::Time::Now();
+		for (unsigned int i = 0; i < framecount; i++)
+		{
+			graphics.beginFrame();
+			graphics.endFrame();
+		}
+		end = core::Time::Now();
+		frametime = (end - start).getNanoseconds();
+		std::cout << "retained frame: " << frametime / framecount / 1000
+			<< " us/frame" << std::endl;
+		// Rebuilding all batches every frame costs about as much as submit()
+		start = core::Time::Now();
+		for (unsigned int i = 0; i < framecount; i++)
+		{
+			graphics.beginFrame();
+			pipeline->updateRenderable(handle);
+			graphics.endFrame();
+		}
+		end = core::Time::Now();
+		frametime = (end - start).getNanoseconds();
+		std::cout << "retained frame (updated): "
+			<< frametime / framecount / 1000 << " us/frame" << std::endl;
+		if (graphics.getRenderStats().getBatchCount() != batchcount)
+		{
+			std::cout << "Retained batch count differs: "
+				<< graphics.getRenderStats().getBatchCount() << std::endl;
+			errors++;
+		}
+		pipeline->unregisterRenderable(handle);
+	}
+	graphics.shutdown();
+	return errors;
+}
@@ -0,0 +1,316 @@
+#include "TestScene.hpp"
+#include "render/CommandStream.hpp"
+#include "CoreRender/core/MemoryPool.hpp"
+
+#include <iostream>
+#include <cstring>
+
+static const unsigned int renderablecount = 64;
+static const unsigned int jobsperrenderable = 8;
+static const unsigned int batchcount = 512;
+static const unsigned int workercount = 4;
+/**
+ * Number of renderables or batches submitted by a single task.
+ */
+static const unsigned int grainsize = 4;
+
+/**
+ * Submits a range of renderables with their explicit submission index. The
+ * range is submitted backwards so that the insertion order differs from the
+ * serial submission even if only one thread executes the tasks.
+ */
+class SubmitTask : public core::Task
+{
+	public:
+		SubmitTask(Pipeline *pipeline, TestRenderable *renderables,
+		           unsigned int begin, unsigned int end)
+			: Task(true), pipeline(pipeline), renderables(renderables),
+			begin(begin), end(end)
+		{
+		}
+
+		virtual void run()
+		{
+			for (unsigned int i = end; i > begin; i--)
+				pipeline->submit(&renderables[i - 1], i - 1);
+		}
+	private:
+		Pipeline *pipeline;
+		TestRenderable *renderables;
+		unsigned int begin;
+		unsigned int end;
+};
+
+/**
+ * Inserts a range of batches into a render pass, backwards like SubmitTask.
+ */
+class InsertTask : public core::Task
+{
+	public:
+		InsertTask(RenderPass *pass, RenderBatch *batches,
+		           unsigned int begin, unsigned int end)
+			: Task(true), pass(pass), batches(batches), begin(begin), end(end)
+		{
+		}
+
+		virtual void run()
+		{
+			for (unsigned int i = end; i > begin; i--)
+				insertBatch(pass, batches, i - 1);
+		}
+
+		static void insertBatch(RenderPass *pass, RenderBatch *batches,
+		                        unsigned int index)
+		{
+			// Groups of batches share the same depth, so their order only
+			// depends on the sequence number
+			float depth = (float)((index / 16) % 4) * 0.25f;
+			pass->insert(&batches[index], depth, (uint64_t)index << 32);
+		}
+	private:
+		RenderPass *pass;
+		RenderBatch *batches;
+		unsigned int begin;
+		unsigned int end;
+};
+
+/**
+ * Copies a command stream into a single buffer, leaving out the jumps
+ * between the memory blocks, and returns the start index of every draw
+ * call.
+ */
+static void readCommands(const RenderPassInfo &info,
+                         std::vector<char> &commands,
+                         std::vector<unsigned int> &draws)
+{
+	const char *current = info.commands;
+	while (true)
+	{
+		const CommandHeader *header = (const CommandHeader*)current;
+		if (header->type == RenderCommand::End)
+			break;
+		if (header->type == RenderCommand::Jump)
+		{
+			memcpy(&current, header + 1, sizeof(char*));
+			continue;
+		}
+		if (header->type == RenderCommand::Draw)
+			draws.push_back(((const DrawCommand*)(header + 1))->startindex);
+		commands.insert(commands.end(), current, current + header->size);
+		current += header->size;
+	}
+}
+
+/**
+ * Submits the same renderables once serially and then several times from a
+ * parallel loop over Pipeline::submit() with explicit indices, and compares
+ * the captured frames.
+ */
+static unsigned int testPipeline(core::TaskScheduler *scheduler)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addContext("LIGHT", "VS", "FS", "", "", BlendMode::Additive);
+		text->addUniform("worldMat", ShaderVariableType::Float4x4);
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		RenderJob job = createTriangleJob(rmgr, material);
+		// All renderables use the same depths, so many batches only differ
+		// in their transformation and submission order
+		std::vector<TestRenderable> renderables(renderablecount);
+		for (unsigned int i = 0; i < renderablecount; i++)
+		{
+			renderables[i].addJobs(job, jobsperrenderable);
+			renderables[i].spreadDepth();
+			std::vector<RenderJob> &jobs = renderables[i].getJobs();
+			for (unsigned int j = 0; j < jobsperrenderable; j++)
+			{
+				jobs[j].uniforms.add("worldMat") = math::Matrix4::TransMat(
+					math::Vector3F((float)j, (float)i, 0));
+			}
+		}
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		pipeline->addPass(new RenderPass("LIGHT"));
+		graphics.addPipeline(pipeline);
+		// The first frames create shaders and upload resources
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			for (unsigned int j = 0; j < renderablecount; j++)
+				pipeline->submit(&renderables[j]);
+			graphics.endFrame();
+		}
+		// Capture one serial and three parallel frames
+		const char *paths[4] = {
+			"/SubmitDeterminismSerial.crf",
+			"/SubmitDeterminismParallel0.crf",
+			"/SubmitDeterminismParallel1.crf",
+			"/SubmitDeterminismParallel2.crf"
+		};
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			graphics.beginFrame();
+			if (i == 0)
+			{
+				for (unsigned int j = 0; j < renderablecount; j++)
+					pipeline->submit(&renderables[j]);
+			}
+			else
+			{
+				core::TaskGroup group;
+				for (unsigned int j = 0; j < renderablecount; j += grainsize)
+				{
+					scheduler->spawn(new SubmitTask(pipeline.get(),
+					                                &renderables[0], j,
+					                                j + grainsize),
+					                 &group);
+				}
+				scheduler->wait(&group);
+			}
+			if (i < 4)
+				graphics.captureFrame(paths[i]);
+			graphics.endFrame();
+		}
+		if (graphics.getRenderStats().getBatchCount()
+		    != 2 * renderablecount * jobsperrenderable)
+		{
+			std::cout << "Batch count: "
+				<< graphics.getRenderStats().getBatchCount() << " (correct: "
+				<< 2 * renderablecount * jobsperrenderable << ")" << std::endl;
+			errors++;
+		}
+		// The captures contain the command streams of both passes in the
+		// order in which the batches are drawn
+		std::vector<char> captures[4];
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			core::File::Ptr file = graphics.getFileSystem()->open(paths[i],
+			                                                      core::FileAccess::Read);
+			if (!file)
+			{
+				std::cout << "Could not open " << paths[i] << "." << std::endl;
+				errors++;
+				continue;
+			}
+			captures[i].resize(file->getSize());
+			if (captures[i].empty()
+			 || file->read(captures[i].size(), &captures[i][0])
+			    != (int)captures[i].size())
+			{
+				std::cout << "Could not read " << paths[i] << "." << std::endl;
+				errors++;
+			}
+		}
+		for (unsigned int i = 1; i < 4; i++)
+		{
+			if (captures[i] != captures[0])
+			{
+				std::cout << "Parallel frame " << i - 1
+					<< " differs from the serial frame." << std::endl;
+				errors++;
+			}
+		}
+	}
+	graphics.shutdown();
+	return errors;
+}
+
+/**
+ * Inserts the same batches into a render pass serially and in parallel and
+ * compares the sort keys, the draw order and the command streams.
+ */
+static unsigned int testRenderPass(core::TaskScheduler *scheduler)
+{
+	unsigned int errors = 0;
+	PipelineState states[2];
+	memset(states, 0, sizeof(states));
+	states[0].shader = 1;
+	states[0].blendMode = BlendMode::Solid;
+	states[1].shader = 2;
+	states[1].blendMode = BlendMode::Additive;
+	std::vector<RenderBatch> batches(batchcount);
+	memset(&batches[0], 0, sizeof(RenderBatch) * batchcount);
+	for (unsigned int i = 0; i < batchcount; i++)
+	{
+		batches[i].state = &states[i % 2];
+		batches[i].vertices = 1 + i % 3;
+		batches[i].indices = 1;
+		batches[i].startindex = i;
+		batches[i].endindex = i + 1;
+	}
+	RenderPass::Ptr pass = new RenderPass("AMBIENT");
+	core::MemoryPool memory;
+	std::vector<uint64_t> sortkeys[2];
+	std::vector<unsigned int> draws[2];
+	std::vector<char> commands[2];
+	for (unsigned int run = 0; run < 2; run++)
+	{
+		for (unsigned int i = 0; i < batchcount; i++)
+			batches[i].sortkey = 0;
+		memory.reset();
+		if (run == 0)
+		{
+			for (unsigned int i = 0; i < batchcount; i++)
+				InsertTask::insertBatch(pass.get(), &batches[0], i);
+		}
+		else
+		{
+			core::TaskGroup group;
+			for (unsigned int i = 0; i < batchcount; i += grainsize)
+			{
+				scheduler->spawn(new InsertTask(pass.get(), &batches[0], i,
+				                                i + grainsize),
+				                 &group);
+			}
+			scheduler->wait(&group);
+		}
+		RenderPassInfo info;
+		pass->prepare(&info, &memory, 0);
+		for (unsigned int i = 0; i < batchcount; i++)
+			sortkeys[run].push_back(batches[i].sortkey);
+		readCommands(info, commands[run], draws[run]);
+	}
+	if (sortkeys[0] != sortkeys[1])
+	{
+		std::cout << "Sort keys differ." << std::endl;
+		errors++;
+	}
+	if (draws[0].size() != batchcount || draws[0] != draws[1])
+	{
+		std::cout << "Batch order differs (" << draws[0].size() << "/"
+			<< draws[1].size() << " draw calls)." << std::endl;
+		errors++;
+	}
+	if (commands[0] != commands[1])
+	{
+		std::cout << "Command streams differ." << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	core::TaskScheduler scheduler;
+	if (!scheduler.start(workercount))
+	{
+		std::cout << "Could not start the task scheduler." << std::endl;
+		return 1;
+	}
+	errors += testPipeline(&scheduler);
+	errors += testRenderPass(&scheduler);
+	scheduler.stop();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
@@ -0,0 +1,107 @@
+#ifndef _CORERENDER_TESTS_RENDER_TESTSCENE_HPP_INCLUDED_
+#define _CORERENDER_TESTS_RENDER_TESTSCENE_HPP_INCLUDED_
+
+#include "CoreRender.hpp"
+
+#include <vector>
+
+using namespace cr;
+using namespace render;
+
+/**
+ * Renderable which draws a fixed list of render jobs.
+ */
+class TestRenderable : public Renderable
+{
+	public:
+		TestRenderable()
+		{
+		}
+		TestRenderable(const RenderJob &job, unsigned int count = 1)
+		{
+			addJobs(job, count);
+		}
+
+		/**
+		 * Appends count copies of a job.
+		 */
+		void addJobs(const RenderJob &job, unsigned int count)
+		{
+			jobs.resize(jobs.size() + count, job);
+		}
+		/**
+		 * Moves every job along the x axis by its index via the "worldMat"
+		 * uniform so that the jobs differ in their uniforms.
+		 */
+		void translateJobs()
+		{
+			for (unsigned int i = 0; i < jobs.size(); i++)
+			{
+				jobs[i].uniforms.add("worldMat")
+					= math::Matrix4::TransMat(math::Vector3F((float)i, 0, 0));
+			}
+		}
+		/**
+		 * Spreads the depth of the jobs evenly between 0 and 1.
+		 */
+		void spreadDepth()
+		{
+			for (unsigned int i = 0; i < jobs.size(); i++)
+				jobs[i].depth = (float)i / jobs.size();
+		}
+		std::vector<RenderJob> &getJobs()
+		{
+			return jobs;
+		}
+
+		virtual unsigned int beginRendering()
+		{
+			return jobs.size();
+		}
+		virtual RenderJob *getJob(unsigned int index)
+		{
+			return &jobs[index];
+		}
+	private:
+		std::vector<RenderJob> jobs;
+};
+
+/**
+ * Creates a shader with empty shader sources "VS" and "FS" and a single
+ * "pos" attribute. The tests add their own contexts, uniforms and textures.
+ */
+inline ShaderText::Ptr createTestShader(res::ResourceManager *rmgr)
+{
+	ShaderText::Ptr text = rmgr->createResource<ShaderText>("ShaderText");
+	text->addText("VS", "void main() {}");
+	text->addText("FS", "void main() {}");
+	text->addAttrib("pos");
+	return text;
+}
+
+/**
+ * Creates a render job which draws a single triangle with a "pos" attribute.
+ * The vertex buffer contains 36 bytes, the index buffer 6 bytes.
+ */
+inline RenderJob createTriangleJob(res::ResourceManager *rmgr,
+                                   Material::Ptr material = 0)
+{
+	float vertices[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+	VertexBuffer::Ptr vertexbuffer = rmgr->createResource<VertexBuffer>("VertexBuffer");
+	vertexbuffer->set(sizeof(vertices), vertices);
+	unsigned short indices[3] = { 0, 1, 2 };
+	IndexBuffer::Ptr indexbuffer = rmgr->createResource<IndexBuffer>("IndexBuffer");
+	indexbuffer->set(sizeof(indices), indices);
+	VertexLayout::Ptr layout = new VertexLayout(1);
+	layout->setElement(0, "pos", 0, 3, 0, VertexElementType::Float, 12);
+	RenderJob job;
+	job.vertices = vertexbuffer;
+	job.vertexcount = 3;
+	job.indices = indexbuffer;
+	job.endindex = 3;
+	job.layout = layout;
+	job.material = material;
+	return job;
+}
+
+#endif
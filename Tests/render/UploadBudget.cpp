@@ -0,0 +1,106 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static unsigned int checkUploads(const char *name,
+                                 const RenderStats &stats,
+                                 unsigned int uploads,
+                                 unsigned int bytes,
+                                 unsigned int queued,
+                                 unsigned int queuedbytes)
+{
+	if (stats.getUploadCount() == uploads
+	 && stats.getUploadBytes() == bytes
+	 && stats.getQueuedUploadCount() == queued
+	 && stats.getQueuedUploadBytes() == queuedbytes)
+		return 0;
+	std::cout << name << ": " << stats.getUploadCount() << " uploads, "
+		<< stats.getUploadBytes() << " bytes, " << stats.getQueuedUploadCount()
+		<< " queued, " << stats.getQueuedUploadBytes() << " bytes (correct: "
+		<< uploads << " uploads, " << bytes << " bytes, " << queued
+		<< " queued, " << queuedbytes << " bytes)" << std::endl;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		// Ten textures with 1024 bytes each
+		Texture2D::Ptr textures[10];
+		for (unsigned int i = 0; i < 10; i++)
+		{
+			textures[i] = rmgr->createResource<Texture2D>("Texture2D");
+			textures[i]->set(16, 16, TextureFormat::RGBA8);
+		}
+		RenderJob job = createTriangleJob(rmgr);
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addTexture("tex");
+		// The material uses the texture which was queued last
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		material->addTexture("tex", textures[9]);
+		job.material = material;
+		TestRenderable renderable(job);
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		graphics.addPipeline(pipeline);
+
+		graphics.setUploadBudget(4096);
+		// The used resources are uploaded first, the budget only allows two
+		// more textures
+		graphics.beginFrame();
+		pipeline->submit(&renderable);
+		graphics.endFrame();
+		// The statistics always belong to the previous frame
+		graphics.beginFrame();
+		graphics.endFrame();
+		RenderStats stats = graphics.getRenderStats();
+		errors += checkUploads("Used resources", stats,
+		                       5, 3 * 1024 + 36 + 6, 7, 7 * 1024);
+		if (stats.getMaxUploadLatency().getNanoseconds() <= 0)
+		{
+			std::cout << "Upload latency was not measured." << std::endl;
+			errors++;
+		}
+		// The rest is spread over the following frames
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkUploads("Byte budget", graphics.getRenderStats(),
+		                       4, 4 * 1024, 3, 3 * 1024);
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkUploads("Last deferred uploads",
+		                       graphics.getRenderStats(), 3, 3 * 1024, 0, 0);
+		// Every frame uploads at least one resource, even if the time budget
+		// is too small for that
+		graphics.setUploadBudget(0, core::Duration::Nanoseconds(1));
+		for (unsigned int i = 0; i < 10; i++)
+			textures[i]->set(16, 16, TextureFormat::RGBA8);
+		graphics.beginFrame();
+		graphics.endFrame();
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkUploads("Time budget", graphics.getRenderStats(),
+		                       1, 1024, 9, 9 * 1024);
+		// Without budget, the whole queue is uploaded at once
+		graphics.setUploadBudget(0, core::Duration::Nanoseconds(0));
+		graphics.beginFrame();
+		graphics.endFrame();
+		graphics.beginFrame();
+		graphics.endFrame();
+		errors += checkUploads("No budget", graphics.getRenderStats(),
+		                       8, 8 * 1024, 0, 0);
+	}
+	graphics.shutdown();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
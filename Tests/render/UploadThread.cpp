@@ -0,0 +1,125 @@
+#include "TestScene.hpp"
+
+#include <iostream>
+
+static unsigned int testSingleThreaded()
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, false, 1,
+	                   true))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		Texture2D::Ptr texture = rmgr->createResource<Texture2D>("Texture2D");
+		texture->set(16, 16, TextureFormat::RGBA8);
+		graphics.beginFrame();
+		// The main thread also renders, so only the upload thread can have
+		// uploaded the texture here
+		texture->waitForUpload();
+		graphics.endFrame();
+		graphics.beginFrame();
+		graphics.endFrame();
+		const RenderStats &stats = graphics.getRenderStats();
+		if (stats.getUploadCount() != 1 || stats.getUploadBytes() != 1024)
+		{
+			std::cout << "Handed over " << stats.getUploadCount()
+				<< " uploads with " << stats.getUploadBytes()
+				<< " bytes (correct: 1 upload with 1024 bytes)" << std::endl;
+			errors++;
+		}
+	}
+	graphics.shutdown();
+	return errors;
+}
+
+static unsigned int testMultithreaded()
+{
+	unsigned int errors = 0;
+	GraphicsEngine graphics;
+	if (!graphics.init(VideoDriverType::Null, 800, 600, false, 0, true, 2,
+	                   true))
+	{
+		std::cout << "Graphics engine failed to initialize!" << std::endl;
+		return 1;
+	}
+	{
+		res::ResourceManager *rmgr = graphics.getResourceManager();
+		Texture2D::Ptr textures[8];
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			textures[i] = rmgr->createResource<Texture2D>("Texture2D");
+			textures[i]->set(64, 64, TextureFormat::RGBA8);
+		}
+		RenderJob job = createTriangleJob(rmgr);
+		ShaderText::Ptr text = createTestShader(rmgr);
+		text->addContext("AMBIENT", "VS", "FS");
+		text->addTexture("tex");
+		Material::Ptr material = rmgr->createResource<Material>("Material");
+		material->setShader(text);
+		material->addTexture("tex", textures[0]);
+		job.material = material;
+		TestRenderable renderable(job);
+		Pipeline::Ptr pipeline = new Pipeline();
+		pipeline->addPass(new RenderPass("AMBIENT"));
+		graphics.addPipeline(pipeline);
+		// The render thread has to wait for the used texture while the other
+		// ones are uploaded in the background
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			graphics.beginFrame();
+			textures[0]->waitForUpload();
+			textures[0]->set(64, 64, TextureFormat::RGBA8);
+			textures[1 + i % 7]->set(64, 64, TextureFormat::RGBA8);
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			textures[i]->waitForUpload();
+			if (textures[i]->getHandle() == 0
+			 || textures[i]->getWidth() != 64 || textures[i]->getHeight() != 64
+			 || textures[i]->getMemorySize() != 64 * 64 * 4)
+			{
+				std::cout << "Texture " << i << ": handle "
+					<< textures[i]->getHandle() << ", "
+					<< textures[i]->getWidth() << "x"
+					<< textures[i]->getHeight() << ", "
+					<< textures[i]->getMemorySize()
+					<< " bytes (correct: 64x64, 16384 bytes)" << std::endl;
+				errors++;
+			}
+		}
+		// Without new uploads, the queue of the upload thread is empty once
+		// the statistics have caught up with the frames in flight
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			graphics.beginFrame();
+			pipeline->submit(&renderable);
+			graphics.endFrame();
+		}
+		const RenderStats &stats = graphics.getRenderStats();
+		if (stats.getQueuedUploadCount() != 0
+		 || stats.getQueuedUploadBytes() != 0)
+		{
+			std::cout << "Upload queue not drained: "
+				<< stats.getQueuedUploadCount() << " uploads with "
+				<< stats.getQueuedUploadBytes() << " bytes" << std::endl;
+			errors++;
+		}
+	}
+	graphics.shutdown();
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int errors = 0;
+	errors += testSingleThreaded();
+	errors += testMultithreaded();
+	std::cout << errors << " errors." << std::endl;
+	return errors;
+}
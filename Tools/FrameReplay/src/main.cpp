@@ -0,0 +1,180 @@
+
+#include "CoreRender.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace cr;
+using namespace render;
+
+static void printUsage()
+{
+	std::cout << "Usage: FrameReplay <capture> [iterations] [null|opengl]"
+		<< std::endl;
+	std::cout << "Paths are relative to the current directory." << std::endl;
+}
+
+/**
+ * Creates zero-filled stand-ins for the buffers and textures of the capture
+ * so that the frame can be drawn with a real driver.
+ */
+static void createStandIns(GraphicsEngine &graphics,
+                           FrameCapture::Ptr capture,
+                           std::vector<res::Resource::Ptr> &standins)
+{
+	res::ResourceManager *rmgr = graphics.getResourceManager();
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < capture->getResourceCount(); i++)
+	{
+		const FrameCaptureFile::Resource &resource = capture->getResource(i);
+		unsigned int size = resource.size > 4 ? resource.size : 4;
+		switch (resource.type)
+		{
+			case FrameCaptureFile::ResourceType::VertexBuffer:
+			{
+				VertexBuffer::Ptr buffer = rmgr->createResource<VertexBuffer>("VertexBuffer");
+				buffer->set(size, calloc(size, 1), VertexBufferUsage::Static, false);
+				standins.push_back(buffer);
+				indices.push_back(i);
+				break;
+			}
+			case FrameCaptureFile::ResourceType::IndexBuffer:
+			{
+				IndexBuffer::Ptr buffer = rmgr->createResource<IndexBuffer>("IndexBuffer");
+				buffer->set(size, calloc(size, 1), false);
+				standins.push_back(buffer);
+				indices.push_back(i);
+				break;
+			}
+			case FrameCaptureFile::ResourceType::Texture:
+			{
+				Texture2D::Ptr texture = rmgr->createResource<Texture2D>("Texture2D");
+				texture->set(1, 1, TextureFormat::RGBA8);
+				standins.push_back(texture);
+				indices.push_back(i);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	// Upload the resources to get valid handles
+	graphics.beginFrame();
+	graphics.endFrame();
+	for (unsigned int i = 0; i < standins.size(); i++)
+	{
+		const FrameCaptureFile::Resource &resource = capture->getResource(indices[i]);
+		int handle = 0;
+		switch (resource.type)
+		{
+			case FrameCaptureFile::ResourceType::VertexBuffer:
+				handle = ((VertexBuffer*)standins[i].get())->getHandle();
+				break;
+			case FrameCaptureFile::ResourceType::IndexBuffer:
+				handle = ((IndexBuffer*)standins[i].get())->getHandle();
+				break;
+			case FrameCaptureFile::ResourceType::Texture:
+				handle = ((Texture2D*)standins[i].get())->getHandle();
+				break;
+		}
+		capture->setResourceHandle(indices[i], handle);
+	}
+	std::cout << "Warning: Shaders cannot be recreated from a capture, "
+		"timings do not include shader execution." << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return -1;
+	}
+	unsigned int iterations = 100;
+	if (argc >= 3)
+		iterations = atoi(argv[2]);
+	VideoDriverType::List type = VideoDriverType::Null;
+	if (argc >= 4)
+	{
+		if (!strcmp(argv[3], "opengl"))
+			type = VideoDriverType::OpenGL;
+		else if (strcmp(argv[3], "null"))
+		{
+			printUsage();
+			return -1;
+		}
+	}
+	if (iterations == 0)
+	{
+		printUsage();
+		return -1;
+	}
+	// Load the capture
+	core::StandardFileSystem::Ptr fs = new core::StandardFileSystem();
+	fs->mount("", "/");
+	std::string path = argv[1];
+	if (path[0] != '/')
+		path = "/" + path;
+	core::File::Ptr file = fs->open(path, core::FileAccess::Read);
+	if (!file)
+	{
+		std::cerr << "Could not open " << argv[1] << "." << std::endl;
+		return -1;
+	}
+	FrameCapture::Ptr capture = new FrameCapture();
+	if (!capture->load(file))
+	{
+		std::cerr << argv[1] << " is no valid frame capture." << std::endl;
+		return -1;
+	}
+	file = 0;
+	// Replay the frame in the calling thread
+	GraphicsEngine graphics;
+	graphics.setFileSystem(fs);
+	if (!graphics.init(type, capture->getWidth(), capture->getHeight(),
+	                   false, 0, false))
+	{
+		std::cerr << "Graphics engine failed to initialize!" << std::endl;
+		return -1;
+	}
+	int result = 0;
+	{
+		std::vector<res::Resource::Ptr> standins;
+		if (type != VideoDriverType::Null)
+			createStandIns(graphics, capture, standins);
+		std::vector<core::Duration> passtimes;
+		std::vector<int64_t> totals(capture->getPassCount(), 0);
+		// The first replay uploads the stand-ins and warms up the caches
+		graphics.replayFrame(capture);
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			passtimes.clear();
+			if (!graphics.replayFrame(capture, &passtimes))
+			{
+				result = -1;
+				break;
+			}
+			for (unsigned int j = 0; j < passtimes.size(); j++)
+				totals[j] += passtimes[j].getNanoseconds();
+		}
+		// Report per-pass timings
+		int64_t total = 0;
+		for (unsigned int i = 0; i < capture->getPassCount() && result == 0; i++)
+		{
+			const FrameCaptureFile::Pass &pass = capture->getPass(i);
+			std::cout << "pass " << i << ": " << pass.batchcount << " batches, "
+				<< pass.commandsize << " bytes, "
+				<< totals[i] / iterations / 1000 << " us" << std::endl;
+			total += totals[i];
+		}
+		if (result == 0)
+		{
+			std::cout << "frame: " << graphics.getRenderStats().getBatchCount()
+				<< " draw calls, " << total / iterations / 1000 << " us ("
+				<< iterations << " iterations)" << std::endl;
+		}
+	}
+	graphics.shutdown();
+	return result;
+}
@@ -59,9 +59,10 @@ int main(int argc, char **argv)
 	pipeline->addPass(pass);
 	graphics.addPipeline(pipeline);
 	// Setup camera matrix
+	cr::math::Matrix4 viewmat = cr::math::Matrix4::TransMat(cr::math::Vector3F(0, 0, -100));
+	viewmat = viewmat * cr::math::Quaternion(cr::math::Vector3F(45.0, 0.0, 0.0)).toMatrix();
 	cr::math::Matrix4 projmat = cr::math::Matrix4::PerspectiveFOV(60.0f, 4.0f/3.0f, 1.0f, 1000.0f);
-	projmat = projmat * cr::math::Matrix4::TransMat(cr::math::Vector3F(0, 0, -100));
-	projmat = projmat * cr::math::Quaternion(cr::math::Vector3F(45.0, 0.0, 0.0)).toMatrix();
+	projmat = projmat * viewmat;
 	// Wait for resources to be loaded
 	model->waitForLoading(true);
 	anim->waitForLoading(true);
@@ -69,6 +70,7 @@ int main(int argc, char **argv)
 	cr::render::ModelRenderable *renderable = new cr::render::ModelRenderable();
 	renderable->setModel(model);
 	renderable->setProjMat(projmat);
+	renderable->setViewMat(viewmat);
 	renderable->setTransMat(cr::math::Quaternion(cr::math::Vector3F(0.0, 45.0, 0.0)).toMatrix());
 	renderable->addAnimStage(anim, 1.0);
 	// Finished loading